@@ -1,5 +1,16 @@
-#include "stdafx.h"
 #include "Algorithm/AlgorithmBase.h"
+#include <algorithm>
 
-// CAlgorithmBase is a pure virtual class.
-// No implementation needed, but this file is required for the project build.
+void CRowProgress::Report(long long nDone)
+{
+    // Whole percents only; a thread that finds the sink busy leaves the report to the next row
+    const int nPermille = (int)(std::min(nDone, m_nTotal) * 100 / m_nTotal) * 10;
+    if (nPermille <= m_nReported.load(std::memory_order_relaxed) || m_busy.test_and_set(std::memory_order_acquire))
+        return;
+    if (nPermille > m_nReported.load(std::memory_order_relaxed))
+    {
+        m_nReported.store(nPermille, std::memory_order_relaxed);
+        m_pSink->OnProgress(nPermille);
+    }
+    m_busy.clear(std::memory_order_release);
+}
@@ -1,25 +1,128 @@
 #pragma once
-#include "stdafx.h"
 #include "Core/ImageBuffer.h"
+#include <atomic>
+#include <string>
 #include <vector>
 
 struct AlgorithmParam {
-    CString strName;
-    CString strDescription;
+    std::wstring strName;
+    std::wstring strDescription;
     double dMinVal;
     double dMaxVal;
     double dDefaultVal;
     double dCurrentVal;
     int nPrecision;                   // 0 for integer params
-    std::vector<CString> vecOptions;  // 비어있으면 슬라이더, 있으면 콤보박스
+    std::vector<std::wstring> vecOptions;  // 비어있으면 슬라이더, 있으면 콤보박스
+};
+
+// Per-sample description of a pointwise 8-bit step, see CAlgorithmBase::GetPointwiseMap().
+// A reducing step turns a pixel of 3+ channels into one sample,
+// gray = (weights[0] * c0 + weights[1] * c1 + weights[2] * c2) >> 8 with the weights summing to
+// 256 at most, and takes a 1-channel pixel as it is. lut then maps every remaining sample.
+struct PointwiseMap {
+    bool bReduce;
+    int  weights[3];
+    BYTE lut[256];
+};
+
+// Receives how far a running Process() has got, in per mille of its work. Calls never overlap
+// but may come from any of the kernel's threads, so implementations must not assume one.
+class IProgressSink {
+public:
+    virtual ~IProgressSink() {}
+    virtual void OnProgress(int nPermille) = 0;
+};
+
+// What a running Process() polls: a flag another thread sets to cancel it, and where its
+// progress goes. Neither is owned; both may be null.
+struct ProcessControl {
+    const std::atomic<bool>* pCancel   = nullptr;
+    IProgressSink*           pProgress = nullptr;
 };
 
 class CAlgorithmBase {
 public:
     virtual ~CAlgorithmBase() {}
-    virtual CString GetName() const = 0;
-    virtual CString GetDescription() const = 0;
+
+    // Cooperative cancellation and progress for the following Process()/ProcessView() calls.
+    // Kernels poll the flag once per row (or block of rows) and fail once it is set, so a stop
+    // takes effect within a few rows instead of after the whole frame. Clones copy the control.
+    void SetProcessControl(const ProcessControl& control) { m_control = control; }
+    const ProcessControl& GetProcessControl() const { return m_control; }
+    bool IsCancelled() const { return m_control.pCancel && m_control.pCancel->load(std::memory_order_relaxed); }
+
+    virtual std::wstring GetName() const = 0;
+    virtual std::wstring GetDescription() const = 0;
     virtual std::vector<AlgorithmParam>& GetParams() = 0;
     virtual bool Process(const CImageBuffer& input, CImageBuffer& output) = 0;
     virtual CAlgorithmBase* Clone() const = 0;
+
+    // Zero-copy path used for ROIs: process 'input' into 'output' in place inside their parent
+    // buffers. Both views have the same size and channel count and never overlap; kernels may
+    // read input's halo. Only called when SupportsViews() returns true.
+    virtual bool SupportsViews() const { return false; }
+    virtual bool ProcessView(const ConstImageView& input, const ImageView& output) { return false; }
+
+    // Sample depths Process()/ProcessView() accept; the output has the input's depth unless the
+    // algorithm says otherwise. The sequence converts other inputs to U8 before calling.
+    virtual bool SupportsDepth(PixelDepth depth) const { return depth == PixelDepth::U8; }
+
+    // True when the kernels work per channel and run faster on planar input (one plane per
+    // channel, unit-stride rows). The sequence then hands multi-channel frames over planar,
+    // converting only where a run of such steps begins and ends; the output keeps the input's
+    // layout. Algorithms that return false only ever see interleaved frames.
+    virtual bool PrefersPlanar() const { return false; }
+
+    // How far (in pixels) an output pixel reads around its own position with the current
+    // parameters: 0 for pointwise operations, -1 when the result depends on the whole frame
+    // (global histograms, hysteresis, voting). Tiled execution requires >= 0 from every step.
+    virtual int GetNeighbourhoodRadius() const { return -1; }
+
+    // Fills 'map' when the step, with its current parameters, is a fixed per-sample mapping of
+    // 8-bit input (optionally reducing to one channel); Process() on a U8 frame of 1 or 3+
+    // channels must then equal applying the map. The sequence fuses runs of such steps into a
+    // single pass (CPointwiseChain). Steps that depend on more than the sample return false.
+    virtual bool GetPointwiseMap(PointwiseMap& map) const { return false; }
+
+protected:
+    ProcessControl m_control;
+};
+
+// Cancellation and progress of one Process() call, for its kernels: every row loop checks
+// IsCancelled() at the top of an iteration (skipping the row once it is set) and calls Add()
+// when the row is done; the kernel then returns !IsCancelled(). Rows are counted across
+// threads and passed on to the sink whenever another percent is complete. nTotalRows covers
+// every pass and plane of the call.
+class CRowProgress {
+public:
+    CRowProgress(const CAlgorithmBase& alg, long long nTotalRows)
+        : m_pCancel(alg.GetProcessControl().pCancel)
+        , m_pSink(alg.GetProcessControl().pProgress)
+        , m_nTotal(nTotalRows > 0 ? nTotalRows : 1)
+        , m_nDone(0)
+        , m_nReported(0)
+    {
+        m_busy.clear();
+    }
+
+    bool IsCancelled() const { return m_pCancel && m_pCancel->load(std::memory_order_relaxed); }
+
+    void Add(long long nRows = 1)
+    {
+        if (m_pSink)
+            Report(m_nDone.fetch_add(nRows, std::memory_order_relaxed) + nRows);
+    }
+
+private:
+    CRowProgress(const CRowProgress&) = delete;
+    CRowProgress& operator=(const CRowProgress&) = delete;
+
+    void Report(long long nDone);
+
+    const std::atomic<bool>* m_pCancel;
+    IProgressSink*           m_pSink;
+    long long                m_nTotal;
+    std::atomic<long long>   m_nDone;
+    std::atomic<int>         m_nReported;   // per mille last passed on
+    std::atomic_flag         m_busy;        // held while the sink is called
 };
@@ -1,4 +1,3 @@
-#include "stdafx.h"
 #include "Algorithm/AlgorithmManager.h"
 #include "Algorithm/Grayscale.h"
 #include "Algorithm/Binarize.h"
@@ -57,10 +56,10 @@ int CAlgorithmManager::GetAlgorithmCount() const
     return (int)m_prototypes.size();
 }
 
-CString CAlgorithmManager::GetAlgorithmName(int index) const
+std::wstring CAlgorithmManager::GetAlgorithmName(int index) const
 {
     if (index < 0 || index >= (int)m_prototypes.size())
-        return _T("");
+        return L"";
 
     return m_prototypes[index]->GetName();
 }
@@ -73,7 +72,7 @@ CAlgorithmBase* CAlgorithmManager::CreateAlgorithm(int index) const
     return m_prototypes[index]->Clone();
 }
 
-CAlgorithmBase* CAlgorithmManager::CreateAlgorithm(const CString& name) const
+CAlgorithmBase* CAlgorithmManager::CreateAlgorithm(const std::wstring& name) const
 {
     for (size_t i = 0; i < m_prototypes.size(); i++)
     {
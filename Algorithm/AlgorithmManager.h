@@ -1,5 +1,4 @@
 #pragma once
-#include "stdafx.h"
 #include "Algorithm/AlgorithmBase.h"
 #include <vector>
 
@@ -8,9 +7,9 @@ public:
     static CAlgorithmManager& GetInstance();
     void RegisterAlgorithms();
     int GetAlgorithmCount() const;
-    CString GetAlgorithmName(int index) const;
+    std::wstring GetAlgorithmName(int index) const;
     CAlgorithmBase* CreateAlgorithm(int index) const;
-    CAlgorithmBase* CreateAlgorithm(const CString& name) const;
+    CAlgorithmBase* CreateAlgorithm(const std::wstring& name) const;
     ~CAlgorithmManager();
 
 private:
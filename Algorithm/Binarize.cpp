@@ -1,5 +1,5 @@
-#include "stdafx.h"
 #include "Algorithm/Binarize.h"
+#include "Core/Profiler.h"
 #include <cmath>
 #include <vector>
 #include <algorithm>
@@ -14,20 +14,20 @@
 CBinarize::CBinarize()
 {
     AlgorithmParam paramMethod;
-    paramMethod.strName        = _T("방식");
-    paramMethod.strDescription = _T("이진화 방식을 선택하세요");
+    paramMethod.strName        = L"방식";
+    paramMethod.strDescription = L"이진화 방식을 선택하세요";
     paramMethod.dMinVal        = 0.0;
     paramMethod.dMaxVal        = 4.0;
     paramMethod.dDefaultVal    = 0.0;
     paramMethod.dCurrentVal    = 0.0;
     paramMethod.nPrecision     = 0;
-    paramMethod.vecOptions     = { _T("표준"), _T("반전"), _T("이중 임계값"),
-                                    _T("적응형"), _T("오츠(자동)") };
+    paramMethod.vecOptions     = { L"표준", L"반전", L"이중 임계값",
+                                    L"적응형", L"오츠(자동)" };
     m_params.push_back(paramMethod);
 
     AlgorithmParam paramThreshold;
-    paramThreshold.strName        = _T("낮은 임계값");
-    paramThreshold.strDescription = _T("픽셀을 흑/백으로 나누는 기준값 (0~255)");
+    paramThreshold.strName        = L"낮은 임계값";
+    paramThreshold.strDescription = L"픽셀을 흑/백으로 나누는 기준값 (0~255)";
     paramThreshold.dMinVal        = 0.0;
     paramThreshold.dMaxVal        = 255.0;
     paramThreshold.dDefaultVal    = 128.0;
@@ -36,8 +36,8 @@ CBinarize::CBinarize()
     m_params.push_back(paramThreshold);
 
     AlgorithmParam paramThreshold2;
-    paramThreshold2.strName        = _T("높은 임계값");
-    paramThreshold2.strDescription = _T("이중 임계값 방식의 상한값 — 이 범위 내 픽셀만 흰색");
+    paramThreshold2.strName        = L"높은 임계값";
+    paramThreshold2.strDescription = L"이중 임계값 방식의 상한값 — 이 범위 내 픽셀만 흰색";
     paramThreshold2.dMinVal        = 0.0;
     paramThreshold2.dMaxVal        = 255.0;
     paramThreshold2.dDefaultVal    = 200.0;
@@ -46,8 +46,8 @@ CBinarize::CBinarize()
     m_params.push_back(paramThreshold2);
 
     AlgorithmParam paramBlockSize;
-    paramBlockSize.strName        = _T("블록 크기");
-    paramBlockSize.strDescription = _T("적응형 방식의 지역 분석 블록 크기 (홀수, 3~99)");
+    paramBlockSize.strName        = L"블록 크기";
+    paramBlockSize.strDescription = L"적응형 방식의 지역 분석 블록 크기 (홀수, 3~99)";
     paramBlockSize.dMinVal        = 3.0;
     paramBlockSize.dMaxVal        = 99.0;
     paramBlockSize.dDefaultVal    = 11.0;
@@ -58,8 +58,8 @@ CBinarize::CBinarize()
 
 CBinarize::~CBinarize() {}
 
-CString CBinarize::GetName() const        { return _T("Binarize"); }
-CString CBinarize::GetDescription() const { return _T("Standard/Reverse/Double/Adaptive/Otsu"); }
+std::wstring CBinarize::GetName() const        { return L"Binarize"; }
+std::wstring CBinarize::GetDescription() const { return L"Standard/Reverse/Double/Adaptive/Otsu"; }
 std::vector<AlgorithmParam>& CBinarize::GetParams() { return m_params; }
 
 // Integer luminance: (77*R + 150*G + 29*B) >> 8  ≈  0.301R + 0.586G + 0.113B
@@ -115,7 +115,7 @@ bool CBinarize::Process(const CImageBuffer& input, CImageBuffer& output)
     int nBlockSize  = (int)m_params[3].dCurrentVal;
 
     if (nBlockSize % 2 == 0) nBlockSize++;
-    nBlockSize = max(3, min(99, nBlockSize));
+    nBlockSize = std::max(3, std::min(99, nBlockSize));
     if (nThreshold2 < nThreshold) nThreshold2 = nThreshold;
 
     if (!output.Create(nWidth, nHeight, 1)) return false;
@@ -125,19 +125,27 @@ bool CBinarize::Process(const CImageBuffer& input, CImageBuffer& output)
     int         nSrcStride = input.GetStride();
     int         nDstStride = output.GetStride();
 
+    // Gray conversion and thresholding, plus the local means of the adaptive method
+    CRowProgress progress(*this, (long long)nHeight * (nMethod == 3 ? 3 : 2));
+
     // Build grayscale buffer — reuse m_grayBuf allocation (no malloc after 1st call)
+    CProfileScope phase("phase", "Binarize: gray");
     m_grayBuf.resize(nWidth * nHeight);
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
+        if (progress.IsCancelled()) continue;
         const BYTE* pRow = pSrc + y * nSrcStride;
         for (int x = 0; x < nWidth; x++)
             m_grayBuf[y * nWidth + x] = toGray(pRow, x, nChannels);
+        progress.Add();
     }
+    if (progress.IsCancelled()) return false;
 
     // Compute Otsu threshold if needed
     if (nMethod == 4)
     {
+        phase.Next("Binarize: Otsu");
         int hist[256] = {};
         for (int i = 0; i < nWidth * nHeight; i++)
             hist[m_grayBuf[i]]++;
@@ -147,6 +155,7 @@ bool CBinarize::Process(const CImageBuffer& input, CImageBuffer& output)
     // Adaptive: compute local mean thresholds — reuse m_localThresh allocation
     if (nMethod == 3)
     {
+        phase.Next("Binarize: local mean");
         m_localThresh.resize(nWidth * nHeight);
         int nHalf = nBlockSize / 2;
         int C     = nThreshold / 8;  // constant subtracted from mean
@@ -154,29 +163,34 @@ bool CBinarize::Process(const CImageBuffer& input, CImageBuffer& output)
 #pragma omp parallel for schedule(static)
         for (int y = 0; y < nHeight; y++)
         {
+            if (progress.IsCancelled()) continue;
             for (int x = 0; x < nWidth; x++)
             {
                 long long sum = 0;
                 int cnt = 0;
                 for (int ky = -nHalf; ky <= nHalf; ky++)
                 {
-                    int sy = max(0, min(nHeight - 1, y + ky));
+                    int sy = std::max(0, std::min(nHeight - 1, y + ky));
                     for (int kx = -nHalf; kx <= nHalf; kx++)
                     {
-                        int sx = max(0, min(nWidth - 1, x + kx));
+                        int sx = std::max(0, std::min(nWidth - 1, x + kx));
                         sum += m_grayBuf[sy * nWidth + sx];
                         cnt++;
                     }
                 }
                 m_localThresh[y * nWidth + x] = (int)(sum / cnt) - C;
             }
+            progress.Add();
         }
+        if (progress.IsCancelled()) return false;
     }
 
     // Apply thresholding
+    phase.Next("Binarize: threshold");
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
+        if (progress.IsCancelled()) continue;
         BYTE* pDstRow = pDst + y * nDstStride;
         for (int x = 0; x < nWidth; x++)
         {
@@ -206,9 +220,45 @@ bool CBinarize::Process(const CImageBuffer& input, CImageBuffer& output)
             }
             pDstRow[x] = bOut;
         }
+        progress.Add();
     }
 
+    return !progress.IsCancelled();
+}
+
+// Standard, reverse and double threshold compare each gray value with fixed thresholds
+bool CBinarize::GetPointwiseMap(PointwiseMap& map) const
+{
+    int nMethod     = (int)m_params[0].dCurrentVal;
+    int nThreshold  = (int)m_params[1].dCurrentVal;
+    int nThreshold2 = (int)m_params[2].dCurrentVal;
+    if (nMethod < 0 || nMethod > 2)
+        return false;
+    if (nThreshold2 < nThreshold) nThreshold2 = nThreshold;
+
+    map.bReduce = true;
+    map.weights[0] = 29;
+    map.weights[1] = 150;
+    map.weights[2] = 77;
+    for (int gray = 0; gray < 256; gray++)
+    {
+        bool bOn = (nMethod == 2) ? (gray >= nThreshold && gray <= nThreshold2) : (gray > nThreshold);
+        if (nMethod == 1) bOn = !bOn;
+        map.lut[gray] = bOn ? 255 : 0;
+    }
     return true;
 }
 
 CAlgorithmBase* CBinarize::Clone() const { return new CBinarize(*this); }
+
+int CBinarize::GetNeighbourhoodRadius() const
+{
+    int nMethod    = (int)m_params[0].dCurrentVal;
+    int nBlockSize = (int)m_params[3].dCurrentVal;
+    if (nBlockSize % 2 == 0) nBlockSize++;
+    nBlockSize = std::max(3, std::min(99, nBlockSize));
+
+    if (nMethod == 4) return -1;               // Otsu: global histogram
+    if (nMethod == 3) return nBlockSize / 2;   // adaptive: local mean
+    return 0;
+}
@@ -1,5 +1,6 @@
-#include "stdafx.h"
 #include "Algorithm/BrightnessContrast.h"
+#include "Core/PixelTraits.h"
+#include "Core/Profiler.h"
 #include <cmath>
 #include <vector>
 #include <algorithm>
@@ -14,19 +15,19 @@
 CBrightnessContrast::CBrightnessContrast()
 {
     AlgorithmParam paramMethod;
-    paramMethod.strName        = _T("방식");
-    paramMethod.strDescription = _T("밝기/대비 처리 방식을 선택하세요");
+    paramMethod.strName        = L"방식";
+    paramMethod.strDescription = L"밝기/대비 처리 방식을 선택하세요";
     paramMethod.dMinVal        = 0.0;
     paramMethod.dMaxVal        = 2.0;
     paramMethod.dDefaultVal    = 0.0;
     paramMethod.dCurrentVal    = 0.0;
     paramMethod.nPrecision     = 0;
-    paramMethod.vecOptions     = { _T("밝기/대비"), _T("감마 보정"), _T("히스토그램 균등화") };
+    paramMethod.vecOptions     = { L"밝기/대비", L"감마 보정", L"히스토그램 균등화" };
     m_params.push_back(paramMethod);
 
     AlgorithmParam paramBrightness;
-    paramBrightness.strName        = _T("밝기");
-    paramBrightness.strDescription = _T("전체 밝기 조절 (-100: 어둡게, 0: 변화 없음, +100: 밝게)");
+    paramBrightness.strName        = L"밝기";
+    paramBrightness.strDescription = L"전체 밝기 조절 (-100: 어둡게, 0: 변화 없음, +100: 밝게)";
     paramBrightness.dMinVal        = -100.0;
     paramBrightness.dMaxVal        = 100.0;
     paramBrightness.dDefaultVal    = 0.0;
@@ -35,8 +36,8 @@ CBrightnessContrast::CBrightnessContrast()
     m_params.push_back(paramBrightness);
 
     AlgorithmParam paramContrast;
-    paramContrast.strName        = _T("대비");
-    paramContrast.strDescription = _T("명암 차이 강도 (-100: 낮은 대비, 0: 변화 없음, +100: 높은 대비)");
+    paramContrast.strName        = L"대비";
+    paramContrast.strDescription = L"명암 차이 강도 (-100: 낮은 대비, 0: 변화 없음, +100: 높은 대비)";
     paramContrast.dMinVal        = -100.0;
     paramContrast.dMaxVal        = 100.0;
     paramContrast.dDefaultVal    = 0.0;
@@ -45,8 +46,8 @@ CBrightnessContrast::CBrightnessContrast()
     m_params.push_back(paramContrast);
 
     AlgorithmParam paramGamma;
-    paramGamma.strName        = _T("감마값");
-    paramGamma.strDescription = _T("감마 보정값 (1.0=변화 없음, 1보다 작으면 어둡게, 크면 밝게)");
+    paramGamma.strName        = L"감마값";
+    paramGamma.strDescription = L"감마 보정값 (1.0=변화 없음, 1보다 작으면 어둡게, 크면 밝게)";
     paramGamma.dMinVal        = 0.1;
     paramGamma.dMaxVal        = 5.0;
     paramGamma.dDefaultVal    = 1.0;
@@ -57,108 +58,214 @@ CBrightnessContrast::CBrightnessContrast()
 
 CBrightnessContrast::~CBrightnessContrast() {}
 
-CString CBrightnessContrast::GetName() const        { return _T("Brightness/Contrast"); }
-CString CBrightnessContrast::GetDescription() const { return _T("BC / Gamma correction / Histogram equalization"); }
+std::wstring CBrightnessContrast::GetName() const        { return L"Brightness/Contrast"; }
+std::wstring CBrightnessContrast::GetDescription() const { return L"BC / Gamma correction / Histogram equalization"; }
 std::vector<AlgorithmParam>& CBrightnessContrast::GetParams() { return m_params; }
 
 bool CBrightnessContrast::Process(const CImageBuffer& input, CImageBuffer& output)
 {
     if (!input.IsValid()) return false;
+    if (!output.Create(input.GetWidth(), input.GetHeight(), input.GetChannels(), input.GetDepth(), input.GetLayout()))
+        return false;
+    return ProcessView(input.GetConstView(), output.GetView());
+}
 
-    int    nWidth    = input.GetWidth();
-    int    nHeight   = input.GetHeight();
-    int    nChannels = input.GetChannels();
-    int    nMethod   = (int)m_params[0].dCurrentVal;
-    double dBright   = m_params[1].dCurrentVal;
-    double dContrast = m_params[2].dCurrentVal;
-    double dGamma    = m_params[3].dCurrentVal;
-
-    if (!output.Create(nWidth, nHeight, nChannels)) return false;
-
-    const BYTE* pSrc      = input.GetData();
-    BYTE*       pDst      = output.GetData();
-    int         nSrcStride = input.GetStride();
-    int         nDstStride = output.GetStride();
+// Brightness/contrast and gamma are defined on the 8-bit scale (v' = f(v) with white = 255);
+// other depths map through the same curve at their own white level. Integer depths go through
+// a table per possible sample value, float is evaluated per sample.
+template <typename T>
+static bool ApplyCurve(const ConstImageView& input, const ImageView& output, double (*fnCurve)(double, const double*),
+                       const double* pArgs, CRowProgress& progress)
+{
+    int nWidth    = input.nWidth;
+    int nHeight   = input.nHeight;
+    int nChannels = input.nChannels;
+    const double scale = 255.0 / PixelTraits<T>::MaxValue();
 
-    // Build lookup table
-    BYTE lut[256];
+    std::vector<T> lut;
+    if (PixelTraits<T>::Depth != PixelDepth::F32)
+    {
+        lut.resize((size_t)PixelTraits<T>::MaxValue() + 1);
+        for (size_t i = 0; i < lut.size(); i++)
+            lut[i] = PixelTraits<T>::FromDouble(fnCurve(i * scale, pArgs) / scale);
+    }
 
-    if (nMethod == 1)
+#pragma omp parallel for schedule(static)
+    for (int y = 0; y < nHeight; y++)
     {
-        // Gamma correction
-        if (dGamma < 0.01) dGamma = 0.01;
-        double invGamma = 1.0 / dGamma;
-        for (int i = 0; i < 256; i++)
+        if (progress.IsCancelled()) continue;
+        const T* pSrcRow = input.RowAs<const T>(y);
+        T*       pDstRow = output.RowAs<T>(y);
+        for (int x = 0; x < nWidth * nChannels; x++)
         {
-            int v = (int)(pow(i / 255.0, invGamma) * 255.0 + 0.5);
-            lut[i] = (BYTE)max(0, min(255, v));
+            if (lut.empty())
+                pDstRow[x] = PixelTraits<T>::FromDouble(fnCurve(pSrcRow[x] * scale, pArgs) / scale);
+            else
+                pDstRow[x] = lut[(size_t)pSrcRow[x]];
         }
+        progress.Add();
     }
-    else if (nMethod == 2)
+    return !progress.IsCancelled();
+}
+
+static double GammaCurve(double v, const double* pArgs)
+{
+    return pow(std::max(0.0, v) / 255.0, pArgs[0]) * 255.0;
+}
+
+static double BrightContrastCurve(double v, const double* pArgs)
+{
+    return 128.0 + pArgs[0] * (v - 128.0) + pArgs[1];
+}
+
+// Histogram equalization - per-channel CDF over the view. Integer depths use one bin per
+// value; float is binned at 16 bits.
+template <typename T>
+static bool ApplyEqualization(const ConstImageView& input, const ImageView& output, CRowProgress& progress)
+{
+    int nWidth    = input.nWidth;
+    int nHeight   = input.nHeight;
+    int nChannels = input.nChannels;
+
+    const int    nBins    = (PixelTraits<T>::Depth == PixelDepth::U8) ? 256 : 65536;
+    const double binScale = (nBins - 1) / PixelTraits<T>::MaxValue();
+    auto Bin = [&](T v) -> int
+    {
+        double b = v * binScale + 0.5;
+        return b <= 0.0 ? 0 : (b >= nBins - 1 ? nBins - 1 : (int)b);
+    };
+
+    std::vector<int> hist(nBins), cdf(nBins);
+    std::vector<T>   lutCh(nBins);
+    for (int c = 0; c < nChannels; c++)
     {
-        // Histogram equalization - build per-channel CDF
-        // Process channel by channel
-        for (int c = 0; c < nChannels; c++)
+        CProfileScope phase("phase", "Equalization: histogram");
+        std::fill(hist.begin(), hist.end(), 0);
+        for (int y = 0; y < nHeight; y++)
         {
-            int hist[256] = {};
-            for (int y = 0; y < nHeight; y++)
-            {
-                const BYTE* pRow = pSrc + y * nSrcStride;
-                for (int x = 0; x < nWidth; x++)
-                    hist[pRow[x * nChannels + c]]++;
-            }
-
-            // CDF
-            int cdf[256] = {};
-            cdf[0] = hist[0];
-            for (int i = 1; i < 256; i++) cdf[i] = cdf[i-1] + hist[i];
-
-            // Find first non-zero
-            int cdfMin = 0;
-            for (int i = 0; i < 256; i++) { if (cdf[i] > 0) { cdfMin = cdf[i]; break; } }
-
-            int total = nWidth * nHeight;
-            BYTE lutCh[256];
-            for (int i = 0; i < 256; i++)
-            {
-                int v = (int)((double)(cdf[i] - cdfMin) / (total - cdfMin) * 255.0 + 0.5);
-                lutCh[i] = (BYTE)max(0, min(255, v));
-            }
+            if (progress.IsCancelled()) return false;
+            const T* pRow = input.RowAs<const T>(y);
+            for (int x = 0; x < nWidth; x++)
+                hist[Bin(pRow[x * nChannels + c])]++;
+            progress.Add();
+        }
+
+        // CDF
+        cdf[0] = hist[0];
+        for (int i = 1; i < nBins; i++) cdf[i] = cdf[i-1] + hist[i];
+
+        // Find first non-zero
+        int cdfMin = 0;
+        for (int i = 0; i < nBins; i++) { if (cdf[i] > 0) { cdfMin = cdf[i]; break; } }
 
+        int total = nWidth * nHeight;
+        for (int i = 0; i < nBins; i++)
+            lutCh[i] = PixelTraits<T>::FromDouble((double)(cdf[i] - cdfMin) / (total - cdfMin) * PixelTraits<T>::MaxValue());
+
+        phase.Next("Equalization: map");
 #pragma omp parallel for schedule(static)
-            for (int y = 0; y < nHeight; y++)
-            {
-                const BYTE* pSrcRow = pSrc + y * nSrcStride;
-                BYTE*       pDstRow = pDst + y * nDstStride;
-                for (int x = 0; x < nWidth; x++)
-                    pDstRow[x * nChannels + c] = lutCh[pSrcRow[x * nChannels + c]];
-            }
+        for (int y = 0; y < nHeight; y++)
+        {
+            if (progress.IsCancelled()) continue;
+            const T* pSrcRow = input.RowAs<const T>(y);
+            T*       pDstRow = output.RowAs<T>(y);
+            for (int x = 0; x < nWidth; x++)
+                pDstRow[x * nChannels + c] = lutCh[Bin(pSrcRow[x * nChannels + c])];
+            progress.Add();
         }
+    }
+    return !progress.IsCancelled();
+}
+
+typedef double (*CurveFn)(double, const double*);
+
+// Curve and arguments of the LUT methods; false for histogram equalization
+static bool SelectCurve(int nMethod, double dBright, double dContrast, double dGamma, CurveFn& fnCurve, double args[2])
+{
+    if (nMethod == 1)
+    {
+        // Gamma correction
+        if (dGamma < 0.01) dGamma = 0.01;
+        fnCurve = GammaCurve;
+        args[0] = 1.0 / dGamma;
         return true;
     }
-    else
+    if (nMethod == 2)
+        return false;
+
+    // Standard brightness + contrast
+    fnCurve = BrightContrastCurve;
+    args[0] = (100.0 + dContrast) / 100.0;
+    args[1] = dBright;
+    return true;
+}
+
+template <typename T>
+static bool ApplyBrightnessContrast(const ConstImageView& input, const ImageView& output, int nMethod,
+                                    double dBright, double dContrast, double dGamma, CRowProgress& progress)
+{
+    CurveFn fnCurve = nullptr;
+    double args[2] = {};
+    if (SelectCurve(nMethod, dBright, dContrast, dGamma, fnCurve, args))
+        return ApplyCurve<T>(input, output, fnCurve, args, progress);
+    return ApplyEqualization<T>(input, output, progress);
+}
+
+// One interleaved view, or one plane
+static bool AdjustView(const ConstImageView& input, const ImageView& output, int nMethod,
+                       double dBright, double dContrast, double dGamma, CRowProgress& progress)
+{
+    switch (input.eDepth)
     {
-        // Standard brightness + contrast
-        double contrastFactor = (100.0 + dContrast) / 100.0;
-        for (int i = 0; i < 256; i++)
-        {
-            double v = 128.0 + contrastFactor * ((double)i - 128.0) + dBright;
-            lut[i] = (BYTE)max(0, min(255, (int)(v + 0.5)));
-        }
+    case PixelDepth::U16: return ApplyBrightnessContrast<unsigned short>(input, output, nMethod, dBright, dContrast, dGamma, progress);
+    case PixelDepth::F32: return ApplyBrightnessContrast<float>(input, output, nMethod, dBright, dContrast, dGamma, progress);
+    default:              return ApplyBrightnessContrast<BYTE>(input, output, nMethod, dBright, dContrast, dGamma, progress);
     }
+}
 
-    // Apply LUT
-#pragma omp parallel for schedule(static)
-    for (int y = 0; y < nHeight; y++)
+// Pointwise except histogram equalization, whose histogram covers the view only (not its halo)
+bool CBrightnessContrast::ProcessView(const ConstImageView& input, const ImageView& output)
+{
+    if (!input.IsValid() || !output.IsValid() || input.eDepth != output.eDepth) return false;
+    if (input.IsPlanar() != output.IsPlanar()) return false;
+
+    int    nMethod   = (int)m_params[0].dCurrentVal;
+    double dBright   = m_params[1].dCurrentVal;
+    double dContrast = m_params[2].dCurrentVal;
+    double dGamma    = m_params[3].dCurrentVal;
+
+    // Equalization reads every row for the histogram, then maps it, once per channel
+    CRowProgress progress(*this, (long long)input.nHeight * (nMethod == 2 ? 2 * input.nChannels : 1));
+
+    // Planar: each plane is a 1-channel image (equalization keeps one histogram per channel)
+    if (input.IsPlanar())
     {
-        const BYTE* pSrcRow = pSrc + y * nSrcStride;
-        BYTE*       pDstRow = pDst + y * nDstStride;
-        for (int x = 0; x < nWidth; x++)
-            for (int c = 0; c < nChannels; c++)
-                pDstRow[x * nChannels + c] = lut[pSrcRow[x * nChannels + c]];
+        for (int c = 0; c < input.nChannels; c++)
+            if (!AdjustView(input.Plane(c), output.Plane(c), nMethod, dBright, dContrast, dGamma, progress)) return false;
+        return true;
     }
+    return AdjustView(input, output, nMethod, dBright, dContrast, dGamma, progress);
+}
+
+CAlgorithmBase* CBrightnessContrast::Clone() const { return new CBrightnessContrast(*this); }
+
+// The 8-bit table ApplyCurve<BYTE> builds (its scale is exactly 1)
+bool CBrightnessContrast::GetPointwiseMap(PointwiseMap& map) const
+{
+    CurveFn fnCurve = nullptr;
+    double args[2] = {};
+    if (!SelectCurve((int)m_params[0].dCurrentVal, m_params[1].dCurrentVal, m_params[2].dCurrentVal,
+                     m_params[3].dCurrentVal, fnCurve, args))
+        return false;
 
+    map.bReduce = false;
+    for (int v = 0; v < 256; v++)
+        map.lut[v] = PixelTraits<BYTE>::FromDouble(fnCurve(v, args));
     return true;
 }
 
-CAlgorithmBase* CBrightnessContrast::Clone() const { return new CBrightnessContrast(*this); }
+int CBrightnessContrast::GetNeighbourhoodRadius() const
+{
+    // Histogram equalization needs the whole frame; the LUT methods are pointwise
+    return ((int)m_params[0].dCurrentVal == 2) ? -1 : 0;
+}
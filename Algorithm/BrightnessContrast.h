@@ -6,10 +6,16 @@ public:
     CBrightnessContrast();
     virtual ~CBrightnessContrast();
 
-    virtual CString GetName() const override;
-    virtual CString GetDescription() const override;
+    virtual std::wstring GetName() const override;
+    virtual std::wstring GetDescription() const override;
     virtual std::vector<AlgorithmParam>& GetParams() override;
     virtual bool Process(const CImageBuffer& input, CImageBuffer& output) override;
+    virtual bool SupportsViews() const override { return true; }
+    virtual bool ProcessView(const ConstImageView& input, const ImageView& output) override;
+    virtual bool SupportsDepth(PixelDepth) const override { return true; }
+    virtual bool PrefersPlanar() const override { return true; }
+    virtual int GetNeighbourhoodRadius() const override;
+    virtual bool GetPointwiseMap(PointwiseMap& map) const override;
     virtual CAlgorithmBase* Clone() const override;
 
 private:
@@ -1,5 +1,6 @@
-#include "stdafx.h"
 #include "Algorithm/EdgeDetect.h"
+#include "Core/Profiler.h"
+#include "Core/PixelTraits.h"
 #include <cmath>
 #include <vector>
 #include <algorithm>
@@ -17,20 +18,20 @@
 CEdgeDetect::CEdgeDetect()
 {
     AlgorithmParam paramMethod;
-    paramMethod.strName        = _T("방식");
-    paramMethod.strDescription = _T("엣지 검출 방식을 선택하세요");
+    paramMethod.strName        = L"방식";
+    paramMethod.strDescription = L"엣지 검출 방식을 선택하세요";
     paramMethod.dMinVal        = 0.0;
     paramMethod.dMaxVal        = 3.0;
     paramMethod.dDefaultVal    = 0.0;
     paramMethod.dCurrentVal    = 0.0;
     paramMethod.nPrecision     = 0;
-    paramMethod.vecOptions     = { _T("소벨(Sobel)"), _T("프리윗(Prewitt)"),
-                                    _T("캐니(Canny)"), _T("라플라시안(Laplacian)") };
+    paramMethod.vecOptions     = { L"소벨(Sobel)", L"프리윗(Prewitt)",
+                                    L"캐니(Canny)", L"라플라시안(Laplacian)" };
     m_params.push_back(paramMethod);
 
     AlgorithmParam paramThreshold;
-    paramThreshold.strName        = _T("낮은 임계값");
-    paramThreshold.strDescription = _T("엣지 검출 하한 임계값 (캐니: 낮은 임계값, 나머지: 단일 기준)");
+    paramThreshold.strName        = L"낮은 임계값";
+    paramThreshold.strDescription = L"엣지 검출 하한 임계값 (캐니: 낮은 임계값, 나머지: 단일 기준)";
     paramThreshold.dMinVal        = 0.0;
     paramThreshold.dMaxVal        = 255.0;
     paramThreshold.dDefaultVal    = 50.0;
@@ -39,8 +40,8 @@ CEdgeDetect::CEdgeDetect()
     m_params.push_back(paramThreshold);
 
     AlgorithmParam paramHighThresh;
-    paramHighThresh.strName        = _T("높은 임계값");
-    paramHighThresh.strDescription = _T("캐니 방식 전용 상한 임계값 — 이 이상이면 강한 엣지로 확정");
+    paramHighThresh.strName        = L"높은 임계값";
+    paramHighThresh.strDescription = L"캐니 방식 전용 상한 임계값 — 이 이상이면 강한 엣지로 확정";
     paramHighThresh.dMinVal        = 0.0;
     paramHighThresh.dMaxVal        = 255.0;
     paramHighThresh.dDefaultVal    = 150.0;
@@ -51,8 +52,8 @@ CEdgeDetect::CEdgeDetect()
 
 CEdgeDetect::~CEdgeDetect() {}
 
-CString CEdgeDetect::GetName() const        { return _T("Edge Detect"); }
-CString CEdgeDetect::GetDescription() const { return _T("Sobel/Prewitt/Canny/Laplacian edge detection"); }
+std::wstring CEdgeDetect::GetName() const        { return L"Edge Detect"; }
+std::wstring CEdgeDetect::GetDescription() const { return L"Sobel/Prewitt/Canny/Laplacian edge detection"; }
 std::vector<AlgorithmParam>& CEdgeDetect::GetParams() { return m_params; }
 
 int CEdgeDetect::ClampCoord(int val, int maxVal)
@@ -66,10 +67,13 @@ BYTE CEdgeDetect::ComputeGrayscale(const BYTE* pRow, int x, int nChannels)
 {
     if (nChannels == 1) return pRow[x];
     BYTE b = pRow[x * nChannels], g = pRow[x * nChannels + 1], r = pRow[x * nChannels + 2];
-    return (BYTE)max(0, min(255, (int)(0.299 * r + 0.587 * g + 0.114 * b + 0.5)));
+    return (BYTE)std::max(0, std::min(255, (int)(0.299 * r + 0.587 * g + 0.114 * b + 0.5)));
 }
 
-static void BuildGrayBuf(const CImageBuffer& input, std::vector<BYTE>& grayBuf)
+// Every method works on a gray copy at the input's depth. Thresholds are given on the 8-bit
+// scale and applied at the depth's white level; the edge map keeps the input depth.
+template <typename T>
+static bool BuildGrayBuf(const CImageBuffer& input, std::vector<T>& grayBuf, CRowProgress& progress)
 {
     int nWidth    = input.GetWidth();
     int nHeight   = input.GetHeight();
@@ -81,35 +85,39 @@ static void BuildGrayBuf(const CImageBuffer& input, std::vector<BYTE>& grayBuf)
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
-        const BYTE* pRow = pSrc + y * nStride;
+        if (progress.IsCancelled()) continue;
+        const T* pRow = reinterpret_cast<const T*>(pSrc + (size_t)y * nStride);
         for (int x = 0; x < nWidth; x++)
         {
             if (nChannels == 1)
                 grayBuf[y * nWidth + x] = pRow[x];
             else
-            {
-                int g = (int)(0.299 * pRow[x * nChannels + 2]
-                            + 0.587 * pRow[x * nChannels + 1]
-                            + 0.114 * pRow[x * nChannels] + 0.5);
-                grayBuf[y * nWidth + x] = (BYTE)max(0, min(255, g));
-            }
+                grayBuf[y * nWidth + x] = PixelTraits<T>::FromDouble(0.299 * pRow[x * nChannels + 2]
+                                                                   + 0.587 * pRow[x * nChannels + 1]
+                                                                   + 0.114 * pRow[x * nChannels]);
         }
+        progress.Add();
     }
+    return !progress.IsCancelled();
 }
 
+template <typename T>
 static bool ApplySobelPrewitt(const CImageBuffer& input, CImageBuffer& output,
-                               int nMethod, int nThreshold)
+                               int nMethod, int nThreshold, CRowProgress& progress)
 {
     int nWidth  = input.GetWidth();
     int nHeight = input.GetHeight();
 
-    std::vector<BYTE> grayBuf;
-    BuildGrayBuf(input, grayBuf);
+    std::vector<T> grayBuf;
+    if (!BuildGrayBuf<T>(input, grayBuf, progress)) return false;
 
-    if (!output.Create(nWidth, nHeight, 1)) return false;
+    if (!output.Create(nWidth, nHeight, 1, PixelTraits<T>::Depth)) return false;
     BYTE* pDst      = output.GetData();
     int   nDstStride = output.GetStride();
 
+    const double maxVal = PixelTraits<T>::MaxValue();
+    const double thresh = nThreshold * maxVal / 255.0;
+
     static const int sobelGx[3][3]   = {{-1,0,1},{-2,0,2},{-1,0,1}};
     static const int sobelGy[3][3]   = {{-1,-2,-1},{0,0,0},{1,2,1}};
     static const int prewittGx[3][3] = {{-1,0,1},{-1,0,1},{-1,0,1}};
@@ -121,77 +129,92 @@ static bool ApplySobelPrewitt(const CImageBuffer& input, CImageBuffer& output,
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
-        BYTE* pDstRow = pDst + y * nDstStride;
+        if (progress.IsCancelled()) continue;
+        T* pDstRow = reinterpret_cast<T*>(pDst + y * nDstStride);
         for (int x = 0; x < nWidth; x++)
         {
-            int nSumGx = 0, nSumGy = 0;
+            double dSumGx = 0, dSumGy = 0;
             for (int ky = -1; ky <= 1; ky++)
             {
-                int sy = max(0, min(nHeight - 1, y + ky));
+                int sy = std::max(0, std::min(nHeight - 1, y + ky));
                 for (int kx = -1; kx <= 1; kx++)
                 {
-                    int sx  = max(0, min(nWidth - 1, x + kx));
-                    int pix = grayBuf[sy * nWidth + sx];
-                    nSumGx += pix * kernelGx[ky + 1][kx + 1];
-                    nSumGy += pix * kernelGy[ky + 1][kx + 1];
+                    int    sx  = std::max(0, std::min(nWidth - 1, x + kx));
+                    double pix = grayBuf[sy * nWidth + sx];
+                    dSumGx += pix * kernelGx[ky + 1][kx + 1];
+                    dSumGy += pix * kernelGy[ky + 1][kx + 1];
                 }
             }
-            int mag = (int)(sqrt((double)(nSumGx * nSumGx + nSumGy * nSumGy)) + 0.5);
-            mag = min(255, mag);
-            pDstRow[x] = (mag >= nThreshold) ? (BYTE)mag : 0;
+            T mag = PixelTraits<T>::FromDouble(std::min(maxVal, sqrt(dSumGx * dSumGx + dSumGy * dSumGy)));
+            pDstRow[x] = (mag >= thresh) ? mag : 0;
         }
+        progress.Add();
     }
-    return true;
+    return !progress.IsCancelled();
 }
 
-static bool ApplyLaplacian(const CImageBuffer& input, CImageBuffer& output, int nThreshold)
+template <typename T>
+static bool ApplyLaplacian(const CImageBuffer& input, CImageBuffer& output, int nThreshold,
+                           CRowProgress& progress)
 {
     int nWidth  = input.GetWidth();
     int nHeight = input.GetHeight();
 
-    std::vector<BYTE> grayBuf;
-    BuildGrayBuf(input, grayBuf);
+    std::vector<T> grayBuf;
+    if (!BuildGrayBuf<T>(input, grayBuf, progress)) return false;
 
-    if (!output.Create(nWidth, nHeight, 1)) return false;
+    if (!output.Create(nWidth, nHeight, 1, PixelTraits<T>::Depth)) return false;
     BYTE* pDst      = output.GetData();
     int   nDstStride = output.GetStride();
 
+    const double maxVal = PixelTraits<T>::MaxValue();
+    const double thresh = nThreshold * maxVal / 255.0;
+
     // Laplacian of Gaussian kernel (approximation)
     static const int kernel[3][3] = {{0,1,0},{1,-4,1},{0,1,0}};
 
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
-        BYTE* pDstRow = pDst + y * nDstStride;
+        if (progress.IsCancelled()) continue;
+        T* pDstRow = reinterpret_cast<T*>(pDst + y * nDstStride);
         for (int x = 0; x < nWidth; x++)
         {
-            int val = 0;
+            double val = 0;
             for (int ky = -1; ky <= 1; ky++)
             {
-                int sy = max(0, min(nHeight - 1, y + ky));
+                int sy = std::max(0, std::min(nHeight - 1, y + ky));
                 for (int kx = -1; kx <= 1; kx++)
                 {
-                    int sx = max(0, min(nWidth - 1, x + kx));
+                    int sx = std::max(0, std::min(nWidth - 1, x + kx));
                     val += grayBuf[sy * nWidth + sx] * kernel[ky + 1][kx + 1];
                 }
             }
-            int mag = min(255, abs(val));
-            pDstRow[x] = (mag >= nThreshold) ? (BYTE)mag : 0;
+            T mag = PixelTraits<T>::FromDouble(std::min(maxVal, fabs(val)));
+            pDstRow[x] = (mag >= thresh) ? mag : 0;
         }
+        progress.Add();
     }
-    return true;
+    return !progress.IsCancelled();
 }
 
+template <typename T>
 static bool ApplyCanny(const CImageBuffer& input, CImageBuffer& output,
-                       int nLowThresh, int nHighThresh)
+                       int nLowThresh, int nHighThresh, CRowProgress& progress)
 {
     int nWidth  = input.GetWidth();
     int nHeight = input.GetHeight();
 
-    std::vector<BYTE> grayBuf;
-    BuildGrayBuf(input, grayBuf);
+    CProfileScope phase("phase", "Canny: gray");
+    std::vector<T> grayBuf;
+    if (!BuildGrayBuf<T>(input, grayBuf, progress)) return false;
+
+    const double maxVal = PixelTraits<T>::MaxValue();
+    const double lowT   = nLowThresh * maxVal / 255.0;
+    const double highT  = nHighThresh * maxVal / 255.0;
 
     // Step 1: Gaussian smoothing (sigma=1.0, kernel=5)
+    phase.Next("Canny: smooth");
     int nKernel = 5, nHalf = 2;
     double sigma = 1.0;
     double gaussK[25];
@@ -207,23 +230,29 @@ static bool ApplyCanny(const CImageBuffer& input, CImageBuffer& output,
         for (int i = 0; i < 25; i++) gaussK[i] /= sum;
     }
 
-    std::vector<BYTE> smoothed(nWidth * nHeight);
+    std::vector<T> smoothed(nWidth * nHeight);
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
+    {
+        if (progress.IsCancelled()) continue;
         for (int x = 0; x < nWidth; x++)
         {
             double s = 0;
             for (int ky = -nHalf; ky <= nHalf; ky++)
                 for (int kx = -nHalf; kx <= nHalf; kx++)
                 {
-                    int sy = max(0, min(nHeight - 1, y + ky));
-                    int sx = max(0, min(nWidth  - 1, x + kx));
+                    int sy = std::max(0, std::min(nHeight - 1, y + ky));
+                    int sx = std::max(0, std::min(nWidth  - 1, x + kx));
                     s += grayBuf[sy * nWidth + sx] * gaussK[(ky+nHalf)*nKernel + kx+nHalf];
                 }
-            smoothed[y * nWidth + x] = (BYTE)(s + 0.5);
+            smoothed[y * nWidth + x] = PixelTraits<T>::FromDouble(s);
         }
+        progress.Add();
+    }
+    if (progress.IsCancelled()) return false;
 
     // Step 2: Sobel gradients
+    phase.Next("Canny: gradient");
     std::vector<float> gMag(nWidth * nHeight);
     std::vector<float> gDir(nWidth * nHeight);
     static const int sobelGx[3][3] = {{-1,0,1},{-2,0,2},{-1,0,1}};
@@ -231,26 +260,34 @@ static bool ApplyCanny(const CImageBuffer& input, CImageBuffer& output,
 
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
+    {
+        if (progress.IsCancelled()) continue;
         for (int x = 0; x < nWidth; x++)
         {
-            int gx = 0, gy = 0;
+            double gx = 0, gy = 0;
             for (int ky = -1; ky <= 1; ky++)
                 for (int kx = -1; kx <= 1; kx++)
                 {
-                    int sy = max(0, min(nHeight - 1, y + ky));
-                    int sx = max(0, min(nWidth  - 1, x + kx));
-                    int p  = smoothed[sy * nWidth + sx];
+                    int    sy = std::max(0, std::min(nHeight - 1, y + ky));
+                    int    sx = std::max(0, std::min(nWidth  - 1, x + kx));
+                    double p  = smoothed[sy * nWidth + sx];
                     gx += p * sobelGx[ky+1][kx+1];
                     gy += p * sobelGy[ky+1][kx+1];
                 }
-            gMag[y * nWidth + x] = (float)sqrt((double)(gx*gx + gy*gy));
-            gDir[y * nWidth + x] = (float)atan2((double)gy, (double)gx);
+            gMag[y * nWidth + x] = (float)sqrt(gx*gx + gy*gy);
+            gDir[y * nWidth + x] = (float)atan2(gy, gx);
         }
+        progress.Add();
+    }
+    if (progress.IsCancelled()) return false;
 
     // Step 3: Non-maximum suppression
-    std::vector<BYTE> nms(nWidth * nHeight, 0);
+    phase.Next("Canny: NMS");
+    std::vector<T> nms(nWidth * nHeight, 0);
 #pragma omp parallel for schedule(static)
     for (int y = 1; y < nHeight - 1; y++)
+    {
+        if (progress.IsCancelled()) continue;
         for (int x = 1; x < nWidth - 1; x++)
         {
             float mag = gMag[y * nWidth + x];
@@ -269,11 +306,18 @@ static bool ApplyCanny(const CImageBuffer& input, CImageBuffer& output,
             else
             { n1 = gMag[(y-1) * nWidth + x - 1]; n2 = gMag[(y+1) * nWidth + x + 1]; }
 
-            nms[y * nWidth + x] = (mag >= n1 && mag >= n2) ? (BYTE)min(255.0f, mag) : 0;
+            // Integer depths truncate the magnitude, as the 8-bit path always has
+            double kept = std::min(maxVal, (double)mag);
+            if (PixelTraits<T>::Depth != PixelDepth::F32) kept = floor(kept);
+            nms[y * nWidth + x] = (mag >= n1 && mag >= n2) ? (T)kept : 0;
         }
+        progress.Add();
+    }
+    if (progress.IsCancelled()) return false;
 
     // Step 4: Hysteresis thresholding
-    if (!output.Create(nWidth, nHeight, 1)) return false;
+    phase.Next("Canny: hysteresis");
+    if (!output.Create(nWidth, nHeight, 1, PixelTraits<T>::Depth)) return false;
     BYTE* pDst      = output.GetData();
     int   nDstStride = output.GetStride();
 
@@ -281,12 +325,14 @@ static bool ApplyCanny(const CImageBuffer& input, CImageBuffer& output,
     std::vector<BYTE> edges(nWidth * nHeight, 0);
     for (int i = 0; i < nWidth * nHeight; i++)
     {
-        if (nms[i] >= nHighThresh)       edges[i] = 255;  // strong
-        else if (nms[i] >= nLowThresh)   edges[i] = 128;  // weak
+        if (nms[i] >= highT)       edges[i] = 255;  // strong
+        else if (nms[i] >= lowT)   edges[i] = 128;  // weak
     }
 
     // Connect weak edges adjacent to strong edges
     for (int y = 1; y < nHeight - 1; y++)
+    {
+        if (progress.IsCancelled()) return false;
         for (int x = 1; x < nWidth - 1; x++)
             if (edges[y * nWidth + x] == 128)
             {
@@ -296,16 +342,33 @@ static bool ApplyCanny(const CImageBuffer& input, CImageBuffer& output,
                         if (edges[(y+ky)*nWidth + x+kx] == 255) connected = true;
                 edges[y * nWidth + x] = connected ? 255 : 0;
             }
+        progress.Add();
+    }
 
+    const T white = PixelTraits<T>::FromDouble(maxVal);
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
-        BYTE* pRow = pDst + y * nDstStride;
+        if (progress.IsCancelled()) continue;
+        T* pRow = reinterpret_cast<T*>(pDst + y * nDstStride);
         for (int x = 0; x < nWidth; x++)
-            pRow[x] = (edges[y * nWidth + x] == 255) ? 255 : 0;
+            pRow[x] = (edges[y * nWidth + x] == 255) ? white : 0;
+        progress.Add();
     }
 
-    return true;
+    return !progress.IsCancelled();
+}
+
+template <typename T>
+static bool DetectEdges(const CImageBuffer& input, CImageBuffer& output,
+                        int nMethod, int nThreshold, int nHighThresh, CRowProgress& progress)
+{
+    switch (nMethod)
+    {
+    case 2: return ApplyCanny<T>(input, output, nThreshold, nHighThresh, progress);
+    case 3: return ApplyLaplacian<T>(input, output, nThreshold, progress);
+    default: return ApplySobelPrewitt<T>(input, output, nMethod, nThreshold, progress);
+    }
 }
 
 bool CEdgeDetect::Process(const CImageBuffer& input, CImageBuffer& output)
@@ -318,12 +381,21 @@ bool CEdgeDetect::Process(const CImageBuffer& input, CImageBuffer& output)
 
     if (nHighThresh < nThreshold) nHighThresh = nThreshold;
 
-    switch (nMethod)
+    // Gray copy and edge map; Canny also smooths, takes gradients, thins and links edges
+    CRowProgress progress(*this, (long long)input.GetHeight() * (nMethod == 2 ? 6 : 2));
+
+    switch (input.GetDepth())
     {
-    case 2: return ApplyCanny(input, output, nThreshold, nHighThresh);
-    case 3: return ApplyLaplacian(input, output, nThreshold);
-    default: return ApplySobelPrewitt(input, output, nMethod, nThreshold);
+    case PixelDepth::U16: return DetectEdges<unsigned short>(input, output, nMethod, nThreshold, nHighThresh, progress);
+    case PixelDepth::F32: return DetectEdges<float>(input, output, nMethod, nThreshold, nHighThresh, progress);
+    default:              return DetectEdges<BYTE>(input, output, nMethod, nThreshold, nHighThresh, progress);
     }
 }
 
 CAlgorithmBase* CEdgeDetect::Clone() const { return new CEdgeDetect(*this); }
+
+int CEdgeDetect::GetNeighbourhoodRadius() const
+{
+    // Canny's hysteresis can follow an edge across the whole frame
+    return ((int)m_params[0].dCurrentVal == 2) ? -1 : 1;
+}
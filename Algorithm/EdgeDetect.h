@@ -6,10 +6,12 @@ public:
     CEdgeDetect();
     virtual ~CEdgeDetect();
 
-    virtual CString GetName() const override;
-    virtual CString GetDescription() const override;
+    virtual std::wstring GetName() const override;
+    virtual std::wstring GetDescription() const override;
     virtual std::vector<AlgorithmParam>& GetParams() override;
     virtual bool Process(const CImageBuffer& input, CImageBuffer& output) override;
+    virtual bool SupportsDepth(PixelDepth) const override { return true; }
+    virtual int GetNeighbourhoodRadius() const override;
     virtual CAlgorithmBase* Clone() const override;
 
 private:
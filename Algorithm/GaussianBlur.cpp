@@ -1,5 +1,6 @@
-#include "stdafx.h"
 #include "Algorithm/GaussianBlur.h"
+#include "Core/PixelTraits.h"
+#include "Core/Profiler.h"
 #include <cmath>
 #include <vector>
 #include <algorithm>
@@ -13,20 +14,20 @@
 CGaussianBlur::CGaussianBlur()
 {
     AlgorithmParam paramMethod;
-    paramMethod.strName        = _T("방식");
-    paramMethod.strDescription = _T("블러 필터 방식을 선택하세요");
+    paramMethod.strName        = L"방식";
+    paramMethod.strDescription = L"블러 필터 방식을 선택하세요";
     paramMethod.dMinVal        = 0.0;
     paramMethod.dMaxVal        = 3.0;
     paramMethod.dDefaultVal    = 0.0;
     paramMethod.dCurrentVal    = 0.0;
     paramMethod.nPrecision     = 0;
-    paramMethod.vecOptions     = { _T("가우시안"), _T("양방향(Bilateral)"),
-                                    _T("미디언"), _T("박스(Box)") };
+    paramMethod.vecOptions     = { L"가우시안", L"양방향(Bilateral)",
+                                    L"미디언", L"박스(Box)" };
     m_params.push_back(paramMethod);
 
     AlgorithmParam paramKernelSize;
-    paramKernelSize.strName        = _T("커널 크기");
-    paramKernelSize.strDescription = _T("블러 적용 범위 (홀수값, 클수록 더 흐릿하게)");
+    paramKernelSize.strName        = L"커널 크기";
+    paramKernelSize.strDescription = L"블러 적용 범위 (홀수값, 클수록 더 흐릿하게)";
     paramKernelSize.dMinVal        = 3.0;
     paramKernelSize.dMaxVal        = 31.0;
     paramKernelSize.dDefaultVal    = 5.0;
@@ -35,8 +36,8 @@ CGaussianBlur::CGaussianBlur()
     m_params.push_back(paramKernelSize);
 
     AlgorithmParam paramSigma;
-    paramSigma.strName        = _T("시그마");
-    paramSigma.strDescription = _T("가우시안/양방향 필터 시그마 — 작을수록 선명하게 유지");
+    paramSigma.strName        = L"시그마";
+    paramSigma.strDescription = L"가우시안/양방향 필터 시그마 — 작을수록 선명하게 유지";
     paramSigma.dMinVal        = 0.1;
     paramSigma.dMaxVal        = 10.0;
     paramSigma.dDefaultVal    = 1.0;
@@ -47,8 +48,8 @@ CGaussianBlur::CGaussianBlur()
 
 CGaussianBlur::~CGaussianBlur() {}
 
-CString CGaussianBlur::GetName() const        { return _T("Blur"); }
-CString CGaussianBlur::GetDescription() const { return _T("Gaussian/Bilateral/Median/Box blur"); }
+std::wstring CGaussianBlur::GetName() const        { return L"Blur"; }
+std::wstring CGaussianBlur::GetDescription() const { return L"Gaussian/Bilateral/Median/Box blur"; }
 std::vector<AlgorithmParam>& CGaussianBlur::GetParams() { return m_params; }
 
 void CGaussianBlur::GenerateGaussianKernel1D(int nKernelSize, double dSigma, std::vector<double>& kernel)
@@ -73,14 +74,17 @@ int CGaussianBlur::ClampCoord(int val, int maxVal)
     return val;
 }
 
-static bool ApplyGaussian(const CImageBuffer& input, CImageBuffer& output,
-                           int nKernelSize, double dSigma)
-{
-    int nWidth    = input.GetWidth();
-    int nHeight   = input.GetHeight();
-    int nChannels = input.GetChannels();
+// All kernels read neighbours through the input view's halo, so a ROI view blurs across its
+// edges with the real surrounding pixels; edge replication happens only at the image border.
+// Each kernel is instantiated per sample type (BYTE, unsigned short, float).
 
-    if (!output.Create(nWidth, nHeight, nChannels)) return false;
+template <typename T>
+static bool ApplyGaussian(const ConstImageView& input, const ImageView& output,
+                           int nKernelSize, double dSigma, CRowProgress& progress)
+{
+    int nWidth    = input.nWidth;
+    int nHeight   = input.nHeight;
+    int nChannels = input.nChannels;
 
     int nHalf = nKernelSize / 2;
     std::vector<double> kernel;
@@ -97,122 +101,135 @@ static bool ApplyGaussian(const CImageBuffer& input, CImageBuffer& output,
         if (dSum > 0) for (auto& v : kernel) v /= dSum;
     }
 
+    // Temp holds the horizontal pass for the view rows plus up to nHalf halo rows each side
+    int yLo = -std::min(nHalf, input.nHaloTop);
+    int yHi = nHeight + std::min(nHalf, input.nHaloBottom);
+
     CImageBuffer temp;
-    if (!temp.Create(nWidth, nHeight, nChannels)) return false;
+    if (!temp.Create(nWidth, yHi - yLo, nChannels, PixelTraits<T>::Depth)) return false;
 
-    const BYTE* pSrc      = input.GetData();
     BYTE*       pTmp      = temp.GetData();
-    BYTE*       pDst      = output.GetData();
-    int         nSrcStride = input.GetStride();
     int         nTmpStride = temp.GetStride();
-    int         nDstStride = output.GetStride();
+    const int   nSamples  = nWidth * nChannels;
 
-    // Horizontal pass
-#pragma omp parallel for schedule(static)
-    for (int y = 0; y < nHeight; y++)
+    // Both passes accumulate whole rows one tap at a time, so the inner loops are unit-stride
+    // multiply-adds over the row (vectorizable; a planar plane is one sample per pixel).
+    // Per sample the taps are still summed in kernel order, as in the direct form.
+
+    // Horizontal pass: each row is first widened by nHalf clamped pixels on both sides
+    CProfileScope phase("phase", "Gaussian: horizontal");
+#pragma omp parallel
     {
-        const BYTE* pSrcRow = pSrc + y * nSrcStride;
-        BYTE*       pTmpRow = pTmp + y * nTmpStride;
-        for (int x = 0; x < nWidth; x++)
+        std::vector<T>      padded((size_t)(nWidth + 2 * nHalf) * nChannels);
+        std::vector<double> acc(nSamples);
+#pragma omp for schedule(static)
+        for (int y = yLo; y < yHi; y++)
         {
-            for (int c = 0; c < nChannels; c++)
+            if (progress.IsCancelled()) continue;
+            const T* pSrcRow = input.RowAs<const T>(y);
+            for (int x = -nHalf; x < nWidth + nHalf; x++)
             {
-                double dSum = 0.0;
-                for (int k = -nHalf; k <= nHalf; k++)
-                {
-                    int nSrcX = max(0, min(nWidth - 1, x + k));
-                    dSum += pSrcRow[nSrcX * nChannels + c] * kernel[k + nHalf];
-                }
-                int v = (int)(dSum + 0.5);
-                pTmpRow[x * nChannels + c] = (BYTE)max(0, min(255, v));
+                const T* pSrc = pSrcRow + input.ClampX(x) * nChannels;
+                T*       pPad = &padded[(size_t)(x + nHalf) * nChannels];
+                for (int c = 0; c < nChannels; c++) pPad[c] = pSrc[c];
             }
+
+            std::fill(acc.begin(), acc.end(), 0.0);
+            for (int k = 0; k < nKernelSize; k++)
+            {
+                const T*     pTap = &padded[(size_t)k * nChannels];
+                const double w    = kernel[k];
+                for (int i = 0; i < nSamples; i++) acc[i] += pTap[i] * w;
+            }
+
+            T* pTmpRow = reinterpret_cast<T*>(pTmp + (y - yLo) * nTmpStride);
+            for (int i = 0; i < nSamples; i++) pTmpRow[i] = PixelTraits<T>::FromDouble(acc[i]);
+            progress.Add();
         }
     }
+    if (progress.IsCancelled()) return false;
 
     // Vertical pass
-#pragma omp parallel for schedule(static)
-    for (int y = 0; y < nHeight; y++)
+    phase.Next("Gaussian: vertical");
+#pragma omp parallel
     {
-        BYTE* pDstRow = pDst + y * nDstStride;
-        for (int x = 0; x < nWidth; x++)
+        std::vector<double> acc(nSamples);
+#pragma omp for schedule(static)
+        for (int y = 0; y < nHeight; y++)
         {
-            for (int c = 0; c < nChannels; c++)
+            if (progress.IsCancelled()) continue;
+            std::fill(acc.begin(), acc.end(), 0.0);
+            for (int k = -nHalf; k <= nHalf; k++)
             {
-                double dSum = 0.0;
-                for (int k = -nHalf; k <= nHalf; k++)
-                {
-                    int nSrcY = max(0, min(nHeight - 1, y + k));
-                    dSum += pTmp[nSrcY * nTmpStride + x * nChannels + c] * kernel[k + nHalf];
-                }
-                int v = (int)(dSum + 0.5);
-                pDstRow[x * nChannels + c] = (BYTE)max(0, min(255, v));
+                int nSrcY = input.ClampY(y + k) - yLo;
+                const T*     pTmpRow = reinterpret_cast<const T*>(pTmp + nSrcY * nTmpStride);
+                const double w       = kernel[k + nHalf];
+                for (int i = 0; i < nSamples; i++) acc[i] += pTmpRow[i] * w;
             }
+
+            T* pDstRow = output.RowAs<T>(y);
+            for (int i = 0; i < nSamples; i++) pDstRow[i] = PixelTraits<T>::FromDouble(acc[i]);
+            progress.Add();
         }
     }
-    return true;
+    return !progress.IsCancelled();
 }
 
-static bool ApplyBox(const CImageBuffer& input, CImageBuffer& output, int nKernelSize)
+template <typename T>
+static bool ApplyBox(const ConstImageView& input, const ImageView& output, int nKernelSize,
+                     CRowProgress& progress)
 {
-    int nWidth    = input.GetWidth();
-    int nHeight   = input.GetHeight();
-    int nChannels = input.GetChannels();
-    if (!output.Create(nWidth, nHeight, nChannels)) return false;
+    int nWidth    = input.nWidth;
+    int nHeight   = input.nHeight;
+    int nChannels = input.nChannels;
 
     int nHalf = nKernelSize / 2;
     double inv = 1.0 / (nKernelSize * nKernelSize);
 
-    const BYTE* pSrc      = input.GetData();
-    BYTE*       pDst      = output.GetData();
-    int         nSrcStride = input.GetStride();
-    int         nDstStride = output.GetStride();
-
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
-        BYTE* pDstRow = pDst + y * nDstStride;
+        if (progress.IsCancelled()) continue;
+        T* pDstRow = output.RowAs<T>(y);
         for (int x = 0; x < nWidth; x++)
         {
             for (int c = 0; c < nChannels; c++)
             {
-                int sum = 0;
+                double sum = 0;
                 for (int ky = -nHalf; ky <= nHalf; ky++)
                 {
-                    int sy = max(0, min(nHeight - 1, y + ky));
-                    const BYTE* pRow = pSrc + sy * nSrcStride;
+                    const T* pRow = input.RowAs<const T>(input.ClampY(y + ky));
                     for (int kx = -nHalf; kx <= nHalf; kx++)
                     {
-                        int sx = max(0, min(nWidth - 1, x + kx));
+                        int sx = input.ClampX(x + kx);
                         sum += pRow[sx * nChannels + c];
                     }
                 }
-                pDstRow[x * nChannels + c] = (BYTE)max(0, min(255, (int)(sum * inv + 0.5)));
+                pDstRow[x * nChannels + c] = PixelTraits<T>::FromDouble(sum * inv);
             }
         }
+        progress.Add();
     }
-    return true;
+    return !progress.IsCancelled();
 }
 
-static bool ApplyMedian(const CImageBuffer& input, CImageBuffer& output, int nKernelSize)
+template <typename T>
+static bool ApplyMedian(const ConstImageView& input, const ImageView& output, int nKernelSize,
+                        CRowProgress& progress)
 {
-    int nWidth    = input.GetWidth();
-    int nHeight   = input.GetHeight();
-    int nChannels = input.GetChannels();
-    if (!output.Create(nWidth, nHeight, nChannels)) return false;
+    int nWidth    = input.nWidth;
+    int nHeight   = input.nHeight;
+    int nChannels = input.nChannels;
 
     int nHalf   = nKernelSize / 2;
     int nPixels = nKernelSize * nKernelSize;
 
-    const BYTE* pSrc      = input.GetData();
-    BYTE*       pDst      = output.GetData();
-    int         nSrcStride = input.GetStride();
-    int         nDstStride = output.GetStride();
-
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
-        std::vector<BYTE> buf(nPixels);
-        BYTE* pDstRow = pDst + y * nDstStride;
+        if (progress.IsCancelled()) continue;
+        std::vector<T> buf(nPixels);
+        T* pDstRow = output.RowAs<T>(y);
         for (int x = 0; x < nWidth; x++)
         {
             for (int c = 0; c < nChannels; c++)
@@ -220,11 +237,10 @@ static bool ApplyMedian(const CImageBuffer& input, CImageBuffer& output, int nKe
                 int n = 0;
                 for (int ky = -nHalf; ky <= nHalf; ky++)
                 {
-                    int sy = max(0, min(nHeight - 1, y + ky));
-                    const BYTE* pRow = pSrc + sy * nSrcStride;
+                    const T* pRow = input.RowAs<const T>(input.ClampY(y + ky));
                     for (int kx = -nHalf; kx <= nHalf; kx++)
                     {
-                        int sx = max(0, min(nWidth - 1, x + kx));
+                        int sx = input.ClampX(x + kx);
                         buf[n++] = pRow[sx * nChannels + c];
                     }
                 }
@@ -232,33 +248,30 @@ static bool ApplyMedian(const CImageBuffer& input, CImageBuffer& output, int nKe
                 pDstRow[x * nChannels + c] = buf[n / 2];
             }
         }
+        progress.Add();
     }
-    return true;
+    return !progress.IsCancelled();
 }
 
-static bool ApplyBilateral(const CImageBuffer& input, CImageBuffer& output,
-                            int nKernelSize, double dSigmaS)
+template <typename T>
+static bool ApplyBilateral(const ConstImageView& input, const ImageView& output,
+                            int nKernelSize, double dSigmaS, CRowProgress& progress)
 {
-    int nWidth    = input.GetWidth();
-    int nHeight   = input.GetHeight();
-    int nChannels = input.GetChannels();
-    if (!output.Create(nWidth, nHeight, nChannels)) return false;
+    int nWidth    = input.nWidth;
+    int nHeight   = input.nHeight;
+    int nChannels = input.nChannels;
 
     int    nHalf   = nKernelSize / 2;
-    double sigmaR  = 30.0;  // range sigma (color similarity)
+    double sigmaR  = 30.0 * PixelTraits<T>::MaxValue() / 255.0;  // range sigma (color similarity)
     double inv2SS  = 1.0 / (2.0 * dSigmaS * dSigmaS);
     double inv2SR  = 1.0 / (2.0 * sigmaR * sigmaR);
 
-    const BYTE* pSrc      = input.GetData();
-    BYTE*       pDst      = output.GetData();
-    int         nSrcStride = input.GetStride();
-    int         nDstStride = output.GetStride();
-
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
-        BYTE* pDstRow = pDst + y * nDstStride;
-        const BYTE* pCenterRow = pSrc + y * nSrcStride;
+        if (progress.IsCancelled()) continue;
+        T* pDstRow = output.RowAs<T>(y);
+        const T* pCenterRow = input.RowAs<const T>(y);
         for (int x = 0; x < nWidth; x++)
         {
             for (int c = 0; c < nChannels; c++)
@@ -268,11 +281,10 @@ static bool ApplyBilateral(const CImageBuffer& input, CImageBuffer& output,
 
                 for (int ky = -nHalf; ky <= nHalf; ky++)
                 {
-                    int sy = max(0, min(nHeight - 1, y + ky));
-                    const BYTE* pRow = pSrc + sy * nSrcStride;
+                    const T* pRow = input.RowAs<const T>(input.ClampY(y + ky));
                     for (int kx = -nHalf; kx <= nHalf; kx++)
                     {
-                        int sx = max(0, min(nWidth - 1, x + kx));
+                        int sx = input.ClampX(x + kx);
                         double val  = pRow[sx * nChannels + c];
                         double diff = val - centerVal;
                         double ws   = exp(-(ky * ky + kx * kx) * inv2SS);
@@ -282,32 +294,80 @@ static bool ApplyBilateral(const CImageBuffer& input, CImageBuffer& output,
                         vSum += w * val;
                     }
                 }
-                int v = (wSum > 0) ? (int)(vSum / wSum + 0.5) : (int)centerVal;
-                pDstRow[x * nChannels + c] = (BYTE)max(0, min(255, v));
+                pDstRow[x * nChannels + c] = PixelTraits<T>::FromDouble((wSum > 0) ? vSum / wSum : centerVal);
             }
         }
+        progress.Add();
+    }
+    return !progress.IsCancelled();
+}
+
+template <typename T>
+static bool ApplyBlur(const ConstImageView& input, const ImageView& output,
+                      int nMethod, int nKernelSize, double dSigma, CRowProgress& progress)
+{
+    switch (nMethod)
+    {
+    case 1: return ApplyBilateral<T>(input, output, nKernelSize, dSigma, progress);
+    case 2: return ApplyMedian<T>(input, output, nKernelSize, progress);
+    case 3: return ApplyBox<T>(input, output, nKernelSize, progress);
+    default: return ApplyGaussian<T>(input, output, nKernelSize, dSigma, progress);
+    }
+}
+
+// One interleaved view, or one plane
+static bool BlurView(const ConstImageView& input, const ImageView& output,
+                     int nMethod, int nKernelSize, double dSigma, CRowProgress& progress)
+{
+    switch (input.eDepth)
+    {
+    case PixelDepth::U16: return ApplyBlur<unsigned short>(input, output, nMethod, nKernelSize, dSigma, progress);
+    case PixelDepth::F32: return ApplyBlur<float>(input, output, nMethod, nKernelSize, dSigma, progress);
+    default:              return ApplyBlur<BYTE>(input, output, nMethod, nKernelSize, dSigma, progress);
     }
-    return true;
 }
 
 bool CGaussianBlur::Process(const CImageBuffer& input, CImageBuffer& output)
 {
     if (!input.IsValid()) return false;
+    if (!output.Create(input.GetWidth(), input.GetHeight(), input.GetChannels(), input.GetDepth(), input.GetLayout()))
+        return false;
+    return ProcessView(input.GetConstView(), output.GetView());
+}
+
+bool CGaussianBlur::ProcessView(const ConstImageView& input, const ImageView& output)
+{
+    if (!input.IsValid() || !output.IsValid() || input.eDepth != output.eDepth) return false;
+    if (input.IsPlanar() != output.IsPlanar()) return false;
 
     int nMethod     = (int)m_params[0].dCurrentVal;
     int nKernelSize = (int)m_params[1].dCurrentVal;
     double dSigma   = m_params[2].dCurrentVal;
 
     if (nKernelSize % 2 == 0) nKernelSize++;
-    nKernelSize = max(3, min(31, nKernelSize));
+    nKernelSize = std::max(3, std::min(31, nKernelSize));
 
-    switch (nMethod)
+    // Gaussian makes two passes over the rows (the first also over the halo rows it reads)
+    const int nPlanes = input.IsPlanar() ? input.nChannels : 1;
+    const int nPasses = (nMethod == 1 || nMethod == 2 || nMethod == 3) ? 1 : 2;
+    CRowProgress progress(*this, (long long)nPlanes * (nPasses * input.nHeight + (nPasses - 1) * (nKernelSize - 1)));
+
+    // Planar: the single-channel kernels run once per plane
+    if (input.IsPlanar())
     {
-    case 1: return ApplyBilateral(input, output, nKernelSize, dSigma);
-    case 2: return ApplyMedian(input, output, nKernelSize);
-    case 3: return ApplyBox(input, output, nKernelSize);
-    default: return ApplyGaussian(input, output, nKernelSize, dSigma);
+        for (int c = 0; c < input.nChannels; c++)
+            if (!BlurView(input.Plane(c), output.Plane(c), nMethod, nKernelSize, dSigma, progress)) return false;
+        return true;
     }
+    return BlurView(input, output, nMethod, nKernelSize, dSigma, progress);
 }
 
 CAlgorithmBase* CGaussianBlur::Clone() const { return new CGaussianBlur(*this); }
+
+int CGaussianBlur::GetNeighbourhoodRadius() const
+{
+    int nKernelSize = (int)m_params[1].dCurrentVal;
+    if (nKernelSize % 2 == 0) nKernelSize++;
+    nKernelSize = std::max(3, std::min(31, nKernelSize));
+    return nKernelSize / 2;
+}
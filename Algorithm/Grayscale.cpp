@@ -1,4 +1,3 @@
-#include "stdafx.h"
 #include "Algorithm/Grayscale.h"
 #include <cmath>
 #include <algorithm>
@@ -12,15 +11,15 @@ CGrayscale::CGrayscale()
     // Channel mode parameter
     // 0=Luminance, 1=R, 2=G, 3=B, 4=H(Hue), 5=S(Sat), 6=V(Val)
     AlgorithmParam paramMode;
-    paramMode.strName        = _T("채널");
-    paramMode.strDescription = _T("추출할 채널을 선택하세요");
+    paramMode.strName        = L"채널";
+    paramMode.strDescription = L"추출할 채널을 선택하세요";
     paramMode.dMinVal        = 0.0;
     paramMode.dMaxVal        = 6.0;
     paramMode.dDefaultVal    = 0.0;
     paramMode.dCurrentVal    = 0.0;
     paramMode.nPrecision     = 0;
-    paramMode.vecOptions     = { _T("휘도(Luminance)"), _T("빨강(R)"), _T("녹색(G)"),
-                                  _T("파랑(B)"), _T("색조(H)"), _T("채도(S)"), _T("명도(V)") };
+    paramMode.vecOptions     = { L"휘도(Luminance)", L"빨강(R)", L"녹색(G)",
+                                  L"파랑(B)", L"색조(H)", L"채도(S)", L"명도(V)" };
     m_params.push_back(paramMode);
 }
 
@@ -28,14 +27,14 @@ CGrayscale::~CGrayscale()
 {
 }
 
-CString CGrayscale::GetName() const
+std::wstring CGrayscale::GetName() const
 {
-    return _T("Grayscale");
+    return L"Grayscale";
 }
 
-CString CGrayscale::GetDescription() const
+std::wstring CGrayscale::GetDescription() const
 {
-    return _T("Channel separation: Luminance / R / G / B / H / S / V");
+    return L"Channel separation: Luminance / R / G / B / H / S / V";
 }
 
 std::vector<AlgorithmParam>& CGrayscale::GetParams()
@@ -97,10 +96,12 @@ bool CGrayscale::Process(const CImageBuffer& input, CImageBuffer& output)
     BYTE*       pDst   = output.GetData();
     int nSrcStride     = input.GetStride();
     int nDstStride     = output.GetStride();
+    CRowProgress progress(*this, nHeight);
 
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
+        if (progress.IsCancelled()) continue;
         const BYTE* pSrcRow = pSrc + y * nSrcStride;
         BYTE*       pDstRow = pDst + y * nDstStride;
 
@@ -139,8 +140,27 @@ bool CGrayscale::Process(const CImageBuffer& input, CImageBuffer& output)
             }
             pDstRow[x] = bOut;
         }
+        progress.Add();
     }
 
+    return !progress.IsCancelled();
+}
+
+// Luminance and the single-channel modes are weighted sums of B (channel 0), G and R; the HSV
+// modes are not, so those runs are not fused
+bool CGrayscale::GetPointwiseMap(PointwiseMap& map) const
+{
+    static const int kWeights[4][3] = { { 29, 150, 77 }, { 0, 0, 256 }, { 0, 256, 0 }, { 256, 0, 0 } };
+
+    int nMode = std::max(0, std::min(6, (int)m_params[0].dCurrentVal));
+    if (nMode > 3)
+        return false;
+
+    map.bReduce = true;
+    for (int c = 0; c < 3; c++)
+        map.weights[c] = kWeights[nMode][c];
+    for (int v = 0; v < 256; v++)
+        map.lut[v] = (BYTE)v;
     return true;
 }
 
@@ -6,10 +6,12 @@ public:
     CGrayscale();
     virtual ~CGrayscale();
 
-    virtual CString GetName() const override;
-    virtual CString GetDescription() const override;
+    virtual std::wstring GetName() const override;
+    virtual std::wstring GetDescription() const override;
     virtual std::vector<AlgorithmParam>& GetParams() override;
     virtual bool Process(const CImageBuffer& input, CImageBuffer& output) override;
+    virtual int GetNeighbourhoodRadius() const override { return 0; }
+    virtual bool GetPointwiseMap(PointwiseMap& map) const override;
     virtual CAlgorithmBase* Clone() const override;
 
     // Channel modes:
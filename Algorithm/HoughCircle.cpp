@@ -1,5 +1,5 @@
-#include "stdafx.h"
 #include "Algorithm/HoughCircle.h"
+#include "Core/Profiler.h"
 #include <cmath>
 #include <vector>
 #include <algorithm>
@@ -16,26 +16,26 @@ CHoughCircle::CHoughCircle()
 {
     AlgorithmParam p;
 
-    p.strName = _T("최소 반지름"); p.strDescription = _T("검출할 원의 최소 반지름 (픽셀 단위)");
+    p.strName = L"최소 반지름"; p.strDescription = L"검출할 원의 최소 반지름 (픽셀 단위)";
     p.dMinVal = 5.0; p.dMaxVal = 300.0; p.dDefaultVal = 20.0; p.dCurrentVal = 20.0; p.nPrecision = 0;
     m_params.push_back(p);
 
-    p.strName = _T("최대 반지름"); p.strDescription = _T("검출할 원의 최대 반지름 (픽셀 단위)");
+    p.strName = L"최대 반지름"; p.strDescription = L"검출할 원의 최대 반지름 (픽셀 단위)";
     p.dMinVal = 10.0; p.dMaxVal = 500.0; p.dDefaultVal = 100.0; p.dCurrentVal = 100.0; p.nPrecision = 0;
     m_params.push_back(p);
 
-    p.strName = _T("검출 임계값"); p.strDescription = _T("원 검출 기준값 — 낮을수록 더 많은 원을 검출 (오검출 주의)");
+    p.strName = L"검출 임계값"; p.strDescription = L"원 검출 기준값 — 낮을수록 더 많은 원을 검출 (오검출 주의)";
     p.dMinVal = 10.0; p.dMaxVal = 255.0; p.dDefaultVal = 80.0; p.dCurrentVal = 80.0; p.nPrecision = 0;
     m_params.push_back(p);
 
-    p.strName = _T("최소 간격"); p.strDescription = _T("검출된 원 중심 사이의 최소 거리 (픽셀) — 중복 제거용");
+    p.strName = L"최소 간격"; p.strDescription = L"검출된 원 중심 사이의 최소 거리 (픽셀) — 중복 제거용";
     p.dMinVal = 5.0; p.dMaxVal = 500.0; p.dDefaultVal = 30.0; p.dCurrentVal = 30.0; p.nPrecision = 0;
     m_params.push_back(p);
 }
 
 CHoughCircle::~CHoughCircle() {}
-CString CHoughCircle::GetName() const        { return _T("Hough Circle"); }
-CString CHoughCircle::GetDescription() const { return _T("Circle detection via Hough transform"); }
+std::wstring CHoughCircle::GetName() const        { return L"Hough Circle"; }
+std::wstring CHoughCircle::GetDescription() const { return L"Circle detection via Hough transform"; }
 std::vector<AlgorithmParam>& CHoughCircle::GetParams() { return m_params; }
 
 // Draw anti-aliased circle outline on image buffer
@@ -92,14 +92,23 @@ bool CHoughCircle::Process(const CImageBuffer& input, CImageBuffer& output)
     int nThresh  = (int)m_params[2].dCurrentVal;
     int nMinDist = (int)m_params[3].dCurrentVal;
 
-    nMinR = max(2, nMinR);
-    nMaxR = max(nMinR + 1, nMaxR);
+    nMinR = std::max(2, nMinR);
+    nMaxR = std::max(nMinR + 1, nMaxR);
+
+    // Radius stride limits the radius resolution to about 30 accumulators
+    int nRadiiStep = std::max(1, (nMaxR - nMinR) / 30 + 1);
+    const int nRadii = (nMaxR - nMinR) / nRadiiStep + 1;
+
+    // Gray and edge rows, then every radius votes over the rows and scans its accumulator
+    CRowProgress progress(*this, (long long)nHeight * (2 + 2 * nRadii));
 
     // Convert to grayscale
+    CProfileScope phase("phase", "Hough Circle: gray");
     std::vector<BYTE> gray(nWidth * nHeight);
     const BYTE* pSrc = input.GetData();
     for (int y = 0; y < nHeight; y++)
     {
+        if (progress.IsCancelled()) return false;
         const BYTE* pRow = pSrc + y * nStride;
         for (int x = 0; x < nWidth; x++)
         {
@@ -108,18 +117,22 @@ bool CHoughCircle::Process(const CImageBuffer& input, CImageBuffer& output)
             else
             {
                 int g = (int)(0.299 * pRow[x*3+2] + 0.587 * pRow[x*3+1] + 0.114 * pRow[x*3] + 0.5);
-                gray[y * nWidth + x] = (BYTE)max(0, min(255, g));
+                gray[y * nWidth + x] = (BYTE)std::max(0, std::min(255, g));
             }
         }
+        progress.Add();
     }
 
     // Simple edge detection using Sobel
+    phase.Next("Hough Circle: edges");
     std::vector<BYTE> edges(nWidth * nHeight, 0);
     {
         static const int sobelGx[3][3] = {{-1,0,1},{-2,0,2},{-1,0,1}};
         static const int sobelGy[3][3] = {{-1,-2,-1},{0,0,0},{1,2,1}};
         int edgeThresh = 30;
         for (int y = 1; y < nHeight - 1; y++)
+        {
+            if (progress.IsCancelled()) return false;
             for (int x = 1; x < nWidth - 1; x++)
             {
                 int gx = 0, gy = 0;
@@ -133,21 +146,27 @@ bool CHoughCircle::Process(const CImageBuffer& input, CImageBuffer& output)
                 int mag = (int)sqrt((double)(gx*gx + gy*gy));
                 edges[y * nWidth + x] = (mag > edgeThresh) ? 255 : 0;
             }
+            progress.Add();
+        }
+        progress.Add(2);   // border rows
     }
 
     // Hough accumulator (indexed by [cy][cx] per radius)
     // Use radius stride to save memory: process each r separately
-    int nRadiiStep = max(1, (nMaxR - nMinR) / 30 + 1);  // limit radius resolution
 
     std::vector<std::tuple<int,int,int,int>> detectedCircles;  // (x, y, r, votes)
 
+    // The radii spans below land on the worker threads' lanes, inside this one
+    phase.Next("Hough Circle: radii");
 #pragma omp parallel for schedule(dynamic, 1)
     for (int r = nMinR; r <= nMaxR; r += nRadiiStep)
     {
+        if (progress.IsCancelled()) continue;
+        CProfileScope radiusPhase("phase", "Hough Circle: vote");
         std::vector<int> acc(nWidth * nHeight, 0);
 
         // Precompute sin/cos for this radius
-        int nAngles = max(36, (int)(2.0 * M_PI * r));
+        int nAngles = std::max(36, (int)(2.0 * M_PI * r));
         std::vector<int> cosTab(nAngles), sinTab(nAngles);
         for (int a = 0; a < nAngles; a++)
         {
@@ -157,7 +176,8 @@ bool CHoughCircle::Process(const CImageBuffer& input, CImageBuffer& output)
         }
 
         // Vote (each radius has its own acc — no race condition)
-        for (int y = 1; y < nHeight - 1; y++)
+        for (int y = 1; y < nHeight - 1 && !progress.IsCancelled(); y++)
+        {
             for (int x = 1; x < nWidth - 1; x++)
                 if (edges[y * nWidth + x])
                     for (int a = 0; a < nAngles; a++)
@@ -167,13 +187,19 @@ bool CHoughCircle::Process(const CImageBuffer& input, CImageBuffer& output)
                         if (cx >= 0 && cx < nWidth && cy >= 0 && cy < nHeight)
                             acc[cy * nWidth + cx]++;
                     }
+            progress.Add();
+        }
+        if (progress.IsCancelled()) continue;
+        progress.Add(2 + 2 * r);   // rows the vote and the peak scan skip
 
         // Normalize threshold by number of edge points
         int localThresh = (int)(nThresh * nAngles / 100);
 
         // Find peaks with NMS → collect into thread-local list
+        radiusPhase.Next("Hough Circle: NMS");
         std::vector<std::tuple<int,int,int,int>> localCircles;
         for (int cy = r; cy < nHeight - r; cy++)
+        {
             for (int cx = r; cx < nWidth - r; cx++)
             {
                 int v = acc[cy * nWidth + cx];
@@ -187,6 +213,8 @@ bool CHoughCircle::Process(const CImageBuffer& input, CImageBuffer& output)
                 if (bMax)
                     localCircles.push_back({ cx, cy, r, v });
             }
+            progress.Add();
+        }
 
         // Merge into shared list (with min-distance filtering)
 #pragma omp critical
@@ -206,7 +234,10 @@ bool CHoughCircle::Process(const CImageBuffer& input, CImageBuffer& output)
         }
     }
 
+    if (progress.IsCancelled()) return false;
+
     // Sort by votes descending, keep top 50
+    phase.Next("Hough Circle: draw");
     std::sort(detectedCircles.begin(), detectedCircles.end(),
         [](const auto& a, const auto& b) { return std::get<3>(a) > std::get<3>(b); });
     if (detectedCircles.size() > 50) detectedCircles.resize(50);
@@ -1,5 +1,5 @@
-#include "stdafx.h"
 #include "Algorithm/HoughLine.h"
+#include "Core/Profiler.h"
 #include <cmath>
 #include <vector>
 #include <algorithm>
@@ -17,28 +17,28 @@ CHoughLine::CHoughLine()
 {
     AlgorithmParam p;
 
-    p.strName = _T("방식"); p.strDescription = _T("라인 검출 방식을 선택하세요");
+    p.strName = L"방식"; p.strDescription = L"라인 검출 방식을 선택하세요";
     p.dMinVal = 0; p.dMaxVal = 1; p.dDefaultVal = 0; p.dCurrentVal = 0; p.nPrecision = 0;
-    p.vecOptions = { _T("표준(무한선)"), _T("확률적(선분 추출)") };
+    p.vecOptions = { L"표준(무한선)", L"확률적(선분 추출)" };
     m_params.push_back(p);
 
     p.vecOptions.clear();
-    p.strName = _T("검출 임계값"); p.strDescription = _T("라인 검출 기준 투표 수 — 높을수록 강한 라인만 검출");
+    p.strName = L"검출 임계값"; p.strDescription = L"라인 검출 기준 투표 수 — 높을수록 강한 라인만 검출";
     p.dMinVal = 10; p.dMaxVal = 300; p.dDefaultVal = 80; p.dCurrentVal = 80; p.nPrecision = 0;
     m_params.push_back(p);
 
-    p.strName = _T("최소 선분 길이"); p.strDescription = _T("검출할 선분의 최소 길이 (확률적 방식 전용, 픽셀)");
+    p.strName = L"최소 선분 길이"; p.strDescription = L"검출할 선분의 최소 길이 (확률적 방식 전용, 픽셀)";
     p.dMinVal = 5; p.dMaxVal = 500; p.dDefaultVal = 30; p.dCurrentVal = 30; p.nPrecision = 0;
     m_params.push_back(p);
 
-    p.strName = _T("최대 허용 간격"); p.strDescription = _T("선분 사이 최대 허용 간격 (확률적 방식 전용, 픽셀)");
+    p.strName = L"최대 허용 간격"; p.strDescription = L"선분 사이 최대 허용 간격 (확률적 방식 전용, 픽셀)";
     p.dMinVal = 1; p.dMaxVal = 100; p.dDefaultVal = 10; p.dCurrentVal = 10; p.nPrecision = 0;
     m_params.push_back(p);
 }
 
 CHoughLine::~CHoughLine() {}
-CString CHoughLine::GetName() const        { return _T("Hough Line"); }
-CString CHoughLine::GetDescription() const { return _T("Line / angle detection via Hough transform"); }
+std::wstring CHoughLine::GetName() const        { return L"Hough Line"; }
+std::wstring CHoughLine::GetDescription() const { return L"Line / angle detection via Hough transform"; }
 std::vector<AlgorithmParam>& CHoughLine::GetParams() { return m_params; }
 
 // Draw a line segment from (x0,y0) to (x1,y1) using Bresenham with thickness
@@ -88,8 +88,10 @@ static void RunStandardHough(
     int nWidth, int nHeight,
     int nThreshold,
     CImageBuffer& output,
-    const std::vector<BYTE>& gray)
+    const std::vector<BYTE>& gray,
+    CRowProgress& progress)
 {
+    CProfileScope phase("phase", "Hough Line: vote");
     double maxRho = sqrt((double)(nWidth*nWidth + nHeight*nHeight));
     int nRho   = (int)(2 * maxRho) + 1;
     int nTheta = 180;
@@ -112,6 +114,7 @@ static void RunStandardHough(
 #pragma omp parallel for schedule(dynamic, 8) num_threads(nT)
         for (int y = 0; y < nHeight; y++)
         {
+            if (progress.IsCancelled()) continue;
             int tid = omp_get_thread_num();
             auto& myAcc = tAcc[tid];
             for (int x = 0; x < nWidth; x++)
@@ -122,13 +125,17 @@ static void RunStandardHough(
                         if (rho >= 0 && rho < nRho)
                             myAcc[rho * nTheta + t]++;
                     }
+            progress.Add();
         }
+        if (progress.IsCancelled()) return;
         for (int tid = 0; tid < nT; tid++)
             for (int i = 0; i < nRho * nTheta; i++)
                 acc[i] += tAcc[tid][i];
     }
 #else
     for (int y = 0; y < nHeight; y++)
+    {
+        if (progress.IsCancelled()) return;
         for (int x = 0; x < nWidth; x++)
             if (edges[y*nWidth+x])
                 for (int t = 0; t < nTheta; t++)
@@ -137,9 +144,12 @@ static void RunStandardHough(
                     if (rho >= 0 && rho < nRho)
                         acc[rho * nTheta + t]++;
                 }
+        progress.Add();
+    }
 #endif
 
     // Collect local maxima
+    phase.Next("Hough Line: NMS");
     struct Line { double rho, theta; int votes; };
     std::vector<Line> lines;
 
@@ -156,6 +166,7 @@ static void RunStandardHough(
                 lines.push_back({r - maxRho, t * M_PI / 180.0, v});
         }
 
+    phase.Next("Hough Line: draw");
     std::sort(lines.begin(), lines.end(),
         [](const Line& a, const Line& b){ return a.votes > b.votes; });
     if (lines.size() > 100) lines.resize(100);
@@ -197,7 +208,8 @@ static void RunProbabilisticHough(
     const std::vector<BYTE>& edges,
     int nWidth, int nHeight,
     int nThreshold, int nMinLength, int nMaxGap,
-    CImageBuffer& output)
+    CImageBuffer& output,
+    CRowProgress& progress)
 {
     double maxRho = sqrt((double)(nWidth*nWidth + nHeight*nHeight));
     int nRho   = (int)(2 * maxRho) + 1;
@@ -212,14 +224,19 @@ static void RunProbabilisticHough(
     }
 
     // Collect edge pixels
-    std::vector<CPoint> edgePts;
+    CProfileScope phase("phase", "Hough Line: sample");
+    std::vector<ImagePoint> edgePts;
     edgePts.reserve(nWidth * nHeight / 4);
     for (int y = 0; y < nHeight; y++)
         for (int x = 0; x < nWidth; x++)
             if (edges[y*nWidth+x])
-                edgePts.push_back(CPoint(x, y));
+                edgePts.push_back(ImagePoint(x, y));
 
-    if (edgePts.empty()) return;
+    if (edgePts.empty())
+    {
+        progress.Add(nHeight);
+        return;
+    }
 
     // Shuffle for random sampling
     std::mt19937 rng(42);
@@ -238,8 +255,21 @@ static void RunProbabilisticHough(
     };
     const int nColCount = 6;
 
-    for (const CPoint& pt : edgePts)
+    // Progress counts the sampled points as a share of the image rows
+    phase.Next("Hough Line: segments");
+    const long long nPts = (long long)edgePts.size();
+    long long nRowsDone = 0;
+    for (long long i = 0; i < nPts; i++)
     {
+        if (progress.IsCancelled()) return;
+        const long long nRows = (i + 1) * nHeight / nPts;
+        if (nRows > nRowsDone)
+        {
+            progress.Add(nRows - nRowsDone);
+            nRowsDone = nRows;
+        }
+
+        const ImagePoint& pt = edgePts[(size_t)i];
         int px = pt.x, py = pt.y;
         if (!mask[py * nWidth + px]) continue;  // already consumed
 
@@ -266,7 +296,6 @@ static void RunProbabilisticHough(
         if (bestVotes < nThreshold) continue;
 
         // Found a line: extract segment along this rho/theta
-        double theta = bestTheta * M_PI / 180.0;
         double cosT  = cosTab[bestTheta];
         double sinT  = sinTab[bestTheta];
         double rhoVal = bestRho - maxRho;
@@ -276,7 +305,7 @@ static void RunProbabilisticHough(
 
         // Project all edge pixels onto this line and find extents
         // Collect points near the (rho,theta) line
-        std::vector<std::pair<double,CPoint>> onLine;
+        std::vector<std::pair<double,ImagePoint>> onLine;
         for (int y2 = 0; y2 < nHeight; y2++)
             for (int x2 = 0; x2 < nWidth; x2++)
             {
@@ -285,28 +314,28 @@ static void RunProbabilisticHough(
                 if (dist < 1.5)
                 {
                     double proj = x2 * lineX + y2 * lineY;
-                    onLine.push_back({proj, CPoint(x2, y2)});
+                    onLine.push_back({proj, ImagePoint(x2, y2)});
                 }
             }
 
         if (onLine.empty()) continue;
 
         std::sort(onLine.begin(), onLine.end(),
-            [](const std::pair<double,CPoint>& a, const std::pair<double,CPoint>& b){
+            [](const std::pair<double,ImagePoint>& a, const std::pair<double,ImagePoint>& b){
                 return a.first < b.first;
             });
 
         // Walk along sorted projections, extract segments (gap-limited)
         double segStart = onLine[0].first;
         double prevProj = onLine[0].first;
-        CPoint ptStart  = onLine[0].second;
-        CPoint ptEnd    = onLine[0].second;
+        ImagePoint ptStart  = onLine[0].second;
+        ImagePoint ptEnd    = onLine[0].second;
 
         // Mark voted pixels as consumed
         for (auto& entry : onLine)
         {
             double proj = entry.first;
-            CPoint p    = entry.second;
+            ImagePoint p    = entry.second;
 
             if (proj - prevProj > nMaxGap)
             {
@@ -342,6 +371,7 @@ static void RunProbabilisticHough(
     }
 
     // Draw detected segments
+    phase.Next("Hough Line: draw");
     for (int i = 0; i < (int)segments.size(); i++)
     {
         const Segment& s = segments[i];
@@ -365,11 +395,16 @@ bool CHoughLine::Process(const CImageBuffer& input, CImageBuffer& output)
     int nMinLength = (int)m_params[2].dCurrentVal;
     int nMaxGap    = (int)m_params[3].dCurrentVal;
 
+    // Gray and edge rows, then the vote (one pass over the rows, or over the sampled points)
+    CRowProgress progress(*this, (long long)nHeight * 3);
+
     // Convert to grayscale
+    CProfileScope phase("phase", "Hough Line: gray");
     std::vector<BYTE> gray(nWidth * nHeight);
     const BYTE* pSrc = input.GetData();
     for (int y = 0; y < nHeight; y++)
     {
+        if (progress.IsCancelled()) return false;
         const BYTE* pRow = pSrc + y * nStride;
         for (int x = 0; x < nWidth; x++)
         {
@@ -378,18 +413,22 @@ bool CHoughLine::Process(const CImageBuffer& input, CImageBuffer& output)
             else
             {
                 int g = (int)(0.299*pRow[x*3+2] + 0.587*pRow[x*3+1] + 0.114*pRow[x*3] + 0.5);
-                gray[y*nWidth+x] = (BYTE)max(0, min(255, g));
+                gray[y*nWidth+x] = (BYTE)std::max(0, std::min(255, g));
             }
         }
+        progress.Add();
     }
 
     // Edge detection: Sobel + threshold
+    phase.Next("Hough Line: edges");
     std::vector<BYTE> edges(nWidth * nHeight, 0);
     {
         static const int sobelGx[3][3] = {{-1,0,1},{-2,0,2},{-1,0,1}};
         static const int sobelGy[3][3] = {{-1,-2,-1},{0,0,0},{1,2,1}};
 #pragma omp parallel for schedule(static)
         for (int y = 1; y < nHeight-1; y++)
+        {
+            if (progress.IsCancelled()) continue;
             for (int x = 1; x < nWidth-1; x++)
             {
                 int gx = 0, gy = 0;
@@ -403,9 +442,14 @@ bool CHoughLine::Process(const CImageBuffer& input, CImageBuffer& output)
                 int mag = (int)sqrt((double)(gx*gx + gy*gy));
                 edges[y*nWidth+x] = (mag > 30) ? 255 : 0;
             }
+            progress.Add();
+        }
+        progress.Add(2);   // border rows
     }
+    if (progress.IsCancelled()) return false;
 
     // Create output image (3-channel for colored lines)
+    phase.Next("Hough Line: output");
     if (nChannels == 1)
     {
         if (!output.Create(nWidth, nHeight, 3)) return false;
@@ -427,13 +471,14 @@ bool CHoughLine::Process(const CImageBuffer& input, CImageBuffer& output)
         if (!output.IsValid()) return false;
     }
 
-    // Run selected method
+    // Run selected method (it times its own phases)
+    phase.End();
     if (nMethod == 0)
-        RunStandardHough(edges, nWidth, nHeight, nThreshold, output, gray);
+        RunStandardHough(edges, nWidth, nHeight, nThreshold, output, gray, progress);
     else
-        RunProbabilisticHough(edges, nWidth, nHeight, nThreshold, nMinLength, nMaxGap, output);
+        RunProbabilisticHough(edges, nWidth, nHeight, nThreshold, nMinLength, nMaxGap, output, progress);
 
-    return true;
+    return !progress.IsCancelled();
 }
 
 CAlgorithmBase* CHoughLine::Clone() const { return new CHoughLine(*this); }
@@ -5,8 +5,8 @@ class CHoughLine : public CAlgorithmBase {
 public:
     CHoughLine();
     virtual ~CHoughLine();
-    virtual CString GetName() const override;
-    virtual CString GetDescription() const override;
+    virtual std::wstring GetName() const override;
+    virtual std::wstring GetDescription() const override;
     virtual std::vector<AlgorithmParam>& GetParams() override;
     virtual bool Process(const CImageBuffer& input, CImageBuffer& output) override;
     virtual CAlgorithmBase* Clone() const override;
@@ -1,4 +1,3 @@
-#include "stdafx.h"
 #include "Algorithm/Invert.h"
 
 #ifdef _OPENMP
@@ -7,34 +6,50 @@
 
 CInvert::CInvert() {}
 CInvert::~CInvert() {}
-CString CInvert::GetName() const        { return _T("Invert"); }
-CString CInvert::GetDescription() const { return _T("Invert pixel values"); }
+std::wstring CInvert::GetName() const        { return L"Invert"; }
+std::wstring CInvert::GetDescription() const { return L"Invert pixel values"; }
 std::vector<AlgorithmParam>& CInvert::GetParams() { return m_params; }
 
 bool CInvert::Process(const CImageBuffer& input, CImageBuffer& output)
 {
     if (!input.IsValid()) return false;
+    if (!output.Create(input.GetWidth(), input.GetHeight(), input.GetChannels())) return false;
+    return ProcessView(input.GetConstView(), output.GetView());
+}
 
-    int nWidth    = input.GetWidth();
-    int nHeight   = input.GetHeight();
-    int nChannels = input.GetChannels();
+bool CInvert::ProcessView(const ConstImageView& input, const ImageView& output)
+{
+    if (!input.IsValid() || !output.IsValid()) return false;
 
-    if (!output.Create(nWidth, nHeight, nChannels)) return false;
+    int nWidth    = input.nWidth;
+    int nHeight   = input.nHeight;
+    int nChannels = input.nChannels;
 
-    const BYTE* pSrc      = input.GetData();
-    BYTE*       pDst      = output.GetData();
-    int         nSrcStride = input.GetStride();
-    int         nDstStride = output.GetStride();
+    const BYTE* pSrc      = input.pData;
+    BYTE*       pDst      = output.pData;
+    int         nSrcStride = input.nStride;
+    int         nDstStride = output.nStride;
+    CRowProgress progress(*this, nHeight);
 
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
+        if (progress.IsCancelled()) continue;
         const BYTE* pSrcRow = pSrc + y * nSrcStride;
         BYTE*       pDstRow = pDst + y * nDstStride;
         for (int x = 0; x < nWidth * nChannels; x++)
             pDstRow[x] = 255 - pSrcRow[x];
+        progress.Add();
     }
 
+    return !progress.IsCancelled();
+}
+
+bool CInvert::GetPointwiseMap(PointwiseMap& map) const
+{
+    map.bReduce = false;
+    for (int v = 0; v < 256; v++)
+        map.lut[v] = (BYTE)(255 - v);
     return true;
 }
 
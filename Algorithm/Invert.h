@@ -5,10 +5,14 @@ class CInvert : public CAlgorithmBase {
 public:
     CInvert();
     virtual ~CInvert();
-    virtual CString GetName() const override;
-    virtual CString GetDescription() const override;
+    virtual std::wstring GetName() const override;
+    virtual std::wstring GetDescription() const override;
     virtual std::vector<AlgorithmParam>& GetParams() override;
     virtual bool Process(const CImageBuffer& input, CImageBuffer& output) override;
+    virtual bool SupportsViews() const override { return true; }
+    virtual bool ProcessView(const ConstImageView& input, const ImageView& output) override;
+    virtual int GetNeighbourhoodRadius() const override { return 0; }
+    virtual bool GetPointwiseMap(PointwiseMap& map) const override;
     virtual CAlgorithmBase* Clone() const override;
 private:
     std::vector<AlgorithmParam> m_params;
@@ -1,5 +1,5 @@
-#include "stdafx.h"
 #include "Algorithm/Morphology.h"
+#include "Core/Profiler.h"
 #include <cmath>
 #include <algorithm>
 
@@ -10,21 +10,21 @@
 CMorphology::CMorphology()
 {
     AlgorithmParam paramOperation;
-    paramOperation.strName        = _T("연산");
-    paramOperation.strDescription = _T("모폴로지 연산을 선택하세요");
+    paramOperation.strName        = L"연산";
+    paramOperation.strDescription = L"모폴로지 연산을 선택하세요";
     paramOperation.dMinVal        = 0.0;
     paramOperation.dMaxVal        = 5.0;
     paramOperation.dDefaultVal    = 0.0;
     paramOperation.dCurrentVal    = 0.0;
     paramOperation.nPrecision     = 0;
-    paramOperation.vecOptions     = { _T("침식(Erode)"), _T("팽창(Dilate)"),
-                                       _T("열기(Open)"), _T("닫기(Close)"),
-                                       _T("탑햇(Top Hat)"), _T("블랙햇(Black Hat)") };
+    paramOperation.vecOptions     = { L"침식(Erode)", L"팽창(Dilate)",
+                                       L"열기(Open)", L"닫기(Close)",
+                                       L"탑햇(Top Hat)", L"블랙햇(Black Hat)" };
     m_params.push_back(paramOperation);
 
     AlgorithmParam paramKernelSize;
-    paramKernelSize.strName        = _T("커널 크기");
-    paramKernelSize.strDescription = _T("구조 요소(커널) 크기 (홀수, 클수록 효과가 강함)");
+    paramKernelSize.strName        = L"커널 크기";
+    paramKernelSize.strDescription = L"구조 요소(커널) 크기 (홀수, 클수록 효과가 강함)";
     paramKernelSize.dMinVal        = 3.0;
     paramKernelSize.dMaxVal        = 21.0;
     paramKernelSize.dDefaultVal    = 3.0;
@@ -33,8 +33,8 @@ CMorphology::CMorphology()
     m_params.push_back(paramKernelSize);
 
     AlgorithmParam paramIterations;
-    paramIterations.strName        = _T("반복 횟수");
-    paramIterations.strDescription = _T("연산 반복 횟수 (횟수가 많을수록 효과가 강해짐)");
+    paramIterations.strName        = L"반복 횟수";
+    paramIterations.strDescription = L"연산 반복 횟수 (횟수가 많을수록 효과가 강해짐)";
     paramIterations.dMinVal        = 1.0;
     paramIterations.dMaxVal        = 10.0;
     paramIterations.dDefaultVal    = 1.0;
@@ -45,8 +45,8 @@ CMorphology::CMorphology()
 
 CMorphology::~CMorphology() {}
 
-CString CMorphology::GetName() const        { return _T("Morphology"); }
-CString CMorphology::GetDescription() const { return _T("Erode/Dilate/Open/Close/TopHat/BlackHat"); }
+std::wstring CMorphology::GetName() const        { return L"Morphology"; }
+std::wstring CMorphology::GetDescription() const { return L"Erode/Dilate/Open/Close/TopHat/BlackHat"; }
 std::vector<AlgorithmParam>& CMorphology::GetParams() { return m_params; }
 
 int CMorphology::ClampCoord(int val, int maxVal)
@@ -56,13 +56,13 @@ int CMorphology::ClampCoord(int val, int maxVal)
     return val;
 }
 
-bool CMorphology::ConvertToGrayscale(const CImageBuffer& input, CImageBuffer& output)
+bool CMorphology::ConvertToGrayscale(const CImageBuffer& input, CImageBuffer& output, CRowProgress& progress)
 {
     int nWidth    = input.GetWidth();
     int nHeight   = input.GetHeight();
     int nChannels = input.GetChannels();
 
-    if (nChannels == 1) { output = input.Clone(); return output.IsValid(); }
+    if (nChannels == 1) { output = input.Clone(); progress.Add(nHeight); return output.IsValid(); }
 
     if (!output.Create(nWidth, nHeight, 1)) return false;
 
@@ -74,18 +74,20 @@ bool CMorphology::ConvertToGrayscale(const CImageBuffer& input, CImageBuffer& ou
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
+        if (progress.IsCancelled()) continue;
         const BYTE* pSrcRow = pSrc + y * nSrcStride;
         BYTE*       pDstRow = pDst + y * nDstStride;
         for (int x = 0; x < nWidth; x++)
         {
             int g = (int)(0.299 * pSrcRow[x*3+2] + 0.587 * pSrcRow[x*3+1] + 0.114 * pSrcRow[x*3] + 0.5);
-            pDstRow[x] = (BYTE)max(0, min(255, g));
+            pDstRow[x] = (BYTE)std::max(0, std::min(255, g));
         }
+        progress.Add();
     }
-    return true;
+    return !progress.IsCancelled();
 }
 
-bool CMorphology::Erode(const CImageBuffer& input, CImageBuffer& output, int nKernelSize)
+bool CMorphology::Erode(const CImageBuffer& input, CImageBuffer& output, int nKernelSize, CRowProgress& progress)
 {
     int nWidth  = input.GetWidth();
     int nHeight = input.GetHeight();
@@ -101,27 +103,29 @@ bool CMorphology::Erode(const CImageBuffer& input, CImageBuffer& output, int nKe
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
+        if (progress.IsCancelled()) continue;
         BYTE* pDstRow = pDst + y * nDstStride;
         for (int x = 0; x < nWidth; x++)
         {
             BYTE bMin = 255;
             for (int ky = -nHalf; ky <= nHalf; ky++)
             {
-                int sy = max(0, min(nHeight - 1, y + ky));
+                int sy = std::max(0, std::min(nHeight - 1, y + ky));
                 const BYTE* pSrcRow = pSrc + sy * nSrcStride;
                 for (int kx = -nHalf; kx <= nHalf; kx++)
                 {
-                    int sx = max(0, min(nWidth - 1, x + kx));
+                    int sx = std::max(0, std::min(nWidth - 1, x + kx));
                     if (pSrcRow[sx] < bMin) bMin = pSrcRow[sx];
                 }
             }
             pDstRow[x] = bMin;
         }
+        progress.Add();
     }
-    return true;
+    return !progress.IsCancelled();
 }
 
-bool CMorphology::Dilate(const CImageBuffer& input, CImageBuffer& output, int nKernelSize)
+bool CMorphology::Dilate(const CImageBuffer& input, CImageBuffer& output, int nKernelSize, CRowProgress& progress)
 {
     int nWidth  = input.GetWidth();
     int nHeight = input.GetHeight();
@@ -137,24 +141,26 @@ bool CMorphology::Dilate(const CImageBuffer& input, CImageBuffer& output, int nK
 #pragma omp parallel for schedule(static)
     for (int y = 0; y < nHeight; y++)
     {
+        if (progress.IsCancelled()) continue;
         BYTE* pDstRow = pDst + y * nDstStride;
         for (int x = 0; x < nWidth; x++)
         {
             BYTE bMax = 0;
             for (int ky = -nHalf; ky <= nHalf; ky++)
             {
-                int sy = max(0, min(nHeight - 1, y + ky));
+                int sy = std::max(0, std::min(nHeight - 1, y + ky));
                 const BYTE* pSrcRow = pSrc + sy * nSrcStride;
                 for (int kx = -nHalf; kx <= nHalf; kx++)
                 {
-                    int sx = max(0, min(nWidth - 1, x + kx));
+                    int sx = std::max(0, std::min(nWidth - 1, x + kx));
                     if (pSrcRow[sx] > bMax) bMax = pSrcRow[sx];
                 }
             }
             pDstRow[x] = bMax;
         }
+        progress.Add();
     }
-    return true;
+    return !progress.IsCancelled();
 }
 
 bool CMorphology::Process(const CImageBuffer& input, CImageBuffer& output)
@@ -166,21 +172,28 @@ bool CMorphology::Process(const CImageBuffer& input, CImageBuffer& output)
     int nIterations = (int)m_params[2].dCurrentVal;
 
     if (nKernelSize % 2 == 0) nKernelSize++;
-    nKernelSize = max(3, min(21, nKernelSize));
-    nIterations = max(1, min(10, nIterations));
+    nKernelSize = std::max(3, std::min(21, nKernelSize));
+    nIterations = std::max(1, std::min(10, nIterations));
 
+    // Gray conversion, then one pass per iteration of each operation (and the hat difference)
+    const int nOps = (nOperation <= 1) ? 1 : 2;
+    CRowProgress progress(*this, (long long)input.GetHeight() * (1 + nOps * nIterations + (nOperation >= 4 ? 1 : 0)));
+
+    CProfileScope phase("phase", "Morphology: gray");
     CImageBuffer grayInput;
-    if (!ConvertToGrayscale(input, grayInput)) return false;
+    if (!ConvertToGrayscale(input, grayInput, progress)) return false;
+    phase.End();
 
     CImageBuffer current = grayInput;
     CImageBuffer result;
 
     auto ApplyOp = [&](int op) -> bool {
+        CProfileScope opPhase("phase", op == 0 ? "Morphology: erode" : "Morphology: dilate");
         CImageBuffer tmp = current;
         result = CImageBuffer();
         for (int it = 0; it < nIterations; it++)
         {
-            bool ok = (op == 0) ? Erode(tmp, result, nKernelSize) : Dilate(tmp, result, nKernelSize);
+            bool ok = (op == 0) ? Erode(tmp, result, nKernelSize, progress) : Dilate(tmp, result, nKernelSize, progress);
             if (!ok) return false;
             if (it < nIterations - 1) { tmp = result; result = CImageBuffer(); }
         }
@@ -219,14 +232,22 @@ bool CMorphology::Process(const CImageBuffer& input, CImageBuffer& output)
         current = eroded;
         if (!ApplyOp(1)) return false;
         CImageBuffer& openResult = result;
+        CProfileScope diffPhase("phase", "Morphology: difference");
 
         int nWidth  = grayInput.GetWidth();
         int nHeight = grayInput.GetHeight();
         if (!opened.Create(nWidth, nHeight, 1)) return false;
-        for (int i = 0; i < nWidth * nHeight; i++)
+        for (int y = 0; y < nHeight; y++)
         {
-            int v = (int)grayInput.GetData()[i] - (int)openResult.GetData()[i];
-            opened.GetData()[i] = (BYTE)max(0, min(255, v));
+            const BYTE* pSrc = grayInput.GetConstData() + y * grayInput.GetStride();
+            const BYTE* pOpen = openResult.GetConstData() + y * openResult.GetStride();
+            BYTE* pDst = opened.GetData() + y * opened.GetStride();
+            for (int x = 0; x < nWidth; x++)
+            {
+                int v = (int)pSrc[x] - (int)pOpen[x];
+                pDst[x] = (BYTE)std::max(0, std::min(255, v));
+            }
+            progress.Add();
         }
         result = opened;
         break;
@@ -238,15 +259,23 @@ bool CMorphology::Process(const CImageBuffer& input, CImageBuffer& output)
         current = dilated;
         if (!ApplyOp(0)) return false;
         CImageBuffer& closeResult = result;
+        CProfileScope diffPhase("phase", "Morphology: difference");
 
         int nWidth  = grayInput.GetWidth();
         int nHeight = grayInput.GetHeight();
         CImageBuffer bh;
         if (!bh.Create(nWidth, nHeight, 1)) return false;
-        for (int i = 0; i < nWidth * nHeight; i++)
+        for (int y = 0; y < nHeight; y++)
         {
-            int v = (int)closeResult.GetData()[i] - (int)grayInput.GetData()[i];
-            bh.GetData()[i] = (BYTE)max(0, min(255, v));
+            const BYTE* pSrc = grayInput.GetConstData() + y * grayInput.GetStride();
+            const BYTE* pClose = closeResult.GetConstData() + y * closeResult.GetStride();
+            BYTE* pDst = bh.GetData() + y * bh.GetStride();
+            for (int x = 0; x < nWidth; x++)
+            {
+                int v = (int)pClose[x] - (int)pSrc[x];
+                pDst[x] = (BYTE)std::max(0, std::min(255, v));
+            }
+            progress.Add();
         }
         result = bh;
         break;
@@ -259,3 +288,18 @@ bool CMorphology::Process(const CImageBuffer& input, CImageBuffer& output)
 }
 
 CAlgorithmBase* CMorphology::Clone() const { return new CMorphology(*this); }
+
+int CMorphology::GetNeighbourhoodRadius() const
+{
+    int nOperation  = (int)m_params[0].dCurrentVal;
+    int nKernelSize = (int)m_params[1].dCurrentVal;
+    int nIterations = (int)m_params[2].dCurrentVal;
+
+    if (nKernelSize % 2 == 0) nKernelSize++;
+    nKernelSize = std::max(3, std::min(21, nKernelSize));
+    nIterations = std::max(1, std::min(10, nIterations));
+
+    // Erode/Dilate run one pass per iteration; Open/Close/Top Hat/Black Hat run two
+    int nRadius = (nKernelSize / 2) * nIterations;
+    return (nOperation <= 1) ? nRadius : 2 * nRadius;
+}
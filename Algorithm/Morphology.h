@@ -6,17 +6,18 @@ public:
     CMorphology();
     virtual ~CMorphology();
 
-    virtual CString GetName() const override;
-    virtual CString GetDescription() const override;
+    virtual std::wstring GetName() const override;
+    virtual std::wstring GetDescription() const override;
     virtual std::vector<AlgorithmParam>& GetParams() override;
     virtual bool Process(const CImageBuffer& input, CImageBuffer& output) override;
+    virtual int GetNeighbourhoodRadius() const override;
     virtual CAlgorithmBase* Clone() const override;
 
 private:
     std::vector<AlgorithmParam> m_params;
 
     int ClampCoord(int val, int maxVal);
-    bool Erode(const CImageBuffer& input, CImageBuffer& output, int nKernelSize);
-    bool Dilate(const CImageBuffer& input, CImageBuffer& output, int nKernelSize);
-    bool ConvertToGrayscale(const CImageBuffer& input, CImageBuffer& output);
+    bool Erode(const CImageBuffer& input, CImageBuffer& output, int nKernelSize, CRowProgress& progress);
+    bool Dilate(const CImageBuffer& input, CImageBuffer& output, int nKernelSize, CRowProgress& progress);
+    bool ConvertToGrayscale(const CImageBuffer& input, CImageBuffer& output, CRowProgress& progress);
 };
@@ -1,5 +1,6 @@
-#include "stdafx.h"
 #include "Algorithm/Sharpening.h"
+#include "Core/PixelTraits.h"
+#include "Core/Profiler.h"
 #include <cmath>
 #include <vector>
 #include <algorithm>
@@ -11,19 +12,19 @@
 CSharpening::CSharpening()
 {
     AlgorithmParam paramMethod;
-    paramMethod.strName        = _T("방식");
-    paramMethod.strDescription = _T("선명화 방식을 선택하세요");
+    paramMethod.strName        = L"방식";
+    paramMethod.strDescription = L"선명화 방식을 선택하세요";
     paramMethod.dMinVal        = 0.0;
     paramMethod.dMaxVal        = 2.0;
     paramMethod.dDefaultVal    = 0.0;
     paramMethod.dCurrentVal    = 0.0;
     paramMethod.nPrecision     = 0;
-    paramMethod.vecOptions     = { _T("언샤프 마스크"), _T("라플라시안"), _T("하이 부스트") };
+    paramMethod.vecOptions     = { L"언샤프 마스크", L"라플라시안", L"하이 부스트" };
     m_params.push_back(paramMethod);
 
     AlgorithmParam paramStrength;
-    paramStrength.strName        = _T("강도");
-    paramStrength.strDescription = _T("선명화 효과의 강도 (값이 클수록 더 선명하게)");
+    paramStrength.strName        = L"강도";
+    paramStrength.strDescription = L"선명화 효과의 강도 (값이 클수록 더 선명하게)";
     paramStrength.dMinVal        = 0.1;
     paramStrength.dMaxVal        = 5.0;
     paramStrength.dDefaultVal    = 1.0;
@@ -32,8 +33,8 @@ CSharpening::CSharpening()
     m_params.push_back(paramStrength);
 
     AlgorithmParam paramRadius;
-    paramRadius.strName        = _T("반경");
-    paramRadius.strDescription = _T("언샤프 마스크/하이 부스트의 블러 반경 (라플라시안 미사용)");
+    paramRadius.strName        = L"반경";
+    paramRadius.strDescription = L"언샤프 마스크/하이 부스트의 블러 반경 (라플라시안 미사용)";
     paramRadius.dMinVal        = 1.0;
     paramRadius.dMaxVal        = 10.0;
     paramRadius.dDefaultVal    = 2.0;
@@ -44,90 +45,138 @@ CSharpening::CSharpening()
 
 CSharpening::~CSharpening() {}
 
-CString CSharpening::GetName() const        { return _T("Sharpening"); }
-CString CSharpening::GetDescription() const { return _T("Unsharp mask / Laplacian / High boost sharpening"); }
+std::wstring CSharpening::GetName() const        { return L"Sharpening"; }
+std::wstring CSharpening::GetDescription() const { return L"Unsharp mask / Laplacian / High boost sharpening"; }
 std::vector<AlgorithmParam>& CSharpening::GetParams() { return m_params; }
 
-bool CSharpening::Process(const CImageBuffer& input, CImageBuffer& output)
+// Horizontal Gaussian pass over the view plus up to nHalf halo rows above and below.
+// Row r of 'temp' holds source row (r + yLo); the vertical pass reads temp via input.ClampY.
+// Rows are widened by nHalf clamped pixels and accumulated one tap at a time, so the inner
+// loop is a unit-stride multiply-add over the row.
+template <typename T>
+static bool HorizontalBlur(const ConstImageView& input, const std::vector<double>& kernel,
+                           CImageBuffer& temp, int& yLo, CRowProgress& progress)
 {
-    if (!input.IsValid()) return false;
+    int nWidth    = input.nWidth;
+    int nHeight   = input.nHeight;
+    int nChannels = input.nChannels;
+    int nHalf     = (int)kernel.size() / 2;
 
-    int    nWidth    = input.GetWidth();
-    int    nHeight   = input.GetHeight();
-    int    nChannels = input.GetChannels();
-    int    nMethod   = (int)m_params[0].dCurrentVal;
-    double dStrength = m_params[1].dCurrentVal;
-    int    nRadius   = (int)m_params[2].dCurrentVal;
+    yLo = -std::min(nHalf, input.nHaloTop);
+    int yHi = nHeight + std::min(nHalf, input.nHaloBottom);
+    if (!temp.Create(nWidth, yHi - yLo, nChannels, PixelTraits<T>::Depth)) return false;
+
+    BYTE* pTmp      = temp.GetData();
+    int   nTmpStride = temp.GetStride();
+    const int nSamples = nWidth * nChannels;
+
+#pragma omp parallel
+    {
+        std::vector<T>      padded((size_t)(nWidth + 2 * nHalf) * nChannels);
+        std::vector<double> acc(nSamples);
+#pragma omp for schedule(static)
+        for (int y = yLo; y < yHi; y++)
+        {
+            if (progress.IsCancelled()) continue;
+            const T* pSrcRow = input.RowAs<const T>(y);
+            for (int x = -nHalf; x < nWidth + nHalf; x++)
+            {
+                const T* pSrc = pSrcRow + input.ClampX(x) * nChannels;
+                for (int c = 0; c < nChannels; c++) padded[(size_t)(x + nHalf) * nChannels + c] = pSrc[c];
+            }
+
+            std::fill(acc.begin(), acc.end(), 0.0);
+            for (int k = 0; k < (int)kernel.size(); k++)
+            {
+                const T*     pTap = &padded[(size_t)k * nChannels];
+                const double w    = kernel[k];
+                for (int i = 0; i < nSamples; i++) acc[i] += pTap[i] * w;
+            }
+
+            T* pTmpRow = reinterpret_cast<T*>(pTmp + (y - yLo) * nTmpStride);
+            for (int i = 0; i < nSamples; i++) pTmpRow[i] = PixelTraits<T>::FromDouble(acc[i]);
+            progress.Add();
+        }
+    }
+    return !progress.IsCancelled();
+}
 
-    if (!output.Create(nWidth, nHeight, nChannels)) return false;
+// Vertical pass over HorizontalBlur's output for output row y; pBlurred receives the row's
+// blurred samples (quantized to T, as they would be stored)
+template <typename T>
+static void VerticalBlurRow(const CImageBuffer& temp, const ConstImageView& input,
+                            const std::vector<double>& kernel, int yLo, int y, double* pBlurred)
+{
+    const BYTE* pTmp  = temp.GetConstData();
+    int nTmpStride    = temp.GetStride();
+    int nHalf         = (int)kernel.size() / 2;
+    int nSamples      = input.nWidth * input.nChannels;
+
+    std::fill(pBlurred, pBlurred + nSamples, 0.0);
+    for (int k = -nHalf; k <= nHalf; k++)
+    {
+        const T*     pTmpRow = reinterpret_cast<const T*>(pTmp + (input.ClampY(y + k) - yLo) * nTmpStride);
+        const double w       = kernel[k + nHalf];
+        for (int i = 0; i < nSamples; i++) pBlurred[i] += pTmpRow[i] * w;
+    }
+    for (int i = 0; i < nSamples; i++) pBlurred[i] = PixelTraits<T>::FromDouble(pBlurred[i]);
+}
+
+static void BuildGaussianKernel(int nHalf, double sigma, std::vector<double>& kernel)
+{
+    kernel.resize(2 * nHalf + 1);
+    double sum = 0;
+    for (int i = 0; i < (int)kernel.size(); i++)
+    {
+        int x = i - nHalf;
+        kernel[i] = exp(-(double)(x * x) / (2.0 * sigma * sigma));
+        sum += kernel[i];
+    }
+    for (auto& v : kernel) v /= sum;
+}
 
-    const BYTE* pSrc      = input.GetData();
-    BYTE*       pDst      = output.GetData();
-    int         nSrcStride = input.GetStride();
-    int         nDstStride = output.GetStride();
+template <typename T>
+static bool Sharpen(const ConstImageView& input, const ImageView& output,
+                    int nMethod, double dStrength, int nRadius, CRowProgress& progress)
+{
+    int nWidth    = input.nWidth;
+    int nHeight   = input.nHeight;
+    int nChannels = input.nChannels;
 
     if (nMethod == 0)
     {
         // Unsharp mask: output = input + strength * (input - blurred)
-        int nKernel = 2 * nRadius + 1;
         double sigma = nRadius / 2.0;
         if (sigma < 0.5) sigma = 0.5;
 
-        // Build Gaussian kernel
-        std::vector<double> kernel(nKernel);
-        double sum = 0;
-        for (int i = 0; i < nKernel; i++)
-        {
-            int x = i - nRadius;
-            kernel[i] = exp(-(double)(x * x) / (2.0 * sigma * sigma));
-            sum += kernel[i];
-        }
-        for (auto& v : kernel) v /= sum;
+        std::vector<double> kernel;
+        BuildGaussianKernel(nRadius, sigma, kernel);
 
         // Horizontal pass
+        CProfileScope phase("phase", "Sharpening: horizontal blur");
         CImageBuffer temp;
-        if (!temp.Create(nWidth, nHeight, nChannels)) return false;
-        BYTE* pTmp      = temp.GetData();
-        int   nTmpStride = temp.GetStride();
-
-#pragma omp parallel for schedule(static)
-        for (int y = 0; y < nHeight; y++)
-        {
-            const BYTE* pSrcRow = pSrc + y * nSrcStride;
-            BYTE*       pTmpRow = pTmp + y * nTmpStride;
-            for (int x = 0; x < nWidth; x++)
-                for (int c = 0; c < nChannels; c++)
-                {
-                    double s = 0;
-                    for (int k = -nRadius; k <= nRadius; k++)
-                    {
-                        int sx = max(0, min(nWidth - 1, x + k));
-                        s += pSrcRow[sx * nChannels + c] * kernel[k + nRadius];
-                    }
-                    pTmpRow[x * nChannels + c] = (BYTE)max(0, min(255, (int)(s + 0.5)));
-                }
-        }
+        int yLo = 0;
+        if (!HorizontalBlur<T>(input, kernel, temp, yLo, progress)) return false;
 
         // Vertical pass + unsharp
-#pragma omp parallel for schedule(static)
-        for (int y = 0; y < nHeight; y++)
+        phase.Next("Sharpening: vertical + unsharp");
+#pragma omp parallel
         {
-            const BYTE* pSrcRow = pSrc + y * nSrcStride;
-            BYTE*       pDstRow = pDst + y * nDstStride;
-            for (int x = 0; x < nWidth; x++)
-                for (int c = 0; c < nChannels; c++)
+            std::vector<double> blurred(nWidth * nChannels);
+#pragma omp for schedule(static)
+            for (int y = 0; y < nHeight; y++)
+            {
+                if (progress.IsCancelled()) continue;
+                VerticalBlurRow<T>(temp, input, kernel, yLo, y, blurred.data());
+                const T* pSrcRow = input.RowAs<const T>(y);
+                T*       pDstRow = output.RowAs<T>(y);
+                for (int i = 0; i < nWidth * nChannels; i++)
                 {
-                    double s = 0;
-                    for (int k = -nRadius; k <= nRadius; k++)
-                    {
-                        int sy = max(0, min(nHeight - 1, y + k));
-                        s += pTmp[sy * nTmpStride + x * nChannels + c] * kernel[k + nRadius];
-                    }
-                    int blurred = (int)(s + 0.5);
-                    int orig    = pSrcRow[x * nChannels + c];
-                    int v       = (int)(orig + dStrength * (orig - blurred) + 0.5);
-                    pDstRow[x * nChannels + c] = (BYTE)max(0, min(255, v));
+                    double orig = pSrcRow[i];
+                    pDstRow[i] = PixelTraits<T>::FromDouble(orig + dStrength * (orig - blurred[i]));
                 }
+                progress.Add();
+            }
         }
     }
     else if (nMethod == 1)
@@ -138,92 +187,118 @@ bool CSharpening::Process(const CImageBuffer& input, CImageBuffer& output)
 #pragma omp parallel for schedule(static)
         for (int y = 0; y < nHeight; y++)
         {
-            const BYTE* pSrcRow = pSrc + y * nSrcStride;
-            BYTE*       pDstRow = pDst + y * nDstStride;
+            if (progress.IsCancelled()) continue;
+            const T* pSrcRow = input.RowAs<const T>(y);
+            T*       pDstRow = output.RowAs<T>(y);
             for (int x = 0; x < nWidth; x++)
                 for (int c = 0; c < nChannels; c++)
                 {
-                    int lapVal = 0;
+                    double lapVal = 0;
                     for (int ky = -1; ky <= 1; ky++)
                     {
-                        int sy = max(0, min(nHeight - 1, y + ky));
-                        const BYTE* pRow = pSrc + sy * nSrcStride;
+                        const T* pRow = input.RowAs<const T>(input.ClampY(y + ky));
                         for (int kx = -1; kx <= 1; kx++)
                         {
-                            int sx = max(0, min(nWidth - 1, x + kx));
+                            int sx = input.ClampX(x + kx);
                             lapVal += pRow[sx * nChannels + c] * lap[ky+1][kx+1];
                         }
                     }
-                    int v = (int)(pSrcRow[x * nChannels + c] + dStrength * lapVal + 0.5);
-                    pDstRow[x * nChannels + c] = (BYTE)max(0, min(255, v));
+                    pDstRow[x * nChannels + c] = PixelTraits<T>::FromDouble(pSrcRow[x * nChannels + c] + dStrength * lapVal);
                 }
+            progress.Add();
         }
     }
     else
     {
         // High Boost: output = A * input - blurred  (A = 1 + strength)
         double A      = 1.0 + dStrength;
-        int    nKernel = max(3, 2 * nRadius + 1);
+        int    nKernel = std::max(3, 2 * nRadius + 1);
         if (nKernel % 2 == 0) nKernel++;
         double sigma  = nRadius / 2.0;
         if (sigma < 0.5) sigma = 0.5;
 
-        std::vector<double> kernel(nKernel);
-        double sum = 0;
-        int nHalf = nKernel / 2;
-        for (int i = 0; i < nKernel; i++)
-        {
-            int x = i - nHalf;
-            kernel[i] = exp(-(double)(x*x) / (2.0 * sigma * sigma));
-            sum += kernel[i];
-        }
-        for (auto& v : kernel) v /= sum;
+        std::vector<double> kernel;
+        BuildGaussianKernel(nKernel / 2, sigma, kernel);
 
+        CProfileScope phase("phase", "Sharpening: horizontal blur");
         CImageBuffer temp;
-        if (!temp.Create(nWidth, nHeight, nChannels)) return false;
-        BYTE* pTmp      = temp.GetData();
-        int   nTmpStride = temp.GetStride();
+        int yLo = 0;
+        if (!HorizontalBlur<T>(input, kernel, temp, yLo, progress)) return false;
 
-#pragma omp parallel for schedule(static)
-        for (int y = 0; y < nHeight; y++)
+        phase.Next("Sharpening: vertical + boost");
+#pragma omp parallel
         {
-            const BYTE* pSrcRow = pSrc + y * nSrcStride;
-            BYTE*       pTmpRow = pTmp + y * nTmpStride;
-            for (int x = 0; x < nWidth; x++)
-                for (int c = 0; c < nChannels; c++)
-                {
-                    double s = 0;
-                    for (int k = -nHalf; k <= nHalf; k++)
-                    {
-                        int sx = max(0, min(nWidth - 1, x + k));
-                        s += pSrcRow[sx * nChannels + c] * kernel[k + nHalf];
-                    }
-                    pTmpRow[x * nChannels + c] = (BYTE)max(0, min(255, (int)(s + 0.5)));
-                }
+            std::vector<double> blurred(nWidth * nChannels);
+#pragma omp for schedule(static)
+            for (int y = 0; y < nHeight; y++)
+            {
+                if (progress.IsCancelled()) continue;
+                VerticalBlurRow<T>(temp, input, kernel, yLo, y, blurred.data());
+                const T* pSrcRow = input.RowAs<const T>(y);
+                T*       pDstRow = output.RowAs<T>(y);
+                for (int i = 0; i < nWidth * nChannels; i++)
+                    pDstRow[i] = PixelTraits<T>::FromDouble(A * pSrcRow[i] - blurred[i]);
+                progress.Add();
+            }
         }
+    }
 
-#pragma omp parallel for schedule(static)
-        for (int y = 0; y < nHeight; y++)
-        {
-            const BYTE* pSrcRow = pSrc + y * nSrcStride;
-            BYTE*       pDstRow = pDst + y * nDstStride;
-            for (int x = 0; x < nWidth; x++)
-                for (int c = 0; c < nChannels; c++)
-                {
-                    double s = 0;
-                    for (int k = -nHalf; k <= nHalf; k++)
-                    {
-                        int sy = max(0, min(nHeight - 1, y + k));
-                        s += pTmp[sy * nTmpStride + x * nChannels + c] * kernel[k + nHalf];
-                    }
-                    int blurred = (int)(s + 0.5);
-                    int v       = (int)(A * pSrcRow[x * nChannels + c] - blurred + 0.5);
-                    pDstRow[x * nChannels + c] = (BYTE)max(0, min(255, v));
-                }
-        }
+    return !progress.IsCancelled();
+}
+
+// One interleaved view, or one plane
+static bool SharpenView(const ConstImageView& input, const ImageView& output,
+                        int nMethod, double dStrength, int nRadius, CRowProgress& progress)
+{
+    switch (input.eDepth)
+    {
+    case PixelDepth::U16: return Sharpen<unsigned short>(input, output, nMethod, dStrength, nRadius, progress);
+    case PixelDepth::F32: return Sharpen<float>(input, output, nMethod, dStrength, nRadius, progress);
+    default:              return Sharpen<BYTE>(input, output, nMethod, dStrength, nRadius, progress);
     }
+}
+
+bool CSharpening::Process(const CImageBuffer& input, CImageBuffer& output)
+{
+    if (!input.IsValid()) return false;
+    if (!output.Create(input.GetWidth(), input.GetHeight(), input.GetChannels(), input.GetDepth(), input.GetLayout()))
+        return false;
+    return ProcessView(input.GetConstView(), output.GetView());
+}
+
+bool CSharpening::ProcessView(const ConstImageView& input, const ImageView& output)
+{
+    if (!input.IsValid() || !output.IsValid() || input.eDepth != output.eDepth) return false;
+    if (input.IsPlanar() != output.IsPlanar()) return false;
 
-    return true;
+    int    nMethod   = (int)m_params[0].dCurrentVal;
+    double dStrength = m_params[1].dCurrentVal;
+    int    nRadius   = (int)m_params[2].dCurrentVal;
+
+    // Unsharp mask and high boost blur in two passes; the halo rows of the first are not counted
+    const int nPlanes = input.IsPlanar() ? input.nChannels : 1;
+    CRowProgress progress(*this, (long long)nPlanes * input.nHeight * (nMethod == 1 ? 1 : 2));
+
+    // Planar: the single-channel kernels run once per plane
+    if (input.IsPlanar())
+    {
+        for (int c = 0; c < input.nChannels; c++)
+            if (!SharpenView(input.Plane(c), output.Plane(c), nMethod, dStrength, nRadius, progress)) return false;
+        return true;
+    }
+    return SharpenView(input, output, nMethod, dStrength, nRadius, progress);
 }
 
 CAlgorithmBase* CSharpening::Clone() const { return new CSharpening(*this); }
+
+int CSharpening::GetNeighbourhoodRadius() const
+{
+    int nMethod = (int)m_params[0].dCurrentVal;
+    int nRadius = (int)m_params[2].dCurrentVal;
+
+    if (nMethod == 0) return std::max(0, nRadius);
+    if (nMethod == 1) return 1;
+    int nKernel = std::max(3, 2 * nRadius + 1);
+    if (nKernel % 2 == 0) nKernel++;
+    return nKernel / 2;
+}
@@ -5,10 +5,15 @@ class CSharpening : public CAlgorithmBase {
 public:
     CSharpening();
     virtual ~CSharpening();
-    virtual CString GetName() const override;
-    virtual CString GetDescription() const override;
+    virtual std::wstring GetName() const override;
+    virtual std::wstring GetDescription() const override;
     virtual std::vector<AlgorithmParam>& GetParams() override;
     virtual bool Process(const CImageBuffer& input, CImageBuffer& output) override;
+    virtual bool SupportsViews() const override { return true; }
+    virtual bool ProcessView(const ConstImageView& input, const ImageView& output) override;
+    virtual bool SupportsDepth(PixelDepth) const override { return true; }
+    virtual bool PrefersPlanar() const override { return true; }
+    virtual int GetNeighbourhoodRadius() const override;
     virtual CAlgorithmBase* Clone() const override;
     // method: 0=UnsharpMask, 1=LaplacianSharpen, 2=HighBoost
 private:
@@ -0,0 +1,154 @@
+// A branching pipeline as one graph against the linear sequences it replaces.
+//
+//   GraphBench [width height]     (default 2560 x 2560, RGB)
+//
+// The graph is blur -> { edge detect, Hough lines, binarize -> morphology }, plus a merge that
+// masks the input with the binarized frame. As linear sequences every branch repeats the blur.
+// The graph runs once on one worker (shared blur only) and once with concurrent branches.
+// Times are the best of several runs; every branch result is compared byte for byte.
+
+#include "Core/PipelineGraph.h"
+#include "Core/SequenceManager.h"
+#include "Algorithm/Binarize.h"
+#include "Algorithm/EdgeDetect.h"
+#include "Algorithm/GaussianBlur.h"
+#include "Algorithm/HoughLine.h"
+#include "Algorithm/Morphology.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double SinceMs(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+bool SameFrame(const CImageBuffer& a, const CImageBuffer& b)
+{
+    if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight() || a.GetChannels() != b.GetChannels() ||
+        a.GetDepth() != b.GetDepth() || a.GetLayout() != b.GetLayout())
+        return false;
+    const size_t rowBytes = (size_t)a.GetWidth() * a.GetChannels() * PixelDepthBytes(a.GetDepth());
+    for (int y = 0; y < a.GetHeight(); y++)
+        if (memcmp(a.GetData() + (size_t)y * a.GetStride(), b.GetData() + (size_t)y * b.GetStride(), rowBytes) != 0)
+            return false;
+    return true;
+}
+
+struct Pipelines
+{
+    CPipelineGraph graph;
+    int nEdge, nHough, nMorph, nMasked;
+    std::unique_ptr<CSequenceManager> branches[3];   // blur + the branch's steps
+
+    Pipelines()
+    {
+        const int nBlur = graph.AddStep(new CGaussianBlur());
+        nEdge  = graph.AddStep(new CEdgeDetect(), nBlur);
+        nHough = graph.AddStep(new CHoughLine(), nBlur);
+        const int nBin = graph.AddStep(new CBinarize(), nBlur);
+        nMorph = graph.AddStep(new CMorphology(), nBin);
+        nMasked = graph.AddMerge(MergeOp::Mask, GRAPH_INPUT, nBin);
+
+        for (auto& p : branches)
+        {
+            p.reset(new CSequenceManager());
+            p->AddStep(new CGaussianBlur());
+        }
+        branches[0]->AddStep(new CEdgeDetect());
+        branches[1]->AddStep(new CHoughLine());
+        branches[2]->AddStep(new CBinarize());
+        branches[2]->AddStep(new CMorphology());
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int width = 2560, height = 2560;
+    if (argc >= 3)
+    {
+        width = atoi(argv[1]);
+        height = atoi(argv[2]);
+    }
+
+    CImageBuffer frame;
+    if (width <= 0 || height <= 0 || !frame.Create(width, height, 3))
+    {
+        fprintf(stderr, "usage: GraphBench [width height]\n");
+        return 1;
+    }
+
+    // Shapes on a noisy background
+    BYTE* pData = frame.GetData();
+    unsigned seed = 12345;
+    for (int y = 0; y < height; y++)
+    {
+        BYTE* pRow = pData + (size_t)y * frame.GetStride();
+        for (int x = 0; x < width; x++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            BYTE v = (BYTE)((((x / 97) + (y / 61)) % 2 ? 180 : 60) + ((seed >> 16) & 31));
+            pRow[x * 3 + 0] = pRow[x * 3 + 1] = pRow[x * 3 + 2] = v;
+        }
+    }
+
+    Pipelines p;
+    const int runs = 3;
+    double linearMs = 1e30, serialMs = 1e30, concurrentMs = 1e30;
+    bool bOk = true;
+    for (int r = 0; r < runs && bOk; r++)
+    {
+        // A fresh copy each time defeats the sequences' fingerprint resume
+        Clock::time_point t0 = Clock::now();
+        for (auto& seq : p.branches)
+        {
+            CImageBuffer copy;
+            copy.CopyDataFrom(frame);
+            bOk = bOk && seq->Execute(copy);
+        }
+        CImageBuffer mask = p.branches[2]->GetHistoryFrame(2), masked;   // binarized frame
+        bOk = bOk && CImageMerger::Merge(MergeOp::Mask, frame, mask, masked);
+        linearMs = std::min(linearMs, SinceMs(t0));
+
+        p.graph.SetMaxConcurrency(1);
+        t0 = Clock::now();
+        bOk = bOk && p.graph.Execute(frame);
+        serialMs = std::min(serialMs, SinceMs(t0));
+
+        p.graph.SetMaxConcurrency(0);
+        t0 = Clock::now();
+        bOk = bOk && p.graph.Execute(frame);
+        concurrentMs = std::min(concurrentMs, SinceMs(t0));
+
+        if (bOk && r == 0)
+        {
+            bool bSame = SameFrame(p.graph.GetOutput(p.nEdge),  p.branches[0]->GetHistoryFrame(2)) &&
+                         SameFrame(p.graph.GetOutput(p.nHough), p.branches[1]->GetHistoryFrame(2)) &&
+                         SameFrame(p.graph.GetOutput(p.nMorph), p.branches[2]->GetHistoryFrame(3)) &&
+                         SameFrame(p.graph.GetOutput(p.nMasked), masked);
+            printf("%d x %d RGB, blur -> { edge, hough, binarize -> morphology, mask }: results %s\n",
+                width, height, bSame ? "identical" : "DIFFER");
+            bOk = bSame;
+        }
+    }
+    if (!bOk)
+    {
+        fprintf(stderr, "run failed\n");
+        return 1;
+    }
+
+    printf("  %-26s %10.2f ms\n", "linear sequences", linearMs);
+    printf("  %-26s %10.2f ms %9.2fx\n", "graph, one worker", serialMs, linearMs / serialMs);
+    printf("  %-26s %10.2f ms %9.2fx\n", "graph, concurrent branches", concurrentMs, linearMs / concurrentMs);
+    return 0;
+}
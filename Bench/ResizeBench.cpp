@@ -0,0 +1,140 @@
+// CImageResizer against the double-precision bilinear loop CreateThumbnail used before it.
+//
+//   ResizeBench [width height]     (default 4000 x 3000, RGB)
+//
+// Times are the best of several runs. "thumbnail" is CImageBuffer::CreateThumbnail on the frame
+// before it has a pyramid (bilinear samples) and again once a viewer has built the pyramid.
+
+#include "Core/ImageBuffer.h"
+#include "Core/ImageResize.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+namespace
+{
+
+// The former CreateThumbnail body: per pixel and channel, double weights and GetPixel()
+CImageBuffer LegacyBilinear(const CImageBuffer& src, int newWidth, int newHeight)
+{
+    CImageBuffer dst;
+    if (!dst.Create(newWidth, newHeight, src.GetChannels()))
+        return dst;
+
+    const double scaleX = static_cast<double>(newWidth) / src.GetWidth();
+    const double scaleY = static_cast<double>(newHeight) / src.GetHeight();
+    for (int y = 0; y < newHeight; y++)
+    {
+        double srcY = static_cast<double>(y) / scaleY;
+        int y0 = static_cast<int>(srcY);
+        int y1 = std::min(y0 + 1, src.GetHeight() - 1);
+        double fy = srcY - y0;
+
+        for (int x = 0; x < newWidth; x++)
+        {
+            double srcX = static_cast<double>(x) / scaleX;
+            int x0 = static_cast<int>(srcX);
+            int x1 = std::min(x0 + 1, src.GetWidth() - 1);
+            double fx = srcX - x0;
+
+            for (int ch = 0; ch < src.GetChannels(); ch++)
+            {
+                double value = src.GetPixel(x0, y0, ch) * (1.0 - fx) * (1.0 - fy)
+                             + src.GetPixel(x1, y0, ch) * fx * (1.0 - fy)
+                             + src.GetPixel(x0, y1, ch) * (1.0 - fx) * fy
+                             + src.GetPixel(x1, y1, ch) * fx * fy;
+                int iValue = std::max(0, std::min(255, static_cast<int>(value + 0.5)));
+                dst.SetPixel(x, y, ch, static_cast<BYTE>(iValue));
+            }
+        }
+    }
+    return dst;
+}
+
+double BestMs(int runs, const std::function<void()>& fn)
+{
+    double best = 1e30;
+    for (int r = 0; r < runs; r++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    }
+    return best;
+}
+
+void Report(const char* pszName, double ms, double legacyMs)
+{
+    printf("  %-22s %10.2f ms %9.1fx\n", pszName, ms, legacyMs / ms);
+}
+
+void BenchResize(const CImageBuffer& src, int width, int height)
+{
+    printf("%d x %d -> %d x %d\n", src.GetWidth(), src.GetHeight(), width, height);
+    double legacy = BestMs(2, [&] { LegacyBilinear(src, width, height); });
+    printf("  %-22s %10.2f ms\n", "legacy bilinear", legacy);
+
+    const struct { const char* pszName; ResizeMethod method; } kMethods[] =
+    {
+        { "nearest",  ResizeMethod::Nearest },
+        { "bilinear", ResizeMethod::Bilinear },
+        { "area",     ResizeMethod::Area },
+    };
+    CImageBuffer dst;
+    for (const auto& m : kMethods)
+        Report(m.pszName, BestMs(5, [&] { CImageResizer::Resize(src, dst, width, height, m.method); }), legacy);
+    printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int width = 4000, height = 3000;
+    if (argc >= 3)
+    {
+        width = atoi(argv[1]);
+        height = atoi(argv[2]);
+    }
+
+    CImageBuffer frame;
+    if (width <= 0 || height <= 0 || !frame.Create(width, height, 3))
+    {
+        fprintf(stderr, "usage: ResizeBench [width height]\n");
+        return 1;
+    }
+
+    // Smooth gradient plus noise, so every method has real work to do
+    BYTE* pData = frame.GetData();
+    unsigned seed = 12345;
+    for (int y = 0; y < height; y++)
+    {
+        BYTE* pRow = pData + (size_t)y * frame.GetStride();
+        for (int x = 0; x < width * 3; x++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            pRow[x] = (BYTE)((x / 3 * 255 / width + y * 255 / height) / 2 + ((seed >> 16) & 31));
+        }
+    }
+
+    // Thumbnail as used by the mini viewers (160 x 120 box)
+    const int thumbW = std::max(1, std::min(160, width * 120 / height));
+    const int thumbH = std::max(1, std::min(120, height * 160 / width));
+    double legacy = BestMs(2, [&] { LegacyBilinear(frame, thumbW, thumbH); });
+    printf("thumbnail %d x %d -> %d x %d\n", width, height, thumbW, thumbH);
+    printf("  %-22s %10.2f ms\n", "legacy bilinear", legacy);
+    Report("cold (no pyramid)", BestMs(5, [&] { frame.CreateThumbnail(160, 120); }), legacy);
+    frame.GetPyramidLevel(frame.GetPyramidLevelCount() - 1);   // as a zoomed-out main viewer does
+    Report("warm (cached pyramid)", BestMs(10, [&] { frame.CreateThumbnail(160, 120); }), legacy);
+    printf("\n");
+
+    BenchResize(frame, width / 3, height / 3);
+    BenchResize(frame, width * 3 / 4, height * 3 / 4);
+
+    CImageBuffer small;
+    CImageResizer::Resize(frame, small, std::max(1, width / 6), std::max(1, height / 6), ResizeMethod::Area);
+    BenchResize(small, small.GetWidth() * 3, small.GetHeight() * 3);
+    return 0;
+}
@@ -0,0 +1,117 @@
+// Stripe execution against step-by-step execution of the same chain.
+//
+//   StripeBench [width height [cacheKB]]     (default 5120 x 5120, RGB; cache = detected L2)
+//
+// The chain is Gaussian blur -> edge detect -> binarize -> morphology with default parameters.
+// Times are the best of several synchronous runs; the history is reset between them so every
+// run computes all steps. The two final frames are compared byte for byte.
+
+#include "Core/SequenceManager.h"
+#include "Core/StripeChain.h"
+#include "Algorithm/Binarize.h"
+#include "Algorithm/EdgeDetect.h"
+#include "Algorithm/GaussianBlur.h"
+#include "Algorithm/Morphology.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+
+void AddChain(CSequenceManager& seq)
+{
+    seq.AddStep(new CGaussianBlur());
+    seq.AddStep(new CEdgeDetect());
+    seq.AddStep(new CBinarize());
+    seq.AddStep(new CMorphology());
+}
+
+// Best of 'runs'; a fresh copy of the frame each time defeats the fingerprint resume
+double BestMs(CSequenceManager& seq, const CImageBuffer& frame, int runs)
+{
+    double best = 1e30;
+    for (int r = 0; r < runs; r++)
+    {
+        CImageBuffer copy;
+        copy.CopyDataFrom(frame);
+        auto t0 = std::chrono::steady_clock::now();
+        if (!seq.Execute(copy))
+            return -1.0;
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    }
+    return best;
+}
+
+bool SameFrame(const CImageBuffer& a, const CImageBuffer& b)
+{
+    if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight() || a.GetChannels() != b.GetChannels() ||
+        a.GetDepth() != b.GetDepth() || a.GetLayout() != b.GetLayout())
+        return false;
+    const size_t rowBytes = (size_t)a.GetWidth() * a.GetChannels() * PixelDepthBytes(a.GetDepth());
+    for (int y = 0; y < a.GetHeight(); y++)
+        if (memcmp(a.GetData() + (size_t)y * a.GetStride(), b.GetData() + (size_t)y * b.GetStride(), rowBytes) != 0)
+            return false;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int width = 5120, height = 5120;
+    size_t cacheBytes = 0;
+    if (argc >= 3)
+    {
+        width = atoi(argv[1]);
+        height = atoi(argv[2]);
+    }
+    if (argc >= 4)
+        cacheBytes = (size_t)atoi(argv[3]) << 10;
+
+    CImageBuffer frame;
+    if (width <= 0 || height <= 0 || !frame.Create(width, height, 3))
+    {
+        fprintf(stderr, "usage: StripeBench [width height [cacheKB]]\n");
+        return 1;
+    }
+
+    // Shapes on a noisy background, so every step has edges to work on
+    BYTE* pData = frame.GetData();
+    unsigned seed = 12345;
+    for (int y = 0; y < height; y++)
+    {
+        BYTE* pRow = pData + (size_t)y * frame.GetStride();
+        for (int x = 0; x < width; x++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            BYTE v = (BYTE)((((x / 97) + (y / 61)) % 2 ? 180 : 60) + ((seed >> 16) & 31));
+            pRow[x * 3 + 0] = pRow[x * 3 + 1] = pRow[x * 3 + 2] = v;
+        }
+    }
+
+    CSequenceManager frameByFrame, striped;
+    AddChain(frameByFrame);
+    AddChain(striped);
+    frameByFrame.SetStripeExecution(false);
+    striped.SetStripeExecution(true, cacheBytes);
+
+    printf("%d x %d RGB, blur -> edge -> binarize -> morphology, cache %zu KB\n", width, height,
+        (cacheBytes ? cacheBytes : CStripeChain::DetectCacheBytes()) >> 10);
+    double baseMs = BestMs(frameByFrame, frame, 3);
+    double stripeMs = BestMs(striped, frame, 3);
+    if (baseMs < 0 || stripeMs < 0)
+    {
+        fprintf(stderr, "run failed\n");
+        return 1;
+    }
+    printf("  %-22s %10.2f ms\n", "frame by frame", baseMs);
+    printf("  %-22s %10.2f ms %9.2fx\n", "striped", stripeMs, baseMs / stripeMs);
+
+    const int last = frameByFrame.GetHistoryCount() - 1;
+    bool bSame = SameFrame(frameByFrame.GetHistoryFrame(last), striped.GetHistoryFrame(last));
+    printf("  results %s\n", bSame ? "identical" : "DIFFER");
+    return bSame ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+#include "Core/BatchProcessor.h"
+#include "Core/BoundedQueue.h"
+#include "Core/SequenceManager.h"
+#include "Utils/Logger.h"
+#include "Utils/StringUtil.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+// One image on its way through the pipeline
+struct BatchItem
+{
+    int               nIndex = -1;   // into the file list
+    CImageBuffer      image;         // decoded input, then the result
+    bool              bOk = false;
+    Clock::time_point tStart;
+};
+
+double ElapsedMs(Clock::time_point t0, Clock::time_point t1)
+{
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+// Nearest-rank percentile of an ascending list
+double Percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+    size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.5);
+    return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+// Starts nThreads threads running fn(busyMs[t]); each adds the time it spent working
+template <typename Fn>
+void StartStage(std::vector<std::thread>& threads, int nThreads, std::vector<double>& busyMs, Fn fn)
+{
+    busyMs.assign(nThreads, 0.0);
+    for (int t = 0; t < nThreads; t++)
+        threads.emplace_back([&busyMs, t, fn]() mutable { fn(busyMs[t]); });
+}
+
+double Utilisation(const std::vector<double>& busyMs, double elapsedMs)
+{
+    double total = 0.0;
+    for (double ms : busyMs) total += ms;
+    return (elapsedMs > 0.0 && !busyMs.empty()) ? total / (elapsedMs * busyMs.size()) : 0.0;
+}
+
+} // namespace
+
+CBatchProcessor::CBatchProcessor()
+    : m_bStopRequested(false)
+{
+}
+
+CBatchProcessor::~CBatchProcessor()
+{
+    ClearSteps();
+}
+
+void CBatchProcessor::AddStep(CAlgorithmBase* pAlg)
+{
+    if (pAlg)
+        m_steps.push_back(pAlg);
+}
+
+void CBatchProcessor::ClearSteps()
+{
+    for (auto* p : m_steps) delete p;
+    m_steps.clear();
+}
+
+std::vector<std::wstring> CBatchProcessor::ListImageFiles(const std::wstring& dir)
+{
+    static const wchar_t* const kExtensions[] = {
+        L"bmp", L"pgm", L"ppm", L"qoi", L"vraw",
+#ifdef _WIN32
+        L"jpg", L"jpeg", L"png", L"tif", L"tiff", L"gif",   // through GDI+
+#endif
+    };
+
+    std::vector<std::wstring> files;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(std::filesystem::path(dir), ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (!it->is_regular_file(ec))
+            continue;
+        const std::wstring path = it->path().wstring();
+        const std::wstring ext = GetFileExtension(path);
+        if (std::find_if(std::begin(kExtensions), std::end(kExtensions),
+                         [&ext](const wchar_t* p) { return ext == p; }) != std::end(kExtensions))
+            files.push_back(path);
+    }
+    if (ec)
+        CLogger::Error(L"CBatchProcessor::ListImageFiles - Cannot read %ls", dir.c_str());
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::wstring CBatchProcessor::GetOutputPath(const std::wstring& inputPath, const BatchOptions& options)
+{
+    std::filesystem::path name = std::filesystem::path(inputPath).filename();
+    if (!options.strOutputExtension.empty())
+        name.replace_extension(std::filesystem::path(L"." + options.strOutputExtension));
+    return (std::filesystem::path(options.strOutputDir) / name).wstring();
+}
+
+bool CBatchProcessor::Run(const std::vector<std::wstring>& files, const BatchOptions& options, BatchStats& stats)
+{
+    stats = BatchStats();
+    if (m_steps.empty() || files.empty())
+    {
+        CLogger::Error(L"CBatchProcessor::Run - %ls", m_steps.empty() ? L"No steps" : L"No input files");
+        return false;
+    }
+
+    const int nWorkers = options.nWorkers > 0 ? options.nWorkers : std::max(1, (int)std::thread::hardware_concurrency());
+    const int nDecoders = std::max(1, options.nDecodeThreads);
+    const int nEncoders = std::max(1, options.nEncodeThreads);
+    const size_t nDepth = options.nQueueDepth > 0 ? (size_t)options.nQueueDepth : (size_t)nWorkers;
+    if (!options.strOutputDir.empty())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(options.strOutputDir), ec);
+        if (ec)
+        {
+            CLogger::Error(L"CBatchProcessor::Run - Cannot create %ls", options.strOutputDir.c_str());
+            return false;
+        }
+    }
+
+    m_bStopRequested = false;
+    CBoundedQueue<BatchItem> decoded(nDepth), processed(nDepth);
+    std::atomic<int> nNextFile(0);
+    std::vector<double> latencyMs(files.size(), -1.0);
+    std::vector<double> decodeBusy, processBusy, encodeBusy;
+    std::vector<std::thread> decoders, workers, encoders;
+    const Clock::time_point tRunStart = Clock::now();
+
+    // Decode: files are handed out one at a time, so a slow file does not hold up the others
+    StartStage(decoders, nDecoders, decodeBusy, [&](double& busyMs)
+    {
+        for (int i = nNextFile++; i < (int)files.size() && !m_bStopRequested; i = nNextFile++)
+        {
+            BatchItem item;
+            item.nIndex = i;
+            item.tStart = Clock::now();
+            item.bOk = item.image.LoadFromFile(files[i]);
+            busyMs += ElapsedMs(item.tStart, Clock::now());
+            if (!decoded.Push(std::move(item)))
+                break;
+        }
+    });
+
+    // Process: each worker owns clones of the steps and one buffer set per step; the frame
+    // ping-pongs between two outputs and the result leaves sharing the last one
+    StartStage(workers, nWorkers, processBusy, [&](double& busyMs)
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(std::max(1, options.nThreadsPerWorker));
+#endif
+        std::vector<std::unique_ptr<CAlgorithmBase>> steps;
+        for (CAlgorithmBase* pStep : m_steps)
+            steps.emplace_back(pStep->Clone());
+        std::vector<PipelineBuffers> bufs(steps.size());
+        CImageBuffer frames[2];
+
+        BatchItem item;
+        while (decoded.Pop(item))
+        {
+            const Clock::time_point t0 = Clock::now();
+            for (size_t k = 0; k < steps.size() && item.bOk; k++)
+            {
+                const CImageBuffer& in = (k == 0) ? item.image : frames[(k - 1) & 1];
+                item.bOk = !m_bStopRequested &&
+                    CSequenceManager::ProcessStep(steps[k].get(), in, frames[k & 1], m_rcROIs, bufs[k], &m_bStopRequested);
+                if (!item.bOk && !m_bStopRequested)
+                    CLogger::Error(L"CBatchProcessor - Step %d (%ls) failed on %ls", (int)k + 1,
+                        steps[k]->GetName().c_str(), files[item.nIndex].c_str());
+            }
+            if (item.bOk)
+                item.image = frames[(steps.size() - 1) & 1];
+            busyMs += ElapsedMs(t0, Clock::now());
+            if (!processed.Push(std::move(item)))
+                break;
+        }
+    });
+
+    // Encode
+    StartStage(encoders, nEncoders, encodeBusy, [&](double& busyMs)
+    {
+        BatchItem item;
+        while (processed.Pop(item))
+        {
+            const Clock::time_point t0 = Clock::now();
+            if (item.bOk && !options.strOutputDir.empty())
+                item.bOk = item.image.SaveToFile(GetOutputPath(files[item.nIndex], options));
+            item.image.Release();
+            const Clock::time_point t1 = Clock::now();
+            busyMs += ElapsedMs(t0, t1);
+            latencyMs[item.nIndex] = ElapsedMs(item.tStart, t1);
+            if (!item.bOk)
+                latencyMs[item.nIndex] = -2.0;   // failed
+            if (m_fnItem)
+                m_fnItem(files[item.nIndex], item.bOk, ElapsedMs(item.tStart, t1));
+        }
+    });
+
+    // Each queue closes once every producer of the stage before it has finished
+    for (auto& t : decoders) t.join();
+    decoded.Close();
+    for (auto& t : workers) t.join();
+    processed.Close();
+    for (auto& t : encoders) t.join();
+
+    const double elapsedMs = ElapsedMs(tRunStart, Clock::now());
+    std::vector<double> sorted;
+    for (double ms : latencyMs)
+    {
+        if (ms == -1.0) continue;   // never reached the pipeline (stopped)
+        stats.nImages++;
+        if (ms < 0.0) stats.nFailed++;
+        else sorted.push_back(ms);
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    stats.dElapsedSec         = elapsedMs / 1000.0;
+    stats.dImagesPerSec       = elapsedMs > 0.0 ? stats.nImages * 1000.0 / elapsedMs : 0.0;
+    stats.dDecodeUtilisation  = Utilisation(decodeBusy, elapsedMs);
+    stats.dProcessUtilisation = Utilisation(processBusy, elapsedMs);
+    stats.dEncodeUtilisation  = Utilisation(encodeBusy, elapsedMs);
+    stats.dLatencyP50Ms       = Percentile(sorted, 50.0);
+    stats.dLatencyP99Ms       = Percentile(sorted, 99.0);
+
+    CLogger::Info(L"CBatchProcessor::Run - %d images (%d failed) in %.2f s, %.1f images/s",
+        stats.nImages, stats.nFailed, stats.dElapsedSec, stats.dImagesPerSec);
+    return true;
+}
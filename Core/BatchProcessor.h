@@ -0,0 +1,74 @@
+#pragma once
+#include "Core/ImageBuffer.h"
+#include "Algorithm/AlgorithmBase.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct BatchOptions
+{
+    int          nDecodeThreads    = 1;
+    int          nWorkers          = 0;   // 0 = one per hardware thread
+    int          nEncodeThreads    = 1;
+    int          nThreadsPerWorker = 1;   // OpenMP threads each worker's algorithms may use
+    int          nQueueDepth       = 0;   // frames each queue holds; 0 = one per worker
+    std::wstring strOutputDir;            // empty = results are not written
+    std::wstring strOutputExtension;      // format of the written files; empty = the input's
+};
+
+struct BatchStats
+{
+    int    nImages;               // images that went through the pipeline
+    int    nFailed;               // ... and failed to load, process or save
+    double dElapsedSec;
+    double dImagesPerSec;
+    double dDecodeUtilisation;    // busy share of each stage's threads over the run, 0..1
+    double dProcessUtilisation;
+    double dEncodeUtilisation;
+    double dLatencyP50Ms;         // per image, from the start of its decode to the end of its save
+    double dLatencyP99Ms;
+};
+
+// Called on an encode thread as each image leaves the pipeline
+typedef std::function<void(const std::wstring& path, bool bOk, double dLatencyMs)> BatchItemFn;
+
+// Runs one step list over many images as three overlapped stages: decode threads load files,
+// workers run the steps, encode threads write the results. Bounded queues between the stages
+// keep at most nQueueDepth frames waiting on each side of the workers. Every worker owns
+// clones of the steps and its own step buffers, so images never share algorithm state and a
+// worker's buffers stay warm from one image to the next.
+class CBatchProcessor {
+public:
+    CBatchProcessor();
+    ~CBatchProcessor();
+
+    // The step list; each worker runs clones of these prototypes
+    void AddStep(CAlgorithmBase* pAlg);   // takes ownership
+    void ClearSteps();
+    int  GetStepCount() const { return (int)m_steps.size(); }
+    void SetROIs(const std::vector<ImageRect>& rois) { m_rcROIs = rois; }
+
+    void SetItemCallback(const BatchItemFn& fn) { m_fnItem = fn; }
+
+    // Synchronous. False if nothing could run (no steps, no files, bad options); images that
+    // fail on the way are counted in stats.nFailed and logged.
+    bool Run(const std::vector<std::wstring>& files, const BatchOptions& options, BatchStats& stats);
+    // From another thread: no further files are read, running steps are cancelled and the
+    // images already in the pipeline come out as failed
+    void Stop() { m_bStopRequested = true; }
+
+    // Image files directly in 'dir' (by extension, sorted by name)
+    static std::vector<std::wstring> ListImageFiles(const std::wstring& dir);
+    // Where Run() writes the result for 'inputPath'
+    static std::wstring GetOutputPath(const std::wstring& inputPath, const BatchOptions& options);
+
+private:
+    CBatchProcessor(const CBatchProcessor&) = delete;
+    CBatchProcessor& operator=(const CBatchProcessor&) = delete;
+
+    std::vector<CAlgorithmBase*> m_steps;
+    std::vector<ImageRect>       m_rcROIs;
+    BatchItemFn                  m_fnItem;
+    std::atomic<bool>            m_bStopRequested;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Blocking FIFO with a fixed capacity, connecting the stages of a pipeline. A full queue
+// holds its producers back, so a fast stage cannot run ahead of a slow one by more than the
+// capacity (and the frames it holds). Any number of producers and consumers.
+template <typename T>
+class CBoundedQueue {
+public:
+    explicit CBoundedQueue(size_t nCapacity)
+        : m_nCapacity(nCapacity > 0 ? nCapacity : 1)
+        , m_bClosed(false)
+    {
+    }
+
+    // Waits while the queue is full; false (item not queued) once the queue is closed
+    bool Push(T&& item)
+    {
+        std::unique_lock<std::mutex> lock(m_cs);
+        m_cvNotFull.wait(lock, [this] { return m_bClosed || m_items.size() < m_nCapacity; });
+        if (m_bClosed)
+            return false;
+        m_items.push_back(std::move(item));
+        m_cvNotEmpty.notify_one();
+        return true;
+    }
+
+    // Waits while the queue is empty; false once it is closed and drained
+    bool Pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(m_cs);
+        m_cvNotEmpty.wait(lock, [this] { return m_bClosed || !m_items.empty(); });
+        if (m_items.empty())
+            return false;
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_cvNotFull.notify_one();
+        return true;
+    }
+
+    // No more pushes; consumers still receive what is queued
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(m_cs);
+        m_bClosed = true;
+        m_cvNotFull.notify_all();
+        m_cvNotEmpty.notify_all();
+    }
+
+private:
+    std::mutex              m_cs;
+    std::condition_variable m_cvNotFull;
+    std::condition_variable m_cvNotEmpty;
+    std::deque<T>           m_items;
+    size_t                  m_nCapacity;
+    bool                    m_bClosed;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+// Platform-neutral basics shared by Core/ and Algorithm/.
+// Nothing here may depend on MFC, Win32 or GDI+ so the core library builds headless.
+
+#include <cstddef>
+#include <string>
+
+// Same definition as <windows.h>, so both may be seen by one translation unit
+typedef unsigned char BYTE;
+
+// Maximum dimensions of an in-memory (decoded, full-frame processed) image
+#define MAX_IMAGE_WIDTH     5120
+#define MAX_IMAGE_HEIGHT    5120
+
+// Maximum dimensions of a mapped raw frame; larger than memory, so it is processed in tiles
+#define MAX_TILED_IMAGE_WIDTH   65536
+#define MAX_TILED_IMAGE_HEIGHT  65536
+
+// Sample type of every channel of a pixel. White is 255, 65535 and 1.0 respectively; U16 carries
+// 10-16 bit camera data and U16/F32 keep chain intermediates from being re-quantized to 8 bits.
+enum class PixelDepth { U8, U16, F32 };
+
+inline int PixelDepthBytes(PixelDepth depth)
+{
+    return depth == PixelDepth::U8 ? 1 : (depth == PixelDepth::U16 ? 2 : 4);
+}
+
+inline double PixelDepthMax(PixelDepth depth)
+{
+    return depth == PixelDepth::U8 ? 255.0 : (depth == PixelDepth::U16 ? 65535.0 : 1.0);
+}
+
+// Arrangement of the channels of a multi-channel buffer. Interleaved keeps a pixel's samples
+// together (RGBRGB...); Planar stores one plane of rows per channel (RRR... GGG... BBB...), so
+// per-channel kernels run unit-stride inner loops. Single-channel buffers are always Interleaved.
+enum class PixelLayout { Interleaved, Planar };
+
+// Integer rectangle with exclusive right/bottom (same layout and semantics as CRect/RECT)
+struct ImageRect
+{
+    int left;
+    int top;
+    int right;
+    int bottom;
+
+    ImageRect() : left(0), top(0), right(0), bottom(0) {}
+    ImageRect(int l, int t, int r, int b) : left(l), top(t), right(r), bottom(b) {}
+
+    int  Width() const       { return right - left; }
+    int  Height() const      { return bottom - top; }
+    bool IsRectEmpty() const { return right <= left || bottom <= top; }
+};
+
+struct ImagePoint
+{
+    int x;
+    int y;
+
+    ImagePoint() : x(0), y(0) {}
+    ImagePoint(int px, int py) : x(px), y(py) {}
+};
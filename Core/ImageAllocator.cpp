@@ -0,0 +1,192 @@
+#include "Core/ImageAllocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// ============================================================================
+// CAlignedAllocator
+// ============================================================================
+
+CAlignedAllocator& CAlignedAllocator::GetInstance()
+{
+    static CAlignedAllocator instance;
+    return instance;
+}
+
+BYTE* CAlignedAllocator::AllocateBlock(size_t bytes)
+{
+#ifdef _WIN32
+    return static_cast<BYTE*>(_aligned_malloc(bytes, IMAGE_BUFFER_ALIGNMENT));
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, IMAGE_BUFFER_ALIGNMENT, bytes) != 0)
+        return nullptr;
+    return static_cast<BYTE*>(p);
+#endif
+}
+
+void CAlignedAllocator::FreeBlock(BYTE* pBlock)
+{
+    if (!pBlock) return;
+#ifdef _WIN32
+    _aligned_free(pBlock);
+#else
+    free(pBlock);
+#endif
+}
+
+BYTE* CAlignedAllocator::Allocate(size_t bytes, size_t& capacity)
+{
+    capacity = (bytes + IMAGE_BUFFER_ALIGNMENT - 1) & ~(size_t)(IMAGE_BUFFER_ALIGNMENT - 1);
+    BYTE* p = AllocateBlock(capacity);
+    if (!p) capacity = 0;
+    return p;
+}
+
+void CAlignedAllocator::Free(BYTE* pBlock, size_t /*capacity*/)
+{
+    FreeBlock(pBlock);
+}
+
+// ============================================================================
+// CBufferPool
+// ============================================================================
+
+CBufferPool& CBufferPool::GetInstance()
+{
+    static CBufferPool instance;
+    return instance;
+}
+
+CBufferPool::CBufferPool()
+    : m_nMaxCachedBytes(sizeof(void*) == 4 ? ((size_t)256 << 20) : ((size_t)1 << 30))
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CBufferPool::~CBufferPool()
+{
+    Trim();
+}
+
+// Round up to one of 4 buckets per power of two (max 25% slack), never below one page
+size_t CBufferPool::BucketSize(size_t bytes)
+{
+    const size_t kPage = 4096;
+    if (bytes <= kPage) return kPage;
+
+    size_t pow2 = kPage;
+    while ((pow2 << 1) != 0 && (pow2 << 1) <= bytes) pow2 <<= 1;
+
+    size_t step = std::max(kPage, pow2 / 4);
+    return (bytes + step - 1) / step * step;
+}
+
+BYTE* CBufferPool::Allocate(size_t bytes, size_t& capacity)
+{
+    capacity = BucketSize(bytes);
+
+    {
+        std::lock_guard<std::mutex> lock(m_cs);
+        auto it = m_freeLists.find(capacity);
+        if (it != m_freeLists.end() && !it->second.empty())
+        {
+            BYTE* p = it->second.back();
+            it->second.pop_back();
+            m_stats.nHits++;
+            m_stats.nBytesCached -= capacity;
+            m_stats.nBytesInUse  += capacity;
+            return p;
+        }
+    }
+
+    BYTE* p = CAlignedAllocator::AllocateBlock(capacity);
+
+    std::lock_guard<std::mutex> lock(m_cs);
+    m_stats.nMisses++;
+    if (!p)
+    {
+        capacity = 0;
+        return nullptr;
+    }
+    m_stats.nBytesInUse += capacity;
+    UpdatePeak();
+    return p;
+}
+
+void CBufferPool::Free(BYTE* pBlock, size_t capacity)
+{
+    if (!pBlock) return;
+
+    bool bCached = false;
+    {
+        std::lock_guard<std::mutex> lock(m_cs);
+        m_stats.nReleases++;
+        m_stats.nBytesInUse -= capacity;
+        if (m_stats.nBytesCached + capacity <= m_nMaxCachedBytes)
+        {
+            m_freeLists[capacity].push_back(pBlock);
+            m_stats.nBytesCached += capacity;
+            bCached = true;
+        }
+    }
+
+    if (!bCached)
+        CAlignedAllocator::FreeBlock(pBlock);
+}
+
+void CBufferPool::SetMaxCachedBytes(size_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_cs);
+        m_nMaxCachedBytes = bytes;
+        if (m_stats.nBytesCached <= m_nMaxCachedBytes)
+            return;
+    }
+    Trim();
+}
+
+size_t CBufferPool::GetMaxCachedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    return m_nMaxCachedBytes;
+}
+
+void CBufferPool::Trim()
+{
+    std::map<size_t, std::vector<BYTE*>> freeLists;
+    {
+        std::lock_guard<std::mutex> lock(m_cs);
+        freeLists.swap(m_freeLists);
+        m_stats.nBytesCached = 0;
+    }
+
+    for (auto& bucket : freeLists)
+        for (BYTE* p : bucket.second)
+            CAlignedAllocator::FreeBlock(p);
+}
+
+ImagePoolStats CBufferPool::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    return m_stats;
+}
+
+void CBufferPool::ResetStats()
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    m_stats.nHits     = 0;
+    m_stats.nMisses   = 0;
+    m_stats.nReleases = 0;
+    m_stats.nPeakBytes = m_stats.nBytesInUse + m_stats.nBytesCached;
+}
+
+void CBufferPool::UpdatePeak()
+{
+    unsigned long long total = m_stats.nBytesInUse + m_stats.nBytesCached;
+    if (total > m_stats.nPeakBytes) m_stats.nPeakBytes = total;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "Core/CoreTypes.h"
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Alignment of every image base pointer and row stride (one cache line, one AVX-512 vector)
+#define IMAGE_BUFFER_ALIGNMENT  64
+
+// Pluggable backing store for CImageBuffer pixel memory.
+// Allocate() returns an IMAGE_BUFFER_ALIGNMENT-aligned block of at least 'bytes' and reports
+// the real block size in 'capacity'; the same capacity is handed back to Free().
+class IImageAllocator {
+public:
+    virtual ~IImageAllocator() {}
+    virtual BYTE* Allocate(size_t bytes, size_t& capacity) = 0;
+    virtual void  Free(BYTE* pBlock, size_t capacity) = 0;
+};
+
+// Plain aligned heap allocation (no caching)
+class CAlignedAllocator : public IImageAllocator {
+public:
+    static CAlignedAllocator& GetInstance();
+    virtual BYTE* Allocate(size_t bytes, size_t& capacity) override;
+    virtual void  Free(BYTE* pBlock, size_t capacity) override;
+
+    static BYTE* AllocateBlock(size_t bytes);
+    static void  FreeBlock(BYTE* pBlock);
+};
+
+struct ImagePoolStats
+{
+    unsigned long long nHits;         // Allocate() served from a cached block
+    unsigned long long nMisses;       // Allocate() that had to go to the heap
+    unsigned long long nReleases;     // Free() calls (cached or returned to heap)
+    unsigned long long nBytesInUse;   // bytes currently owned by live buffers
+    unsigned long long nBytesCached;  // bytes parked in the free lists
+    unsigned long long nPeakBytes;    // high-water mark of in-use + cached bytes
+};
+
+// Size-bucketed buffer pool. Requests are rounded up to a bucket (4 buckets per power of two,
+// page granularity) so a released frame can be reused by any later request of similar size.
+// Blocks are only returned to the heap by Trim() or when the cache limit would be exceeded.
+class CBufferPool : public IImageAllocator {
+public:
+    static CBufferPool& GetInstance();
+    ~CBufferPool();
+
+    virtual BYTE* Allocate(size_t bytes, size_t& capacity) override;
+    virtual void  Free(BYTE* pBlock, size_t capacity) override;
+
+    void   SetMaxCachedBytes(size_t bytes);
+    size_t GetMaxCachedBytes() const;
+    void   Trim();                        // release every cached block to the heap
+
+    ImagePoolStats GetStats() const;
+    void           ResetStats();          // zero hit/miss/release counters, peak = current
+
+    static size_t BucketSize(size_t bytes);
+
+private:
+    CBufferPool();
+    CBufferPool(const CBufferPool&) = delete;
+    CBufferPool& operator=(const CBufferPool&) = delete;
+
+    void UpdatePeak();
+
+    std::map<size_t, std::vector<BYTE*>> m_freeLists;   // bucket size -> cached blocks
+    size_t                   m_nMaxCachedBytes;
+    ImagePoolStats           m_stats;
+    mutable std::mutex       m_cs;
+};
@@ -1,6 +1,21 @@
 #pragma once
-#include "stdafx.h"
+#include "Core/CoreTypes.h"
+#include "Core/ImageAllocator.h"
+#include "Core/ImageView.h"
+#include <atomic>
+#include <string>
 
+class CImagePyramid;
+
+// Pixel storage is reference counted and copy-on-write: copies, assignment and Clone() share
+// the same block, and the first mutable access (non-const GetData, SetPixel, PasteRegion)
+// on a shared or read-only buffer detaches it into a private copy. Create() never copies; on a shared
+// buffer it simply starts a new block because the caller is about to overwrite the pixels.
+//
+// Samples are 8-bit by default; U16 and F32 buffers (see PixelDepth) use the same layout with
+// wider samples, and GetStride() is always in bytes. Pixels are interleaved unless the buffer
+// was created Planar: then each channel is its own plane of GetHeight() rows at GetStride(),
+// the planes follow each other GetPlaneStride() bytes apart, and GetData() is plane 0.
 class CImageBuffer {
 public:
     CImageBuffer();
@@ -10,37 +25,121 @@ public:
     CImageBuffer& operator=(CImageBuffer&& other) noexcept;
     ~CImageBuffer();
 
-    bool Create(int width, int height, int channels = 3);
+    bool Create(int width, int height, int channels = 3, PixelDepth depth = PixelDepth::U8,
+                PixelLayout layout = PixelLayout::Interleaved);
     bool CopyDataFrom(const CImageBuffer& src);              // reuse allocation, memcpy only
-    bool ExtractRegionInto(const CRect& rc, CImageBuffer& dst) const;  // ROI without alloc
-    bool LoadFromFile(const CString& filePath);
-    bool SaveToFile(const CString& filePath);
-    CImageBuffer Clone() const;
+    bool ExtractRegionInto(const ImageRect& rc, CImageBuffer& dst) const;  // ROI without alloc
+    bool LoadFromFile(const std::wstring& filePath);        // BMP/PGM/PPM/QOI natively, else GDI+;
+                                                            // a corrupt file leaves the buffer released
+    bool SaveToFile(const std::wstring& filePath) const;    // format chosen by extension
+
+    // Raw frame container (.vraw): 64-byte header, then the rows at GetStride().
+    // Files are always interleaved; a planar buffer is saved through an interleaved copy.
+    // MapRawFile() maps the file read-only and uses it as the pixel storage (no decode, no copy);
+    // the first write detaches into a private pooled copy, exactly like a shared buffer.
+    // SaveRawFile() writes header and pixel block in one sequential pass.
+    bool MapRawFile(const std::wstring& filePath);
+    bool SaveRawFile(const std::wstring& filePath) const;
+    CImageBuffer Clone() const;                               // shares storage (O(1))
+
+    // Converts to another depth, rescaling white (255 / 65535 / 1.0) and saturating when
+    // narrowing. Same depth shares the storage. dst must not be this buffer.
+    bool ConvertTo(PixelDepth depth, CImageBuffer& dst) const;
+
+    // Rearranges the channels (SIMD interleave/deinterleave). Same layout shares the storage.
+    bool ConvertLayout(PixelLayout layout, CImageBuffer& dst) const;
+
+    // Both at once, e.g. ConvertTo(PixelDepth::U8, PixelLayout::Interleaved, ...) for display
+    bool ConvertTo(PixelDepth depth, PixelLayout layout, CImageBuffer& dst) const;
     void Release();
 
-    BYTE* GetData() const { return m_pData; }
+    const BYTE* GetData() const { return m_pData; }
+    BYTE* GetData() { return Detach() ? m_pData : nullptr; }  // unshares before writing
+    const BYTE* GetConstData() const { return m_pData; }      // read access on non-const objects
+    bool IsShared() const { return m_pStorage != nullptr && m_pStorage->nRefs.load() > 1; }
+    long GetShareCount() const { return m_pStorage ? m_pStorage->nRefs.load() : 0; }      // holders of the storage
+    bool SharesStorageWith(const CImageBuffer& other) const { return m_pStorage != nullptr && m_pStorage == other.m_pStorage; }
+    bool IsReadOnly() const { return m_pStorage != nullptr && m_pStorage->bReadOnly; }   // file mapping
     int GetWidth() const { return m_nWidth; }
     int GetHeight() const { return m_nHeight; }
     int GetChannels() const { return m_nChannels; }
     int GetStride() const { return m_nStride; }
+    PixelDepth GetDepth() const { return m_eDepth; }
+    int GetPixelBytes() const { return m_nChannels * PixelDepthBytes(m_eDepth); }
+    PixelLayout GetLayout() const { return m_eLayout; }
+    bool IsPlanar() const { return m_eLayout == PixelLayout::Planar; }
+    int GetPlaneCount() const { return IsPlanar() ? m_nChannels : 1; }
+    size_t GetPlaneStride() const { return IsPlanar() ? (size_t)m_nStride * m_nHeight : 0; }
+    const BYTE* GetPlane(int plane) const { return m_pData ? m_pData + plane * GetPlaneStride() : nullptr; }
+    size_t GetCapacity() const { return m_pStorage ? m_pStorage->nCapacity : 0; }
     bool IsValid() const { return m_pData != nullptr && m_nWidth > 0 && m_nHeight > 0; }
 
+    // 8-bit buffers only (return 0 / ignored otherwise)
     BYTE GetPixel(int x, int y, int ch = 0) const;
     void SetPixel(int x, int y, int ch, BYTE value);
 
-    HBITMAP CreateHBitmap() const;
+    // Built from the nearest pyramid level when the frame already has one, so a large reduction
+    // is box-filtered, not aliased; without one, bilinear samples of the frame (no pyramid built)
     CImageBuffer CreateThumbnail(int maxWidth, int maxHeight) const;
 
+    // Display mip pyramid (ImagePyramid.cpp): level n is the frame as 8-bit interleaved,
+    // halved n times with a 2x2 box filter. Levels are built on first use and cached with the
+    // pixel block, so every copy of the frame shares them; the first write drops the cache.
+    int GetPyramidLevelCount() const;
+    int SelectPyramidLevel(int width, int height) const;   // smallest level still >= width x height
+    CImageBuffer GetPyramidLevel(int level) const;          // shares the cached level
+
+    // Zero-copy views; a rect is clamped to the image and its halo reaches the image border.
+    // GetView() unshares the storage first, like the non-const GetData().
+    ImageView      GetView();
+    ImageView      GetView(const ImageRect& rc);
+    ConstImageView GetConstView() const;
+    ConstImageView GetConstView(const ImageRect& rc) const;
+
     // ROI region operations
-    CImageBuffer ExtractRegion(const CRect& rcRegion) const;
+    CImageBuffer ExtractRegion(const ImageRect& rcRegion) const;
     void PasteRegion(const CImageBuffer& source, int destX, int destY);
 
+    // Allocator used by subsequent Create() calls (default: CBufferPool)
+    static void SetAllocator(IImageAllocator* pAllocator);
+    static IImageAllocator* GetAllocator();
+
 private:
-    BYTE* m_pData;
+    struct Storage
+    {
+        BYTE*             pBlock;
+        size_t            nCapacity;    // size of pBlock as reported by the allocator
+        IImageAllocator*  pAllocator;   // allocator that owns pBlock
+        bool              bReadOnly;    // pBlock may not be written (mapped file)
+        std::atomic<long> nRefs;
+        std::atomic<CImagePyramid*> pPyramid;   // display levels of pBlock, built on demand
+    };
+
+    BYTE* m_pData;          // == m_pStorage->pBlock, cached for the accessors
     int m_nWidth;
     int m_nHeight;
     int m_nChannels;
     int m_nStride;
+    PixelDepth m_eDepth;
+    PixelLayout m_eLayout;
+    Storage* m_pStorage;
+
+    static IImageAllocator* s_pAllocator;
+
+#ifdef _WIN32
+    // JPEG/PNG/TIFF and BMP variants the native codec does not handle (ImageBufferGdiplus.cpp)
+    bool LoadWithGdiplus(const std::wstring& filePath);
+    bool SaveWithGdiplus(const std::wstring& filePath) const;
+#endif
+
+    // Bytes from one pixel to the next within a row (of a plane, when planar)
+    int GetColumnBytes() const { return IsPlanar() ? PixelDepthBytes(m_eDepth) : GetPixelBytes(); }
+    size_t GetDataSize() const { return (size_t)m_nStride * m_nHeight * GetPlaneCount(); }
 
     void CopyFrom(const CImageBuffer& other);
+    bool AllocateStorage(size_t bytes);
+    void FreeStorage();
+    bool Detach();
+    void DropPyramid();                        // before the sole owner rewrites the pixels
+    static void ReleaseStorage(Storage* pStorage);
 };
@@ -0,0 +1,240 @@
+// GDI+ fallback for file formats the native codecs do not cover (Windows only)
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// GDI+ headers use unqualified min/max, which NOMINMAX removed
+namespace Gdiplus { using std::min; using std::max; }
+#include <gdiplus.h>
+
+#include "Core/ImageBuffer.h"
+#include "Core/PixelConvert.h"
+#include "Utils/Logger.h"
+#include "Utils/StringUtil.h"
+
+// Encoder CLSIDs never change for the life of the process; enumerate GDI+ encoders once per MIME type
+static bool FindEncoderClsid(const std::wstring& mimeType, CLSID& clsid)
+{
+    static std::mutex cs;
+    static std::map<std::wstring, CLSID> cache;
+
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = cache.find(mimeType);
+    if (it != cache.end())
+    {
+        clsid = it->second;
+        return true;
+    }
+
+    UINT numEncoders = 0;
+    UINT encoderSize = 0;
+    Gdiplus::GetImageEncodersSize(&numEncoders, &encoderSize);
+    if (encoderSize == 0) return false;
+
+    std::vector<BYTE> storage(encoderSize);
+    Gdiplus::ImageCodecInfo* pEncoders = reinterpret_cast<Gdiplus::ImageCodecInfo*>(storage.data());
+    Gdiplus::GetImageEncoders(numEncoders, encoderSize, pEncoders);
+
+    for (UINT i = 0; i < numEncoders; i++)
+    {
+        if (mimeType == pEncoders[i].MimeType)
+        {
+            clsid = pEncoders[i].Clsid;
+            cache[mimeType] = clsid;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CImageBuffer::LoadWithGdiplus(const std::wstring& filePath)
+{
+    Gdiplus::Bitmap bmp(filePath.c_str());
+    if (bmp.GetLastStatus() != Gdiplus::Ok)
+    {
+        CLogger::Error(L"CImageBuffer::LoadWithGdiplus - Failed to load: %ls", filePath.c_str());
+        return false;
+    }
+
+    int srcWidth = static_cast<int>(bmp.GetWidth());
+    int srcHeight = static_cast<int>(bmp.GetHeight());
+
+    if (srcWidth <= 0 || srcHeight <= 0)
+    {
+        CLogger::Error(L"CImageBuffer::LoadWithGdiplus - Invalid image dimensions: %d x %d", srcWidth, srcHeight);
+        return false;
+    }
+
+    if (srcWidth > MAX_IMAGE_WIDTH || srcHeight > MAX_IMAGE_HEIGHT)
+    {
+        CLogger::Error(L"CImageBuffer::LoadWithGdiplus - Image too large: %d x %d (max %d x %d)",
+            srcWidth, srcHeight, MAX_IMAGE_WIDTH, MAX_IMAGE_HEIGHT);
+        return false;
+    }
+
+    // Determine source pixel format and target channels
+    Gdiplus::PixelFormat srcFormat = bmp.GetPixelFormat();
+    int targetChannels = 3; // Default to RGB
+
+    // Check if source is grayscale
+    bool isGrayscale = (srcFormat == PixelFormat8bppIndexed);
+
+    if (isGrayscale)
+    {
+        targetChannels = 1;
+    }
+
+    if (!Create(srcWidth, srcHeight, targetChannels))
+    {
+        return false;
+    }
+
+    // Lock the source bitmap for reading
+    Gdiplus::Rect lockRect(0, 0, srcWidth, srcHeight);
+    Gdiplus::BitmapData bmpData;
+
+    Gdiplus::PixelFormat lockFormat;
+    if (targetChannels == 1)
+    {
+        // For grayscale, we need to handle carefully
+        // Lock as 24bpp and convert, since 8bpp indexed LockBits can be tricky
+        lockFormat = PixelFormat24bppRGB;
+    }
+    else
+    {
+        lockFormat = PixelFormat24bppRGB;
+    }
+
+    Gdiplus::Status lockStatus = bmp.LockBits(&lockRect, Gdiplus::ImageLockModeRead, lockFormat, &bmpData);
+    if (lockStatus != Gdiplus::Ok)
+    {
+        CLogger::Error(L"CImageBuffer::LoadWithGdiplus - LockBits failed with status %d", lockStatus);
+        Release();
+        return false;
+    }
+
+    BYTE* pSrcData = static_cast<BYTE*>(bmpData.Scan0);
+    int srcStride = bmpData.Stride;
+
+    if (targetChannels == 1 && isGrayscale)
+    {
+        // Convert from 24bpp BGR to grayscale (standard luminance; R, G and B are equal here anyway)
+        for (int y = 0; y < srcHeight; y++)
+            PixelConvert::BgrToGray(pSrcData + y * srcStride, m_pData + y * m_nStride, srcWidth);
+    }
+    else
+    {
+        // Copy 24bpp RGB data (GDI+ stores as BGR)
+        // We store as RGB internally
+        for (int y = 0; y < srcHeight; y++)
+            PixelConvert::SwapRedBlue(pSrcData + y * srcStride, m_pData + y * m_nStride, srcWidth);
+    }
+
+    bmp.UnlockBits(&bmpData);
+
+    CLogger::Info(L"CImageBuffer::LoadWithGdiplus - Loaded %ls (%d x %d, %d ch)",
+        filePath.c_str(), m_nWidth, m_nHeight, m_nChannels);
+    return true;
+}
+
+bool CImageBuffer::SaveWithGdiplus(const std::wstring& filePath) const
+{
+    // Create GDI+ bitmap from our data
+    Gdiplus::Bitmap* pBitmap = nullptr;
+
+    if (m_nChannels == 1)
+    {
+        // Grayscale: create 24bpp bitmap and fill with gray values
+        pBitmap = new Gdiplus::Bitmap(m_nWidth, m_nHeight, PixelFormat24bppRGB);
+        if (pBitmap->GetLastStatus() != Gdiplus::Ok)
+        {
+            CLogger::Error(L"CImageBuffer::SaveWithGdiplus - Failed to create GDI+ bitmap");
+            delete pBitmap;
+            return false;
+        }
+
+        Gdiplus::Rect lockRect(0, 0, m_nWidth, m_nHeight);
+        Gdiplus::BitmapData bmpData;
+        pBitmap->LockBits(&lockRect, Gdiplus::ImageLockModeWrite, PixelFormat24bppRGB, &bmpData);
+
+        BYTE* pDst = static_cast<BYTE*>(bmpData.Scan0);
+        for (int y = 0; y < m_nHeight; y++)
+            PixelConvert::GrayToRgb(m_pData + y * m_nStride, pDst + y * bmpData.Stride, m_nWidth);
+        pBitmap->UnlockBits(&bmpData);
+    }
+    else if (m_nChannels == 3)
+    {
+        // RGB: create 24bpp bitmap and convert RGB to BGR
+        pBitmap = new Gdiplus::Bitmap(m_nWidth, m_nHeight, PixelFormat24bppRGB);
+        if (pBitmap->GetLastStatus() != Gdiplus::Ok)
+        {
+            CLogger::Error(L"CImageBuffer::SaveWithGdiplus - Failed to create GDI+ bitmap");
+            delete pBitmap;
+            return false;
+        }
+
+        Gdiplus::Rect lockRect(0, 0, m_nWidth, m_nHeight);
+        Gdiplus::BitmapData bmpData;
+        pBitmap->LockBits(&lockRect, Gdiplus::ImageLockModeWrite, PixelFormat24bppRGB, &bmpData);
+
+        BYTE* pDst = static_cast<BYTE*>(bmpData.Scan0);
+        for (int y = 0; y < m_nHeight; y++)
+            PixelConvert::SwapRedBlue(m_pData + y * m_nStride, pDst + y * bmpData.Stride, m_nWidth);
+        pBitmap->UnlockBits(&bmpData);
+    }
+    else
+    {
+        CLogger::Error(L"CImageBuffer::SaveWithGdiplus - Unsupported channel count: %d", m_nChannels);
+        return false;
+    }
+
+    // Determine encoder CLSID based on file extension
+    std::wstring ext = GetFileExtension(filePath);
+
+    std::wstring mimeType;
+    if (ext == L"bmp")
+        mimeType = L"image/bmp";
+    else if (ext == L"jpg" || ext == L"jpeg")
+        mimeType = L"image/jpeg";
+    else if (ext == L"png")
+        mimeType = L"image/png";
+    else if (ext == L"tif" || ext == L"tiff")
+        mimeType = L"image/tiff";
+    else
+        mimeType = L"image/bmp"; // Default to BMP
+
+    CLSID encoderClsid;
+    bool foundEncoder = FindEncoderClsid(mimeType, encoderClsid);
+
+    bool success = false;
+    if (foundEncoder)
+    {
+        Gdiplus::Status status = pBitmap->Save(filePath.c_str(), &encoderClsid, nullptr);
+        success = (status == Gdiplus::Ok);
+        if (!success)
+        {
+            CLogger::Error(L"CImageBuffer::SaveWithGdiplus - Save failed with status %d", status);
+        }
+    }
+    else
+    {
+        CLogger::Error(L"CImageBuffer::SaveWithGdiplus - No encoder found for extension: %ls", ext.c_str());
+    }
+
+    delete pBitmap;
+
+    if (success)
+    {
+        CLogger::Info(L"CImageBuffer::SaveWithGdiplus - Saved %ls", filePath.c_str());
+    }
+    return success;
+}
+
+#endif // _WIN32
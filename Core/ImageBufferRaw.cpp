@@ -0,0 +1,269 @@
+// Raw frame container (.vraw) for CImageBuffer: memory-mapped load, single-pass save.
+//
+// Layout (little-endian):
+//   0  char[4]  magic "VSRF"
+//   4  uint32   version (1)
+//   8  uint32   header size (64) == offset of the first row
+//  12  int32    width
+//  16  int32    height
+//  20  int32    channels
+//  24  int32    stride (bytes per row, >= width * channels * sample size)
+//  28  uint32   pixel format, interleaved in native byte order (0 = U8, 1 = U16, 2 = F32)
+//  32  uint64   pixel bytes (stride * height)
+//  40  reserved (zero) up to 64
+//
+// The header is one cache line, so a page-aligned mapping leaves every row exactly as aligned
+// as it was in the CImageBuffer that wrote it.
+
+#include "Core/ImageBuffer.h"
+#include "Core/RawFrame.h"
+#include "Utils/Logger.h"
+#include "Utils/StringUtil.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// Owner of mapped pixel blocks. It never allocates; Free() unmaps the view that starts one
+// header before the pixels.
+class CMappedFileAllocator : public IImageAllocator
+{
+public:
+    static CMappedFileAllocator& GetInstance()
+    {
+        static CMappedFileAllocator instance;
+        return instance;
+    }
+
+    virtual BYTE* Allocate(size_t /*bytes*/, size_t& capacity) override
+    {
+        capacity = 0;
+        return nullptr;
+    }
+
+    virtual void Free(BYTE* pBlock, size_t capacity) override
+    {
+        if (!pBlock) return;
+        BYTE* pView = pBlock - RAW_FRAME_HEADER_SIZE;
+#ifdef _WIN32
+        (void)capacity;
+        UnmapViewOfFile(pView);
+#else
+        munmap(pView, capacity + RAW_FRAME_HEADER_SIZE);
+#endif
+    }
+};
+
+bool ValidateHeader(const RawFrameHeader& hdr, unsigned long long fileSize, const std::wstring& filePath)
+{
+    if (memcmp(hdr.magic, "VSRF", 4) != 0 || hdr.nVersion != RAW_FRAME_VERSION ||
+        hdr.nHeaderSize != RAW_FRAME_HEADER_SIZE || hdr.nPixelFormat > RAW_FRAME_FORMAT_F32)
+    {
+        CLogger::Error(L"CImageBuffer::MapRawFile - Not a raw frame (or unsupported version): %ls", filePath.c_str());
+        return false;
+    }
+    if (hdr.nWidth <= 0 || hdr.nHeight <= 0 || hdr.nWidth > MAX_TILED_IMAGE_WIDTH || hdr.nHeight > MAX_TILED_IMAGE_HEIGHT ||
+        hdr.nChannels <= 0 || hdr.nChannels > 4 ||
+        hdr.nStride < hdr.nWidth * hdr.nChannels * PixelDepthBytes((PixelDepth)hdr.nPixelFormat) ||
+        hdr.nDataSize != (unsigned long long)hdr.nStride * hdr.nHeight)
+    {
+        CLogger::Error(L"CImageBuffer::MapRawFile - Invalid geometry %d x %d x %d, stride %d: %ls",
+            hdr.nWidth, hdr.nHeight, hdr.nChannels, hdr.nStride, filePath.c_str());
+        return false;
+    }
+    if (fileSize < RAW_FRAME_HEADER_SIZE + hdr.nDataSize)
+    {
+        CLogger::Error(L"CImageBuffer::MapRawFile - Truncated file: %ls", filePath.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool CImageBuffer::MapRawFile(const std::wstring& filePath)
+{
+    BYTE* pView = nullptr;
+    unsigned long long fileSize = 0;
+
+#ifdef _WIN32
+    HANDLE hFile = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        CLogger::Error(L"CImageBuffer::MapRawFile - Cannot open %ls", filePath.c_str());
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(hFile, &size) && size.QuadPart >= (LONGLONG)RAW_FRAME_HEADER_SIZE)
+    {
+        fileSize = (unsigned long long)size.QuadPart;
+        HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (hMapping)
+        {
+            pView = static_cast<BYTE*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(hMapping);   // the view keeps the mapping alive
+        }
+    }
+    CloseHandle(hFile);
+#else
+    int fd = open(WideToUtf8(filePath).c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        CLogger::Error(L"CImageBuffer::MapRawFile - Cannot open %ls", filePath.c_str());
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (unsigned long long)st.st_size >= RAW_FRAME_HEADER_SIZE)
+    {
+        fileSize = (unsigned long long)st.st_size;
+        void* p = mmap(nullptr, (size_t)fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            pView = static_cast<BYTE*>(p);
+            madvise(p, (size_t)fileSize, MADV_WILLNEED);   // start read-ahead, don't wait for it
+        }
+    }
+    close(fd);   // the mapping keeps the file alive
+#endif
+
+    if (!pView)
+    {
+        CLogger::Error(L"CImageBuffer::MapRawFile - Mapping failed: %ls", filePath.c_str());
+        return false;
+    }
+
+    RawFrameHeader hdr;
+    memcpy(&hdr, pView, sizeof(hdr));
+    CMappedFileAllocator& owner = CMappedFileAllocator::GetInstance();
+    if (!ValidateHeader(hdr, fileSize, filePath))
+    {
+        owner.Free(pView + RAW_FRAME_HEADER_SIZE, (size_t)fileSize - RAW_FRAME_HEADER_SIZE);
+        return false;
+    }
+
+    Release();
+    m_pStorage = new Storage;
+    m_pStorage->pBlock = pView + RAW_FRAME_HEADER_SIZE;
+    m_pStorage->nCapacity = (size_t)fileSize - RAW_FRAME_HEADER_SIZE;
+    m_pStorage->pAllocator = &owner;
+    m_pStorage->bReadOnly = true;
+    m_pStorage->nRefs = 1;
+    m_pStorage->pPyramid = nullptr;
+    m_pData = m_pStorage->pBlock;
+    m_nWidth = hdr.nWidth;
+    m_nHeight = hdr.nHeight;
+    m_nChannels = hdr.nChannels;
+    m_nStride = hdr.nStride;
+    m_eDepth = (PixelDepth)hdr.nPixelFormat;
+    m_eLayout = PixelLayout::Interleaved;
+
+    CLogger::Info(L"CImageBuffer::MapRawFile - Mapped %ls (%d x %d, %d ch)",
+        filePath.c_str(), m_nWidth, m_nHeight, m_nChannels);
+    return true;
+}
+
+bool CImageBuffer::SaveRawFile(const std::wstring& filePath) const
+{
+    if (!IsValid())
+    {
+        CLogger::Error(L"CImageBuffer::SaveRawFile - Buffer is not valid");
+        return false;
+    }
+    if (IsPlanar())
+    {
+        CImageBuffer interleaved;
+        return ConvertLayout(PixelLayout::Interleaved, interleaved) && interleaved.SaveRawFile(filePath);
+    }
+
+    RawFrameHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, "VSRF", 4);
+    hdr.nVersion = RAW_FRAME_VERSION;
+    hdr.nHeaderSize = (unsigned int)RAW_FRAME_HEADER_SIZE;
+    hdr.nWidth = m_nWidth;
+    hdr.nHeight = m_nHeight;
+    hdr.nChannels = m_nChannels;
+    hdr.nStride = m_nStride;
+    hdr.nPixelFormat = (unsigned int)m_eDepth;
+    hdr.nDataSize = (unsigned long long)m_nStride * m_nHeight;
+
+    // Rows are contiguous at m_nStride, so the whole frame is header + one block
+    const BYTE* pPixels = m_pData;
+    size_t remaining = (size_t)hdr.nDataSize;
+    bool ok = false;
+
+#ifdef _WIN32
+    HANDLE hFile = CreateFileW(filePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile != INVALID_HANDLE_VALUE)
+    {
+        DWORD written = 0;
+        ok = WriteFile(hFile, &hdr, (DWORD)sizeof(hdr), &written, nullptr) && written == sizeof(hdr);
+        while (ok && remaining > 0)
+        {
+            DWORD chunk = (DWORD)std::min<size_t>(remaining, (size_t)1 << 30);
+            ok = WriteFile(hFile, pPixels, chunk, &written, nullptr) && written == chunk;
+            pPixels += chunk;
+            remaining -= chunk;
+        }
+        ok = CloseHandle(hFile) && ok;
+        if (!ok) DeleteFileW(filePath.c_str());
+    }
+#else
+    std::string path = WideToUtf8(filePath);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0)
+    {
+        // One gathered write for header + pixels; loop only on short writes
+        struct iovec iov[2];
+        iov[0].iov_base = &hdr;
+        iov[0].iov_len = sizeof(hdr);
+        iov[1].iov_base = const_cast<BYTE*>(pPixels);
+        iov[1].iov_len = remaining;
+        int nIov = 2;
+        struct iovec* pIov = iov;
+        ok = true;
+        while (nIov > 0)
+        {
+            ssize_t n = writev(fd, pIov, nIov);
+            if (n < 0) { ok = false; break; }
+            while (nIov > 0 && (size_t)n >= pIov->iov_len)
+            {
+                n -= (ssize_t)pIov->iov_len;
+                pIov++;
+                nIov--;
+            }
+            if (nIov > 0)
+            {
+                pIov->iov_base = static_cast<BYTE*>(pIov->iov_base) + n;
+                pIov->iov_len -= (size_t)n;
+            }
+        }
+        ok = (close(fd) == 0) && ok;
+        if (!ok) unlink(path.c_str());
+    }
+#endif
+
+    if (!ok)
+    {
+        CLogger::Error(L"CImageBuffer::SaveRawFile - Write failed: %ls", filePath.c_str());
+        return false;
+    }
+    CLogger::Info(L"CImageBuffer::SaveRawFile - Saved %ls", filePath.c_str());
+    return true;
+}
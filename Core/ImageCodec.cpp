@@ -0,0 +1,821 @@
+#include "Core/ImageCodec.h"
+#include "Core/ImageBuffer.h"
+#include "Core/PixelConvert.h"
+#include "Utils/Logger.h"
+#include "Utils/StringUtil.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+// ============================================================================
+// Byte streams
+// ============================================================================
+
+const size_t kStreamBufferSize = 64 * 1024;
+
+// Forward-only reader over a FILE* (buffered) or a memory block (zero-copy).
+// Large Read() calls bypass the buffer and land directly in the caller's memory.
+class ByteSource
+{
+public:
+    explicit ByteSource(FILE* fp)
+        : m_fp(fp), m_buf(kStreamBufferSize), m_pCur(nullptr), m_pEnd(nullptr) {}
+    ByteSource(const BYTE* pData, size_t size)
+        : m_fp(nullptr), m_pCur(pData), m_pEnd(pData + size) {}
+
+    // Returns -1 at end of stream
+    int Get()
+    {
+        if (m_pCur == m_pEnd && !Refill()) return -1;
+        return *m_pCur++;
+    }
+
+    bool Read(void* pDst, size_t n)
+    {
+        BYTE* p = static_cast<BYTE*>(pDst);
+        size_t avail = (size_t)(m_pEnd - m_pCur);
+        size_t take = std::min(avail, n);
+        if (take)
+        {
+            memcpy(p, m_pCur, take);
+            m_pCur += take; p += take; n -= take;
+        }
+        if (n == 0) return true;
+        if (!m_fp) return false;
+
+        if (n >= m_buf.size())
+            return fread(p, 1, n, m_fp) == n;
+        if (!Refill() || (size_t)(m_pEnd - m_pCur) < n) return false;
+        memcpy(p, m_pCur, n);
+        m_pCur += n;
+        return true;
+    }
+
+    bool Skip(size_t n)
+    {
+        size_t avail = (size_t)(m_pEnd - m_pCur);
+        if (n <= avail) { m_pCur += n; return true; }
+        m_pCur = m_pEnd;
+        n -= avail;
+        return m_fp && fseek(m_fp, (long)n, SEEK_CUR) == 0;
+    }
+
+    // Makes up to n bytes visible without consuming them (n <= buffer size)
+    const BYTE* Peek(size_t n, size_t& avail)
+    {
+        if ((size_t)(m_pEnd - m_pCur) < n && m_fp)
+        {
+            size_t have = (size_t)(m_pEnd - m_pCur);
+            if (have) memmove(m_buf.data(), m_pCur, have);
+            have += fread(m_buf.data() + have, 1, m_buf.size() - have, m_fp);
+            m_pCur = m_buf.data();
+            m_pEnd = m_pCur + have;
+        }
+        avail = std::min(n, (size_t)(m_pEnd - m_pCur));
+        return m_pCur;
+    }
+
+private:
+    bool Refill()
+    {
+        if (!m_fp) return false;
+        size_t got = fread(m_buf.data(), 1, m_buf.size(), m_fp);
+        m_pCur = m_buf.data();
+        m_pEnd = m_pCur + got;
+        return got > 0;
+    }
+
+    FILE*             m_fp;
+    std::vector<BYTE> m_buf;
+    const BYTE*       m_pCur;
+    const BYTE*       m_pEnd;
+};
+
+// Buffered writer to a FILE* or an in-memory vector
+class ByteSink
+{
+public:
+    explicit ByteSink(FILE* fp) : m_fp(fp), m_pOut(nullptr), m_bOk(true) { m_buf.reserve(kStreamBufferSize); }
+    explicit ByteSink(std::vector<BYTE>& out) : m_fp(nullptr), m_pOut(&out), m_bOk(true) { m_buf.reserve(kStreamBufferSize); }
+
+    void Put(BYTE b)
+    {
+        m_buf.push_back(b);
+        if (m_buf.size() >= kStreamBufferSize) Flush();
+    }
+
+    void Write(const void* pSrc, size_t n)
+    {
+        const BYTE* p = static_cast<const BYTE*>(pSrc);
+        if (m_buf.size() + n < kStreamBufferSize)
+        {
+            m_buf.insert(m_buf.end(), p, p + n);
+            return;
+        }
+        Flush();
+        if (m_fp) m_bOk = m_bOk && fwrite(p, 1, n, m_fp) == n;
+        else      m_pOut->insert(m_pOut->end(), p, p + n);
+    }
+
+    void PutU16LE(unsigned v) { Put((BYTE)v); Put((BYTE)(v >> 8)); }
+    void PutU32LE(unsigned long v) { PutU16LE(v & 0xFFFF); PutU16LE((v >> 16) & 0xFFFF); }
+    void PutU32BE(unsigned long v) { Put((BYTE)(v >> 24)); Put((BYTE)(v >> 16)); Put((BYTE)(v >> 8)); Put((BYTE)v); }
+
+    bool Flush()
+    {
+        if (!m_buf.empty())
+        {
+            if (m_fp) m_bOk = m_bOk && fwrite(m_buf.data(), 1, m_buf.size(), m_fp) == m_buf.size();
+            else      m_pOut->insert(m_pOut->end(), m_buf.begin(), m_buf.end());
+            m_buf.clear();
+        }
+        return m_bOk;
+    }
+
+private:
+    FILE*              m_fp;
+    std::vector<BYTE>* m_pOut;
+    std::vector<BYTE>  m_buf;
+    bool               m_bOk;
+};
+
+inline unsigned ReadU16LE(const BYTE* p) { return p[0] | (p[1] << 8); }
+inline unsigned long ReadU32LE(const BYTE* p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+inline unsigned long ReadU32BE(const BYTE* p)
+{
+    return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) | ((unsigned long)p[2] << 8) | (unsigned long)p[3];
+}
+
+bool CheckDimensions(const wchar_t* codec, long width, long height)
+{
+    if (width <= 0 || height <= 0 || width > MAX_IMAGE_WIDTH || height > MAX_IMAGE_HEIGHT)
+    {
+        CLogger::Error(L"CImageCodec - %ls: unsupported dimensions %ld x %ld (max %d x %d)",
+            codec, width, height, MAX_IMAGE_WIDTH, MAX_IMAGE_HEIGHT);
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// BMP (BI_RGB 8/24/32 bpp, BI_BITFIELDS 32 bpp with standard masks)
+// ============================================================================
+
+const unsigned long BMP_BI_RGB       = 0;
+const unsigned long BMP_BI_BITFIELDS = 3;
+
+CodecResult DecodeBmp(ByteSource& src, CImageBuffer& image)
+{
+    BYTE hdr[54];
+    if (!src.Read(hdr, 18)) return CodecResult::Failed;
+
+    unsigned long offBits = ReadU32LE(hdr + 10);
+    unsigned long infoSize = ReadU32LE(hdr + 14);
+    if (infoSize < 40) return CodecResult::NotHandled;     // OS/2 core header
+    if (!src.Read(hdr + 18, 36)) return CodecResult::Failed;
+
+    long width  = (long)(int)ReadU32LE(hdr + 18);
+    long height = (long)(int)ReadU32LE(hdr + 22);
+    unsigned bitCount = ReadU16LE(hdr + 28);
+    unsigned long compression = ReadU32LE(hdr + 30);
+    unsigned long clrUsed = ReadU32LE(hdr + 46);
+
+    bool bTopDown = height < 0;
+    if (bTopDown) height = -height;
+
+    bool bSupported = (bitCount == 8 && compression == BMP_BI_RGB)
+                   || (bitCount == 24 && compression == BMP_BI_RGB)
+                   || (bitCount == 32 && (compression == BMP_BI_RGB || compression == BMP_BI_BITFIELDS));
+    if (!bSupported) return CodecResult::NotHandled;        // RLE, 16 bpp, 1/4 bpp, JPEG/PNG-in-BMP
+    if (!CheckDimensions(L"BMP", width, height)) return CodecResult::Failed;
+
+    // BITFIELDS masks follow a 40-byte header; V2+ headers carry them at offset 40
+    size_t consumed = 54;
+    size_t extra = infoSize - 40;          // header bytes past BITMAPINFOHEADER
+    if (compression == BMP_BI_BITFIELDS)
+    {
+        if (extra != 0 && extra < 12) return CodecResult::NotHandled;
+        BYTE masks[12];
+        if (!src.Read(masks, 12)) return CodecResult::Failed;
+        consumed += 12;
+        extra = extra ? extra - 12 : 0;
+        if (ReadU32LE(masks) != 0x00FF0000 || ReadU32LE(masks + 4) != 0x0000FF00 || ReadU32LE(masks + 8) != 0x000000FF)
+            return CodecResult::NotHandled;
+    }
+    if (!src.Skip(extra)) return CodecResult::Failed;
+    consumed += extra;
+
+    // Palette (8 bpp): gray palettes load as a single channel
+    BYTE palette[256][3] = {};
+    bool bGray = false;
+    if (bitCount == 8)
+    {
+        size_t entries = (clrUsed == 0 || clrUsed > 256) ? 256 : clrUsed;
+        BYTE quad[4];
+        bGray = true;
+        for (size_t i = 0; i < entries; i++)
+        {
+            if (!src.Read(quad, 4)) return CodecResult::Failed;
+            palette[i][0] = quad[2];   // R
+            palette[i][1] = quad[1];   // G
+            palette[i][2] = quad[0];   // B
+            if (quad[0] != quad[1] || quad[1] != quad[2]) bGray = false;
+        }
+        consumed += entries * 4;
+    }
+
+    if (offBits < consumed) return CodecResult::Failed;
+    if (!src.Skip(offBits - consumed)) return CodecResult::Failed;
+
+    const int w = (int)width, h = (int)height;
+    const int channels = (bitCount == 8 && bGray) ? 1 : 3;
+    if (!image.Create(w, h, channels)) return CodecResult::Failed;
+
+    const size_t srcRowBytes = (((size_t)w * bitCount + 31) / 32) * 4;
+    const size_t pixelBytes  = (size_t)w * bitCount / 8;
+    std::vector<BYTE> rowBuf;                  // 32 bpp rows are wider than the RGB destination
+    if (bitCount == 32) rowBuf.resize(pixelBytes);
+
+    BYTE lut[256];
+    for (int i = 0; i < 256; i++) lut[i] = palette[i][0];
+
+    BYTE* pData = image.GetData();
+    const int stride = image.GetStride();
+
+    for (int r = 0; r < h; r++)
+    {
+        BYTE* pDst = pData + (size_t)(bTopDown ? r : h - 1 - r) * stride;
+
+        if (bitCount == 24)
+        {
+            if (!src.Read(pDst, pixelBytes)) return CodecResult::Failed;
+            PixelConvert::SwapRedBlue(pDst, pDst, w);   // BGR -> RGB in place
+        }
+        else if (bitCount == 32)
+        {
+            if (!src.Read(rowBuf.data(), pixelBytes)) return CodecResult::Failed;
+            PixelConvert::BgraToRgb(rowBuf.data(), pDst, w);
+        }
+        else if (channels == 1)
+        {
+            if (!src.Read(pDst, pixelBytes)) return CodecResult::Failed;
+            for (int x = 0; x < w; x++)
+                pDst[x] = lut[pDst[x]];
+        }
+        else
+        {
+            // Read indices into the tail of the RGB row and expand forwards in place:
+            // index x sits at 2w+x and is consumed before RGB triple x (ending at 3x+2) overwrites it
+            BYTE* pIdx = pDst + 2 * (size_t)w;
+            if (!src.Read(pIdx, pixelBytes)) return CodecResult::Failed;
+            for (int x = 0; x < w; x++)
+            {
+                const BYTE* c = palette[pIdx[x]];
+                pDst[x * 3 + 0] = c[0];
+                pDst[x * 3 + 1] = c[1];
+                pDst[x * 3 + 2] = c[2];
+            }
+        }
+
+        if (srcRowBytes > pixelBytes && !src.Skip(srcRowBytes - pixelBytes))
+            return CodecResult::Failed;
+    }
+    return CodecResult::Ok;
+}
+
+bool EncodeBmp(const CImageBuffer& image, ByteSink& dst)
+{
+    const int w = image.GetWidth(), h = image.GetHeight(), ch = image.GetChannels();
+    if (ch != 1 && ch != 3)
+    {
+        CLogger::Error(L"CImageCodec - BMP: unsupported channel count %d", ch);
+        return false;
+    }
+
+    const unsigned bitCount = ch == 1 ? 8 : 24;
+    const size_t rowBytes = (((size_t)w * bitCount + 31) / 32) * 4;
+    const size_t paletteBytes = ch == 1 ? 256 * 4 : 0;
+    const size_t offBits = 54 + paletteBytes;
+    const size_t fileSize = offBits + rowBytes * h;
+
+    // BITMAPFILEHEADER
+    dst.Put('B'); dst.Put('M');
+    dst.PutU32LE((unsigned long)fileSize);
+    dst.PutU32LE(0);
+    dst.PutU32LE((unsigned long)offBits);
+    // BITMAPINFOHEADER (bottom-up)
+    dst.PutU32LE(40);
+    dst.PutU32LE((unsigned long)w);
+    dst.PutU32LE((unsigned long)h);
+    dst.PutU16LE(1);
+    dst.PutU16LE(bitCount);
+    dst.PutU32LE(BMP_BI_RGB);
+    dst.PutU32LE((unsigned long)(rowBytes * h));
+    dst.PutU32LE(2835);                     // 72 DPI
+    dst.PutU32LE(2835);
+    dst.PutU32LE(ch == 1 ? 256 : 0);
+    dst.PutU32LE(0);
+
+    if (ch == 1)
+        for (int i = 0; i < 256; i++) { dst.Put((BYTE)i); dst.Put((BYTE)i); dst.Put((BYTE)i); dst.Put(0); }
+
+    std::vector<BYTE> row(rowBytes, 0);
+    const BYTE* pData = image.GetData();
+    const int stride = image.GetStride();
+    for (int y = h - 1; y >= 0; y--)
+    {
+        const BYTE* pSrc = pData + (size_t)y * stride;
+        if (ch == 1)
+            memcpy(row.data(), pSrc, w);
+        else
+            PixelConvert::SwapRedBlue(pSrc, row.data(), w);
+        dst.Write(row.data(), rowBytes);
+    }
+    return true;
+}
+
+// ============================================================================
+// PGM / PPM (binary P5 / P6)
+// ============================================================================
+
+// Next header integer, skipping whitespace and '#' comments; consumes one trailing whitespace
+bool ReadPnmInt(ByteSource& src, long& value)
+{
+    int c = src.Get();
+    for (;;)
+    {
+        if (c == '#')
+            while (c != '\n' && c != -1) c = src.Get();
+        else if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+            c = src.Get();
+        else
+            break;
+    }
+    if (c < '0' || c > '9') return false;
+
+    value = 0;
+    while (c >= '0' && c <= '9')
+    {
+        value = value * 10 + (c - '0');
+        if (value > 0x7FFFFFF) return false;
+        c = src.Get();
+    }
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+CodecResult DecodePnm(ByteSource& src, CImageBuffer& image)
+{
+    BYTE magic[2];
+    if (!src.Read(magic, 2)) return CodecResult::Failed;
+    if (magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6')) return CodecResult::NotHandled;   // ASCII P2/P3, PBM
+
+    const int channels = magic[1] == '5' ? 1 : 3;
+    long width = 0, height = 0, maxVal = 0;
+    if (!ReadPnmInt(src, width) || !ReadPnmInt(src, height) || !ReadPnmInt(src, maxVal) ||
+        maxVal <= 0 || maxVal > 65535)
+    {
+        CLogger::Error(L"CImageCodec - PNM: malformed header");
+        return CodecResult::Failed;
+    }
+    if (!CheckDimensions(channels == 1 ? L"PGM" : L"PPM", width, height)) return CodecResult::Failed;
+
+    // More than 8 bits per sample (e.g. 12-bit mono cameras) loads as U16 at full scale
+    const int w = (int)width, h = (int)height;
+    const PixelDepth depth = maxVal < 256 ? PixelDepth::U8 : PixelDepth::U16;
+    if (!image.Create(w, h, channels, depth)) return CodecResult::Failed;
+
+    BYTE* pData = image.GetData();
+    const int stride = image.GetStride();
+    const size_t rowSamples = (size_t)w * channels;
+
+    if (maxVal < 256)
+    {
+        // Samples are bytes in our own order: read rows in place, rescale only if needed
+        BYTE lut[256];
+        for (int i = 0; i < 256; i++) lut[i] = (BYTE)std::min(255L, (i * 255 + maxVal / 2) / maxVal);
+
+        for (int y = 0; y < h; y++)
+        {
+            BYTE* pDst = pData + (size_t)y * stride;
+            if (!src.Read(pDst, rowSamples)) return CodecResult::Failed;
+            if (maxVal != 255)
+                for (size_t i = 0; i < rowSamples; i++) pDst[i] = lut[pDst[i]];
+        }
+    }
+    else
+    {
+        // 16-bit big-endian samples, rescaled so maxVal becomes 65535
+        std::vector<BYTE> rowBuf(rowSamples * 2);
+        for (int y = 0; y < h; y++)
+        {
+            if (!src.Read(rowBuf.data(), rowBuf.size())) return CodecResult::Failed;
+            unsigned short* pDst = reinterpret_cast<unsigned short*>(pData + (size_t)y * stride);
+            // 64-bit products: v * 65535 exceeds a 32-bit long for the upper half of the range
+            const unsigned long long nMax = (unsigned long long)maxVal;
+            for (size_t i = 0; i < rowSamples; i++)
+            {
+                const unsigned long long v = ((unsigned)rowBuf[i * 2] << 8) | rowBuf[i * 2 + 1];
+                if (nMax == 65535)
+                    pDst[i] = (unsigned short)v;
+                else
+                    pDst[i] = (unsigned short)std::min(65535ULL, (v * 65535 + nMax / 2) / nMax);
+            }
+        }
+    }
+    return CodecResult::Ok;
+}
+
+// 16-bit PNM body: big-endian samples, channels mapped like the 8-bit path
+void EncodePnm16(const CImageBuffer& image, int outChannels, ByteSink& dst)
+{
+    const int w = image.GetWidth(), h = image.GetHeight(), ch = image.GetChannels();
+    std::vector<BYTE> row((size_t)w * outChannels * 2);
+    for (int y = 0; y < h; y++)
+    {
+        const unsigned short* pSrc =
+            reinterpret_cast<const unsigned short*>(image.GetData() + (size_t)y * image.GetStride());
+        BYTE* pOut = row.data();
+        for (int x = 0; x < w; x++)
+        {
+            for (int c = 0; c < outChannels; c++)
+            {
+                unsigned v;
+                if (ch == outChannels) v = pSrc[x * ch + c];
+                else if (ch == 1)      v = pSrc[x];
+                else v = (pSrc[x * 3] * 299u + pSrc[x * 3 + 1] * 587u + pSrc[x * 3 + 2] * 114u) / 1000u;
+                *pOut++ = (BYTE)(v >> 8);
+                *pOut++ = (BYTE)v;
+            }
+        }
+        dst.Write(row.data(), row.size());
+    }
+}
+
+// outChannels 1 -> P5, 3 -> P6; gray is expanded and RGB reduced to luminance as needed.
+// U16 images are written with maxval 65535.
+bool EncodePnm(const CImageBuffer& image, int outChannels, ByteSink& dst)
+{
+    const int w = image.GetWidth(), h = image.GetHeight(), ch = image.GetChannels();
+    if (ch != 1 && ch != 3)
+    {
+        CLogger::Error(L"CImageCodec - PNM: unsupported channel count %d", ch);
+        return false;
+    }
+
+    const bool bWide = image.GetDepth() == PixelDepth::U16;
+    char header[64];
+    int len = snprintf(header, sizeof(header), "P%c\n%d %d\n%d\n", outChannels == 1 ? '5' : '6', w, h,
+                       bWide ? 65535 : 255);
+    dst.Write(header, (size_t)len);
+    if (bWide)
+    {
+        EncodePnm16(image, outChannels, dst);
+        return true;
+    }
+
+    const BYTE* pData = image.GetData();
+    const int stride = image.GetStride();
+    std::vector<BYTE> row(ch == outChannels ? 0 : (size_t)w * outChannels);
+    for (int y = 0; y < h; y++)
+    {
+        const BYTE* pSrc = pData + (size_t)y * stride;
+        if (ch == outChannels)
+        {
+            dst.Write(pSrc, (size_t)w * ch);      // rows are already in file order
+            continue;
+        }
+        if (outChannels == 3)
+            PixelConvert::GrayToRgb(pSrc, row.data(), w);
+        else
+            PixelConvert::RgbToGray(pSrc, row.data(), w);
+        dst.Write(row.data(), row.size());
+    }
+    return true;
+}
+
+// ============================================================================
+// QOI (https://qoiformat.org/qoi-specification.pdf)
+// ============================================================================
+
+const BYTE QOI_OP_INDEX = 0x00;
+const BYTE QOI_OP_DIFF  = 0x40;
+const BYTE QOI_OP_LUMA  = 0x80;
+const BYTE QOI_OP_RUN   = 0xC0;
+const BYTE QOI_OP_RGB   = 0xFE;
+const BYTE QOI_OP_RGBA  = 0xFF;
+const BYTE QOI_MASK_2   = 0xC0;
+
+struct QoiPixel { BYTE r, g, b, a; };
+
+inline int QoiHash(const QoiPixel& p) { return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) & 63; }
+
+CodecResult DecodeQoi(ByteSource& src, CImageBuffer& image)
+{
+    BYTE hdr[14];
+    if (!src.Read(hdr, 14)) return CodecResult::Failed;
+    if (memcmp(hdr, "qoif", 4) != 0) return CodecResult::NotHandled;
+
+    unsigned long width = ReadU32BE(hdr + 4), height = ReadU32BE(hdr + 8);
+    if (hdr[12] != 3 && hdr[12] != 4)
+    {
+        CLogger::Error(L"CImageCodec - QOI: invalid channel count %d", hdr[12]);
+        return CodecResult::Failed;
+    }
+    if (width > 0x7FFFFFFF || height > 0x7FFFFFFF ||
+        !CheckDimensions(L"QOI", (long)width, (long)height))
+        return CodecResult::Failed;
+
+    const int w = (int)width, h = (int)height;
+    if (!image.Create(w, h, 3)) return CodecResult::Failed;   // alpha is dropped
+
+    QoiPixel index[64] = {};
+    QoiPixel px = { 0, 0, 0, 255 };
+    int run = 0;
+
+    BYTE* pData = image.GetData();
+    const int stride = image.GetStride();
+    for (int y = 0; y < h; y++)
+    {
+        BYTE* pDst = pData + (size_t)y * stride;
+        for (int x = 0; x < w; x++, pDst += 3)
+        {
+            if (run > 0)
+                run--;
+            else
+            {
+                int b1 = src.Get();
+                if (b1 < 0) return CodecResult::Failed;
+
+                if (b1 == QOI_OP_RGB || b1 == QOI_OP_RGBA)
+                {
+                    BYTE rgba[4];
+                    if (!src.Read(rgba, b1 == QOI_OP_RGB ? 3 : 4)) return CodecResult::Failed;
+                    px.r = rgba[0]; px.g = rgba[1]; px.b = rgba[2];
+                    if (b1 == QOI_OP_RGBA) px.a = rgba[3];
+                }
+                else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX)
+                    px = index[b1];
+                else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF)
+                {
+                    px.r = (BYTE)(px.r + ((b1 >> 4) & 3) - 2);
+                    px.g = (BYTE)(px.g + ((b1 >> 2) & 3) - 2);
+                    px.b = (BYTE)(px.b + (b1 & 3) - 2);
+                }
+                else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA)
+                {
+                    int b2 = src.Get();
+                    if (b2 < 0) return CodecResult::Failed;
+                    int vg = (b1 & 0x3F) - 32;
+                    px.r = (BYTE)(px.r + vg - 8 + ((b2 >> 4) & 0x0F));
+                    px.g = (BYTE)(px.g + vg);
+                    px.b = (BYTE)(px.b + vg - 8 + (b2 & 0x0F));
+                }
+                else   // QOI_OP_RUN
+                    run = b1 & 0x3F;
+
+                index[QoiHash(px)] = px;
+            }
+            pDst[0] = px.r;
+            pDst[1] = px.g;
+            pDst[2] = px.b;
+        }
+    }
+    return CodecResult::Ok;
+}
+
+bool EncodeQoi(const CImageBuffer& image, ByteSink& dst)
+{
+    const int w = image.GetWidth(), h = image.GetHeight(), ch = image.GetChannels();
+    if (ch != 1 && ch != 3)
+    {
+        CLogger::Error(L"CImageCodec - QOI: unsupported channel count %d", ch);
+        return false;
+    }
+
+    dst.Write("qoif", 4);
+    dst.PutU32BE((unsigned long)w);
+    dst.PutU32BE((unsigned long)h);
+    dst.Put(3);     // RGB (gray is stored as R=G=B)
+    dst.Put(0);     // sRGB with linear alpha
+
+    QoiPixel index[64] = {};
+    QoiPixel prev = { 0, 0, 0, 255 };
+    int run = 0;
+
+    const BYTE* pData = image.GetData();
+    const int stride = image.GetStride();
+    for (int y = 0; y < h; y++)
+    {
+        const BYTE* pSrc = pData + (size_t)y * stride;
+        for (int x = 0; x < w; x++, pSrc += ch)
+        {
+            QoiPixel px = { pSrc[0], pSrc[ch == 3 ? 1 : 0], pSrc[ch == 3 ? 2 : 0], 255 };
+
+            if (px.r == prev.r && px.g == prev.g && px.b == prev.b)
+            {
+                if (++run == 62)
+                {
+                    dst.Put((BYTE)(QOI_OP_RUN | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0)
+            {
+                dst.Put((BYTE)(QOI_OP_RUN | (run - 1)));
+                run = 0;
+            }
+
+            int hash = QoiHash(px);
+            const QoiPixel& cached = index[hash];
+            if (cached.r == px.r && cached.g == px.g && cached.b == px.b && cached.a == px.a)
+                dst.Put((BYTE)(QOI_OP_INDEX | hash));
+            else
+            {
+                index[hash] = px;
+
+                signed char vr = (signed char)(px.r - prev.r);
+                signed char vg = (signed char)(px.g - prev.g);
+                signed char vb = (signed char)(px.b - prev.b);
+                signed char vgr = (signed char)(vr - vg);
+                signed char vgb = (signed char)(vb - vg);
+
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                    dst.Put((BYTE)(QOI_OP_DIFF | ((vr + 2) << 4) | ((vg + 2) << 2) | (vb + 2)));
+                else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8)
+                {
+                    dst.Put((BYTE)(QOI_OP_LUMA | (vg + 32)));
+                    dst.Put((BYTE)(((vgr + 8) << 4) | (vgb + 8)));
+                }
+                else
+                {
+                    dst.Put(QOI_OP_RGB);
+                    dst.Put(px.r); dst.Put(px.g); dst.Put(px.b);
+                }
+            }
+            prev = px;
+        }
+    }
+    if (run > 0)
+        dst.Put((BYTE)(QOI_OP_RUN | (run - 1)));
+
+    static const BYTE kEndMarker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    dst.Write(kEndMarker, sizeof(kEndMarker));
+    return true;
+}
+
+// ============================================================================
+// Dispatch helpers
+// ============================================================================
+
+CodecResult DecodeStream(ByteSource& src, CImageBuffer& image)
+{
+    size_t avail = 0;
+    const BYTE* pHeader = src.Peek(4, avail);
+    switch (CImageCodec::FormatFromSignature(pHeader, avail))
+    {
+    case ImageFileFormat::Bmp: return DecodeBmp(src, image);
+    case ImageFileFormat::Pgm:
+    case ImageFileFormat::Ppm: return DecodePnm(src, image);
+    case ImageFileFormat::Qoi: return DecodeQoi(src, image);
+    default:                   return CodecResult::NotHandled;
+    }
+}
+
+bool EncodeStream(ImageFileFormat format, const CImageBuffer& image, ByteSink& dst)
+{
+    // PNM stores up to 16 bits per sample; every other format is written from an 8-bit copy.
+    // All of them store interleaved pixels.
+    const bool bPnm = (format == ImageFileFormat::Pgm || format == ImageFileFormat::Ppm);
+    const PixelDepth target = (bPnm && image.GetDepth() != PixelDepth::U8) ? PixelDepth::U16 : PixelDepth::U8;
+    if (image.GetDepth() != target || image.IsPlanar())
+    {
+        CImageBuffer converted;
+        return image.ConvertTo(target, PixelLayout::Interleaved, converted) && EncodeStream(format, converted, dst);
+    }
+
+    switch (format)
+    {
+    case ImageFileFormat::Bmp: return EncodeBmp(image, dst);
+    case ImageFileFormat::Pgm: return EncodePnm(image, 1, dst);
+    case ImageFileFormat::Ppm: return EncodePnm(image, 3, dst);
+    case ImageFileFormat::Qoi: return EncodeQoi(image, dst);
+    default:                   return false;
+    }
+}
+
+} // namespace
+
+// ============================================================================
+// CImageCodec
+// ============================================================================
+
+ImageFileFormat CImageCodec::FormatFromExtension(const std::wstring& path)
+{
+    std::wstring ext = GetFileExtension(path);
+    if (ext == L"bmp" || ext == L"dib") return ImageFileFormat::Bmp;
+    if (ext == L"pgm")                  return ImageFileFormat::Pgm;
+    if (ext == L"ppm" || ext == L"pnm") return ImageFileFormat::Ppm;
+    if (ext == L"qoi")                  return ImageFileFormat::Qoi;
+    return ImageFileFormat::Unknown;
+}
+
+ImageFileFormat CImageCodec::FormatFromSignature(const BYTE* pHeader, size_t size)
+{
+    if (!pHeader || size < 2) return ImageFileFormat::Unknown;
+    if (pHeader[0] == 'B' && pHeader[1] == 'M') return ImageFileFormat::Bmp;
+    if (pHeader[0] == 'P' && pHeader[1] == '5') return ImageFileFormat::Pgm;
+    if (pHeader[0] == 'P' && pHeader[1] == '6') return ImageFileFormat::Ppm;
+    if (size >= 4 && memcmp(pHeader, "qoif", 4) == 0) return ImageFileFormat::Qoi;
+    return ImageFileFormat::Unknown;
+}
+
+FILE* CImageCodec::OpenFile(const std::wstring& path, const wchar_t* mode)
+{
+#ifdef _WIN32
+    FILE* fp = nullptr;
+    if (_wfopen_s(&fp, path.c_str(), mode) != 0) return nullptr;
+    return fp;
+#else
+    return fopen(WideToUtf8(path).c_str(), WideToUtf8(mode).c_str());
+#endif
+}
+
+CodecResult CImageCodec::Load(const std::wstring& path, CImageBuffer& image)
+{
+    FILE* fp = OpenFile(path, L"rb");
+    if (!fp)
+    {
+        CLogger::Error(L"CImageCodec::Load - Cannot open %ls", path.c_str());
+        return CodecResult::Failed;
+    }
+
+    ByteSource src(fp);
+    CodecResult result = DecodeStream(src, image);
+    fclose(fp);
+
+    if (result == CodecResult::Failed)
+    {
+        CLogger::Error(L"CImageCodec::Load - Truncated or corrupt file: %ls", path.c_str());
+        image.Release();
+    }
+    return result;
+}
+
+CodecResult CImageCodec::Save(const std::wstring& path, const CImageBuffer& image)
+{
+    ImageFileFormat format = FormatFromExtension(path);
+    if (format == ImageFileFormat::Unknown) return CodecResult::NotHandled;
+
+    // .pnm follows the image; .pgm/.ppm force gray/colour
+    if (format == ImageFileFormat::Ppm && GetFileExtension(path) == L"pnm" && image.GetChannels() == 1)
+        format = ImageFileFormat::Pgm;
+
+    FILE* fp = OpenFile(path, L"wb");
+    if (!fp)
+    {
+        CLogger::Error(L"CImageCodec::Save - Cannot create %ls", path.c_str());
+        return CodecResult::Failed;
+    }
+
+    ByteSink dst(fp);
+    bool ok = EncodeStream(format, image, dst) && dst.Flush();
+    ok = (fclose(fp) == 0) && ok;
+
+    if (!ok)
+    {
+        CLogger::Error(L"CImageCodec::Save - Write failed: %ls", path.c_str());
+#ifdef _WIN32
+        _wremove(path.c_str());
+#else
+        remove(WideToUtf8(path).c_str());
+#endif
+        return CodecResult::Failed;
+    }
+    return CodecResult::Ok;
+}
+
+CodecResult CImageCodec::Decode(const BYTE* pData, size_t size, CImageBuffer& image)
+{
+    if (!pData || size == 0) return CodecResult::NotHandled;
+
+    ByteSource src(pData, size);
+    CodecResult result = DecodeStream(src, image);
+    if (result == CodecResult::Failed)
+        image.Release();
+    return result;
+}
+
+bool CImageCodec::Encode(ImageFileFormat format, const CImageBuffer& image, std::vector<BYTE>& out)
+{
+    out.clear();
+    if (!image.IsValid()) return false;
+
+    ByteSink dst(out);
+    return EncodeStream(format, image, dst) && dst.Flush();
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "Core/CoreTypes.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class CImageBuffer;
+
+// File formats implemented natively (no GDI+)
+enum class ImageFileFormat { Unknown, Bmp, Pgm, Ppm, Qoi };
+
+// NotHandled means "not a format or variant this codec implements", so the caller may try
+// another decoder (GDI+ on Windows). Failed means the file is ours but broken or unwritable.
+enum class CodecResult { Ok, NotHandled, Failed };
+
+// Built-in codecs for uncompressed BMP (8/24/32 bpp), binary PGM/PPM (P5/P6) and QOI.
+//
+// Decoders read straight into the destination rows after a single Create(), so a buffer that
+// already has the right geometry keeps its allocation and no intermediate bitmap is built.
+// 8-bit BMPs with a gray palette and PGMs load as 1 channel; everything else loads as RGB
+// (alpha is dropped). QOI has no gray mode, so 1-channel images are stored as R=G=B.
+class CImageCodec
+{
+public:
+    static ImageFileFormat FormatFromExtension(const std::wstring& path);
+    static ImageFileFormat FormatFromSignature(const BYTE* pHeader, size_t size);
+
+    // Load sniffs the file signature; Save picks the format from the extension
+    static CodecResult Load(const std::wstring& path, CImageBuffer& image);
+    static CodecResult Save(const std::wstring& path, const CImageBuffer& image);
+
+    // In-memory variants (benchmarks, network payloads)
+    static CodecResult Decode(const BYTE* pData, size_t size, CImageBuffer& image);
+    static bool Encode(ImageFileFormat format, const CImageBuffer& image, std::vector<BYTE>& out);
+
+    // Opens a wide path with the platform file API (_wfopen on Windows, UTF-8 fopen elsewhere)
+    static FILE* OpenFile(const std::wstring& path, const wchar_t* mode);
+
+private:
+    // Prevent instantiation
+    CImageCodec() = delete;
+};
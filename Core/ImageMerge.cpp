@@ -0,0 +1,129 @@
+#include "Core/ImageMerge.h"
+#include "Core/ImageBuffer.h"
+#include "Utils/Logger.h"
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MERGE_SSE2 1
+#include <emmintrin.h>
+#else
+#define MERGE_SSE2 0
+#endif
+
+namespace
+{
+
+template <MergeOp Op>
+inline BYTE MergeSample(BYTE a, BYTE b)
+{
+    switch (Op)
+    {
+    case MergeOp::Mask:       return b ? a : 0;
+    case MergeOp::Difference: return (BYTE)(a > b ? a - b : b - a);
+    case MergeOp::Add:        return (BYTE)std::min(255, a + b);
+    case MergeOp::Min:        return std::min(a, b);
+    default:                  return std::max(a, b);
+    }
+}
+
+#if MERGE_SSE2
+template <MergeOp Op>
+inline __m128i MergeVector(__m128i a, __m128i b)
+{
+    switch (Op)
+    {
+    case MergeOp::Mask:       return _mm_andnot_si128(_mm_cmpeq_epi8(b, _mm_setzero_si128()), a);
+    case MergeOp::Difference: return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+    case MergeOp::Add:        return _mm_adds_epu8(a, b);
+    case MergeOp::Min:        return _mm_min_epu8(a, b);
+    default:                  return _mm_max_epu8(a, b);
+    }
+}
+#endif
+
+// One row; nChannels > 1 with bBroadcast means b has one sample per pixel
+template <MergeOp Op>
+void MergeRow(const BYTE* pA, const BYTE* pB, BYTE* pDst, int width, int nChannels, bool bBroadcast)
+{
+    if (bBroadcast)
+    {
+        for (int x = 0; x < width; x++)
+            for (int c = 0; c < nChannels; c++)
+                pDst[x * nChannels + c] = MergeSample<Op>(pA[x * nChannels + c], pB[x]);
+        return;
+    }
+
+    const int n = width * nChannels;
+    int i = 0;
+#if MERGE_SSE2
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pA + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pB + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), MergeVector<Op>(a, b));
+    }
+#endif
+    for (; i < n; i++)
+        pDst[i] = MergeSample<Op>(pA[i], pB[i]);
+}
+
+template <MergeOp Op>
+void MergeRows(const CImageBuffer& a, const CImageBuffer& b, CImageBuffer& dst)
+{
+    const int width = a.GetWidth(), height = a.GetHeight(), nChannels = a.GetChannels();
+    const bool bBroadcast = (b.GetChannels() != nChannels);
+    const BYTE* pA = a.GetData();
+    const BYTE* pB = b.GetData();
+    BYTE* pDst = dst.GetData();
+    const int strideA = a.GetStride(), strideB = b.GetStride(), strideDst = dst.GetStride();
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; y++)
+        MergeRow<Op>(pA + (size_t)y * strideA, pB + (size_t)y * strideB, pDst + (size_t)y * strideDst,
+                     width, nChannels, bBroadcast);
+}
+
+} // namespace
+
+bool CImageMerger::Merge(MergeOp op, const CImageBuffer& a, const CImageBuffer& b, CImageBuffer& dst)
+{
+    if (!a.IsValid() || !b.IsValid() || &dst == &a || &dst == &b)
+        return false;
+    if (a.GetDepth() != PixelDepth::U8 || b.GetDepth() != PixelDepth::U8 || a.IsPlanar() || b.IsPlanar())
+    {
+        CLogger::Error(L"CImageMerger::Merge - Inputs must be 8-bit interleaved");
+        return false;
+    }
+    if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight() ||
+        (b.GetChannels() != a.GetChannels() && b.GetChannels() != 1))
+    {
+        CLogger::Error(L"CImageMerger::Merge - %ls needs inputs of one size (%d x %d x %d vs %d x %d x %d)",
+            GetOpName(op), a.GetWidth(), a.GetHeight(), a.GetChannels(), b.GetWidth(), b.GetHeight(), b.GetChannels());
+        return false;
+    }
+    if (!dst.Create(a.GetWidth(), a.GetHeight(), a.GetChannels(), PixelDepth::U8))
+        return false;
+
+    switch (op)
+    {
+    case MergeOp::Mask:       MergeRows<MergeOp::Mask>(a, b, dst);       break;
+    case MergeOp::Difference: MergeRows<MergeOp::Difference>(a, b, dst); break;
+    case MergeOp::Add:        MergeRows<MergeOp::Add>(a, b, dst);        break;
+    case MergeOp::Min:        MergeRows<MergeOp::Min>(a, b, dst);        break;
+    case MergeOp::Max:        MergeRows<MergeOp::Max>(a, b, dst);        break;
+    }
+    return true;
+}
+
+const wchar_t* CImageMerger::GetOpName(MergeOp op)
+{
+    switch (op)
+    {
+    case MergeOp::Mask:       return L"Mask";
+    case MergeOp::Difference: return L"Difference";
+    case MergeOp::Add:        return L"Add";
+    case MergeOp::Min:        return L"Min";
+    case MergeOp::Max:        return L"Max";
+    }
+    return L"?";
+}
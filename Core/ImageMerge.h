@@ -0,0 +1,27 @@
+#pragma once
+#include "Core/CoreTypes.h"
+
+class CImageBuffer;
+
+// Per-sample combination of two frames, a (the image) and b:
+//   Mask        a where b is non-zero, 0 elsewhere
+//   Difference  |a - b|
+//   Add         a + b, saturating at 255
+//   Min, Max    the smaller / larger sample
+enum class MergeOp { Mask, Difference, Add, Min, Max };
+
+// Two-input kernels for graph merge nodes (CPipelineGraph). Inputs are 8-bit interleaved and
+// the same size; b has a's channel count or one channel, which then applies to every channel
+// of a (a binary mask over a colour frame). The result has a's format. Same-format inputs run
+// 16 samples at a time with SSE2 on x86; rows are spread over threads with OpenMP.
+class CImageMerger
+{
+public:
+    // dst must be neither a nor b
+    static bool Merge(MergeOp op, const CImageBuffer& a, const CImageBuffer& b, CImageBuffer& dst);
+    static const wchar_t* GetOpName(MergeOp op);
+
+private:
+    // Prevent instantiation
+    CImageMerger() = delete;
+};
@@ -0,0 +1,121 @@
+#include "Core/ImagePyramid.h"
+#include "Core/PixelConvert.h"
+#include <algorithm>
+
+// ============================================================================
+// CImagePyramid
+// ============================================================================
+
+CImagePyramid::CImagePyramid(const CImageBuffer& source)
+    : m_nWidth(source.GetWidth())
+    , m_nHeight(source.GetHeight())
+    , m_nChannels(source.GetChannels())
+    , m_eDepth(source.GetDepth())
+    , m_eLayout(source.GetLayout())
+    , m_nLevels(CountLevels(source.GetWidth(), source.GetHeight()))
+{
+}
+
+bool CImagePyramid::Matches(const CImageBuffer& source) const
+{
+    return source.GetWidth() == m_nWidth && source.GetHeight() == m_nHeight &&
+           source.GetChannels() == m_nChannels && source.GetDepth() == m_eDepth &&
+           source.GetLayout() == m_eLayout;
+}
+
+int CImagePyramid::CountLevels(int width, int height)
+{
+    // Level k is (width >> k) x (height >> k); stop before a side reaches 0
+    int levels = 1;
+    while ((width >> levels) > 0 && (height >> levels) > 0)
+        levels++;
+    return levels;
+}
+
+CImageBuffer CImagePyramid::GetLevel(const CImageBuffer& source, int level)
+{
+    level = std::max(0, std::min(level, m_nLevels - 1));
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    // Level 0 is the frame itself unless it needs converting for display
+    const bool bDisplayFormat = (m_eDepth == PixelDepth::U8 && m_eLayout == PixelLayout::Interleaved);
+    if (!bDisplayFormat && !m_base.IsValid() &&
+        !source.ConvertTo(PixelDepth::U8, PixelLayout::Interleaved, m_base))
+        return CImageBuffer();
+    const CImageBuffer& base = bDisplayFormat ? source : m_base;
+
+    while ((int)m_levels.size() < level)
+    {
+        CImageBuffer next;
+        if (!Downsample(m_levels.empty() ? base : m_levels.back(), next))
+            return CImageBuffer();
+        m_levels.push_back(next);
+    }
+    return level == 0 ? base : m_levels[level - 1];
+}
+
+bool CImagePyramid::Downsample(const CImageBuffer& src, CImageBuffer& dst)
+{
+    if (!src.IsValid() || src.GetDepth() != PixelDepth::U8 || src.IsPlanar())
+        return false;
+
+    const int w = src.GetWidth() / 2, h = src.GetHeight() / 2, ch = src.GetChannels();
+    if (w <= 0 || h <= 0 || !dst.Create(w, h, ch))
+        return false;
+
+    const BYTE* pSrc = src.GetData();
+    BYTE* pDst = dst.GetData();
+    const int srcStride = src.GetStride(), dstStride = dst.GetStride();
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < h; y++)
+    {
+        const BYTE* pRow0 = pSrc + (size_t)(2 * y) * srcStride;
+        PixelConvert::DownsampleRow2x(pRow0, pRow0 + srcStride, pDst + (size_t)y * dstStride, w, ch);
+    }
+    return true;
+}
+
+// ============================================================================
+// CImageBuffer pyramid access
+// ============================================================================
+
+int CImageBuffer::GetPyramidLevelCount() const
+{
+    return IsValid() ? CImagePyramid::CountLevels(m_nWidth, m_nHeight) : 0;
+}
+
+int CImageBuffer::SelectPyramidLevel(int width, int height) const
+{
+    int level = 0;
+    const int levels = GetPyramidLevelCount();
+    while (level + 1 < levels && (m_nWidth >> (level + 1)) >= width && (m_nHeight >> (level + 1)) >= height)
+        level++;
+    return level;
+}
+
+CImageBuffer CImageBuffer::GetPyramidLevel(int level) const
+{
+    if (!IsValid())
+        return CImageBuffer();
+
+    // First caller attaches the pyramid to the block; a losing racer discards its own
+    CImagePyramid* pPyramid = m_pStorage->pPyramid.load(std::memory_order_acquire);
+    if (pPyramid == nullptr)
+    {
+        CImagePyramid* pNew = new CImagePyramid(*this);
+        if (m_pStorage->pPyramid.compare_exchange_strong(pPyramid, pNew, std::memory_order_acq_rel))
+            pPyramid = pNew;
+        else
+            delete pNew;
+    }
+
+    // A block only ever carries one geometry; anything else is served without caching
+    if (!pPyramid->Matches(*this))
+    {
+        CImagePyramid uncached(*this);
+        return uncached.GetLevel(*this, level);
+    }
+    return pPyramid->GetLevel(*this, level);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "Core/ImageBuffer.h"
+#include <mutex>
+#include <vector>
+
+// Display mip pyramid of one frame. Level 0 is the frame as 8-bit interleaved; each further
+// level halves both sides (odd edges dropped) with a 2x2 box filter, down to the level whose
+// shorter side is 1 pixel (a 4x4 frame has 3 levels). Levels are built on first request and kept.
+//
+// CImageBuffer owns one per pixel block (see CImageBuffer::GetPyramidLevel), so every copy of
+// a frame shares it. The pyramid never references the block it describes; the caller passes
+// the frame back in, and Matches() guards against a different geometry.
+class CImagePyramid {
+public:
+    explicit CImagePyramid(const CImageBuffer& source);
+
+    bool Matches(const CImageBuffer& source) const;
+    int GetLevelCount() const { return m_nLevels; }
+
+    // Level 'level' of 'source' (clamped to the deepest level); shares the cached pixels
+    CImageBuffer GetLevel(const CImageBuffer& source, int level);
+
+    // Number of levels of a width x height frame (always >= 1)
+    static int CountLevels(int width, int height);
+
+    // Halves an 8-bit interleaved image with a 2x2 box filter into dst
+    static bool Downsample(const CImageBuffer& src, CImageBuffer& dst);
+
+private:
+    std::mutex m_lock;                   // GetLevel() may be called from several threads
+    int m_nWidth;
+    int m_nHeight;
+    int m_nChannels;
+    PixelDepth m_eDepth;
+    PixelLayout m_eLayout;
+    int m_nLevels;
+    CImageBuffer m_base;                 // 8-bit interleaved copy when the frame is not
+    std::vector<CImageBuffer> m_levels;  // m_levels[k - 1] is level k, filled in order
+};
@@ -0,0 +1,293 @@
+#include "Core/ImageResize.h"
+#include "Core/ImageBuffer.h"
+#include "Utils/Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RESIZE_SSE2 1
+#include <emmintrin.h>
+#else
+#define RESIZE_SSE2 0
+#endif
+
+namespace
+{
+
+const int WEIGHT_BITS = 14;                          // the weights of one window sum to 1 << 14
+const int INTER_BITS  = 7;                           // fraction bits kept in the intermediate rows
+const int H_SHIFT     = WEIGHT_BITS - INTER_BITS;    // 8-bit source -> intermediate
+const int V_SHIFT     = WEIGHT_BITS + INTER_BITS;    // intermediate -> 8-bit result
+
+// Source window of every output column (or row): taps [start[i], start[i] + nTaps) with
+// weights[i * nTaps + k]. Windows are shifted to stay inside the source, so every tap is readable.
+struct FilterTable
+{
+    int nTaps;
+    std::vector<int> start;
+    std::vector<short> weights;
+};
+
+void BuildTable(int srcSize, int dstSize, ResizeMethod method, FilterTable& table)
+{
+    const double scale = static_cast<double>(srcSize) / dstSize;
+    const bool bArea = (method == ResizeMethod::Area && scale > 1.0);
+    const int maxTaps = bArea ? static_cast<int>(std::ceil(scale)) + 1 : (method == ResizeMethod::Nearest ? 1 : 2);
+
+    std::vector<int> first(dstSize), count(dstSize);
+    std::vector<double> w((size_t)dstSize * maxTaps, 0.0);
+    int nTaps = 1;
+
+    for (int i = 0; i < dstSize; i++)
+    {
+        double* pW = &w[(size_t)i * maxTaps];
+        if (method == ResizeMethod::Nearest)
+        {
+            first[i] = std::min(static_cast<int>((i + 0.5) * scale), srcSize - 1);
+            count[i] = 1;
+            pW[0] = 1.0;
+        }
+        else if (bArea)
+        {
+            // Every source pixel overlapping [i * scale, (i + 1) * scale), weighted by its coverage
+            const double lo = i * scale, hi = std::min((i + 1) * scale, (double)srcSize);
+            const int x0 = static_cast<int>(lo);
+            const int x1 = std::min(static_cast<int>(std::ceil(hi)), srcSize);
+            first[i] = x0;
+            count[i] = x1 - x0;
+            for (int x = x0; x < x1; x++)
+                pW[x - x0] = (std::min(hi, x + 1.0) - std::max(lo, (double)x)) / scale;
+        }
+        else
+        {
+            double c = (i + 0.5) * scale - 0.5;
+            c = std::max(0.0, std::min(c, srcSize - 1.0));
+            const int x0 = static_cast<int>(c);
+            const double f = c - x0;
+            first[i] = x0;
+            count[i] = (x0 + 1 < srcSize) ? 2 : 1;
+            pW[0] = 1.0 - f;
+            if (count[i] == 2) pW[1] = f;
+        }
+        nTaps = std::max(nTaps, count[i]);
+    }
+
+    table.nTaps = nTaps;
+    table.start.resize(dstSize);
+    table.weights.assign((size_t)dstSize * nTaps, 0);
+    for (int i = 0; i < dstSize; i++)
+    {
+        const int start = std::min(first[i], srcSize - nTaps);
+        short* pOut = &table.weights[(size_t)i * nTaps];
+        const double* pW = &w[(size_t)i * maxTaps];
+
+        // Round to fixed point, then put the rounding error on the largest tap so the sum is exact
+        int sum = 0, largest = 0;
+        for (int k = 0; k < count[i]; k++)
+        {
+            const int o = first[i] - start + k;
+            pOut[o] = static_cast<short>(std::lround(pW[k] * (1 << WEIGHT_BITS)));
+            sum += pOut[o];
+            if (pOut[o] > pOut[largest]) largest = o;
+        }
+        pOut[largest] = static_cast<short>(pOut[largest] + (1 << WEIGHT_BITS) - sum);
+        table.start[i] = start;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Horizontal pass: one 8-bit row -> one intermediate row of dstWidth * channels samples
+// ----------------------------------------------------------------------------
+
+void HorizontalScalar(const BYTE* pSrc, short* pDst, int i, const FilterTable& xt, int channels)
+{
+    const short* pW = &xt.weights[(size_t)i * xt.nTaps];
+    const BYTE* p = pSrc + (size_t)xt.start[i] * channels;
+    for (int c = 0; c < channels; c++)
+    {
+        int acc = 0;
+        for (int k = 0; k < xt.nTaps; k++)
+            acc += p[k * channels + c] * pW[k];
+        pDst[i * channels + c] = static_cast<short>((acc + (1 << (H_SHIFT - 1))) >> H_SHIFT);
+    }
+}
+
+#if RESIZE_SSE2
+inline __m128i LoadPixel(const BYTE* p)
+{
+    int v;
+    memcpy(&v, p, sizeof(v));
+    return _mm_cvtsi32_si128(v);
+}
+
+// Up to 4 channels in 32-bit lanes; taps are taken in pairs so one pmaddwd applies two weights.
+// Always stores 4 samples: the intermediate row has slack and later columns overwrite the rest.
+void HorizontalSse2(const BYTE* pSrc, short* pDst, int i, const FilterTable& xt, int channels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const short* pW = &xt.weights[(size_t)i * xt.nTaps];
+    const BYTE* p = pSrc + (size_t)xt.start[i] * channels;
+    __m128i acc = zero;
+    int k = 0;
+    for (; k + 1 < xt.nTaps; k += 2)
+    {
+        __m128i ab = _mm_unpacklo_epi8(_mm_unpacklo_epi8(LoadPixel(p + k * channels), LoadPixel(p + (k + 1) * channels)), zero);
+        __m128i wp = _mm_set1_epi32((unsigned short)pW[k] | ((int)pW[k + 1] << 16));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(ab, wp));
+    }
+    if (k < xt.nTaps)
+    {
+        __m128i a = _mm_unpacklo_epi16(_mm_unpacklo_epi8(LoadPixel(p + k * channels), zero), zero);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(a, _mm_set1_epi32((unsigned short)pW[k])));
+    }
+    acc = _mm_srai_epi32(_mm_add_epi32(acc, _mm_set1_epi32(1 << (H_SHIFT - 1))), H_SHIFT);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + i * channels), _mm_packs_epi32(acc, acc));
+}
+#endif
+
+void HorizontalPass(const BYTE* pSrc, short* pDst, int srcWidth, int dstWidth, const FilterTable& xt, int channels)
+{
+    int i = 0;
+#if RESIZE_SSE2
+    if (channels <= 4)
+    {
+        // A column is vectorised while its last 4-byte pixel load stays inside the row
+        const int rowBytes = srcWidth * channels;
+        for (; i < dstWidth && (xt.start[i] + xt.nTaps - 1) * channels + 4 <= rowBytes; i++)
+            HorizontalSse2(pSrc, pDst, i, xt, channels);
+    }
+#else
+    (void)srcWidth;
+#endif
+    for (; i < dstWidth; i++)
+        HorizontalScalar(pSrc, pDst, i, xt, channels);
+}
+
+// ----------------------------------------------------------------------------
+// Vertical pass: nTaps intermediate rows -> one 8-bit output row of 'count' samples
+// ----------------------------------------------------------------------------
+
+void VerticalPass(const short* const* ppRows, const short* pW, int nTaps, BYTE* pDst, int count)
+{
+    int i = 0;
+#if RESIZE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (V_SHIFT - 1));
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+        int k = 0;
+        for (; k < nTaps; k += 2)
+        {
+            // Rows k and k + 1 interleaved, so pmaddwd computes a*wk + b*wk1 per sample
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ppRows[k] + i));
+            __m128i b = (k + 1 < nTaps) ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(ppRows[k + 1] + i)) : zero;
+            __m128i wp = _mm_set1_epi32((unsigned short)pW[k] | ((k + 1 < nTaps ? (int)pW[k + 1] : 0) << 16));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), wp));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), wp));
+        }
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round), V_SHIFT);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round), V_SHIFT);
+        __m128i v = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + i), _mm_packus_epi16(v, v));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        int acc = 0;
+        for (int k = 0; k < nTaps; k++)
+            acc += ppRows[k][i] * pW[k];
+        pDst[i] = static_cast<BYTE>(std::max(0, std::min(255, (acc + (1 << (V_SHIFT - 1))) >> V_SHIFT)));
+    }
+}
+
+// One plane (or the whole interleaved image): rows of 'channels' samples per pixel
+void ResizePlane(const BYTE* pSrc, int srcStride, int srcWidth,
+                 BYTE* pDst, int dstStride, int dstWidth, int dstHeight,
+                 int channels, const FilterTable& xt, const FilterTable& yt)
+{
+    // Intermediate rows for the source rows the vertical windows give weight to (a bilinear
+    // reduction skips the rest)
+    const int rowFirst = yt.start.front();
+    const int rowCount = yt.start.back() + yt.nTaps - rowFirst;
+    const size_t interStride = (size_t)dstWidth * channels + 8;   // slack for 4-sample stores
+    std::vector<short> inter(interStride * rowCount);
+    std::vector<char> used(rowCount, 0);
+    for (int y = 0; y < dstHeight; y++)
+        for (int k = 0; k < yt.nTaps; k++)
+            if (yt.weights[(size_t)y * yt.nTaps + k] != 0)
+                used[yt.start[y] + k - rowFirst] = 1;
+
+    #pragma omp parallel for schedule(static)
+    for (int r = 0; r < rowCount; r++)
+        if (used[r])
+            HorizontalPass(pSrc + (size_t)(rowFirst + r) * srcStride, &inter[(size_t)r * interStride],
+                           srcWidth, dstWidth, xt, channels);
+
+    #pragma omp parallel
+    {
+        std::vector<const short*> rows(yt.nTaps);
+        #pragma omp for schedule(static)
+        for (int y = 0; y < dstHeight; y++)
+        {
+            for (int k = 0; k < yt.nTaps; k++)
+                rows[k] = &inter[(size_t)(yt.start[y] + k - rowFirst) * interStride];
+            VerticalPass(rows.data(), &yt.weights[(size_t)y * yt.nTaps], yt.nTaps,
+                         pDst + (size_t)y * dstStride, dstWidth * channels);
+        }
+    }
+}
+
+void NearestPlane(const BYTE* pSrc, int srcStride, BYTE* pDst, int dstStride, int dstWidth, int dstHeight,
+                  int channels, const FilterTable& xt, const FilterTable& yt)
+{
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < dstHeight; y++)
+    {
+        const BYTE* pRow = pSrc + (size_t)yt.start[y] * srcStride;
+        BYTE* pOut = pDst + (size_t)y * dstStride;
+        for (int x = 0; x < dstWidth; x++)
+            memcpy(pOut + x * channels, pRow + (size_t)xt.start[x] * channels, channels);
+    }
+}
+
+} // namespace
+
+bool CImageResizer::Resize(const CImageBuffer& src, CImageBuffer& dst, int width, int height, ResizeMethod method)
+{
+    if (!src.IsValid() || src.GetDepth() != PixelDepth::U8 || &src == &dst)
+    {
+        CLogger::Error(L"CImageResizer::Resize - Source must be a valid 8-bit image other than the destination");
+        return false;
+    }
+    if (width <= 0 || height <= 0)
+    {
+        CLogger::Error(L"CImageResizer::Resize - Invalid size %d x %d", width, height);
+        return false;
+    }
+
+    const int srcW = src.GetWidth(), srcH = src.GetHeight(), ch = src.GetChannels();
+    if (!dst.Create(width, height, ch, PixelDepth::U8, src.GetLayout()))
+        return false;
+
+    FilterTable xt, yt;
+    BuildTable(srcW, width, method, xt);
+    BuildTable(srcH, height, method, yt);
+
+    // Planar images are resized plane by plane as single-channel rows
+    const int planes = src.GetPlaneCount();
+    const int samples = src.IsPlanar() ? 1 : ch;
+    BYTE* pDst = dst.GetData();
+    for (int p = 0; p < planes; p++)
+    {
+        BYTE* pDstPlane = pDst + p * dst.GetPlaneStride();
+        if (method == ResizeMethod::Nearest)
+            NearestPlane(src.GetPlane(p), src.GetStride(), pDstPlane, dst.GetStride(), width, height, samples, xt, yt);
+        else
+            ResizePlane(src.GetPlane(p), src.GetStride(), srcW, pDstPlane, dst.GetStride(),
+                        width, height, samples, xt, yt);
+    }
+    return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "Core/CoreTypes.h"
+
+class CImageBuffer;
+
+// Nearest copies one source pixel; Bilinear blends the 2x2 neighbours of the sample point;
+// Area averages every source pixel the output pixel covers (box filter, the right choice for
+// reductions; it equals Bilinear when enlarging).
+enum class ResizeMethod { Nearest, Bilinear, Area };
+
+// Separable resampling engine for 8-bit images (any channel count, interleaved or planar).
+//
+// Sample positions are pixel-centre aligned. Each output column and row gets a precomputed
+// source window and 14-bit fixed-point weights; a horizontal pass writes 16-bit intermediate
+// rows (7 extra fraction bits) and a vertical pass blends them back to 8 bits. Both passes
+// use SSE2 multiply-add on x86 and run over rows with OpenMP.
+class CImageResizer
+{
+public:
+    // dst takes src's channel count and layout; dst must not be src
+    static bool Resize(const CImageBuffer& src, CImageBuffer& dst, int width, int height,
+                       ResizeMethod method = ResizeMethod::Bilinear);
+
+private:
+    // Prevent instantiation
+    CImageResizer() = delete;
+};
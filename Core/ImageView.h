@@ -0,0 +1,84 @@
+#pragma once
+#include "Core/CoreTypes.h"
+
+// Non-owning strided window into a CImageBuffer (or any interleaved pixel block).
+// The view does not keep the parent alive; it is valid only while the parent is unchanged.
+// pData and nStride are in bytes; samples are eDepth wide, so U16/F32 kernels read rows
+// through RowAs<unsigned short>() / RowAs<float>().
+//
+// A view of a planar buffer has nPlaneStride != 0: pData and Row() address channel 0, and
+// Plane(c) returns the single-channel view of channel c with the same geometry and halo.
+//
+// The halo fields record how many pixels beyond each edge of the view still belong to the
+// parent image. Neighbourhood kernels read through Row()/ClampX()/ClampY() so a sub-rectangle
+// sees its real neighbours, and edge replication only happens at the parent's border.
+template <typename T>
+struct ImageViewT
+{
+    T*  pData;         // first pixel of the view
+    int nWidth;
+    int nHeight;
+    int nStride;       // bytes between rows (parent stride)
+    int nChannels;
+    PixelDepth eDepth;
+    ptrdiff_t nPlaneStride;   // bytes between channel planes, 0 when interleaved
+    int nHaloLeft;     // readable pixels left of column 0
+    int nHaloTop;      // readable rows above row 0
+    int nHaloRight;    // readable pixels right of column nWidth-1
+    int nHaloBottom;   // readable rows below row nHeight-1
+
+    ImageViewT()
+        : pData(nullptr), nWidth(0), nHeight(0), nStride(0), nChannels(0), eDepth(PixelDepth::U8)
+        , nPlaneStride(0), nHaloLeft(0), nHaloTop(0), nHaloRight(0), nHaloBottom(0) {}
+
+    ImageViewT(T* p, int w, int h, int stride, int ch, PixelDepth depth = PixelDepth::U8,
+               ptrdiff_t planeStride = 0)
+        : pData(p), nWidth(w), nHeight(h), nStride(stride), nChannels(ch), eDepth(depth)
+        , nPlaneStride(planeStride), nHaloLeft(0), nHaloTop(0), nHaloRight(0), nHaloBottom(0) {}
+
+    // Mutable view -> read-only view
+    template <typename U>
+    ImageViewT(const ImageViewT<U>& other)
+        : pData(other.pData), nWidth(other.nWidth), nHeight(other.nHeight)
+        , nStride(other.nStride), nChannels(other.nChannels), eDepth(other.eDepth)
+        , nPlaneStride(other.nPlaneStride), nHaloLeft(other.nHaloLeft), nHaloTop(other.nHaloTop)
+        , nHaloRight(other.nHaloRight), nHaloBottom(other.nHaloBottom) {}
+
+    bool IsValid() const { return pData != nullptr && nWidth > 0 && nHeight > 0; }
+    bool IsPlanar() const { return nPlaneStride != 0; }
+
+    // Channel c of a planar view as a 1-channel view (an interleaved view is returned unchanged)
+    ImageViewT Plane(int c) const
+    {
+        if (!IsPlanar()) return *this;
+        ImageViewT plane(*this);
+        plane.pData        = pData + c * nPlaneStride;
+        plane.nChannels    = 1;
+        plane.nPlaneStride = 0;
+        return plane;
+    }
+
+    // y may lie anywhere in [-nHaloTop, nHeight + nHaloBottom)
+    T* Row(int y) const { return pData + static_cast<ptrdiff_t>(y) * nStride; }
+
+    // Typed row; S must match eDepth (and be const for a ConstImageView)
+    template <typename S>
+    S* RowAs(int y) const { return reinterpret_cast<S*>(Row(y)); }
+
+    // Clamp a neighbour coordinate to the readable range (view + halo)
+    int ClampX(int x) const
+    {
+        if (x < -nHaloLeft)            return -nHaloLeft;
+        if (x >= nWidth + nHaloRight)  return nWidth + nHaloRight - 1;
+        return x;
+    }
+    int ClampY(int y) const
+    {
+        if (y < -nHaloTop)             return -nHaloTop;
+        if (y >= nHeight + nHaloBottom) return nHeight + nHaloBottom - 1;
+        return y;
+    }
+};
+
+typedef ImageViewT<BYTE>       ImageView;
+typedef ImageViewT<const BYTE> ConstImageView;
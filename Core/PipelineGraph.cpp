@@ -0,0 +1,217 @@
+#include "Core/PipelineGraph.h"
+#include "Utils/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double ElapsedMs(Clock::time_point t0, Clock::time_point t1)
+{
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+} // namespace
+
+CPipelineGraph::CPipelineGraph()
+    : m_nMaxConcurrency(0)
+    , m_bStopRequested(false)
+{
+}
+
+CPipelineGraph::~CPipelineGraph()
+{
+    Clear();
+}
+
+bool CPipelineGraph::CheckInput(int nInput, const wchar_t* pszCaller) const
+{
+    if (nInput == GRAPH_INPUT || (nInput >= 0 && nInput < (int)m_nodes.size()))
+        return true;
+    CLogger::Error(L"CPipelineGraph::%ls - Input %d is not an earlier node", pszCaller, nInput);
+    return false;
+}
+
+int CPipelineGraph::AddStep(CAlgorithmBase* pAlg, int nInput)
+{
+    if (!pAlg || !CheckInput(nInput, L"AddStep"))
+    {
+        delete pAlg;
+        return -1;
+    }
+    m_nodes.emplace_back();
+    m_nodes.back().pStep = pAlg;
+    m_nodes.back().inputs.push_back(nInput);
+    return (int)m_nodes.size() - 1;
+}
+
+int CPipelineGraph::AddMerge(MergeOp op, int nInputA, int nInputB)
+{
+    if (!CheckInput(nInputA, L"AddMerge") || !CheckInput(nInputB, L"AddMerge"))
+        return -1;
+    m_nodes.emplace_back();
+    m_nodes.back().eMerge = op;
+    m_nodes.back().inputs.push_back(nInputA);
+    m_nodes.back().inputs.push_back(nInputB);
+    return (int)m_nodes.size() - 1;
+}
+
+void CPipelineGraph::Clear()
+{
+    for (Node& node : m_nodes) delete node.pStep;
+    m_nodes.clear();
+}
+
+std::wstring CPipelineGraph::GetNodeName(int node) const
+{
+    const Node& n = m_nodes[node];
+    return n.pStep ? n.pStep->GetName() : std::wstring(CImageMerger::GetOpName(n.eMerge));
+}
+
+CAlgorithmBase* CPipelineGraph::GetStep(int node) const
+{
+    return m_nodes[node].pStep;
+}
+
+CImageBuffer CPipelineGraph::GetOutput(int node) const
+{
+    const CImageBuffer& result = m_nodes[node].result;
+    if (!result.IsPlanar())
+        return result;
+    CImageBuffer interleaved;
+    result.ConvertLayout(PixelLayout::Interleaved, interleaved);
+    return interleaved;
+}
+
+bool CPipelineGraph::RunNode(int node, const CImageBuffer& input)
+{
+    Node& n = m_nodes[node];
+    const Clock::time_point t0 = Clock::now();
+    bool bOk;
+
+    if (n.pStep)
+    {
+        const CImageBuffer& in = (n.inputs[0] == GRAPH_INPUT) ? input : m_nodes[n.inputs[0]].result;
+        bOk = CSequenceManager::ProcessStep(n.pStep, in, n.bufs.stepOutput, m_rcROIs, n.bufs, &m_bStopRequested);
+    }
+    else
+    {
+        // Merges read 8-bit interleaved frames; others are converted (a mask from a U16 step, a
+        // frame from a planar run)
+        const CImageBuffer* pIn[2];
+        bOk = true;
+        for (int k = 0; k < 2 && bOk; k++)
+        {
+            const CImageBuffer& in = (n.inputs[k] == GRAPH_INPUT) ? input : m_nodes[n.inputs[k]].result;
+            pIn[k] = &in;
+            if (in.GetDepth() != PixelDepth::U8 || in.IsPlanar())
+            {
+                bOk = in.ConvertTo(PixelDepth::U8, PixelLayout::Interleaved, n.mergeIn[k]);
+                pIn[k] = &n.mergeIn[k];
+            }
+        }
+        bOk = bOk && !m_bStopRequested && CImageMerger::Merge(n.eMerge, *pIn[0], *pIn[1], n.bufs.stepOutput);
+    }
+
+    n.dTimeMs = ElapsedMs(t0, Clock::now());
+    if (bOk && n.bufs.stepOutput.IsValid())
+        n.result = n.bufs.stepOutput;
+    else if (!m_bStopRequested)
+        CLogger::Error(L"CPipelineGraph - Node %d (%ls) failed", node, GetNodeName(node).c_str());
+    return bOk && n.result.IsValid();
+}
+
+bool CPipelineGraph::Execute(const CImageBuffer& input)
+{
+    const int nNodes = (int)m_nodes.size();
+    if (nNodes == 0 || !input.IsValid())
+        return false;
+    m_bStopRequested = false;
+
+    // Last run's results go first, so each node writes into its own unshared output again
+    std::vector<int> pending(nNodes, 0);
+    std::vector<std::vector<int>> consumers(nNodes);
+    std::deque<int> ready;
+    for (int i = 0; i < nNodes; i++)
+    {
+        m_nodes[i].result.Release();
+        m_nodes[i].dTimeMs = 0.0;
+        for (int in : m_nodes[i].inputs)
+        {
+            if (in == GRAPH_INPUT) continue;
+            pending[i]++;
+            consumers[in].push_back(i);
+        }
+        if (pending[i] == 0)
+            ready.push_back(i);
+    }
+
+#ifdef _OPENMP
+    const int nOmpThreads = omp_get_max_threads();
+#else
+    const int nOmpThreads = 1;
+#endif
+    const int nWorkers = std::max(1, std::min(nNodes, m_nMaxConcurrency > 0 ? m_nMaxConcurrency : nOmpThreads));
+
+    // Workers take nodes in the order they became ready; finishing one readies the consumers
+    // whose last input it was. A failure (or Stop) lets every worker leave after its node.
+    std::mutex mtx;
+    std::condition_variable cv;
+    int nRunning = 0, nDone = 0;
+    bool bFailed = false;
+    auto worker = [&]()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        for (;;)
+        {
+            cv.wait(lock, [&]() { return !ready.empty() || nDone == nNodes || bFailed; });
+            if (bFailed || nDone == nNodes)
+                break;
+            const int node = ready.front();
+            ready.pop_front();
+            nRunning++;
+#ifdef _OPENMP
+            omp_set_num_threads(std::max(1, nOmpThreads / (nRunning + (int)ready.size())));
+#endif
+            lock.unlock();
+
+            const bool bOk = !m_bStopRequested && RunNode(node, input);
+
+            lock.lock();
+            nRunning--;
+            nDone++;
+            if (!bOk)
+                bFailed = true;
+            else
+                for (int c : consumers[node])
+                    if (--pending[c] == 0)
+                        ready.push_back(c);
+            cv.notify_all();
+        }
+    };
+
+    const Clock::time_point t0 = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 1; t < nWorkers; t++)
+        threads.emplace_back(worker);
+    worker();   // the calling thread is worker 0
+    for (auto& t : threads) t.join();
+#ifdef _OPENMP
+    omp_set_num_threads(nOmpThreads);
+#endif
+
+    if (bFailed || m_bStopRequested)
+        return false;
+    CLogger::Info(L"CPipelineGraph - %d nodes in %.1f ms on %d workers", nNodes, ElapsedMs(t0, Clock::now()), nWorkers);
+    return true;
+}
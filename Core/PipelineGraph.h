@@ -0,0 +1,75 @@
+#pragma once
+#include "Core/ImageBuffer.h"
+#include "Core/ImageMerge.h"
+#include "Core/SequenceManager.h"
+#include "Algorithm/AlgorithmBase.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Input id of a node that reads the graph's input frame
+const int GRAPH_INPUT = -1;
+
+// A processing graph: nodes are algorithms (one input) or merges (two inputs, CImageMerger),
+// edges are the frames they read. A node may feed any number of others, so a shared upstream
+// step (one blur ahead of an edge branch and a Hough branch) runs once per Execute().
+// Nodes can only read nodes added before them, so the insertion order is already a valid
+// execution order and the graph cannot contain a cycle.
+//
+// Execute() runs every node as soon as its inputs are done. Independent branches run
+// concurrently on a few worker threads; each node's algorithm gets an equal share of the
+// OpenMP threads among the nodes running or ready at its start, so a lone node (a chain of
+// one branch) still uses all of them. Steps go through CSequenceManager::ProcessStep, with the
+// same ROI compositing and depth/layout conversion as the sequence, in per-node buffers that
+// are kept from one run to the next.
+class CPipelineGraph {
+public:
+    CPipelineGraph();
+    ~CPipelineGraph();
+
+    // Node ids count up from 0; -1 (and an error log) when an input id is not an earlier node
+    int AddStep(CAlgorithmBase* pAlg, int nInput = GRAPH_INPUT);   // takes ownership
+    int AddMerge(MergeOp op, int nInputA, int nInputB);
+    void Clear();
+
+    int GetNodeCount() const { return (int)m_nodes.size(); }
+    std::wstring GetNodeName(int node) const;
+    CAlgorithmBase* GetStep(int node) const;            // nullptr for a merge node
+    const std::vector<int>& GetNodeInputs(int node) const { return m_nodes[node].inputs; }
+
+    // Applied to every step node (merges use the whole frame)
+    void SetROIs(const std::vector<ImageRect>& rois) { m_rcROIs = rois; }
+    // Worker threads for independent branches; 0 = one per OpenMP thread
+    void SetMaxConcurrency(int nWorkers) { m_nMaxConcurrency = nWorkers; }
+
+    // Synchronous. False if any node failed (logged) or the run was stopped.
+    bool Execute(const CImageBuffer& input);
+    void Stop() { m_bStopRequested = true; }   // from another thread
+
+    // Results of the last Execute(), interleaved; invalid for nodes that did not run
+    CImageBuffer GetOutput(int node) const;
+    double GetNodeTimeMs(int node) const { return m_nodes[node].dTimeMs; }
+
+private:
+    CPipelineGraph(const CPipelineGraph&) = delete;
+    CPipelineGraph& operator=(const CPipelineGraph&) = delete;
+
+    struct Node
+    {
+        CAlgorithmBase*  pStep = nullptr;   // owned; nullptr for a merge
+        MergeOp          eMerge = MergeOp::Mask;
+        std::vector<int> inputs;            // node ids or GRAPH_INPUT
+        PipelineBuffers  bufs;              // result in stepOutput
+        CImageBuffer     mergeIn[2];        // merge inputs brought to 8-bit interleaved
+        CImageBuffer     result;            // shares bufs.stepOutput after a run
+        double           dTimeMs = 0.0;
+    };
+
+    bool CheckInput(int nInput, const wchar_t* pszCaller) const;
+    bool RunNode(int node, const CImageBuffer& input);
+
+    std::vector<Node>      m_nodes;
+    std::vector<ImageRect> m_rcROIs;
+    int                    m_nMaxConcurrency;
+    std::atomic<bool>      m_bStopRequested;
+};
@@ -0,0 +1,660 @@
+#include "Core/PixelConvert.h"
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PIXELCONVERT_X86 1
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define PIXELCONVERT_X86 0
+#endif
+
+// GCC/Clang compile the SSSE3 functions for that target only; MSVC needs no flag for intrinsics
+#if PIXELCONVERT_X86 && (defined(__GNUC__) || defined(__clang__))
+#define PIXELCONVERT_TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+#define PIXELCONVERT_TARGET_SSSE3
+#endif
+
+namespace
+{
+
+std::atomic<bool> s_bSimdEnabled(true);
+
+// ----------------------------------------------------------------------------
+// Scalar kernels; the SIMD paths hand their unfinished tail (from 'start') to these
+// ----------------------------------------------------------------------------
+
+void SwapRedBlueScalar(const BYTE* pSrc, BYTE* pDst, int start, int count)
+{
+    for (int i = start; i < count; i++)
+    {
+        BYTE r = pSrc[i * 3 + 0], g = pSrc[i * 3 + 1], b = pSrc[i * 3 + 2];
+        pDst[i * 3 + 0] = b;
+        pDst[i * 3 + 1] = g;
+        pDst[i * 3 + 2] = r;
+    }
+}
+
+void GrayToRgbScalar(const BYTE* pSrc, BYTE* pDst, int start, int count)
+{
+    for (int i = start; i < count; i++)
+        pDst[i * 3 + 0] = pDst[i * 3 + 1] = pDst[i * 3 + 2] = pSrc[i];
+}
+
+// nR / nB: byte offset of red and blue inside the 3-byte pixel
+void ToGrayScalar(const BYTE* pSrc, BYTE* pDst, int start, int count, int nR, int nB)
+{
+    for (int i = start; i < count; i++)
+    {
+        const BYTE* p = pSrc + i * 3;
+        pDst[i] = (BYTE)((p[nR] * 299 + p[1] * 587 + p[nB] * 114) / 1000);
+    }
+}
+
+void WeightedGrayScalar(const BYTE* pSrc, BYTE* pDst, int start, int count, int channels, const int* w)
+{
+    for (int i = start; i < count; i++)
+    {
+        const BYTE* p = pSrc + (size_t)i * channels;
+        pDst[i] = (BYTE)((w[0] * p[0] + w[1] * p[1] + w[2] * p[2]) >> 8);
+    }
+}
+
+void BgraToRgbScalar(const BYTE* pSrc, BYTE* pDst, int start, int count)
+{
+    for (int i = start; i < count; i++)
+    {
+        pDst[i * 3 + 0] = pSrc[i * 4 + 2];
+        pDst[i * 3 + 1] = pSrc[i * 4 + 1];
+        pDst[i * 3 + 2] = pSrc[i * 4 + 0];
+    }
+}
+
+void RgbToBgraScalar(const BYTE* pSrc, BYTE* pDst, int start, int count)
+{
+    for (int i = start; i < count; i++)
+    {
+        pDst[i * 4 + 0] = pSrc[i * 3 + 2];
+        pDst[i * 4 + 1] = pSrc[i * 3 + 1];
+        pDst[i * 4 + 2] = pSrc[i * 3 + 0];
+        pDst[i * 4 + 3] = 255;
+    }
+}
+
+void GrayToBgraScalar(const BYTE* pSrc, BYTE* pDst, int start, int count)
+{
+    for (int i = start; i < count; i++)
+    {
+        pDst[i * 4 + 0] = pDst[i * 4 + 1] = pDst[i * 4 + 2] = pSrc[i];
+        pDst[i * 4 + 3] = 255;
+    }
+}
+
+void DownsampleScalar(const BYTE* pRow0, const BYTE* pRow1, BYTE* pDst, int start, int count, int channels)
+{
+    for (int i = start; i < count; i++)
+        for (int c = 0; c < channels; c++)
+        {
+            const int a = (2 * i) * channels + c, b = a + channels;
+            pDst[i * channels + c] = (BYTE)((pRow0[a] + pRow0[b] + pRow1[a] + pRow1[b] + 2) >> 2);
+        }
+}
+
+// Interleave kernels, one instantiation per sample width (float is moved as its 32-bit pattern)
+template <typename S>
+void DeinterleaveScalar(const BYTE* pSrc, BYTE* const* ppDst, int start, int count, int channels)
+{
+    const S* s = reinterpret_cast<const S*>(pSrc);
+    for (int c = 0; c < channels; c++)
+    {
+        S* d = reinterpret_cast<S*>(ppDst[c]);
+        for (int i = start; i < count; i++)
+            d[i] = s[i * channels + c];
+    }
+}
+
+template <typename S>
+void InterleaveScalar(const BYTE* const* ppSrc, BYTE* pDst, int start, int count, int channels)
+{
+    S* d = reinterpret_cast<S*>(pDst);
+    for (int c = 0; c < channels; c++)
+    {
+        const S* s = reinterpret_cast<const S*>(ppSrc[c]);
+        for (int i = start; i < count; i++)
+            d[i * channels + c] = s[i];
+    }
+}
+
+void DeinterleaveTail(const BYTE* pSrc, BYTE* const* ppDst, int start, int count, int channels, int sampleBytes)
+{
+    switch (sampleBytes)
+    {
+    case 2:  DeinterleaveScalar<unsigned short>(pSrc, ppDst, start, count, channels); break;
+    case 4:  DeinterleaveScalar<unsigned int>(pSrc, ppDst, start, count, channels);   break;
+    default: DeinterleaveScalar<BYTE>(pSrc, ppDst, start, count, channels);           break;
+    }
+}
+
+void InterleaveTail(const BYTE* const* ppSrc, BYTE* pDst, int start, int count, int channels, int sampleBytes)
+{
+    switch (sampleBytes)
+    {
+    case 2:  InterleaveScalar<unsigned short>(ppSrc, pDst, start, count, channels); break;
+    case 4:  InterleaveScalar<unsigned int>(ppSrc, pDst, start, count, channels);   break;
+    default: InterleaveScalar<BYTE>(ppSrc, pDst, start, count, channels);           break;
+    }
+}
+
+#if PIXELCONVERT_X86
+
+// pshufb control vectors for one (channels, sample width) pair. A block is 16 bytes per
+// channel, i.e. 16 / sampleBytes pixels: 'channels' interleaved input vectors become one
+// vector per plane and back. Lanes with the high bit set produce zero, so each output is the
+// OR of one shuffle per input vector.
+struct ShuffleMasks
+{
+    __m128i split[4][4];   // [plane][interleaved vector]
+    __m128i merge[4][4];   // [interleaved vector][plane]
+};
+
+void BuildMasks(ShuffleMasks& m, int channels, int sampleBytes)
+{
+    alignas(16) BYTE lanes[16];
+    for (int k = 0; k < channels; k++)
+        for (int v = 0; v < channels; v++)
+        {
+            // Plane k, byte j comes from interleaved byte (i * channels + k) * sampleBytes + b
+            for (int j = 0; j < 16; j++)
+            {
+                int src = ((j / sampleBytes) * channels + k) * sampleBytes + j % sampleBytes;
+                lanes[j] = (src / 16 == v) ? (BYTE)(src % 16) : 0x80;
+            }
+            m.split[k][v] = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+
+            // Interleaved vector v, byte j comes from plane (sample % channels)
+            for (int j = 0; j < 16; j++)
+            {
+                int sample = (16 * v + j) / sampleBytes;
+                int b      = (16 * v + j) % sampleBytes;
+                lanes[j] = (sample % channels == k) ? (BYTE)((sample / channels) * sampleBytes + b) : 0x80;
+            }
+            m.merge[v][k] = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+        }
+}
+
+// Built once: [sample width 1/2/4][channels 2..4]
+const ShuffleMasks& GetMasks(int channels, int sampleBytes)
+{
+    struct Table
+    {
+        ShuffleMasks masks[3][3];
+        Table()
+        {
+            for (int s = 0; s < 3; s++)
+                for (int c = 2; c <= 4; c++)
+                    BuildMasks(masks[s][c - 2], c, 1 << s);
+        }
+    };
+    static const Table table;
+    return table.masks[sampleBytes == 1 ? 0 : (sampleBytes == 2 ? 1 : 2)][channels - 2];
+}
+
+template <int CH>
+PIXELCONVERT_TARGET_SSSE3
+int DeinterleaveSsse3(const BYTE* pSrc, BYTE* const* ppDst, int count, int sampleBytes)
+{
+    const ShuffleMasks& m = GetMasks(CH, sampleBytes);
+    const int nBlock = 16 / sampleBytes;
+    int i = 0;
+    for (; i + nBlock <= count; i += nBlock)
+    {
+        const BYTE* pIn = pSrc + (size_t)i * CH * sampleBytes;
+        __m128i in[CH];
+        for (int v = 0; v < CH; v++)
+            in[v] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn + 16 * v));
+        for (int k = 0; k < CH; k++)
+        {
+            __m128i out = _mm_shuffle_epi8(in[0], m.split[k][0]);
+            for (int v = 1; v < CH; v++)
+                out = _mm_or_si128(out, _mm_shuffle_epi8(in[v], m.split[k][v]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(ppDst[k] + (size_t)i * sampleBytes), out);
+        }
+    }
+    return i;
+}
+
+template <int CH>
+PIXELCONVERT_TARGET_SSSE3
+int InterleaveSsse3(const BYTE* const* ppSrc, BYTE* pDst, int count, int sampleBytes)
+{
+    const ShuffleMasks& m = GetMasks(CH, sampleBytes);
+    const int nBlock = 16 / sampleBytes;
+    int i = 0;
+    for (; i + nBlock <= count; i += nBlock)
+    {
+        __m128i in[CH];
+        for (int k = 0; k < CH; k++)
+            in[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ppSrc[k] + (size_t)i * sampleBytes));
+        BYTE* pOut = pDst + (size_t)i * CH * sampleBytes;
+        for (int v = 0; v < CH; v++)
+        {
+            __m128i out = _mm_shuffle_epi8(in[0], m.merge[v][0]);
+            for (int k = 1; k < CH; k++)
+                out = _mm_or_si128(out, _mm_shuffle_epi8(in[k], m.merge[v][k]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 16 * v), out);
+        }
+    }
+    return i;
+}
+
+// pshufb controls of the swizzle kernels (0x80 = zero the lane)
+struct SwizzleMasks
+{
+    __m128i swapRB;        // 5 RGB pixels reversed in place, byte 15 passed through
+    __m128i grayToRgb[3];  // 16 gray -> 48 RGB bytes
+    __m128i bgraToRgb;     // 4 BGRA pixels -> 12 RGB bytes (upper 4 zero)
+    __m128i rgbToBgra;     // 4 RGB pixels (12 bytes) -> 16 BGRA bytes, alpha zero
+    __m128i grayToBgra[4]; // 16 gray -> 64 BGRA bytes, alpha zero
+    __m128i grayRG[2];     // 4 pixels -> 16-bit (R, G) pairs; [0] RGB order, [1] BGR order
+    __m128i grayB[2];      // 4 pixels -> 16-bit (B, 0) pairs
+};
+
+const SwizzleMasks& GetSwizzleMasks()
+{
+    struct Table
+    {
+        SwizzleMasks m;
+        Table()
+        {
+            alignas(16) BYTE lanes[16];
+            auto Load = [&]() { return _mm_load_si128(reinterpret_cast<const __m128i*>(lanes)); };
+
+            for (int j = 0; j < 16; j++) lanes[j] = (BYTE)(j < 15 ? (j / 3) * 3 + 2 - j % 3 : 15);
+            m.swapRB = Load();
+            for (int v = 0; v < 3; v++)
+            {
+                for (int j = 0; j < 16; j++) lanes[j] = (BYTE)((16 * v + j) / 3);
+                m.grayToRgb[v] = Load();
+            }
+            for (int j = 0; j < 16; j++) lanes[j] = j < 12 ? (BYTE)((j / 3) * 4 + 2 - j % 3) : 0x80;
+            m.bgraToRgb = Load();
+            for (int j = 0; j < 16; j++) lanes[j] = (j % 4 == 3) ? 0x80 : (BYTE)((j / 4) * 3 + 2 - j % 4);
+            m.rgbToBgra = Load();
+            for (int v = 0; v < 4; v++)
+            {
+                for (int j = 0; j < 16; j++) lanes[j] = (j % 4 == 3) ? 0x80 : (BYTE)(4 * v + j / 4);
+                m.grayToBgra[v] = Load();
+            }
+            for (int order = 0; order < 2; order++)
+            {
+                const int nR = order == 0 ? 0 : 2, nB = 2 - nR;
+                for (int j = 0; j < 16; j++)
+                    lanes[j] = (j % 2) ? 0x80 : (BYTE)((j / 4) * 3 + ((j / 2) % 2 ? 1 : nR));
+                m.grayRG[order] = Load();
+                for (int j = 0; j < 16; j++)
+                    lanes[j] = (j % 4) ? 0x80 : (BYTE)((j / 4) * 3 + nB);
+                m.grayB[order] = Load();
+            }
+        }
+    };
+    static const Table table;
+    return table.m;
+}
+
+PIXELCONVERT_TARGET_SSSE3
+int SwapRedBlueSsse3(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    // 16-byte windows advance by 5 pixels; the 16th byte is stored unchanged, so the next
+    // window (which starts there) still reads the original even when pSrc == pDst
+    const __m128i mask = GetSwizzleMasks().swapRB;
+    int i = 0;
+    for (; i + 6 <= count; i += 5)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i * 3), _mm_shuffle_epi8(v, mask));
+    }
+    return i;
+}
+
+PIXELCONVERT_TARGET_SSSE3
+int GrayToRgbSsse3(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    const SwizzleMasks& m = GetSwizzleMasks();
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+        __m128i* pOut = reinterpret_cast<__m128i*>(pDst + i * 3);
+        _mm_storeu_si128(pOut + 0, _mm_shuffle_epi8(v, m.grayToRgb[0]));
+        _mm_storeu_si128(pOut + 1, _mm_shuffle_epi8(v, m.grayToRgb[1]));
+        _mm_storeu_si128(pOut + 2, _mm_shuffle_epi8(v, m.grayToRgb[2]));
+    }
+    return i;
+}
+
+// Luminance of the 4 pixels at the start of v as 32-bit lanes. Weighted sums come from
+// pmaddwd; x / 1000 is exact as (x * 274877907) >> 38 for every x < 2^18.
+PIXELCONVERT_TARGET_SSSE3
+inline __m128i Gray4(__m128i v, __m128i maskRG, __m128i maskB)
+{
+    const __m128i wRG = _mm_set1_epi32(587 << 16 | 299);
+    const __m128i wB  = _mm_set1_epi32(114);
+    const __m128i magic = _mm_set1_epi32(274877907);
+    __m128i sum = _mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi8(v, maskRG), wRG),
+                                _mm_madd_epi16(_mm_shuffle_epi8(v, maskB), wB));
+    __m128i q02 = _mm_srli_epi64(_mm_mul_epu32(sum, magic), 38);
+    __m128i q13 = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(sum, 32), magic), 38);
+    return _mm_or_si128(q02, _mm_slli_epi64(q13, 32));
+}
+
+PIXELCONVERT_TARGET_SSSE3
+int ToGraySsse3(const BYTE* pSrc, BYTE* pDst, int count, int order)
+{
+    const SwizzleMasks& m = GetSwizzleMasks();
+    int i = 0;
+    for (; i + 10 <= count; i += 8)   // the second load reads 16 bytes from pixel i + 4
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i * 3));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i * 3 + 12));
+        __m128i g16 = _mm_packs_epi32(Gray4(a, m.grayRG[order], m.grayB[order]),
+                                      Gray4(b, m.grayRG[order], m.grayB[order]));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + i), _mm_packus_epi16(g16, g16));
+    }
+    return i;
+}
+
+// 3-channel pixels only; the RGB-order masks pair (c0, c1) and single out c2
+PIXELCONVERT_TARGET_SSSE3
+int WeightedGraySsse3(const BYTE* pSrc, BYTE* pDst, int count, const int* w)
+{
+    const SwizzleMasks& m = GetSwizzleMasks();
+    const __m128i w01 = _mm_set1_epi32(w[1] << 16 | w[0]);
+    const __m128i w2  = _mm_set1_epi32(w[2]);
+    int i = 0;
+    for (; i + 10 <= count; i += 8)   // the second load reads 16 bytes from pixel i + 4
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i * 3));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i * 3 + 12));
+        __m128i sa = _mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi8(a, m.grayRG[0]), w01),
+                                   _mm_madd_epi16(_mm_shuffle_epi8(a, m.grayB[0]), w2));
+        __m128i sb = _mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi8(b, m.grayRG[0]), w01),
+                                   _mm_madd_epi16(_mm_shuffle_epi8(b, m.grayB[0]), w2));
+        __m128i g16 = _mm_packs_epi32(_mm_srli_epi32(sa, 8), _mm_srli_epi32(sb, 8));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + i), _mm_packus_epi16(g16, g16));
+    }
+    return i;
+}
+
+PIXELCONVERT_TARGET_SSSE3
+int BgraToRgbSsse3(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    // 16 pixels: four 12-byte results are packed into three 16-byte stores
+    const __m128i mask = GetSwizzleMasks().bgraToRgb;
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i* pIn = reinterpret_cast<const __m128i*>(pSrc + i * 4);
+        __m128i r0 = _mm_shuffle_epi8(_mm_loadu_si128(pIn + 0), mask);
+        __m128i r1 = _mm_shuffle_epi8(_mm_loadu_si128(pIn + 1), mask);
+        __m128i r2 = _mm_shuffle_epi8(_mm_loadu_si128(pIn + 2), mask);
+        __m128i r3 = _mm_shuffle_epi8(_mm_loadu_si128(pIn + 3), mask);
+        __m128i* pOut = reinterpret_cast<__m128i*>(pDst + i * 3);
+        _mm_storeu_si128(pOut + 0, _mm_or_si128(r0, _mm_slli_si128(r1, 12)));
+        _mm_storeu_si128(pOut + 1, _mm_or_si128(_mm_srli_si128(r1, 4), _mm_slli_si128(r2, 8)));
+        _mm_storeu_si128(pOut + 2, _mm_or_si128(_mm_srli_si128(r2, 8), _mm_slli_si128(r3, 4)));
+    }
+    return i;
+}
+
+PIXELCONVERT_TARGET_SSSE3
+int RgbToBgraSsse3(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    const __m128i mask  = GetSwizzleMasks().rgbToBgra;
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    int i = 0;
+    for (; i + 6 <= count; i += 4)   // 16-byte load for 12 bytes of input
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, mask), alpha));
+    }
+    return i;
+}
+
+PIXELCONVERT_TARGET_SSSE3
+int GrayToBgraSsse3(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    const SwizzleMasks& m = GetSwizzleMasks();
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+        __m128i* pOut = reinterpret_cast<__m128i*>(pDst + i * 4);
+        for (int k = 0; k < 4; k++)
+            _mm_storeu_si128(pOut + k, _mm_or_si128(_mm_shuffle_epi8(v, m.grayToBgra[k]), alpha));
+    }
+    return i;
+}
+
+// 2x2 box filter controls for 1..4 channels. One group is 16 source bytes (12 for RGB): the
+// shuffle lines up the two horizontal neighbours of every output sample so that pmaddubsw
+// adds them; 'compact' closes the gap the 6-sample RGB groups leave after packing.
+struct DownsampleMasks
+{
+    __m128i pairs[4];
+    __m128i compact;
+};
+
+const DownsampleMasks& GetDownsampleMasks()
+{
+    struct Table
+    {
+        DownsampleMasks m;
+        Table()
+        {
+            alignas(16) BYTE lanes[16];
+            for (int ch = 1; ch <= 4; ch++)
+            {
+                const int nOut = (ch == 3 ? 12 : 16) / 2;
+                for (int j = 0; j < 16; j++)
+                {
+                    const int o = j / 2, p = o / ch, c = o % ch;
+                    lanes[j] = o < nOut ? (BYTE)((2 * p + j % 2) * ch + c) : 0x80;
+                }
+                m.pairs[ch - 1] = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+            }
+            for (int j = 0; j < 16; j++) lanes[j] = j < 12 ? (BYTE)(j < 6 ? j : j + 2) : 0x80;
+            m.compact = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+        }
+    };
+    static const Table table;
+    return table.m;
+}
+
+// Rounded 2x2 means of one group as 16-bit lanes
+PIXELCONVERT_TARGET_SSSE3
+inline __m128i BoxGroup(const BYTE* p0, const BYTE* p1, __m128i pairs)
+{
+    const __m128i ones = _mm_set1_epi8(1);
+    __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p0)), pairs);
+    __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p1)), pairs);
+    __m128i s = _mm_add_epi16(_mm_maddubs_epi16(a, ones), _mm_maddubs_epi16(b, ones));
+    return _mm_srli_epi16(_mm_add_epi16(s, _mm_set1_epi16(2)), 2);
+}
+
+PIXELCONVERT_TARGET_SSSE3
+int DownsampleSsse3(const BYTE* pRow0, const BYTE* pRow1, BYTE* pDst, int count, int channels)
+{
+    const DownsampleMasks& m = GetDownsampleMasks();
+    const __m128i pairs = m.pairs[channels - 1];
+    const int nGroup = channels == 3 ? 12 : 16;   // source bytes per group
+    const int nStep = nGroup / channels;          // output pixels per two groups
+    const size_t srcBytes = (size_t)2 * count * channels;
+    const size_t dstBytes = (size_t)count * channels;
+
+    int i = 0;
+    for (; (size_t)2 * i * channels + nGroup + 16 <= srcBytes && (size_t)i * channels + 16 <= dstBytes; i += nStep)
+    {
+        const size_t offset = (size_t)2 * i * channels;
+        __m128i out = _mm_packus_epi16(BoxGroup(pRow0 + offset, pRow1 + offset, pairs),
+                                       BoxGroup(pRow0 + offset + nGroup, pRow1 + offset + nGroup, pairs));
+        if (channels == 3) out = _mm_shuffle_epi8(out, m.compact);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + (size_t)i * channels), out);
+    }
+    return i;
+}
+
+bool DetectSsse3()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3") != 0;
+#endif
+}
+
+#endif // PIXELCONVERT_X86
+
+bool UseSsse3()
+{
+    return PixelConvert::HasSsse3() && s_bSimdEnabled.load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+bool PixelConvert::HasSsse3()
+{
+#if PIXELCONVERT_X86
+    static const bool bSsse3 = DetectSsse3();
+    return bSsse3;
+#else
+    return false;
+#endif
+}
+
+void PixelConvert::SetSimdEnabled(bool bEnabled)
+{
+    s_bSimdEnabled.store(bEnabled);
+}
+
+void PixelConvert::SwapRedBlue(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    int done = 0;
+#if PIXELCONVERT_X86
+    if (UseSsse3()) done = SwapRedBlueSsse3(pSrc, pDst, count);
+#endif
+    SwapRedBlueScalar(pSrc, pDst, done, count);
+}
+
+void PixelConvert::GrayToRgb(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    int done = 0;
+#if PIXELCONVERT_X86
+    if (UseSsse3()) done = GrayToRgbSsse3(pSrc, pDst, count);
+#endif
+    GrayToRgbScalar(pSrc, pDst, done, count);
+}
+
+void PixelConvert::RgbToGray(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    int done = 0;
+#if PIXELCONVERT_X86
+    if (UseSsse3()) done = ToGraySsse3(pSrc, pDst, count, 0);
+#endif
+    ToGrayScalar(pSrc, pDst, done, count, 0, 2);
+}
+
+void PixelConvert::BgrToGray(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    int done = 0;
+#if PIXELCONVERT_X86
+    if (UseSsse3()) done = ToGraySsse3(pSrc, pDst, count, 1);
+#endif
+    ToGrayScalar(pSrc, pDst, done, count, 2, 0);
+}
+
+void PixelConvert::WeightedGrayRow(const BYTE* pSrc, BYTE* pDst, int count, int channels, const int weights[3])
+{
+    int done = 0;
+#if PIXELCONVERT_X86
+    if (channels == 3 && UseSsse3()) done = WeightedGraySsse3(pSrc, pDst, count, weights);
+#endif
+    WeightedGrayScalar(pSrc, pDst, done, count, channels, weights);
+}
+
+void PixelConvert::BgraToRgb(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    int done = 0;
+#if PIXELCONVERT_X86
+    if (UseSsse3()) done = BgraToRgbSsse3(pSrc, pDst, count);
+#endif
+    BgraToRgbScalar(pSrc, pDst, done, count);
+}
+
+void PixelConvert::RgbToBgra(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    int done = 0;
+#if PIXELCONVERT_X86
+    if (UseSsse3()) done = RgbToBgraSsse3(pSrc, pDst, count);
+#endif
+    RgbToBgraScalar(pSrc, pDst, done, count);
+}
+
+void PixelConvert::GrayToBgra(const BYTE* pSrc, BYTE* pDst, int count)
+{
+    int done = 0;
+#if PIXELCONVERT_X86
+    if (UseSsse3()) done = GrayToBgraSsse3(pSrc, pDst, count);
+#endif
+    GrayToBgraScalar(pSrc, pDst, done, count);
+}
+
+void PixelConvert::DownsampleRow2x(const BYTE* pRow0, const BYTE* pRow1, BYTE* pDst, int count, int channels)
+{
+    int done = 0;
+#if PIXELCONVERT_X86
+    if (channels >= 1 && channels <= 4 && UseSsse3()) done = DownsampleSsse3(pRow0, pRow1, pDst, count, channels);
+#endif
+    DownsampleScalar(pRow0, pRow1, pDst, done, count, channels);
+}
+
+void PixelConvert::DeinterleaveRow(const BYTE* pSrc, BYTE* const* ppDst, int count, int channels, int sampleBytes)
+{
+    int done = 0;
+#if PIXELCONVERT_X86
+    if (UseSsse3())
+    {
+        switch (channels)
+        {
+        case 2: done = DeinterleaveSsse3<2>(pSrc, ppDst, count, sampleBytes); break;
+        case 3: done = DeinterleaveSsse3<3>(pSrc, ppDst, count, sampleBytes); break;
+        case 4: done = DeinterleaveSsse3<4>(pSrc, ppDst, count, sampleBytes); break;
+        default: break;
+        }
+    }
+#endif
+    DeinterleaveTail(pSrc, ppDst, done, count, channels, sampleBytes);
+}
+
+void PixelConvert::InterleaveRow(const BYTE* const* ppSrc, BYTE* pDst, int count, int channels, int sampleBytes)
+{
+    int done = 0;
+#if PIXELCONVERT_X86
+    if (UseSsse3())
+    {
+        switch (channels)
+        {
+        case 2: done = InterleaveSsse3<2>(ppSrc, pDst, count, sampleBytes); break;
+        case 3: done = InterleaveSsse3<3>(ppSrc, pDst, count, sampleBytes); break;
+        case 4: done = InterleaveSsse3<4>(ppSrc, pDst, count, sampleBytes); break;
+        default: break;
+        }
+    }
+#endif
+    InterleaveTail(ppSrc, pDst, done, count, channels, sampleBytes);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "Core/CoreTypes.h"
+
+// Row-level pixel rearrangement and reduction kernels shared by CImageBuffer, the codecs and
+// the display code. 'count' is always in pixels and rows need no alignment.
+//
+// The x86 paths use SSSE3 byte shuffles and are picked at run time (CPUID), so the library
+// still runs on CPUs without it; every function has a scalar fallback with identical results.
+namespace PixelConvert
+{
+    // True when the SSSE3 paths are in use on this CPU
+    bool HasSsse3();
+
+    // Forces the scalar paths (false) or allows SIMD again (true); for benchmarks and checks
+    void SetSimdEnabled(bool bEnabled);
+
+    // RGB <-> BGR, 3 bytes per pixel; pSrc may equal pDst (in-place swap)
+    void SwapRedBlue(const BYTE* pSrc, BYTE* pDst, int count);
+
+    // Gray -> RGB with R = G = B
+    void GrayToRgb(const BYTE* pSrc, BYTE* pDst, int count);
+
+    // RGB / BGR -> gray as (299 R + 587 G + 114 B) / 1000, truncated (the app-wide luminance)
+    void RgbToGray(const BYTE* pSrc, BYTE* pDst, int count);
+    void BgrToGray(const BYTE* pSrc, BYTE* pDst, int count);
+
+    // Weighted sum of the first three samples of pixels with 'channels' >= 3 samples:
+    // pDst[i] = (weights[0] * c0 + weights[1] * c1 + weights[2] * c2) >> 8, weights >= 0 summing
+    // to 256 at most (the algorithms' integer luminance and single-channel picks)
+    void WeightedGrayRow(const BYTE* pSrc, BYTE* pDst, int count, int channels, const int weights[3]);
+
+    // 32-bit BGRA / BGRX -> RGB, alpha dropped (32 bpp BMP rows)
+    void BgraToRgb(const BYTE* pSrc, BYTE* pDst, int count);
+
+    // RGB / gray -> opaque BGRA32, the layout of a 32 bpp DIB section row
+    void RgbToBgra(const BYTE* pSrc, BYTE* pDst, int count);
+    void GrayToBgra(const BYTE* pSrc, BYTE* pDst, int count);
+
+    // 2x2 box filter of two adjacent 8-bit rows: 'count' output pixels of 'channels' samples,
+    // each the rounded mean of the 2x2 block at 2i in pRow0 / pRow1 (mip pyramid levels)
+    void DownsampleRow2x(const BYTE* pRow0, const BYTE* pRow1, BYTE* pDst, int count, int channels);
+
+    // Splits 'count' interleaved pixels of 'channels' samples (each 'sampleBytes' wide: 1, 2
+    // or 4) into one row per channel: ppDst[c][i] = pSrc[i * channels + c].
+    void DeinterleaveRow(const BYTE* pSrc, BYTE* const* ppDst, int count, int channels, int sampleBytes);
+
+    // Inverse of DeinterleaveRow: pDst[i * channels + c] = ppSrc[c][i]
+    void InterleaveRow(const BYTE* const* ppSrc, BYTE* pDst, int count, int channels, int sampleBytes);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "Core/CoreTypes.h"
+
+// Per-sample-type constants and conversions for kernels templated on the pixel depth.
+// Kernels compute in double and store through FromDouble(): integer depths round and
+// saturate (bit-identical to the original 8-bit code paths), float keeps the exact value.
+template <typename T> struct PixelTraits;
+
+template <> struct PixelTraits<BYTE>
+{
+    static const PixelDepth Depth = PixelDepth::U8;
+    static double MaxValue() { return 255.0; }
+    static BYTE FromDouble(double v) { return v <= 0.0 ? 0 : (v >= 255.0 ? 255 : (BYTE)(v + 0.5)); }
+};
+
+template <> struct PixelTraits<unsigned short>
+{
+    static const PixelDepth Depth = PixelDepth::U16;
+    static double MaxValue() { return 65535.0; }
+    static unsigned short FromDouble(double v)
+    {
+        return v <= 0.0 ? 0 : (v >= 65535.0 ? 65535 : (unsigned short)(v + 0.5));
+    }
+};
+
+template <> struct PixelTraits<float>
+{
+    static const PixelDepth Depth = PixelDepth::F32;
+    static double MaxValue() { return 1.0; }
+    static float FromDouble(double v) { return (float)v; }
+};
@@ -0,0 +1,152 @@
+#include "Core/PointwiseChain.h"
+#include "Core/PixelConvert.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+CPointwiseChain::CPointwiseChain()
+    : m_bReduce(false)
+    , m_bPlanar(false)
+    , m_weights()
+{
+    for (int v = 0; v < 256; v++)
+        m_preLut[v] = m_postLut[v] = (BYTE)v;
+}
+
+CPointwiseChain* CPointwiseChain::Fuse(CAlgorithmBase* const* ppSteps, int count, const CImageBuffer& input, bool bROIs)
+{
+    if (count < 2 || !input.IsValid() || input.GetDepth() != PixelDepth::U8)
+        return nullptr;
+
+    CPointwiseChain chain;
+    int channels = input.GetChannels();
+    PointwiseMap map;
+    for (int k = 0; k < count && ppSteps[k]; k++)
+    {
+        if (!ppSteps[k]->GetPointwiseMap(map))
+            break;
+
+        // On one channel a reduction is the identity and the step is just its table. Two
+        // channels have no third sample for the weighted sum.
+        const bool bReduces = (map.bReduce && channels > 1);
+        if (bReduces && (bROIs || channels < 3))
+            break;
+
+        PixelLayout layout = (ppSteps[k]->PrefersPlanar() && channels > 1) ? PixelLayout::Planar : PixelLayout::Interleaved;
+        if (bReduces)
+        {
+            chain.m_bReduce = true;
+            for (int c = 0; c < 3; c++)
+                chain.m_weights[c] = map.weights[c];
+            for (int v = 0; v < 256; v++)
+                chain.m_postLut[v] = map.lut[v];
+            channels = 1;
+            layout = PixelLayout::Interleaved;
+        }
+        else
+        {
+            BYTE* pLut = chain.m_bReduce ? chain.m_postLut : chain.m_preLut;
+            for (int v = 0; v < 256; v++)
+                pLut[v] = map.lut[pLut[v]];
+        }
+
+        chain.m_strName += (k > 0 ? L" + " : L"") + ppSteps[k]->GetName();
+        chain.m_frames.push_back({ channels, PixelDepth::U8, layout });
+    }
+
+    if (chain.GetStepCount() < 2)
+        return nullptr;
+    chain.m_bPlanar = (chain.m_frames.back().eLayout == PixelLayout::Planar);
+    return new CPointwiseChain(chain);
+}
+
+std::wstring CPointwiseChain::GetDescription() const
+{
+    return L"Consecutive pointwise steps in one pass";
+}
+
+bool CPointwiseChain::Process(const CImageBuffer& input, CImageBuffer& output)
+{
+    if (!input.IsValid() || input.GetDepth() != PixelDepth::U8) return false;
+
+    if (!m_bReduce)
+    {
+        if (!output.Create(input.GetWidth(), input.GetHeight(), input.GetChannels(), PixelDepth::U8, input.GetLayout()))
+            return false;
+        return ProcessView(input.GetConstView(), output.GetView());
+    }
+
+    // Reduction: the same interleaved 3+ channel input Grayscale and Binarize take
+    if (input.IsPlanar() || input.GetChannels() < 3) return false;
+
+    int nWidth    = input.GetWidth();
+    int nHeight   = input.GetHeight();
+    int nChannels = input.GetChannels();
+    if (!output.Create(nWidth, nHeight, 1)) return false;
+
+    bool bPreLut = false;
+    for (int v = 0; v < 256 && !bPreLut; v++)
+        bPreLut = (m_preLut[v] != v);
+
+    const BYTE* pSrc       = input.GetData();
+    BYTE*       pDst       = output.GetData();
+    int         nSrcStride = input.GetStride();
+    int         nDstStride = output.GetStride();
+    CRowProgress progress(*this, nHeight);
+
+#pragma omp parallel
+    {
+        std::vector<BYTE> row(bPreLut ? (size_t)nWidth * nChannels : 0);
+
+#pragma omp for schedule(static)
+        for (int y = 0; y < nHeight; y++)
+        {
+            if (progress.IsCancelled()) continue;
+            const BYTE* pSrcRow = pSrc + (size_t)y * nSrcStride;
+            BYTE*       pDstRow = pDst + (size_t)y * nDstStride;
+            if (bPreLut)
+            {
+                for (int x = 0; x < nWidth * nChannels; x++)
+                    row[x] = m_preLut[pSrcRow[x]];
+                pSrcRow = row.data();
+            }
+            PixelConvert::WeightedGrayRow(pSrcRow, pDstRow, nWidth, nChannels, m_weights);
+            for (int x = 0; x < nWidth; x++)
+                pDstRow[x] = m_postLut[pDstRow[x]];
+            progress.Add();
+        }
+    }
+    return !progress.IsCancelled();
+}
+
+bool CPointwiseChain::ProcessView(const ConstImageView& input, const ImageView& output)
+{
+    if (m_bReduce || !input.IsValid() || !output.IsValid()) return false;
+    if (input.eDepth != PixelDepth::U8 || output.eDepth != PixelDepth::U8) return false;
+    if (input.IsPlanar() != output.IsPlanar()) return false;
+
+    // A planar frame maps each plane as a one-channel image
+    const int nPlanes = input.IsPlanar() ? input.nChannels : 1;
+    CRowProgress progress(*this, (long long)nPlanes * input.nHeight);
+
+    for (int c = 0; c < nPlanes; c++)
+    {
+        const ConstImageView src = input.IsPlanar() ? input.Plane(c) : input;
+        const ImageView      dst = output.IsPlanar() ? output.Plane(c) : output;
+        const int nHeight = src.nHeight;
+        const int nRowLen = src.nWidth * src.nChannels;
+
+#pragma omp parallel for schedule(static)
+        for (int y = 0; y < nHeight; y++)
+        {
+            if (progress.IsCancelled()) continue;
+            const BYTE* pSrcRow = src.Row(y);
+            BYTE*       pDstRow = dst.Row(y);
+            for (int x = 0; x < nRowLen; x++)
+                pDstRow[x] = m_preLut[pSrcRow[x]];
+            progress.Add();
+        }
+    }
+    return !progress.IsCancelled();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Core/StepChain.h"
+
+// A run of consecutive pointwise steps (CAlgorithmBase::GetPointwiseMap) executed as one step.
+//
+// Per-sample tables compose into a single 256-entry table. A run with a channel reduction
+// (Grayscale, Binarize) becomes the tables of the steps before it, applied to each channel,
+// the weighted sum, and the tables after it applied to the gray value; every reduction after
+// the first sees one channel and only adds its table. The whole run then reads and writes the
+// frame once, each row going through the fused table (or, when reducing, the pre-table into a
+// row buffer, the SSSE3 weighted sum and the post-table) while it is in cache.
+//
+// Results equal running the steps one by one, including the output's channel count and
+// layout. Not registered with the algorithm manager; the sequence builds it with Fuse().
+class CPointwiseChain : public CStepChain {
+public:
+    // Fuses the longest run of pointwise steps at the start of ppSteps[0..count) for frames
+    // like 'input' (8-bit; 1 or 3+ channels once a step reduces). With ROIs, reducing steps end
+    // the run: their 1-channel ROI results are pasted back as gray, which the fused step does
+    // not reproduce. Returns nullptr when fewer than two steps qualify; the caller owns the chain.
+    static CPointwiseChain* Fuse(CAlgorithmBase* const* ppSteps, int count, const CImageBuffer& input, bool bROIs);
+
+    virtual std::wstring GetDescription() const override;
+    virtual bool Process(const CImageBuffer& input, CImageBuffer& output) override;
+    virtual bool SupportsViews() const override { return !m_bReduce; }
+    virtual bool ProcessView(const ConstImageView& input, const ImageView& output) override;
+    virtual bool PrefersPlanar() const override { return m_bPlanar; }
+    virtual int GetNeighbourhoodRadius() const override { return 0; }
+    virtual bool GetPointwiseMap(PointwiseMap& map) const override { return false; }
+    virtual CAlgorithmBase* Clone() const override { return new CPointwiseChain(*this); }
+
+private:
+    CPointwiseChain();
+
+    bool m_bReduce;
+    bool m_bPlanar;         // layout of the last step's output
+    int  m_weights[3];
+    BYTE m_preLut[256];     // per channel, before the reduction (all of it without one)
+    BYTE m_postLut[256];    // on the gray value
+};
@@ -0,0 +1,313 @@
+#include "Core/Profiler.h"
+#include "Core/ImageCodec.h"
+#include "Utils/Logger.h"
+#include "Utils/StringUtil.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+
+struct ProfileThreadLog
+{
+    std::mutex               cs;          // the owner appends, readers copy
+    std::vector<ProfileSpan> spans;
+    unsigned long long       nDropped = 0;
+    int                      nThread  = 0;
+    bool                     bInUse   = false;   // guarded by the profiler's m_cs
+};
+
+namespace
+{
+
+// The calling thread's log; handed back when the thread exits
+struct ThreadLogSlot
+{
+    ProfileThreadLog* pLog = nullptr;
+    ~ThreadLogSlot() { if (pLog) CProfiler::ReleaseThreadLog(pLog); }
+};
+
+thread_local ThreadLogSlot t_logSlot;
+
+long long SteadyNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AppendJsonString(std::string& out, const std::string& text)
+{
+    out += '"';
+    for (unsigned char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += (char)c;
+        }
+        else if (c < 0x20)
+        {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            out += esc;
+        }
+        else
+        {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+CProfiler& CProfiler::GetInstance()
+{
+    static CProfiler instance;
+    return instance;
+}
+
+CProfiler::CProfiler()
+    : m_bEnabled(false)
+    , m_nEpochNs(SteadyNs())
+{
+}
+
+CProfiler::~CProfiler()
+{
+}
+
+void CProfiler::Reset()
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    for (auto& pLog : m_logs)
+    {
+        std::lock_guard<std::mutex> logLock(pLog->cs);
+        pLog->spans.clear();
+        pLog->nDropped = 0;
+    }
+    m_nEpochNs.store(SteadyNs(), std::memory_order_relaxed);
+}
+
+long long CProfiler::NowUs() const
+{
+    return (SteadyNs() - m_nEpochNs.load(std::memory_order_relaxed)) / 1000;
+}
+
+ProfileThreadLog* CProfiler::GetThreadLog()
+{
+    if (t_logSlot.pLog)
+        return t_logSlot.pLog;
+
+    // A log whose thread has exited keeps its number, so trace lanes stay few
+    std::lock_guard<std::mutex> lock(m_cs);
+    ProfileThreadLog* pLog = nullptr;
+    for (auto& p : m_logs)
+        if (!p->bInUse) { pLog = p.get(); break; }
+    if (!pLog)
+    {
+        m_logs.emplace_back(new ProfileThreadLog);
+        pLog = m_logs.back().get();
+        pLog->nThread = (int)m_logs.size() - 1;
+    }
+    pLog->bInUse = true;
+    t_logSlot.pLog = pLog;
+    return pLog;
+}
+
+void CProfiler::ReleaseThreadLog(ProfileThreadLog* pLog)
+{
+    CProfiler& profiler = GetInstance();
+    std::lock_guard<std::mutex> lock(profiler.m_cs);
+    pLog->bInUse = false;
+}
+
+void CProfiler::Record(const char* pszCategory, std::string&& strName, long long nStartUs, long long nEndUs)
+{
+    ProfileThreadLog* pLog = GetThreadLog();
+    std::lock_guard<std::mutex> lock(pLog->cs);
+    if (pLog->spans.size() >= MAX_SPANS_PER_THREAD)
+    {
+        pLog->nDropped++;
+        return;
+    }
+    ProfileSpan span;
+    span.pszCategory = pszCategory;
+    span.strName     = std::move(strName);
+    span.nStartUs    = nStartUs;
+    span.nDurUs      = std::max(0LL, nEndUs - nStartUs);
+    span.nThread     = pLog->nThread;
+    pLog->spans.push_back(std::move(span));
+}
+
+std::vector<ProfileSpan> CProfiler::GetSpans() const
+{
+    std::vector<ProfileSpan> spans;
+    {
+        std::lock_guard<std::mutex> lock(m_cs);
+        for (auto& pLog : m_logs)
+        {
+            std::lock_guard<std::mutex> logLock(pLog->cs);
+            spans.insert(spans.end(), pLog->spans.begin(), pLog->spans.end());
+        }
+    }
+    std::stable_sort(spans.begin(), spans.end(),
+        [](const ProfileSpan& a, const ProfileSpan& b) { return a.nStartUs < b.nStartUs; });
+    return spans;
+}
+
+unsigned long long CProfiler::GetDroppedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    unsigned long long n = 0;
+    for (auto& pLog : m_logs)
+    {
+        std::lock_guard<std::mutex> logLock(pLog->cs);
+        n += pLog->nDropped;
+    }
+    return n;
+}
+
+std::vector<ProfileStat> CProfiler::GetStats() const
+{
+    std::map<std::pair<std::string, std::string>, std::vector<long long>> groups;
+    for (const ProfileSpan& span : GetSpans())
+        groups[std::make_pair(std::string(span.pszCategory), span.strName)].push_back(span.nDurUs);
+
+    std::vector<ProfileStat> stats;
+    stats.reserve(groups.size());
+    for (auto& group : groups)
+    {
+        std::vector<long long>& durs = group.second;
+        std::sort(durs.begin(), durs.end());
+        ProfileStat stat;
+        stat.strCategory = group.first.first;
+        stat.strName     = group.first.second;
+        stat.nCount      = (int)durs.size();
+        stat.dMinUs      = (double)durs.front();
+        stat.dMaxUs      = (double)durs.back();
+        stat.dTotalUs    = 0.0;
+        for (long long d : durs) stat.dTotalUs += (double)d;
+        stat.dMeanUs     = stat.dTotalUs / durs.size();
+        // Nearest rank: the smallest duration at least 99% of the spans do not exceed
+        const size_t nRank = (durs.size() * 99 + 99) / 100;
+        stat.dP99Us      = (double)durs[std::max<size_t>(nRank, 1) - 1];
+        stats.push_back(stat);
+    }
+    std::stable_sort(stats.begin(), stats.end(), [](const ProfileStat& a, const ProfileStat& b)
+    {
+        if (a.strCategory != b.strCategory) return a.strCategory < b.strCategory;
+        return a.dTotalUs > b.dTotalUs;
+    });
+    return stats;
+}
+
+std::string CProfiler::FormatStats() const
+{
+    std::string text;
+    char line[512];
+    snprintf(line, sizeof(line), "  %-8s %-32s %7s %10s %10s %10s %10s %11s\n",
+        "kind", "span", "count", "min ms", "mean ms", "p99 ms", "max ms", "total ms");
+    text += line;
+    for (const ProfileStat& s : GetStats())
+    {
+        snprintf(line, sizeof(line), "  %-8s %-32s %7d %10.3f %10.3f %10.3f %10.3f %11.3f\n",
+            s.strCategory.c_str(), s.strName.c_str(), s.nCount, s.dMinUs / 1000.0, s.dMeanUs / 1000.0,
+            s.dP99Us / 1000.0, s.dMaxUs / 1000.0, s.dTotalUs / 1000.0);
+        text += line;
+    }
+    return text;
+}
+
+std::string CProfiler::ToChromeTrace() const
+{
+    // Complete events ("ph":"X") on one lane per recording thread; spans that nest in time on
+    // a lane are drawn nested
+    const std::vector<ProfileSpan> spans = GetSpans();
+    int nThreads = 0;
+    for (const ProfileSpan& span : spans)
+        nThreads = std::max(nThreads, span.nThread + 1);
+
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    char buf[160];
+    bool bFirst = true;
+    for (int t = 0; t < nThreads; t++)
+    {
+        snprintf(buf, sizeof(buf), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"thread %d\"}}", bFirst ? "" : ",\n", t, t);
+        json += buf;
+        bFirst = false;
+    }
+    for (const ProfileSpan& span : spans)
+    {
+        json += bFirst ? "{\"name\":" : ",\n{\"name\":";
+        bFirst = false;
+        AppendJsonString(json, span.strName);
+        json += ",\"cat\":";
+        AppendJsonString(json, span.pszCategory);
+        snprintf(buf, sizeof(buf), ",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d}",
+            span.nStartUs, span.nDurUs, span.nThread);
+        json += buf;
+    }
+    json += "\n]}\n";
+    return json;
+}
+
+bool CProfiler::ExportChromeTrace(const std::wstring& path) const
+{
+    const std::string json = ToChromeTrace();
+    FILE* fp = CImageCodec::OpenFile(path, L"wb");
+    if (!fp)
+    {
+        CLogger::Error(L"CProfiler - Cannot write %ls", path.c_str());
+        return false;
+    }
+    const bool bOk = fwrite(json.data(), 1, json.size(), fp) == json.size();
+    if (fclose(fp) != 0 || !bOk)
+    {
+        CLogger::Error(L"CProfiler - Failed writing %ls", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// CProfileScope
+// ---------------------------------------------------------------------------
+
+CProfileScope::CProfileScope(const char* pszCategory, const char* pszName)
+    : m_pszCategory(pszCategory)
+    , m_nStartUs(0)
+    , m_bActive(CProfiler::GetInstance().IsEnabled())
+{
+    if (m_bActive)
+    {
+        m_strName  = pszName;
+        m_nStartUs = CProfiler::GetInstance().NowUs();
+    }
+}
+
+void CProfileScope::SetName(const std::wstring& name)
+{
+    if (m_bActive)
+        m_strName = WideToUtf8(name);
+}
+
+void CProfileScope::Next(const char* pszName)
+{
+    End();
+    m_bActive = CProfiler::GetInstance().IsEnabled();
+    if (m_bActive)
+    {
+        m_strName  = pszName;
+        m_nStartUs = CProfiler::GetInstance().NowUs();
+    }
+}
+
+void CProfileScope::End()
+{
+    if (!m_bActive)
+        return;
+    m_bActive = false;
+    CProfiler& profiler = CProfiler::GetInstance();
+    profiler.Record(m_pszCategory, std::move(m_strName), m_nStartUs, profiler.NowUs());
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One timed span. Categories are static strings: "step" (one ProcessStep call), "roi" (one ROI
+// of a step), "phase" (a part of an algorithm's kernel), "preview" (one dialog preview).
+struct ProfileSpan
+{
+    const char* pszCategory;
+    std::string strName;    // UTF-8
+    long long   nStartUs;   // since the profiler's epoch (construction or Reset)
+    long long   nDurUs;
+    int         nThread;    // small number per recording thread
+};
+
+// Spans of one category and name, aggregated
+struct ProfileStat
+{
+    std::string strCategory;
+    std::string strName;
+    int         nCount;
+    double      dMinUs;
+    double      dMeanUs;
+    double      dP99Us;     // nearest rank
+    double      dMaxUs;
+    double      dTotalUs;
+};
+
+struct ProfileThreadLog;
+
+// Process-wide span recorder, off by default. Every thread appends to a log of its own, so
+// recording threads never wait for each other; a log is taken over by the next new thread once
+// its thread has exited. Each log keeps at most MAX_SPANS_PER_THREAD spans and counts the rest
+// as dropped. Reading (GetSpans, GetStats, the exports) may run while spans are recorded.
+class CProfiler {
+public:
+    static const size_t MAX_SPANS_PER_THREAD = 1 << 18;
+
+    static CProfiler& GetInstance();
+    ~CProfiler();
+
+    void SetEnabled(bool bEnabled) { m_bEnabled.store(bEnabled, std::memory_order_relaxed); }
+    bool IsEnabled() const { return m_bEnabled.load(std::memory_order_relaxed); }
+
+    // Drops the recorded spans and restarts the clock
+    void Reset();
+
+    // Microseconds since the epoch
+    long long NowUs() const;
+
+    void Record(const char* pszCategory, std::string&& strName, long long nStartUs, long long nEndUs);
+
+    std::vector<ProfileSpan> GetSpans() const;             // ordered by start time
+    std::vector<ProfileStat> GetStats() const;             // by category, then total time, largest first
+    std::string              FormatStats() const;          // GetStats() as a text table, in ms
+    std::string              ToChromeTrace() const;        // Trace Event Format JSON (chrome://tracing, Perfetto)
+    bool                     ExportChromeTrace(const std::wstring& path) const;
+    unsigned long long       GetDroppedCount() const;
+
+    // Called by the thread-local slot when its thread exits
+    static void ReleaseThreadLog(ProfileThreadLog* pLog);
+
+private:
+    CProfiler();
+    CProfiler(const CProfiler&) = delete;
+    CProfiler& operator=(const CProfiler&) = delete;
+
+    ProfileThreadLog* GetThreadLog();
+
+    std::atomic<bool>                              m_bEnabled;
+    std::atomic<long long>                         m_nEpochNs;   // steady_clock time of the epoch
+    std::vector<std::unique_ptr<ProfileThreadLog>> m_logs;
+    mutable std::mutex                             m_cs;         // guards m_logs
+};
+
+// Times the enclosing scope as one span. With the profiler disabled it costs one relaxed load
+// and records nothing; the name (often an algorithm's GetName()) should then not be built, so
+// callers with a computed name set it once IsActive() says it will be used:
+//
+//     CProfileScope span("step");
+//     if (span.IsActive()) span.SetName(pStep->GetName());
+//
+// Next() closes the current span and opens another in the same category, for consecutive
+// phases of one function; End() closes it before the scope does.
+class CProfileScope {
+public:
+    explicit CProfileScope(const char* pszCategory, const char* pszName = "");
+    ~CProfileScope() { End(); }
+
+    bool IsActive() const { return m_bActive; }
+    void SetName(const std::wstring& name);
+    void SetName(const char* pszName) { if (m_bActive) m_strName = pszName; }
+    void Next(const char* pszName);
+    void End();
+
+private:
+    CProfileScope(const CProfileScope&) = delete;
+    CProfileScope& operator=(const CProfileScope&) = delete;
+
+    const char* m_pszCategory;
+    std::string m_strName;
+    long long   m_nStartUs;
+    bool        m_bActive;
+};
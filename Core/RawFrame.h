@@ -0,0 +1,60 @@
+#pragma once
+#include "Core/ImageView.h"
+#include <cstdio>
+#include <string>
+
+// On-disk header of a raw frame (.vraw); see ImageBufferRaw.cpp for the layout.
+const size_t   RAW_FRAME_HEADER_SIZE = 64;
+const unsigned RAW_FRAME_VERSION     = 1;
+
+// Pixel format field: the PixelDepth value of the samples
+const unsigned RAW_FRAME_FORMAT_U8   = (unsigned)PixelDepth::U8;
+const unsigned RAW_FRAME_FORMAT_U16  = (unsigned)PixelDepth::U16;
+const unsigned RAW_FRAME_FORMAT_F32  = (unsigned)PixelDepth::F32;
+
+struct RawFrameHeader
+{
+    char               magic[4];
+    unsigned int       nVersion;
+    unsigned int       nHeaderSize;
+    int                nWidth;
+    int                nHeight;
+    int                nChannels;
+    int                nStride;
+    unsigned int       nPixelFormat;
+    unsigned long long nDataSize;
+    BYTE               reserved[24];
+};
+static_assert(sizeof(RawFrameHeader) == RAW_FRAME_HEADER_SIZE, "raw frame header must be 64 bytes");
+
+// Writes a .vraw frame region by region, so a frame that never exists in memory as a whole
+// (tiled execution output) can still be saved and later mapped with CImageBuffer::MapRawFile.
+// Regions may arrive in any order; pixels never written read back as zero.
+class CRawFrameWriter
+{
+public:
+    CRawFrameWriter();
+    ~CRawFrameWriter();   // closes a file that is still open
+
+    bool Open(const std::wstring& filePath, int width, int height, int channels,
+              PixelDepth depth = PixelDepth::U8);
+    bool WriteRegion(int x, int y, const ConstImageView& region);
+    bool Close();         // false if any write failed; the partial file is removed
+
+    bool IsOpen() const { return m_pFile != nullptr; }
+
+private:
+    CRawFrameWriter(const CRawFrameWriter&) = delete;
+    CRawFrameWriter& operator=(const CRawFrameWriter&) = delete;
+
+    bool Seek(unsigned long long offset);
+
+    FILE*        m_pFile;
+    std::wstring m_strPath;
+    int          m_nWidth;
+    int          m_nHeight;
+    int          m_nChannels;
+    int          m_nStride;
+    PixelDepth   m_eDepth;
+    bool         m_bFailed;
+};
@@ -0,0 +1,141 @@
+#include "Core/RawFrame.h"
+#include "Core/ImageAllocator.h"
+#include "Core/ImageCodec.h"
+#include "Utils/Logger.h"
+#include "Utils/StringUtil.h"
+#include <cstring>
+
+CRawFrameWriter::CRawFrameWriter()
+    : m_pFile(nullptr)
+    , m_nWidth(0)
+    , m_nHeight(0)
+    , m_nChannels(0)
+    , m_nStride(0)
+    , m_eDepth(PixelDepth::U8)
+    , m_bFailed(false)
+{
+}
+
+CRawFrameWriter::~CRawFrameWriter()
+{
+    if (m_pFile)
+        Close();
+}
+
+bool CRawFrameWriter::Seek(unsigned long long offset)
+{
+#ifdef _WIN32
+    return _fseeki64(m_pFile, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(m_pFile, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool CRawFrameWriter::Open(const std::wstring& filePath, int width, int height, int channels,
+                           PixelDepth depth)
+{
+    if (m_pFile) Close();
+
+    if (width <= 0 || height <= 0 || width > MAX_TILED_IMAGE_WIDTH || height > MAX_TILED_IMAGE_HEIGHT ||
+        channels <= 0 || channels > 4)
+    {
+        CLogger::Error(L"CRawFrameWriter::Open - Invalid geometry %d x %d x %d", width, height, channels);
+        return false;
+    }
+
+    m_pFile = CImageCodec::OpenFile(filePath, L"wb");
+    if (!m_pFile)
+    {
+        CLogger::Error(L"CRawFrameWriter::Open - Cannot create %ls", filePath.c_str());
+        return false;
+    }
+
+    m_strPath   = filePath;
+    m_nWidth    = width;
+    m_nHeight   = height;
+    m_nChannels = channels;
+    m_eDepth    = depth;
+    m_nStride   = (width * channels * PixelDepthBytes(depth) + IMAGE_BUFFER_ALIGNMENT - 1) &
+                  ~(IMAGE_BUFFER_ALIGNMENT - 1);
+    m_bFailed   = false;
+
+    RawFrameHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, "VSRF", 4);
+    hdr.nVersion     = RAW_FRAME_VERSION;
+    hdr.nHeaderSize  = (unsigned int)RAW_FRAME_HEADER_SIZE;
+    hdr.nWidth       = width;
+    hdr.nHeight      = height;
+    hdr.nChannels    = channels;
+    hdr.nStride      = m_nStride;
+    hdr.nPixelFormat = (unsigned int)depth;
+    hdr.nDataSize    = (unsigned long long)m_nStride * height;
+
+    // Extend the file to its final size up front (sparse where the file system allows), so
+    // MapRawFile accepts it no matter which regions end up written
+    const BYTE zero = 0;
+    if (fwrite(&hdr, sizeof(hdr), 1, m_pFile) != 1 ||
+        !Seek(RAW_FRAME_HEADER_SIZE + hdr.nDataSize - 1) || fwrite(&zero, 1, 1, m_pFile) != 1)
+    {
+        m_bFailed = true;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool CRawFrameWriter::WriteRegion(int x, int y, const ConstImageView& region)
+{
+    if (!m_pFile || m_bFailed || !region.IsValid()) return false;
+
+    // Raw frames are interleaved; planar regions must be converted by the caller
+    if (region.nChannels != m_nChannels || region.eDepth != m_eDepth || region.IsPlanar() || x < 0 || y < 0 ||
+        x + region.nWidth > m_nWidth || y + region.nHeight > m_nHeight)
+    {
+        CLogger::Error(L"CRawFrameWriter::WriteRegion - Region %d x %d x %d at (%d, %d) does not fit the %d x %d x %d frame",
+            region.nWidth, region.nHeight, region.nChannels, x, y, m_nWidth, m_nHeight, m_nChannels);
+        return false;
+    }
+
+    const size_t pixelBytes = (size_t)m_nChannels * PixelDepthBytes(m_eDepth);
+    const size_t rowBytes = region.nWidth * pixelBytes;
+    const bool bFullRows = (x == 0 && region.nWidth == m_nWidth);
+    for (int row = 0; row < region.nHeight; row++)
+    {
+        // Rows of a full-width region are contiguous in the file, so only the first one seeks
+        if (row == 0 || !bFullRows)
+        {
+            unsigned long long offset = RAW_FRAME_HEADER_SIZE +
+                (unsigned long long)(y + row) * m_nStride + (unsigned long long)x * pixelBytes;
+            if (!Seek(offset)) { m_bFailed = true; break; }
+        }
+        if (fwrite(region.Row(row), 1, rowBytes, m_pFile) != rowBytes) { m_bFailed = true; break; }
+        if (bFullRows && m_nStride > (int)rowBytes)
+        {
+            const BYTE pad[IMAGE_BUFFER_ALIGNMENT] = {};
+            if (fwrite(pad, 1, m_nStride - rowBytes, m_pFile) != m_nStride - rowBytes) { m_bFailed = true; break; }
+        }
+    }
+
+    if (m_bFailed)
+        CLogger::Error(L"CRawFrameWriter::WriteRegion - Write failed: %ls", m_strPath.c_str());
+    return !m_bFailed;
+}
+
+bool CRawFrameWriter::Close()
+{
+    if (!m_pFile) return false;
+
+    bool ok = (fclose(m_pFile) == 0) && !m_bFailed;
+    m_pFile = nullptr;
+    if (!ok)
+    {
+#ifdef _WIN32
+        _wremove(m_strPath.c_str());
+#else
+        remove(WideToUtf8(m_strPath).c_str());
+#endif
+        CLogger::Error(L"CRawFrameWriter::Close - Failed to write %ls", m_strPath.c_str());
+    }
+    return ok;
+}
@@ -0,0 +1,442 @@
+#include "Core/Recipe.h"
+#include "Core/ImageCodec.h"
+#include "Core/SequenceManager.h"
+#include "Algorithm/AlgorithmManager.h"
+#include "Utils/Logger.h"
+#include "Utils/StringUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+
+const char* const kTextMagic = "VisionRecipe";
+const int         kTextVersion = 1;
+const char        kBinaryMagic[4] = { 'V', 'R', 'C', 'P' };
+const int         kBinaryVersion = 1;
+
+const char* const kDepthNames[] = { "u8", "u16", "f32" };   // PixelDepth order
+
+std::string Trim(const std::string& s)
+{
+    const char* ws = " \t\r\n";
+    size_t b = s.find_first_not_of(ws);
+    if (b == std::string::npos) return std::string();
+    return s.substr(b, s.find_last_not_of(ws) - b + 1);
+}
+
+// Shortest form that reads back as the same double
+std::string FormatDouble(double v)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.15g", v);
+    if (strtod(buf, nullptr) != v)
+        snprintf(buf, sizeof(buf), "%.17g", v);
+    return buf;
+}
+
+bool ParseDouble(const std::string& s, double& v)
+{
+    char* pEnd = nullptr;
+    v = strtod(s.c_str(), &pEnd);
+    return !s.empty() && pEnd && *pEnd == '\0';
+}
+
+// Little-endian writer and bounds-checked reader for the binary encoding
+class CRecipeWriter
+{
+public:
+    explicit CRecipeWriter(std::vector<BYTE>& out) : m_out(out) {}
+
+    void U8(unsigned v)  { m_out.push_back((BYTE)v); }
+    void U16(unsigned v) { U8(v & 0xFF); U8((v >> 8) & 0xFF); }
+    void U32(unsigned long v) { U16(v & 0xFFFF); U16((v >> 16) & 0xFFFF); }
+    void I32(int v) { U32((unsigned long)(unsigned)v); }
+    void F64(double v)
+    {
+        unsigned long long bits;
+        memcpy(&bits, &v, sizeof(bits));
+        U32((unsigned long)(bits & 0xFFFFFFFFu));
+        U32((unsigned long)(bits >> 32));
+    }
+    void Str(const std::wstring& text)
+    {
+        const std::string utf8 = WideToUtf8(text);
+        U16((unsigned)std::min<size_t>(utf8.size(), 0xFFFF));
+        m_out.insert(m_out.end(), utf8.begin(), utf8.begin() + std::min<size_t>(utf8.size(), 0xFFFF));
+    }
+
+private:
+    std::vector<BYTE>& m_out;
+};
+
+class CRecipeReader
+{
+public:
+    CRecipeReader(const BYTE* pData, size_t size) : m_p(pData), m_nLeft(size), m_bOk(true) {}
+
+    bool Ok() const { return m_bOk; }
+    unsigned U8()  { return Take(1) ? m_p[-1] : 0; }
+    unsigned U16() { unsigned lo = U8(); return lo | (U8() << 8); }
+    unsigned long U32() { unsigned long lo = U16(); return lo | ((unsigned long)U16() << 16); }
+    int I32() { return (int)(unsigned)U32(); }
+    double F64()
+    {
+        unsigned long long lo = U32();
+        unsigned long long bits = lo | ((unsigned long long)U32() << 32);
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    std::wstring Str()
+    {
+        const unsigned n = U16();
+        if (!Take(n)) return std::wstring();
+        return Utf8ToWide(std::string((const char*)m_p - n, n));
+    }
+
+private:
+    bool Take(size_t n)
+    {
+        if (!m_bOk || n > m_nLeft) { m_bOk = false; return false; }
+        m_p += n;
+        m_nLeft -= n;
+        return true;
+    }
+
+    const BYTE* m_p;
+    size_t      m_nLeft;
+    bool        m_bOk;
+};
+
+} // namespace
+
+void CRecipe::AddStep(CAlgorithmBase* pStep)
+{
+    if (!pStep) return;
+
+    RecipeStep step;
+    step.strAlgorithm = pStep->GetName();
+    for (const AlgorithmParam& param : pStep->GetParams())
+    {
+        step.paramNames.push_back(param.strName);
+        step.paramValues.push_back(param.dCurrentVal);
+    }
+    m_steps.push_back(step);
+}
+
+void CRecipe::SetFrame(const CImageBuffer& image)
+{
+    m_frame = RecipeFrame();
+    if (image.IsValid())
+    {
+        m_frame.nWidth    = image.GetWidth();
+        m_frame.nHeight   = image.GetHeight();
+        m_frame.nChannels = image.GetChannels();
+        m_frame.eDepth    = image.GetDepth();
+    }
+}
+
+void CRecipe::Capture(const CSequenceManager& sequence)
+{
+    m_steps.clear();
+    for (int i = 0; i < sequence.GetStepCount(); i++)
+        AddStep(sequence.GetStep(i));
+    m_rcROIs = sequence.GetROIs();
+}
+
+bool CRecipe::Apply(CSequenceManager& sequence, const CImageBuffer* pFrame) const
+{
+    std::vector<CAlgorithmBase*> steps = CreateSteps();
+    if (steps.empty() && !m_steps.empty())
+        return false;
+
+    sequence.ClearSteps();
+    for (CAlgorithmBase* pStep : steps)
+        sequence.AddStep(pStep);
+    sequence.SetROIs(m_rcROIs);
+    if (pFrame && pFrame->IsValid())
+        sequence.PrepareBuffers(pFrame->GetWidth(), pFrame->GetHeight(), pFrame->GetChannels(), pFrame->GetDepth());
+    else if (m_frame.nWidth > 0)
+        sequence.PrepareBuffers(m_frame.nWidth, m_frame.nHeight, m_frame.nChannels, m_frame.eDepth);
+    return true;
+}
+
+std::vector<CAlgorithmBase*> CRecipe::CreateSteps() const
+{
+    std::vector<CAlgorithmBase*> steps;
+    for (const RecipeStep& step : m_steps)
+    {
+        CAlgorithmBase* pAlg = CAlgorithmManager::GetInstance().CreateAlgorithm(step.strAlgorithm);
+        bool bOk = (pAlg != nullptr);
+        if (!bOk)
+            CLogger::Error(L"CRecipe::CreateSteps - Unknown algorithm: %ls", step.strAlgorithm.c_str());
+
+        for (size_t p = 0; bOk && p < step.paramNames.size(); p++)
+        {
+            std::vector<AlgorithmParam>& params = pAlg->GetParams();
+            auto it = std::find_if(params.begin(), params.end(),
+                [&](const AlgorithmParam& param) { return param.strName == step.paramNames[p]; });
+            if (it == params.end())
+            {
+                CLogger::Error(L"CRecipe::CreateSteps - %ls has no parameter %ls",
+                    step.strAlgorithm.c_str(), step.paramNames[p].c_str());
+                bOk = false;
+                break;
+            }
+            // A hand-edited value like 2.22 for an option index or a kernel size is rounded
+            const int nDigits = it->vecOptions.empty() ? std::max(0, it->nPrecision) : 0;
+            const double dScale = std::pow(10.0, nDigits);
+            const double dValue = std::round(step.paramValues[p] * dScale) / dScale;
+            it->dCurrentVal = std::max(it->dMinVal, std::min(it->dMaxVal, dValue));
+        }
+
+        if (!bOk)
+        {
+            delete pAlg;
+            for (CAlgorithmBase* p : steps) delete p;
+            return std::vector<CAlgorithmBase*>();
+        }
+        steps.push_back(pAlg);
+    }
+    return steps;
+}
+
+std::string CRecipe::FormatText() const
+{
+    std::string text = std::string(kTextMagic) + " " + std::to_string(kTextVersion) + "\n";
+    if (m_frame.nWidth > 0)
+        text += "frame " + std::to_string(m_frame.nWidth) + " " + std::to_string(m_frame.nHeight) + " " +
+                std::to_string(m_frame.nChannels) + " " + kDepthNames[(int)m_frame.eDepth] + "\n";
+    for (const RecipeStep& step : m_steps)
+    {
+        text += "step " + WideToUtf8(step.strAlgorithm) + "\n";
+        for (size_t p = 0; p < step.paramNames.size(); p++)
+            text += "  " + WideToUtf8(step.paramNames[p]) + " = " + FormatDouble(step.paramValues[p]) + "\n";
+    }
+    for (const ImageRect& rc : m_rcROIs)
+        text += "roi " + std::to_string(rc.left) + " " + std::to_string(rc.top) + " " +
+                std::to_string(rc.right) + " " + std::to_string(rc.bottom) + "\n";
+    return text;
+}
+
+bool CRecipe::ParseText(const std::string& text)
+{
+    std::vector<RecipeStep> steps;
+    std::vector<ImageRect>  rois;
+    RecipeFrame frame;
+    bool bHeader = false;
+    int  nLine = 0;
+
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos) end = text.size();
+        std::string line = text.substr(pos, end - pos);
+        pos = end + 1;
+        nLine++;
+
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        line = Trim(line);
+        if (line.empty()) continue;
+
+        bool bOk = true;
+        if (!bHeader)
+        {
+            int nVersion = 0;
+            bOk = (line.compare(0, strlen(kTextMagic), kTextMagic) == 0 &&
+                   sscanf(line.c_str() + strlen(kTextMagic), "%d", &nVersion) == 1 && nVersion == kTextVersion);
+            bHeader = true;
+        }
+        else if (line.compare(0, 6, "frame ") == 0)
+        {
+            char depth[8] = {};
+            bOk = sscanf(line.c_str() + 6, "%d %d %d %7s", &frame.nWidth, &frame.nHeight, &frame.nChannels, depth) == 4 &&
+                  frame.nWidth > 0 && frame.nHeight > 0 && frame.nChannels > 0;
+            int d = 0;
+            while (d < 3 && strcmp(depth, kDepthNames[d]) != 0) d++;
+            bOk = bOk && d < 3;
+            frame.eDepth = (PixelDepth)std::min(d, 2);
+        }
+        else if (line.compare(0, 5, "step ") == 0)
+        {
+            RecipeStep step;
+            step.strAlgorithm = Utf8ToWide(Trim(line.substr(5)));
+            steps.push_back(step);
+        }
+        else if (line.compare(0, 4, "roi ") == 0)
+        {
+            ImageRect rc;
+            char extra;
+            bOk = sscanf(line.c_str() + 4, "%d %d %d %d %c", &rc.left, &rc.top, &rc.right, &rc.bottom, &extra) == 4;
+            rois.push_back(rc);
+        }
+        else
+        {
+            // "name = value" of the current step; names may contain spaces, values do not
+            size_t eq = line.rfind('=');
+            double value = 0.0;
+            bOk = (eq != std::string::npos && !steps.empty() && ParseDouble(Trim(line.substr(eq + 1)), value));
+            if (bOk)
+            {
+                steps.back().paramNames.push_back(Utf8ToWide(Trim(line.substr(0, eq))));
+                steps.back().paramValues.push_back(value);
+            }
+        }
+
+        if (!bOk)
+        {
+            CLogger::Error(L"CRecipe::ParseText - Invalid line %d: %ls", nLine, Utf8ToWide(line).c_str());
+            return false;
+        }
+    }
+
+    if (!bHeader)
+    {
+        CLogger::Error(L"CRecipe::ParseText - Empty recipe");
+        return false;
+    }
+    m_steps  = steps;
+    m_rcROIs = rois;
+    m_frame  = frame;
+    return true;
+}
+
+void CRecipe::Encode(std::vector<BYTE>& out) const
+{
+    out.clear();
+    CRecipeWriter w(out);
+    for (char c : kBinaryMagic) w.U8((BYTE)c);
+    w.U16(kBinaryVersion);
+
+    w.U32(m_frame.nWidth);
+    w.U32(m_frame.nHeight);
+    w.U16(m_frame.nChannels);
+    w.U8((unsigned)m_frame.eDepth);
+
+    w.U16((unsigned)m_steps.size());
+    for (const RecipeStep& step : m_steps)
+    {
+        w.Str(step.strAlgorithm);
+        w.U16((unsigned)step.paramNames.size());
+        for (size_t p = 0; p < step.paramNames.size(); p++)
+        {
+            w.Str(step.paramNames[p]);
+            w.F64(step.paramValues[p]);
+        }
+    }
+
+    w.U16((unsigned)m_rcROIs.size());
+    for (const ImageRect& rc : m_rcROIs)
+    {
+        w.I32(rc.left);
+        w.I32(rc.top);
+        w.I32(rc.right);
+        w.I32(rc.bottom);
+    }
+}
+
+bool CRecipe::Decode(const BYTE* pData, size_t size)
+{
+    if (size < 6 || memcmp(pData, kBinaryMagic, 4) != 0)
+    {
+        CLogger::Error(L"CRecipe::Decode - Not a binary recipe");
+        return false;
+    }
+    CRecipeReader r(pData + 4, size - 4);
+    const unsigned nVersion = r.U16();
+    if (nVersion == 0 || nVersion > (unsigned)kBinaryVersion)
+    {
+        CLogger::Error(L"CRecipe::Decode - Unsupported version %u", nVersion);
+        return false;
+    }
+
+    RecipeFrame frame;
+    frame.nWidth    = (int)r.U32();
+    frame.nHeight   = (int)r.U32();
+    frame.nChannels = (int)r.U16();
+    const unsigned nDepth = r.U8();
+    frame.eDepth = (PixelDepth)std::min(nDepth, 2u);
+
+    std::vector<RecipeStep> steps(r.U16());
+    for (RecipeStep& step : steps)
+    {
+        step.strAlgorithm = r.Str();
+        const unsigned nParams = r.U16();
+        for (unsigned p = 0; p < nParams && r.Ok(); p++)
+        {
+            step.paramNames.push_back(r.Str());
+            step.paramValues.push_back(r.F64());
+        }
+    }
+
+    std::vector<ImageRect> rois(r.U16());
+    for (ImageRect& rc : rois)
+    {
+        rc.left   = r.I32();
+        rc.top    = r.I32();
+        rc.right  = r.I32();
+        rc.bottom = r.I32();
+    }
+
+    if (!r.Ok() || nDepth > 2 || frame.nWidth < 0 || frame.nHeight < 0)
+    {
+        CLogger::Error(L"CRecipe::Decode - Truncated or corrupt recipe");
+        return false;
+    }
+    m_steps  = steps;
+    m_rcROIs = rois;
+    m_frame  = frame.nWidth > 0 ? frame : RecipeFrame();
+    return true;
+}
+
+bool CRecipe::Load(const std::wstring& path)
+{
+    FILE* fp = CImageCodec::OpenFile(path, L"rb");
+    if (!fp)
+    {
+        CLogger::Error(L"CRecipe::Load - Cannot open %ls", path.c_str());
+        return false;
+    }
+    std::vector<BYTE> data;
+    BYTE buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(fp);
+
+    if (data.size() >= 4 && memcmp(data.data(), kBinaryMagic, 4) == 0)
+        return Decode(data.data(), data.size());
+
+    size_t nSkip = (data.size() >= 3 && memcmp(data.data(), "\xEF\xBB\xBF", 3) == 0) ? 3 : 0;   // UTF-8 BOM
+    return ParseText(std::string((const char*)data.data() + nSkip, data.size() - nSkip));
+}
+
+bool CRecipe::Save(const std::wstring& path) const
+{
+    std::vector<BYTE> data;
+    if (GetFileExtension(path) == L"vrcp")
+        Encode(data);
+    else
+    {
+        const std::string text = FormatText();
+        data.assign(text.begin(), text.end());
+    }
+
+    FILE* fp = CImageCodec::OpenFile(path, L"wb");
+    if (!fp)
+    {
+        CLogger::Error(L"CRecipe::Save - Cannot create %ls", path.c_str());
+        return false;
+    }
+    bool bOk = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    bOk = (fclose(fp) == 0) && bOk;
+    if (!bOk)
+        CLogger::Error(L"CRecipe::Save - Write failed: %ls", path.c_str());
+    return bOk;
+}
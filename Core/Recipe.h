@@ -0,0 +1,83 @@
+#pragma once
+#include "Core/CoreTypes.h"
+#include <string>
+#include <vector>
+
+class CAlgorithmBase;
+class CImageBuffer;
+class CSequenceManager;
+
+// One step of a recipe: a registered algorithm and the values of its parameters by name.
+// Parameters a recipe does not list keep their defaults.
+struct RecipeStep
+{
+    std::wstring              strAlgorithm;   // CAlgorithmBase::GetName()
+    std::vector<std::wstring> paramNames;
+    std::vector<double>       paramValues;
+};
+
+// Frames a recipe is set up for; nWidth == 0 when it does not say
+struct RecipeFrame
+{
+    int        nWidth    = 0;
+    int        nHeight   = 0;
+    int        nChannels = 0;
+    PixelDepth eDepth    = PixelDepth::U8;
+};
+
+// A sequence as data: the step list with parameter values, the ROIs and optionally the frame
+// format it runs on. Two encodings carry the same content:
+//
+// Text (UTF-8, one item per line, '#' starts a comment), for review and hand edits:
+//
+//   VisionRecipe 1
+//   frame 5120 5120 3 u8         width height channels depth (u8, u16, f32)
+//   step Blur
+//     커널 크기 = 5
+//     시그마 = 1.5
+//   step Binarize
+//   roi 10 10 200 150            left top right bottom
+//
+// Binary (.vrcp), for loading on a product switch: "VRCP", u16 version, then the same items
+// as little-endian integers, IEEE doubles and length-prefixed UTF-8 names. Readers reject a
+// newer version; within a version the layout only grows at the end.
+//
+// Algorithms are created through CAlgorithmManager, so it must have its algorithms registered.
+class CRecipe {
+public:
+    void Clear() { m_steps.clear(); m_rcROIs.clear(); m_frame = RecipeFrame(); }
+    const std::vector<RecipeStep>& GetSteps() const { return m_steps; }
+    const std::vector<ImageRect>&  GetROIs() const { return m_rcROIs; }
+    const RecipeFrame&             GetFrame() const { return m_frame; }
+
+    // Records the step's name and current parameter values
+    void AddStep(CAlgorithmBase* pStep);
+    void SetROIs(const std::vector<ImageRect>& rois) { m_rcROIs = rois; }
+    void SetFrame(const CImageBuffer& image);
+
+    // The sequence's steps and ROIs
+    void Capture(const CSequenceManager& sequence);
+    // Replaces the sequence's steps and ROIs, and sizes its step buffers once
+    // (CSequenceManager::PrepareBuffers): for pFrame, the image that will run, or else for the
+    // recipe's frame when it names one. The sequence is left unchanged on failure.
+    bool Apply(CSequenceManager& sequence, const CImageBuffer* pFrame = nullptr) const;
+    // New algorithm instances with the recipe's parameter values (caller owns them); empty if
+    // an algorithm or parameter is unknown. Values are clamped to the parameter's range and
+    // rounded to its precision, so integer and option parameters stay whole.
+    std::vector<CAlgorithmBase*> CreateSteps() const;
+
+    // Load() tells the encodings apart by content; Save() writes binary for a .vrcp path and
+    // text otherwise
+    bool Load(const std::wstring& path);
+    bool Save(const std::wstring& path) const;
+
+    bool ParseText(const std::string& text);
+    std::string FormatText() const;
+    bool Decode(const BYTE* pData, size_t size);
+    void Encode(std::vector<BYTE>& out) const;
+
+private:
+    std::vector<RecipeStep> m_steps;
+    std::vector<ImageRect>  m_rcROIs;
+    RecipeFrame             m_frame;
+};
@@ -0,0 +1,119 @@
+#pragma once
+#include "Core/SpscRing.h"
+#include <atomic>
+#include <functional>
+
+// Execution events of a CSequenceManager run:
+//   Progress    nIndex = 0-based step about to run,  nCount = step count
+//   StepProgress nIndex = 0-based step running,      nCount = step count,  nPermille = how far its
+//               kernel has got (steps running longer than a few tens of ms, whole-frame runs only;
+//               a chained run reports on its first step)
+//   StepDone    nIndex = 0-based step,               nCount = step count,  nElapsedUs = the step's
+//               time from its Progress event (a chained run reports its whole time on its last
+//               step, 0 on the others)
+//   StepReused  nIndex = 0-based step,               nCount = step count   (output kept from the
+//               previous run)
+//   Error       nIndex = 0-based step that failed,   nCount = step count
+//   TileDone    nIndex = 0-based tile,               nCount = tile count   (tiled runs only)
+//   Complete    nCount = step count
+//   Stopped     nCount = step count   (StopExecution ended the run early)
+// Every run ends with exactly one of Error, Complete or Stopped; its nTimeUs is the run time.
+enum class SequenceEvent { Progress, StepProgress, StepDone, StepReused, Error, Complete, TileDone, Stopped };
+
+struct SequenceEventRecord
+{
+    SequenceEvent eType;
+    int           nIndex;
+    int           nCount;
+    long long     nTimeUs;      // since the run started
+    long long     nElapsedUs;   // StepDone only
+    int           nPermille;    // StepProgress only
+};
+
+// Receives the events of a run, on the thread that executes it (the worker thread of
+// StartExecution, the caller's thread for Execute and ExecuteTiled). Implementations must not
+// call back into the sequence manager's run control from there; a UI hands the events to its
+// own thread through a CSequenceEventQueue.
+class ISequenceObserver {
+public:
+    virtual ~ISequenceObserver() {}
+    virtual void OnSequenceEvent(const SequenceEventRecord& evt) = 0;
+};
+
+// Observer that carries events from the run's thread to one consumer thread through a
+// lock-free ring, without allocating. The wake function runs on the producer when the first
+// event arrives after a Drain(), so a consumer with a message loop needs one posted message per
+// batch of events rather than one per event. Events that find the ring full are counted and
+// dropped, except the run's closing Error, Complete or Stopped: that one is parked in a side
+// slot and delivered after the ring's contents, so a consumer that stalled long enough to fill
+// the ring still sees its run end. The slot holds one event; the consumer must drain it before
+// the next run starts, as a UI that starts runs only after the previous one ended does.
+class CSequenceEventQueue : public ISequenceObserver {
+public:
+    explicit CSequenceEventQueue(size_t nCapacity = 1024)
+        : m_ring(nCapacity)
+        , m_bWakePending(false)
+        , m_bFinalPending(false)
+        , m_nDropped(0)
+    {
+    }
+
+    // Set before the first run; called on the producer thread
+    void SetWakeFn(const std::function<void()>& fn) { m_fnWake = fn; }
+
+    void OnSequenceEvent(const SequenceEventRecord& evt) override
+    {
+        if (!m_ring.TryPush(evt))
+        {
+            if (!IsFinalEvent(evt.eType) || m_bFinalPending.load(std::memory_order_acquire))
+            {
+                m_nDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            m_finalEvt = evt;
+            m_bFinalPending.store(true, std::memory_order_release);
+        }
+        if (!m_bWakePending.exchange(true, std::memory_order_acq_rel) && m_fnWake)
+            m_fnWake();
+    }
+
+    // Consumer thread: hands every queued event to 'observer' in order; returns how many.
+    // The wake flag is cleared first, so an event pushed during the drain either is delivered
+    // here or wakes the consumer again.
+    int Drain(ISequenceObserver& observer)
+    {
+        m_bWakePending.exchange(false, std::memory_order_acq_rel);
+        int n = 0;
+        SequenceEventRecord evt;
+        while (m_ring.TryPop(evt))
+        {
+            observer.OnSequenceEvent(evt);
+            n++;
+        }
+        // Parked only after the ring filled up, so it follows everything popped above
+        if (m_bFinalPending.load(std::memory_order_acquire))
+        {
+            evt = m_finalEvt;
+            m_bFinalPending.store(false, std::memory_order_release);
+            observer.OnSequenceEvent(evt);
+            n++;
+        }
+        return n;
+    }
+
+    // Events lost to a full ring since construction (never Error, Complete or Stopped)
+    unsigned long long GetDroppedCount() const { return m_nDropped.load(std::memory_order_relaxed); }
+
+private:
+    static bool IsFinalEvent(SequenceEvent e)
+    {
+        return e == SequenceEvent::Error || e == SequenceEvent::Complete || e == SequenceEvent::Stopped;
+    }
+
+    CSpscRing<SequenceEventRecord>  m_ring;
+    std::atomic<bool>               m_bWakePending;
+    std::atomic<bool>               m_bFinalPending;   // m_finalEvt holds an undelivered event
+    SequenceEventRecord             m_finalEvt;
+    std::atomic<unsigned long long> m_nDropped;
+    std::function<void()>           m_fnWake;
+};
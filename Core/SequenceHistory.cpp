@@ -0,0 +1,456 @@
+#include "Core/SequenceManager.h"
+#include "Core/ImageCodec.h"
+#include "Utils/Logger.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <filesystem>
+#include <memory>
+#include <typeinfo>
+
+namespace
+{
+
+// 64-bit FNV-1a
+const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ull;
+const unsigned long long FNV_PRIME        = 1099511628211ull;
+
+unsigned long long HashBytes(unsigned long long hash, const void* pData, size_t size)
+{
+    const BYTE* p = static_cast<const BYTE*>(pData);
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ p[i]) * FNV_PRIME;
+    return hash;
+}
+
+template <typename T>
+unsigned long long HashValue(unsigned long long hash, const T& value)
+{
+    return HashBytes(hash, &value, sizeof(value));
+}
+
+} // namespace
+
+// ============================================================================
+// Fingerprints
+// ============================================================================
+
+unsigned long long CSequenceManager::InputFingerprint(const CImageBuffer& input, const std::vector<ImageRect>& rois)
+{
+    // The block address identifies the pixels: history[0] holds a reference, so the block can
+    // neither be freed and reused nor written in place (a write detaches the writer's copy)
+    unsigned long long hash = HashValue(FNV_OFFSET_BASIS, reinterpret_cast<uintptr_t>(input.GetConstData()));
+    const int geometry[] = { input.GetWidth(), input.GetHeight(), input.GetChannels(), input.GetStride(),
+                             (int)input.GetDepth(), (int)input.GetLayout() };
+    hash = HashBytes(hash, geometry, sizeof(geometry));
+
+    hash = HashValue(hash, rois.size());
+    for (const ImageRect& rc : rois)
+    {
+        const int coords[] = { rc.left, rc.top, rc.right, rc.bottom };
+        hash = HashBytes(hash, coords, sizeof(coords));
+    }
+    return hash;
+}
+
+unsigned long long CSequenceManager::StepFingerprint(unsigned long long upstream, CAlgorithmBase* pStep)
+{
+    // The type name is static, so fingerprinting a step allocates nothing
+    const char* pszType = typeid(*pStep).name();
+    const size_t nLength = strlen(pszType);
+    unsigned long long hash = HashValue(upstream, nLength);
+    hash = HashBytes(hash, pszType, nLength);
+
+    const std::vector<AlgorithmParam>& params = pStep->GetParams();
+    hash = HashValue(hash, params.size());
+    for (const AlgorithmParam& param : params)
+        hash = HashValue(hash, param.dCurrentVal);
+    return hash;
+}
+
+unsigned long long CSequenceManager::ChainFingerprint(CAlgorithmBase* const* ppSteps, int count,
+                                                       const CImageBuffer& input, bool bROIs) const
+{
+    // Stripe chains keep the step pointers, so the pointers are part of it as well as the steps'
+    // parameters
+    unsigned long long hash = FNV_OFFSET_BASIS;
+    for (int k = 0; k < count; k++)
+    {
+        hash = HashValue(hash, reinterpret_cast<uintptr_t>(ppSteps[k]));
+        hash = StepFingerprint(hash, ppSteps[k]);
+    }
+    const long long settings[] = { input.GetWidth(), input.GetHeight(), input.GetChannels(), (int)input.GetDepth(),
+                                   (int)input.GetLayout(), bROIs, m_bFusePointwise, m_bStripes,
+                                   (long long)m_nStripeCacheBytes };
+    return HashBytes(hash, settings, sizeof(settings));
+}
+
+// ============================================================================
+// Public history access
+// ============================================================================
+
+int CSequenceManager::GetHistoryCount() const
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    return (int)m_history.size();
+}
+
+CImageBuffer CSequenceManager::GetHistoryFrame(int index)
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    if (index < 0 || index >= (int)m_history.size())
+        return CImageBuffer();
+
+    if (!RestoreFrame(index))
+    {
+        CLogger::Error(L"CSequenceManager - History frame %d is no longer available", index);
+        return CImageBuffer();
+    }
+    m_history[index].nLastUse = ++m_nHistoryClock;
+    EnforceHistoryBudget(index);
+    return m_history[index].image;
+}
+
+void CSequenceManager::SetHistoryBudget(size_t nBytes)
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    m_nHistoryBudget = nBytes;
+    EnforceHistoryBudget(-1);
+}
+
+size_t CSequenceManager::GetHistoryBudget() const
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    return m_nHistoryBudget;
+}
+
+void CSequenceManager::SetHistorySpillMode(HistorySpillMode mode)
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    m_eSpillMode = mode;
+}
+
+void CSequenceManager::SetHistorySpillDirectory(const std::wstring& dir)
+{
+    // Files already written keep their full path, so they are still found and deleted
+    std::lock_guard<std::mutex> lock(m_cs);
+    m_strSpillDir = dir;
+}
+
+HistoryStats CSequenceManager::GetHistoryStats() const
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    HistoryStats stats = m_historyStats;
+    stats.nBudgetBytes = m_nHistoryBudget;
+    stats.nFrames = (int)m_history.size();
+    stats.nResidentFrames = stats.nSpilledFrames = stats.nDroppedFrames = 0;
+    for (const HistoryFrame& frame : m_history)
+    {
+        if (frame.image.IsValid())            stats.nResidentFrames++;
+        else if (!frame.strSpillPath.empty()) stats.nSpilledFrames++;
+        else                                  stats.nDroppedFrames++;
+    }
+    return stats;
+}
+
+// ============================================================================
+// Bookkeeping (m_cs held)
+// ============================================================================
+
+void CSequenceManager::TruncateHistory(int count)
+{
+    for (int i = std::max(0, count); i < (int)m_history.size(); i++)
+    {
+        const HistoryFrame& frame = m_history[i];
+        if (frame.image.IsValid())
+            m_historyStats.nResidentBytes -= frame.nBytes;
+        if (!frame.strSpillPath.empty())
+        {
+            std::error_code ec;
+            std::filesystem::remove(std::filesystem::path(frame.strSpillPath), ec);
+            m_historyStats.nSpillFileBytes -= frame.nSpillBytes;
+        }
+    }
+    if (count < (int)m_history.size())
+        m_history.erase(m_history.begin() + std::max(0, count), m_history.end());
+}
+
+int CSequenceManager::FindResumeStep(const CImageBuffer& input)
+{
+    if (m_history.empty() || m_history[0].nFingerprint != InputFingerprint(input, m_rcROIs))
+        return 0;
+
+    // Frame k+1 is reusable while its fingerprint matches the current steps 0..k
+    unsigned long long fingerprint = m_history[0].nFingerprint;
+    const int limit = std::min((int)m_history.size() - 1, (int)m_steps.size());
+    int resume = 0;
+    while (resume < limit)
+    {
+        fingerprint = StepFingerprint(fingerprint, m_steps[resume]);
+        if (m_history[resume + 1].nFingerprint != fingerprint)
+            break;
+        resume++;
+    }
+
+    // The chain's result is interleaved; a planar intermediate frame that is now the last
+    // one is recomputed rather than converted, so it is stored exactly as a fresh run would
+    if (resume > 0 && resume == (int)m_steps.size() && m_history[resume].eLayout == PixelLayout::Planar)
+        resume--;
+
+    // The run continues from this frame, so it has to be in memory
+    while (resume > 0 && !RestoreFrame(resume))
+        resume--;
+    return resume;
+}
+
+void CSequenceManager::PushHistory(const CImageBuffer& image, unsigned long long nFingerprint)
+{
+    HistoryFrame frame;
+    frame.image     = image;
+    frame.nWidth    = image.GetWidth();
+    frame.nHeight   = image.GetHeight();
+    frame.nChannels = image.GetChannels();
+    frame.eDepth    = image.GetDepth();
+    frame.eLayout   = image.GetLayout();
+    frame.nBytes    = (size_t)image.GetStride() * image.GetHeight() * image.GetPlaneCount();
+    frame.nSpillBytes  = 0;
+    frame.nFingerprint = nFingerprint;
+    frame.nLastUse  = ++m_nHistoryClock;
+    m_history.push_back(frame);
+
+    m_historyStats.nResidentBytes += frame.nBytes;
+    m_historyStats.nPeakResidentBytes = std::max(m_historyStats.nPeakResidentBytes, m_historyStats.nResidentBytes);
+}
+
+// A frame a chained run skipped (see SetPointwiseFusion, SetStripeExecution): recorded in the format its step would
+// have produced, not resident; RestoreFrame() regenerates it, which also sets its size
+void CSequenceManager::PushDroppedHistory(int width, int height, int channels, PixelDepth depth, PixelLayout layout,
+                                          unsigned long long nFingerprint)
+{
+    HistoryFrame frame;
+    frame.nWidth    = width;
+    frame.nHeight   = height;
+    frame.nChannels = channels;
+    frame.eDepth    = depth;
+    frame.eLayout   = layout;
+    frame.nBytes    = 0;
+    frame.nSpillBytes  = 0;
+    frame.nFingerprint = nFingerprint;
+    frame.nLastUse  = ++m_nHistoryClock;
+    m_history.push_back(frame);
+}
+
+void CSequenceManager::EnforceHistoryBudget(int keep)
+{
+    if (m_nHistoryBudget == 0)
+        return;
+
+    // The input (root of every regeneration) and the newest frame (next step's input, and the
+    // result) always stay; so does 'keep', the frame just handed out
+    std::vector<bool> skip(m_history.size(), false);
+    while (m_historyStats.nResidentBytes > m_nHistoryBudget)
+    {
+        int victim = -1;
+        for (int i = 1; i < (int)m_history.size() - 1; i++)
+        {
+            if (i == keep || skip[i] || !m_history[i].image.IsValid()) continue;
+            if (victim < 0 || m_history[i].nLastUse < m_history[victim].nLastUse)
+                victim = i;
+        }
+        if (victim < 0)
+        {
+            m_historyStats.nOverBudget++;
+            return;
+        }
+        if (!EvictFrame(victim))
+            skip[victim] = true;
+    }
+}
+
+bool CSequenceManager::EvictFrame(int index)
+{
+    HistoryFrame& frame = m_history[index];
+
+    // The step buffers that produced and consumed the frame share its block; without
+    // releasing them eviction would free nothing. They are released only once the frame is
+    // sure to go, so a frame that stays keeps its run's buffers (no reallocation on rerun).
+    CImageBuffer* stepRefs[3] = {};
+    if (index - 1 < (int)m_stepBufs.size())
+    {
+        stepRefs[0] = &m_stepBufs[index - 1].stepOutput;
+        stepRefs[1] = &m_stepBufs[index - 1].interleaved;
+    }
+    if (index < (int)m_stepBufs.size())
+        stepRefs[2] = &m_stepBufs[index].stepInput;
+
+    // Anyone else holding the frame is using it, and dropping ours would not free it either
+    long nHolders = frame.image.GetShareCount() - 1;
+    for (CImageBuffer* pRef : stepRefs)
+        if (pRef && pRef->SharesStorageWith(frame.image))
+            nHolders--;
+    if (nHolders > 0)
+        return false;
+
+    const bool bRegenerate = (m_eSpillMode == HistorySpillMode::Regenerate && CanRegenerate(index));
+    if (!bRegenerate && frame.strSpillPath.empty() && !SpillFrame(index))
+        return false;
+
+    for (CImageBuffer* pRef : stepRefs)
+        if (pRef) pRef->Release();
+    frame.image.Release();
+    m_historyStats.nResidentBytes -= frame.nBytes;
+    m_historyStats.nEvictions++;
+    return true;
+}
+
+bool CSequenceManager::RestoreFrame(int index)
+{
+    HistoryFrame& frame = m_history[index];
+    if (frame.image.IsValid())
+        return true;
+
+    // A spill file that fails to load still leaves regeneration as a fallback
+    bool bRestored = !frame.strSpillPath.empty() && LoadSpilledFrame(index);
+    if (bRestored)
+        m_historyStats.nReloads++;
+    else if (CanRegenerate(index) && RegenerateFrame(index))
+    {
+        m_historyStats.nRegenerations++;
+        bRestored = true;
+    }
+    if (!bRestored)
+        return false;
+
+    m_historyStats.nResidentBytes += frame.nBytes;
+    m_historyStats.nPeakResidentBytes = std::max(m_historyStats.nPeakResidentBytes, m_historyStats.nResidentBytes);
+    return true;
+}
+
+bool CSequenceManager::CanRegenerate(int index) const
+{
+    // Frame k is step k-1's output: steps 0..k-1 must still fingerprint to it
+    if (index < 1 || index > (int)m_steps.size())
+        return false;
+    unsigned long long fingerprint = m_history[0].nFingerprint;
+    for (int s = 0; s < index; s++)
+        fingerprint = StepFingerprint(fingerprint, m_steps[s]);
+    return fingerprint == m_history[index].nFingerprint;
+}
+
+bool CSequenceManager::RegenerateFrame(int index)
+{
+    // Nearest earlier frame that is resident or on disk; frame 0 is never evicted
+    int source = index - 1;
+    while (source > 0 && !m_history[source].image.IsValid() && m_history[source].strSpillPath.empty())
+        source--;
+    if (!RestoreFrame(source))
+        return false;
+    m_history[source].nLastUse = ++m_nHistoryClock;
+
+    // Clones, so a run on the worker thread never shares an algorithm instance with us
+    CImageBuffer frame = m_history[source].image;
+    PipelineBuffers bufs;
+    for (int s = source; s < index; s++)
+    {
+        std::unique_ptr<CAlgorithmBase> pStep(m_steps[s]->Clone());
+        CImageBuffer next;
+        if (!pStep || !ProcessStep(pStep.get(), frame, next, m_historyROIs, bufs))
+            return false;
+        frame = next;
+    }
+
+    // Frames are kept in the layout they were produced in (a run's last step stores interleaved)
+    const HistoryFrame& target = m_history[index];
+    if (frame.GetLayout() != target.eLayout)
+    {
+        CImageBuffer converted;
+        if (!frame.ConvertLayout(target.eLayout, converted))
+            return false;
+        frame = converted;
+    }
+    if (frame.GetWidth() != target.nWidth || frame.GetHeight() != target.nHeight ||
+        frame.GetChannels() != target.nChannels || frame.GetDepth() != target.eDepth ||
+        frame.GetLayout() != target.eLayout)
+    {
+        CLogger::Error(L"CSequenceManager - Regenerated history frame %d does not match the original", index);
+        return false;
+    }
+    m_history[index].image = frame;
+    m_history[index].nBytes = (size_t)frame.GetStride() * frame.GetHeight() * frame.GetPlaneCount();
+    return true;
+}
+
+// ============================================================================
+// Spill files (m_cs held)
+// ============================================================================
+
+bool CSequenceManager::SpillFrame(int index)
+{
+    HistoryFrame& frame = m_history[index];
+
+    std::error_code ec;
+    std::filesystem::path dir = m_strSpillDir.empty()
+        ? std::filesystem::temp_directory_path(ec) : std::filesystem::path(m_strSpillDir);
+    if (ec || dir.empty())
+    {
+        CLogger::Error(L"CSequenceManager - No directory for history spill files");
+        return false;
+    }
+
+    // 8-bit RGB compresses losslessly as QOI; other formats go out as raw frames
+    const bool bQoi = (frame.eDepth == PixelDepth::U8 && frame.nChannels == 3 && frame.eLayout == PixelLayout::Interleaved);
+    wchar_t szName[64];
+    swprintf(szName, 64, L"vshistory_%08x_%03d.%ls", m_nSpillToken, index, bQoi ? L"qoi" : L"vraw");
+    const std::wstring path = (dir / szName).wstring();
+
+    const bool bSaved = bQoi ? CImageCodec::Save(path, frame.image) == CodecResult::Ok
+                             : frame.image.SaveRawFile(path);
+    if (!bSaved)
+    {
+        CLogger::Error(L"CSequenceManager - Failed to write history spill file %ls", path.c_str());
+        std::filesystem::remove(std::filesystem::path(path), ec);
+        return false;
+    }
+
+    frame.strSpillPath = path;
+    const std::uintmax_t nFileBytes = std::filesystem::file_size(std::filesystem::path(path), ec);
+    frame.nSpillBytes = ec ? 0 : nFileBytes;
+    m_historyStats.nSpillFileBytes += frame.nSpillBytes;
+    m_historyStats.nSpillWrites++;
+    return true;
+}
+
+bool CSequenceManager::LoadSpilledFrame(int index)
+{
+    HistoryFrame& frame = m_history[index];
+
+    // Raw files are copied out of the mapping so the file is not held open (and can be deleted)
+    CImageBuffer loaded;
+    bool bLoaded = false;
+    if (CImageCodec::FormatFromExtension(frame.strSpillPath) == ImageFileFormat::Qoi)
+        bLoaded = (CImageCodec::Load(frame.strSpillPath, loaded) == CodecResult::Ok);
+    else
+    {
+        CImageBuffer mapped;
+        bLoaded = mapped.MapRawFile(frame.strSpillPath) && loaded.CopyDataFrom(mapped);
+    }
+
+    // Raw files are always interleaved; planar intermediate frames are rearranged back
+    if (bLoaded && frame.eLayout == PixelLayout::Planar && !loaded.IsPlanar())
+    {
+        CImageBuffer planar;
+        bLoaded = loaded.ConvertLayout(PixelLayout::Planar, planar);
+        loaded = planar;
+    }
+
+    if (!bLoaded || loaded.GetWidth() != frame.nWidth || loaded.GetHeight() != frame.nHeight ||
+        loaded.GetChannels() != frame.nChannels || loaded.GetDepth() != frame.eDepth ||
+        loaded.GetLayout() != frame.eLayout)
+    {
+        CLogger::Error(L"CSequenceManager - Failed to reload history spill file %ls", frame.strSpillPath.c_str());
+        return false;
+    }
+    frame.image = loaded;
+    return true;
+}
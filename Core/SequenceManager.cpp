@@ -1,12 +1,76 @@
-#include "stdafx.h"
 #include "Core/SequenceManager.h"
+#include "Core/PointwiseChain.h"
+#include "Core/Profiler.h"
+#include "Core/StripeChain.h"
+#include "Utils/Logger.h"
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <system_error>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+
+// ROIs up to this many pixels are dispatched one per thread, with the algorithm's own OpenMP
+// regions serialised; at that size a parallel region costs more than it saves. Larger ROIs
+// run one after another and parallelise inside the algorithm.
+const long long ROI_PARALLEL_MAX_PIXELS = 512 * 512;
+
+// Shortest gap between two StepProgress events of a step; about what a progress bar can show
+const int PROGRESS_INTERVAL_MS = 40;
+
+ImageRect ClipToImage(const ImageRect& rc, int width, int height)
+{
+    return ImageRect(std::max(0, rc.left), std::max(0, rc.top), std::min(width, rc.right), std::min(height, rc.bottom));
+}
+
+bool Intersects(const ImageRect& a, const ImageRect& b)
+{
+    return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+// ROI 'index' (clipped to rc) of a composited step. View-capable algorithms write straight
+// into output; others go through the ROI's roiIn/roiOut slot, pasted only when bPaste is set.
+bool ProcessROI(CAlgorithmBase* pStep, const CImageBuffer& input, CImageBuffer& output, const ImageRect& rc,
+                PipelineBuffers& bufs, int index, bool bPaste)
+{
+    CProfileScope span("roi");
+    if (span.IsActive())
+        span.SetName(pStep->GetName() + L" ROI " + std::to_wstring(index + 1));
+
+    if (pStep->SupportsViews())
+        return pStep->ProcessView(input.GetConstView(rc), output.GetView(rc));
+
+    CImageBuffer& roiOut = bufs.roiOut[index];
+    if (!input.ExtractRegionInto(rc, bufs.roiIn[index])) return false;
+    if (!pStep->Process(bufs.roiIn[index], roiOut) || !roiOut.IsValid()) return false;
+    if (bPaste)
+        output.PasteRegion(roiOut, rc.left, rc.top);
+    return true;
+}
+
+} // namespace
 
 CSequenceManager::CSequenceManager()
-    : m_pThread(nullptr)
+    : m_nResumeStep(0)
+    , m_nHistoryBudget(0)
+    , m_eSpillMode(HistorySpillMode::Disk)
+    , m_nSpillToken(std::random_device()())
+    , m_nHistoryClock(0)
+    , m_historyStats()
     , m_bRunning(false)
     , m_bStopRequested(false)
-    , m_hNotifyWnd(NULL)
+    , m_pObserver(nullptr)
+    , m_stepProgress(*this)
+    , m_nTileSize(1024)
+    , m_bFusePointwise(true)
+    , m_bStripes(false)
+    , m_nStripeCacheBytes(0)
 {
 }
 
@@ -14,17 +78,20 @@ CSequenceManager::~CSequenceManager()
 {
     StopExecution();
     ClearSteps();
+
+    std::lock_guard<std::mutex> lock(m_cs);
+    ClearHistory();   // deletes the spill files
 }
 
 void CSequenceManager::AddStep(CAlgorithmBase* pAlg)
 {
-    CSingleLock lock(&m_cs, TRUE);
+    std::lock_guard<std::mutex> lock(m_cs);
     m_steps.push_back(pAlg);
 }
 
 void CSequenceManager::RemoveStep(int index)
 {
-    CSingleLock lock(&m_cs, TRUE);
+    std::lock_guard<std::mutex> lock(m_cs);
     if (index < 0 || index >= (int)m_steps.size()) return;
     delete m_steps[index];
     m_steps.erase(m_steps.begin() + index);
@@ -32,34 +99,34 @@ void CSequenceManager::RemoveStep(int index)
 
 void CSequenceManager::MoveStepUp(int index)
 {
-    CSingleLock lock(&m_cs, TRUE);
+    std::lock_guard<std::mutex> lock(m_cs);
     if (index <= 0 || index >= (int)m_steps.size()) return;
     std::swap(m_steps[index], m_steps[index - 1]);
 }
 
 void CSequenceManager::MoveStepDown(int index)
 {
-    CSingleLock lock(&m_cs, TRUE);
+    std::lock_guard<std::mutex> lock(m_cs);
     if (index < 0 || index >= (int)m_steps.size() - 1) return;
     std::swap(m_steps[index], m_steps[index + 1]);
 }
 
 void CSequenceManager::ClearSteps()
 {
-    CSingleLock lock(&m_cs, TRUE);
+    std::lock_guard<std::mutex> lock(m_cs);
     for (auto* p : m_steps) delete p;
     m_steps.clear();
 }
 
 int CSequenceManager::GetStepCount() const
 {
-    CSingleLock lock(&m_cs, TRUE);
+    std::lock_guard<std::mutex> lock(m_cs);
     return (int)m_steps.size();
 }
 
 CAlgorithmBase* CSequenceManager::GetStep(int index) const
 {
-    CSingleLock lock(&m_cs, TRUE);
+    std::lock_guard<std::mutex> lock(m_cs);
     if (index < 0 || index >= (int)m_steps.size()) return nullptr;
     return m_steps[index];
 }
@@ -70,172 +137,682 @@ void CSequenceManager::RemoveROI(int index)
         m_rcROIs.erase(m_rcROIs.begin() + index);
 }
 
+void CSequenceManager::BeginRun(const CImageBuffer& input)
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    m_inputImage = input;              // shares the caller's pixels (copy-on-write)
+
+    // Keep the frames of the unchanged prefix; everything after it is recomputed. A full run
+    // starts a new history, so frame 0 takes the current input and ROI fingerprint.
+    m_nResumeStep = FindResumeStep(input);
+    TruncateHistory(m_nResumeStep > 0 ? m_nResumeStep + 1 : 0);
+
+    // The steps that run drop their references to last run's frames, so every slot they write
+    // is unshared again and Create() keeps its block
+    for (int i = m_nResumeStep; i < (int)m_stepBufs.size(); i++)
+        m_stepBufs[i].stepInput.Release();
+    m_history.reserve(m_steps.size() + 1);
+    if (m_history.empty())
+        PushHistory(m_inputImage, InputFingerprint(m_inputImage, m_rcROIs));   // history[0] = original
+    m_historyROIs = m_rcROIs;
+}
+
 bool CSequenceManager::StartExecution(const CImageBuffer& input)
 {
     if (m_bRunning) return false;
     if (!input.IsValid()) return false;
 
-    if (m_pThread != nullptr)
-    {
-        ::WaitForSingleObject(m_pThread->m_hThread, 0);
-        delete m_pThread;
-        m_pThread = nullptr;
-    }
+    // Reap the previous (finished) worker
+    if (m_thread.joinable())
+        m_thread.join();
 
-    m_inputImage.CopyDataFrom(input);  // reuse m_inputImage allocation (0 malloc after 1st run)
-    m_history.clear();
-    m_history.push_back(m_inputImage.Clone());  // history[0] = original
+    BeginRun(input);
 
     m_bRunning = true;
     m_bStopRequested = false;
 
-    m_pThread = AfxBeginThread(ExecuteThread, this, THREAD_PRIORITY_NORMAL, 0, CREATE_SUSPENDED, NULL);
-    if (m_pThread == nullptr)
+    try
+    {
+        m_thread = std::thread([this]() { DoExecute(); });
+    }
+    catch (const std::system_error&)
     {
         m_bRunning = false;
         return false;
     }
-
-    m_pThread->m_bAutoDelete = FALSE;
-    m_pThread->ResumeThread();
     return true;
 }
 
-void CSequenceManager::StopExecution()
+bool CSequenceManager::Execute(const CImageBuffer& input)
 {
-    if (!m_bRunning && m_pThread == nullptr) return;
+    if (m_bRunning) return false;
+    if (!input.IsValid()) return false;
+
+    if (m_thread.joinable())
+        m_thread.join();
+
+    BeginRun(input);
 
+    m_bRunning = true;
+    m_bStopRequested = false;
+    return DoExecute();
+}
+
+void CSequenceManager::StopExecution()
+{
     m_bStopRequested = true;
 
-    if (m_pThread != nullptr)
+    if (m_thread.joinable())
+        m_thread.join();
+
+    m_bRunning = false;
+}
+
+bool CSequenceManager::PrepareBuffers(int width, int height, int channels, PixelDepth depth)
+{
+    if (m_bRunning || width <= 0 || height <= 0 || channels <= 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_cs);
+    const int stepCount = (int)m_steps.size();
+    if ((int)m_stepBufs.size() < stepCount)
+        m_stepBufs.resize(stepCount);
+
+    // Blank probe frame; with ROIs it is covered by one ROI, so each step composites as in a run
+    const int probeW = std::min(width, 64), probeH = std::min(height, 64);
+    CImageBuffer frame;
+    if (!frame.Create(probeW, probeH, channels, depth)) return false;
+    memset(frame.GetData(), 0, (size_t)frame.GetStride() * probeH);
+    std::vector<ImageRect> probeROIs;
+    if (!m_rcROIs.empty())
+        probeROIs.push_back(ImageRect(0, 0, probeW, probeH));
+
+    for (int i = 0; i < stepCount; i++)
     {
-        ::WaitForSingleObject(m_pThread->m_hThread, 5000);
-        delete m_pThread;
-        m_pThread = nullptr;
+        std::unique_ptr<CPointwiseChain> pChain;
+        if (m_bFusePointwise)
+            pChain.reset(CPointwiseChain::Fuse(&m_steps[i], stepCount - i, frame, !m_rcROIs.empty()));
+        CAlgorithmBase* pRun = pChain ? pChain.get() : m_steps[i];
+        const int last = i + (pChain ? pChain->GetStepCount() : 1) - 1;
+
+        PipelineBuffers probeBufs;
+        CImageBuffer out;
+        if (!ProcessStep(pRun, frame, out, probeROIs, probeBufs) || !out.IsValid())
+        {
+            CLogger::Info(L"CSequenceManager::PrepareBuffers - Step %d (%ls) failed on the probe frame",
+                i + 1, m_steps[i]->GetName().c_str());
+            return false;
+        }
+
+        // The buffers DoExecute() works in for this step, at full size
+        PipelineBuffers& bufs = m_stepBufs[last];
+        PixelDepth  inDepth;
+        PixelLayout inLayout;
+        GetStepInputFormat(pRun, frame, inDepth, inLayout);
+        bool bOk = bufs.stepOutput.Create(width, height, out.GetChannels(), out.GetDepth(), out.GetLayout());
+        if (inDepth != frame.GetDepth() || inLayout != frame.GetLayout())
+            bOk = bOk && bufs.converted.Create(width, height, channels, inDepth, inLayout);
+        if (last == stepCount - 1 && out.IsPlanar())
+            bOk = bOk && bufs.interleaved.Create(width, height, out.GetChannels(), out.GetDepth(), PixelLayout::Interleaved);
+        if (!m_rcROIs.empty() && !pRun->SupportsViews())
+        {
+            const CImageBuffer& roiOut = probeBufs.roiOut[0];
+            bufs.roiIn.resize(m_rcROIs.size());
+            bufs.roiOut.resize(m_rcROIs.size());
+            for (size_t j = 0; j < m_rcROIs.size() && bOk; j++)
+            {
+                const ImageRect rc = ClipToImage(m_rcROIs[j], width, height);
+                if (rc.IsRectEmpty()) continue;
+                bOk = bufs.roiIn[j].Create(rc.Width(), rc.Height(), channels, inDepth, inLayout) &&
+                      bufs.roiOut[j].Create(rc.Width(), rc.Height(), roiOut.GetChannels(), roiOut.GetDepth(), roiOut.GetLayout());
+            }
+        }
+        if (!bOk)
+            return false;
+
+        channels = out.GetChannels();
+        frame = out;
+        i = last;
     }
+    return true;
+}
 
-    m_bRunning = false;
+void CSequenceManager::Notify(SequenceEvent evt, int index, int count, long long elapsedUs, int permille)
+{
+    if (!m_pObserver)
+        return;
+    SequenceEventRecord rec;
+    rec.eType = evt;
+    rec.nIndex = index;
+    rec.nCount = count;
+    rec.nTimeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_tRunStart).count();
+    rec.nElapsedUs = elapsedUs;
+    rec.nPermille = permille;
+    m_pObserver->OnSequenceEvent(rec);
+}
+
+void CSequenceManager::CStepProgress::Begin(int nStep, int nCount)
+{
+    m_nStep = nStep;
+    m_nCount = nCount;
+    m_tLast = std::chrono::steady_clock::now();
+}
+
+void CSequenceManager::CStepProgress::OnProgress(int nPermille)
+{
+    // A fast step finishes before the first interval and reports nothing
+    const std::chrono::steady_clock::time_point tNow = std::chrono::steady_clock::now();
+    if (tNow - m_tLast < std::chrono::milliseconds(PROGRESS_INTERVAL_MS))
+        return;
+    m_tLast = tNow;
+    m_owner.Notify(SequenceEvent::StepProgress, m_nStep, m_nCount, 0, nPermille);
+}
+
+bool CSequenceManager::ProcessStep(CAlgorithmBase* pStep, const CImageBuffer& stepInput, CImageBuffer& output,
+                                   const std::vector<ImageRect>& rois, PipelineBuffers& bufs,
+                                   const std::atomic<bool>* pCancel, IProgressSink* pProgress)
+{
+    if (!pStep || !stepInput.IsValid()) return false;
+
+    CProfileScope span("step");
+    if (span.IsActive())
+        span.SetName(pStep->GetName());
+
+    // The kernels poll the flag themselves; ROI clones copy it. Progress is passed on for
+    // whole-frame runs only: concurrent ROIs would each count from zero.
+    const ProcessControl prevControl = pStep->GetProcessControl();
+    ProcessControl control;
+    control.pCancel   = pCancel;
+    control.pProgress = rois.empty() ? pProgress : nullptr;
+    pStep->SetProcessControl(control);
+    const bool bOk = RunStep(pStep, stepInput, output, rois, bufs, pCancel);
+    pStep->SetProcessControl(prevControl);
+    return bOk;
+}
+
+bool CSequenceManager::RunStep(CAlgorithmBase* pStep, const CImageBuffer& stepInput, CImageBuffer& output,
+                               const std::vector<ImageRect>& rois, PipelineBuffers& bufs,
+                               const std::atomic<bool>* pCancel)
+{
+
+    // 8-bit-only algorithms see an 8-bit copy of a U16/F32 frame; planar-preferring ones a
+    // planar frame (converted once at the start of a planar run, passed through after that)
+    PixelDepth  depth  = stepInput.GetDepth();
+    PixelLayout layout = stepInput.GetLayout();
+    GetStepInputFormat(pStep, stepInput, depth, layout);
+    const bool bConvert = (depth != stepInput.GetDepth() || layout != stepInput.GetLayout());
+    if (bConvert && !stepInput.ConvertTo(depth, layout, bufs.converted)) return false;
+    const CImageBuffer& input = bConvert ? bufs.converted : stepInput;
+
+    // No ROI: process full image into pre-alloc output (smart Create inside Process)
+    if (rois.empty())
+        return pStep->Process(input, output);
+
+    // Composite: copy input into output, then overwrite each ROI region. View-capable
+    // algorithms are zero-copy: they read the ROI (and its halo) from input and write it
+    // straight into output; others go through the per-ROI slots bufs.roiIn/roiOut.
+    if (!output.CopyDataFrom(input)) return false;
+
+    const int nROIs = (int)rois.size();
+    const bool bViews = pStep->SupportsViews();
+    if (!bViews)
+    {
+        if ((int)bufs.roiIn.size()  < nROIs) bufs.roiIn.resize(nROIs);
+        if ((int)bufs.roiOut.size() < nROIs) bufs.roiOut.resize(nROIs);
+    }
+
+    // Small ROIs run concurrently first. Large ones, and the write-back of ROIs that overlap
+    // another, follow in list order, so where ROIs overlap the later one still wins.
+    std::vector<ImageRect>& clipped = bufs.roiClipped;
+    clipped.resize(nROIs);
+    bufs.roiFlags.assign(2 * nROIs, 0);
+    char* bSmall    = bufs.roiFlags.data();
+    char* bOverlaps = bSmall + nROIs;
+    int nSmall = 0;
+    for (int j = 0; j < nROIs; j++)
+    {
+        clipped[j] = ClipToImage(rois[j], input.GetWidth(), input.GetHeight());
+        if (clipped[j].IsRectEmpty()) continue;   // outside the image: left as it is
+        bSmall[j] = ((long long)clipped[j].Width() * clipped[j].Height() <= ROI_PARALLEL_MAX_PIXELS);
+        nSmall += bSmall[j];
+        for (int k = 0; k < j; k++)
+            if (!clipped[k].IsRectEmpty() && Intersects(clipped[j], clipped[k]))
+                bOverlaps[j] = bOverlaps[k] = 1;
+    }
+
+    std::atomic<bool> bFailed(false);
+    if (nSmall > 0)
+    {
+        #pragma omp parallel if (nSmall > 1)
+        {
+            // Algorithms may keep scratch buffers in members, so every extra thread runs a clone
+            std::unique_ptr<CAlgorithmBase> pClone;
+            CAlgorithmBase* pAlg = pStep;
+#ifdef _OPENMP
+            if (omp_get_thread_num() > 0)
+            {
+                pClone.reset(pStep->Clone());
+                pAlg = pClone.get();
+            }
+            omp_set_num_threads(1);   // regions opened by the algorithm stay on this thread
+#endif
+            #pragma omp for schedule(dynamic)
+            for (int j = 0; j < nROIs; j++)
+            {
+                if (!bSmall[j] || (bViews && bOverlaps[j])) continue;
+                if (bFailed || (pCancel && *pCancel)) continue;
+                if (!ProcessROI(pAlg, input, output, clipped[j], bufs, j, !bOverlaps[j]))
+                    bFailed = true;
+            }
+        }
+    }
+
+    for (int j = 0; j < nROIs && !bFailed; j++)
+    {
+        if (pCancel && *pCancel) return false;
+        if (clipped[j].IsRectEmpty() || (bSmall[j] && !bOverlaps[j])) continue;
+
+        if (bSmall[j] && !bViews)
+            output.PasteRegion(bufs.roiOut[j], clipped[j].left, clipped[j].top);   // processed above
+        else if (!ProcessROI(pStep, input, output, clipped[j], bufs, j, true))
+            return false;
+    }
+    return !bFailed && !(pCancel && *pCancel);
 }
 
-UINT CSequenceManager::ExecuteThread(LPVOID pParam)
+void CSequenceManager::GetStepInputFormat(const CAlgorithmBase* pStep, const CImageBuffer& input,
+                                          PixelDepth& depth, PixelLayout& layout)
 {
-    CSequenceManager* pMgr = reinterpret_cast<CSequenceManager*>(pParam);
-    if (pMgr) pMgr->DoExecute();
-    return 0;
+    depth  = pStep->SupportsDepth(input.GetDepth()) ? input.GetDepth() : PixelDepth::U8;
+    layout = (pStep->PrefersPlanar() && input.GetChannels() > 1) ? PixelLayout::Planar : PixelLayout::Interleaved;
 }
 
-void CSequenceManager::DoExecute()
+bool CSequenceManager::DoExecute()
 {
     int stepCount = 0;
+    int firstStep = 0;
+    unsigned long long fingerprint = 0;
+    // The ROI set the fingerprints were taken with; only BeginRun() writes it, never during a run
+    const std::vector<ImageRect>& rois = m_historyROIs;
     {
-        CSingleLock lock(&m_cs, TRUE);
+        std::lock_guard<std::mutex> lock(m_cs);
         stepCount = (int)m_steps.size();
+        firstStep = m_nResumeStep;
+        fingerprint = m_history.back().nFingerprint;
+
+        // Ensure we have enough pre-allocated buffer sets (persistent across runs). Under the
+        // lock: history eviction on the GUI thread releases the buffers that share evicted frames.
+        if ((int)m_stepBufs.size() < stepCount)
+            m_stepBufs.resize(stepCount);
+        if ((int)m_chains.size() < stepCount)
+            m_chains.resize(stepCount);
     }
 
-    // Snapshot the ROI list (thread-safe copy, no lock needed during processing)
-    std::vector<CRect> rois = m_rcROIs;
-    bool bHasROIs = !rois.empty();
+    // Pool counters at run start; a warmed-up run should report zero misses
+    m_tRunStart = std::chrono::steady_clock::now();
+    const ImagePoolStats poolStart = CBufferPool::GetInstance().GetStats();
 
-    // Ensure we have enough pre-allocated buffer sets (persistent across runs)
-    if ((int)m_stepBufs.size() < stepCount)
-        m_stepBufs.resize(stepCount);
+    if (firstStep > 0 && firstStep == stepCount)
+        CLogger::Info(L"CSequenceManager - All %d steps unchanged, nothing to run", stepCount);
+    else if (firstStep > 0)
+        CLogger::Info(L"CSequenceManager - Steps 1-%d unchanged, resuming at step %d", firstStep, firstStep + 1);
+    for (int i = 0; i < firstStep; i++)
+        Notify(SequenceEvent::StepReused, i, stepCount);
 
-    for (int i = 0; i < stepCount; i++)
+    for (int i = firstStep; i < stepCount; i++)
     {
         if (m_bStopRequested) break;
 
-        // Post progress
-        if (m_hNotifyWnd && ::IsWindow(m_hNotifyWnd))
-            ::PostMessage(m_hNotifyWnd, WM_SEQUENCE_PROGRESS, (WPARAM)(i + 1), (LPARAM)stepCount);
+        // The step's time counts from its Progress event: chain planning and buffer preparation
+        // are part of it
+        const std::chrono::steady_clock::time_point tStepStart = std::chrono::steady_clock::now();
+        Notify(SequenceEvent::Progress, i, stepCount);
+        m_stepProgress.Begin(i, stepCount);
 
-        // Copy input from history into pre-allocated buffer (no malloc after 1st run)
+        // Step input shares the previous history frame (read-only, no copy)
         {
-            CSingleLock lock(&m_cs, TRUE);
+            std::lock_guard<std::mutex> lock(m_cs);
             if (!m_history.empty())
-                m_stepBufs[i].stepInput.CopyDataFrom(m_history.back());
+                m_stepBufs[i].stepInput = m_history.back().image;   // newest frame, never evicted
         }
 
         CImageBuffer& inp = m_stepBufs[i].stepInput;
         if (!inp.IsValid())
         {
-            if (m_hNotifyWnd && ::IsWindow(m_hNotifyWnd))
-                ::PostMessage(m_hNotifyWnd, WM_SEQUENCE_ERROR, (WPARAM)i, 0);
+            Notify(SequenceEvent::Error, i, stepCount);
             m_bRunning = false;
-            return;
+            return false;
         }
 
-        // Get algorithm pointer (brief lock)
+        // Get algorithm pointer and fingerprint the parameters it runs with (brief lock). A run
+        // of steps starting here may execute as one chain, band by band or as one fused pointwise
+        // pass; each step it replaces still gets its own fingerprint and history frame. The
+        // chain decision is reused from the last run unless steps, parameters or format changed.
         CAlgorithmBase* pStep = nullptr;
+        CStepChain* pChain = nullptr;
+        bool bNewChain = false;
+        std::vector<unsigned long long>& fingerprints = m_runFingerprints;
+        fingerprints.clear();
         {
-            CSingleLock lock(&m_cs, TRUE);
-            if (i < (int)m_steps.size()) pStep = m_steps[i];
+            std::lock_guard<std::mutex> lock(m_cs);
+            const int nAvailable = std::min(stepCount, (int)m_steps.size()) - i;
+            if (nAvailable > 0) pStep = m_steps[i];
+            if (pStep && (m_bStripes || m_bFusePointwise))
+            {
+                PlannedChain& plan = m_chains[i];
+                const unsigned long long nKey = ChainFingerprint(&m_steps[i], nAvailable, inp, !rois.empty());
+                if (!plan.bValid || plan.nFingerprint != nKey)
+                {
+                    CStepChain* pNew = nullptr;
+                    if (m_bStripes && rois.empty())
+                    {
+                        pNew = CStripeChain::Build(&m_steps[i], nAvailable, inp, m_bFusePointwise, m_nStripeCacheBytes);
+                    }
+                    if (!pNew && m_bFusePointwise)
+                        pNew = CPointwiseChain::Fuse(&m_steps[i], nAvailable, inp, !rois.empty());
+                    plan.pChain.reset(pNew);
+                    plan.nFingerprint = nKey;
+                    plan.bValid = true;
+                    bNewChain = (pNew != nullptr);
+                }
+                pChain = plan.pChain.get();
+            }
+            const int nCount = pChain ? pChain->GetStepCount() : (pStep ? 1 : 0);
+            for (int k = 0; k < nCount; k++)
+            {
+                fingerprint = StepFingerprint(fingerprint, m_steps[i + k]);
+                fingerprints.push_back(fingerprint);
+            }
         }
 
         if (!pStep)
         {
-            if (m_hNotifyWnd && ::IsWindow(m_hNotifyWnd))
-                ::PostMessage(m_hNotifyWnd, WM_SEQUENCE_ERROR, (WPARAM)i, 0);
+            Notify(SequenceEvent::Error, i, stepCount);
             m_bRunning = false;
-            return;
+            return false;
         }
 
+        // A chain works in the last replaced step's buffers, which hold the frame it outputs
+        const int last = i + (int)fingerprints.size() - 1;
+        CAlgorithmBase* pRun = pChain ? pChain : pStep;
+        PipelineBuffers& bufs = m_stepBufs[last];
+        if (bNewChain)
+            CLogger::Info(L"CSequenceManager - Steps %d-%d run as one chain (%ls): %ls", i + 1, last + 1,
+                pChain->GetName().c_str(), pChain->GetDescription().c_str());
+
         // Prepare ROI buffers (smart Create = no alloc if size unchanged)
-        m_stepBufs[i].Prepare(inp.GetWidth(), inp.GetHeight(), inp.GetChannels(), rois);
-        CImageBuffer& outRef = m_stepBufs[i].stepOutput;
+        PixelDepth  outDepth;
+        PixelLayout outLayout;
+        GetStepInputFormat(pRun, inp, outDepth, outLayout);
+        bufs.Prepare(inp.GetWidth(), inp.GetHeight(), inp.GetChannels(), outDepth, outLayout, rois);
+        CImageBuffer& outRef = bufs.stepOutput;
 
         // Run algorithm WITHOUT holding mutex (allows OpenMP parallelism inside)
-        bool success = false;
-        auto tStepStart = std::chrono::high_resolution_clock::now();
+        bool success = ProcessStep(pRun, inp, outRef, rois, bufs, &m_bStopRequested,
+                                   m_pObserver ? &m_stepProgress : nullptr);
 
-        if (!bHasROIs)
+        // The chain's result is interleaved again; intermediate frames may stay planar
+        CImageBuffer* pResult = &outRef;
+        if (success && last == stepCount - 1 && outRef.IsPlanar())
         {
-            // No ROI: process full image into pre-alloc output (smart Create inside Process)
-            success = pStep->Process(inp, outRef);
+            success = outRef.ConvertLayout(PixelLayout::Interleaved, bufs.interleaved);
+            pResult = &bufs.interleaved;
         }
-        else
+
+        const long long elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - tStepStart).count();
+
+        if (success && pResult->IsValid())
         {
-            // Composite: copy input into output, then overwrite each ROI region
-            success = outRef.CopyDataFrom(inp);
-            if (success)
             {
-                for (int j = 0; j < (int)rois.size(); j++)
+                std::lock_guard<std::mutex> lock(m_cs);
+                for (int k = i; k < last; k++)
                 {
-                    if (m_bStopRequested) { success = false; break; }
-                    if (!inp.ExtractRegionInto(rois[j], m_stepBufs[i].roiIn[j])) continue;
-                    if (pStep->Process(m_stepBufs[i].roiIn[j], m_stepBufs[i].roiOut[j])
-                        && m_stepBufs[i].roiOut[j].IsValid())
-                    {
-                        outRef.PasteRegion(m_stepBufs[i].roiOut[j], rois[j].left, rois[j].top);
-                    }
-                    else { success = false; break; }
+                    int channels;
+                    PixelDepth depth;
+                    PixelLayout layout;
+                    pChain->GetFrameFormat(k - i, channels, depth, layout);
+                    PushDroppedHistory(inp.GetWidth(), inp.GetHeight(), channels, depth, layout, fingerprints[k - i]);
                 }
+                // History shares outRef's storage; next run's write into outRef
+                // detaches only if a viewer still holds this frame
+                PushHistory(*pResult, fingerprints.back());
+                EnforceHistoryBudget(-1);
             }
+            for (int k = i; k < last; k++)
+                Notify(SequenceEvent::StepDone, k, stepCount);
+            Notify(SequenceEvent::StepDone, last, stepCount, elapsedUs);
+            i = last;
+        }
+        else
+        {
+            // A step cancelled by StopExecution fails too; that is not an error
+            Notify(m_bStopRequested ? SequenceEvent::Stopped : SequenceEvent::Error, i, stepCount);
+            m_bRunning = false;
+            return false;
         }
+    }
+
+    const ImagePoolStats poolEnd = CBufferPool::GetInstance().GetStats();
+    CLogger::Info(L"CSequenceManager - Run finished: pool hits %llu, misses %llu, peak %llu MB",
+        poolEnd.nHits - poolStart.nHits, poolEnd.nMisses - poolStart.nMisses, poolEnd.nPeakBytes >> 20);
+    const HistoryStats history = GetHistoryStats();
+    if (history.nBudgetBytes > 0)
+        CLogger::Info(L"CSequenceManager - History: %d of %d frames resident (%llu / %llu MB), %d spilled, %d dropped",
+            history.nResidentFrames, history.nFrames, history.nResidentBytes >> 20, history.nBudgetBytes >> 20,
+            history.nSpilledFrames, history.nDroppedFrames);
 
-        auto tStepEnd = std::chrono::high_resolution_clock::now();
-        long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(tStepEnd - tStepStart).count();
+    m_bRunning = false;
+
+    if (m_bStopRequested)
+    {
+        Notify(SequenceEvent::Stopped, 0, stepCount);
+        return false;
+    }
+
+    Notify(SequenceEvent::Complete, 0, stepCount);
+    return true;
+}
 
-        if (success && outRef.IsValid())
+bool CSequenceManager::CanExecuteTiled(int* pHalo) const
+{
+    std::lock_guard<std::mutex> lock(m_cs);
+    int nHalo = 0;
+    for (int i = 0; i < (int)m_steps.size(); i++)
+    {
+        int nRadius = m_steps[i]->GetNeighbourhoodRadius();
+        if (nRadius < 0)
         {
+            CLogger::Error(L"CSequenceManager - Step %d (%ls) needs the whole frame and cannot run tiled",
+                i + 1, m_steps[i]->GetName().c_str());
+            return false;
+        }
+        nHalo += nRadius;
+    }
+    if (pHalo) *pHalo = nHalo;
+    return true;
+}
+
+bool CSequenceManager::ExecuteTiled(const CImageBuffer& input, const TileSinkFn& sink)
+{
+    if (m_bRunning) return false;
+    if (!input.IsValid() || !sink) return false;
+
+    if (m_thread.joinable())
+        m_thread.join();
+
+    // Every step widens the context an output pixel depends on by its own radius, so a tile
+    // extended by the sum is exact in its core. Clamped kernels only differ from a full-frame
+    // run inside that margin; at the frame border the tile edge is the real border.
+    int nHalo = 0;
+    if (!CanExecuteTiled(&nHalo))
+        return false;
+
+    std::vector<CAlgorithmBase*> steps;
+    {
+        std::lock_guard<std::mutex> lock(m_cs);
+        steps = m_steps;
+    }
+
+    m_bRunning = true;
+    m_bStopRequested = false;
+
+    // Keep the core at least 4x the halo so the overlap costs at most ~2.25x the core area
+    const int nWidth  = input.GetWidth();
+    const int nHeight = input.GetHeight();
+    int nCore = std::max(std::max(64, m_nTileSize), 4 * nHalo);
+    nCore = std::min(nCore, std::max(nWidth, nHeight));
+    const int nTilesX = (nWidth  + nCore - 1) / nCore;
+    const int nTilesY = (nHeight + nCore - 1) / nCore;
+    const int nTiles  = nTilesX * nTilesY;
+
+    m_tRunStart = std::chrono::steady_clock::now();
+
+    // Two ping-pong buffers hold the whole chain; they are sized by the first tile and reused.
+    // The third receives a converted copy where a step takes another depth or layout, and the
+    // tile is interleaved again before it goes to the sink.
+    CImageBuffer tileBufs[2];
+    CImageBuffer tileConverted;
+    const int nSteps = (int)steps.size();
+
+    // Every tile reaches a step in the same format, so each start step is fused once, at the
+    // first tile, and the chain serves the rest
+    std::vector<std::unique_ptr<CPointwiseChain>> fusedChains(nSteps);
+    std::vector<bool> bFusePlanned(nSteps, false);
+    const bool bFuse = m_bFusePointwise;
+    bool success = true;
+    bool bStopped = false;
+    for (int t = 0; t < nTiles && success; t++)
+    {
+        if (m_bStopRequested) { success = false; bStopped = true; break; }
+
+        ImageRect rcCore;
+        rcCore.left   = (t % nTilesX) * nCore;
+        rcCore.top    = (t / nTilesX) * nCore;
+        rcCore.right  = std::min(nWidth,  rcCore.left + nCore);
+        rcCore.bottom = std::min(nHeight, rcCore.top  + nCore);
+
+        ImageRect rcPadded(std::max(0, rcCore.left - nHalo), std::max(0, rcCore.top - nHalo),
+                           std::min(nWidth, rcCore.right + nHalo), std::min(nHeight, rcCore.bottom + nHalo));
+
+        if (!input.ExtractRegionInto(rcPadded, tileBufs[0]))
+        {
+            Notify(SequenceEvent::Error, 0, nSteps);
+            success = false;
+            break;
+        }
+
+        int nCur = 0;
+        for (int i = 0; i < (int)steps.size(); i++)
+        {
+            CImageBuffer& out = tileBufs[nCur ^ 1];
+            const CImageBuffer* pIn = &tileBufs[nCur];
+
+            // Runs of pointwise steps go through the tile once; no history to fill in here
+            if (bFuse && !bFusePlanned[i])
             {
-                CSingleLock lock(&m_cs, TRUE);
-                // Clone outRef into history (outRef stays alive for next run's reuse)
-                m_history.push_back(outRef.Clone());
+                fusedChains[i].reset(CPointwiseChain::Fuse(&steps[i], nSteps - i, *pIn, false));
+                bFusePlanned[i] = true;
+            }
+            CPointwiseChain* pFused = fusedChains[i].get();
+            CAlgorithmBase* pStep = pFused ? pFused : steps[i];
+
+            PixelDepth  depth;
+            PixelLayout layout;
+            GetStepInputFormat(pStep, *pIn, depth, layout);
+            if (depth != pIn->GetDepth() || layout != pIn->GetLayout())
+            {
+                if (!pIn->ConvertTo(depth, layout, tileConverted))
+                {
+                    Notify(SequenceEvent::Error, i, nSteps);
+                    success = false;
+                    break;
+                }
+                pIn = &tileConverted;
             }
-            if (m_hNotifyWnd && ::IsWindow(m_hNotifyWnd))
-                ::PostMessage(m_hNotifyWnd, WM_SEQUENCE_STEP_DONE, (WPARAM)i, (LPARAM)elapsedMs);
+            // Tiles are small, so only the stop flag goes to the kernels
+            ProcessControl control;
+            control.pCancel = &m_bStopRequested;
+            pStep->SetProcessControl(control);
+            CProfileScope span("step");
+            if (span.IsActive())
+                span.SetName(pStep->GetName());
+            const bool bStepOk = pStep->Process(*pIn, out);
+            pStep->SetProcessControl(ProcessControl());
+            if (!bStepOk || !out.IsValid() ||
+                out.GetWidth() != rcPadded.Width() || out.GetHeight() != rcPadded.Height())
+            {
+                bStopped = m_bStopRequested;
+                if (!bStopped)
+                    Notify(SequenceEvent::Error, i, nSteps);
+                success = false;
+                break;
+            }
+            nCur ^= 1;
+            if (pFused)
+                i += pFused->GetStepCount() - 1;
         }
-        else
+        if (!success) break;
+
+        if (tileBufs[nCur].IsPlanar())
         {
-            if (m_hNotifyWnd && ::IsWindow(m_hNotifyWnd))
-                ::PostMessage(m_hNotifyWnd, WM_SEQUENCE_ERROR, (WPARAM)i, 0);
-            m_bRunning = false;
-            return;
+            if (!tileBufs[nCur].ConvertLayout(PixelLayout::Interleaved, tileBufs[nCur ^ 1]))
+            {
+                Notify(SequenceEvent::Error, nSteps - 1, nSteps);
+                success = false;
+                break;
+            }
+            nCur ^= 1;
         }
+
+        ImageRect rcLocal(rcCore.left - rcPadded.left, rcCore.top - rcPadded.top,
+                          rcCore.right - rcPadded.left, rcCore.bottom - rcPadded.top);
+        if (!sink(rcCore, tileBufs[nCur].GetConstView(rcLocal)))
+        {
+            CLogger::Error(L"CSequenceManager - Tile sink rejected tile %d of %d", t + 1, nTiles);
+            Notify(SequenceEvent::Error, nSteps - 1, nSteps);
+            success = false;
+            break;
+        }
+        Notify(SequenceEvent::TileDone, t, nTiles);
     }
 
+    const long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - m_tRunStart).count();
+    CLogger::Info(L"CSequenceManager - Tiled run %ls: %d x %d in %d tiles of %d px (halo %d), %lld ms",
+        success ? L"finished" : L"stopped", nWidth, nHeight, nTiles, nCore, nHalo, elapsedMs);
+
     m_bRunning = false;
+    if (!success)
+    {
+        if (bStopped)
+            Notify(SequenceEvent::Stopped, 0, nSteps);
+        return false;
+    }
+
+    Notify(SequenceEvent::Complete, 0, nSteps);
+    return true;
+}
 
-    if (!m_bStopRequested && m_hNotifyWnd && ::IsWindow(m_hNotifyWnd))
-        ::PostMessage(m_hNotifyWnd, WM_SEQUENCE_COMPLETE, 0, 0);
+bool CSequenceManager::ExecuteTiled(const CImageBuffer& input, CImageBuffer& output)
+{
+    // The chain decides the output channel count, so the frame is created from the first tile
+    bool bCreated = false;
+    return ExecuteTiled(input, [&](const ImageRect& rcTile, const ConstImageView& tile) -> bool
+    {
+        if (!bCreated)
+        {
+            if (!output.Create(input.GetWidth(), input.GetHeight(), tile.nChannels, tile.eDepth)) return false;
+            bCreated = true;
+        }
+        ImageView dst = output.GetView(rcTile);
+        if (dst.nWidth != tile.nWidth || dst.nHeight != tile.nHeight || dst.nChannels != tile.nChannels ||
+            dst.eDepth != tile.eDepth)
+            return false;
+        const size_t rowBytes = (size_t)tile.nWidth * tile.nChannels * PixelDepthBytes(tile.eDepth);
+        for (int y = 0; y < tile.nHeight; y++)
+            memcpy(dst.Row(y), tile.Row(y), rowBytes);
+        return true;
+    });
 }
@@ -1,31 +1,71 @@
 #pragma once
-#include "stdafx.h"
+#include "Core/CoreTypes.h"
 #include "Core/ImageBuffer.h"
+#include "Core/SequenceEvents.h"
+#include "Core/StepChain.h"
 #include "Algorithm/AlgorithmBase.h"
-#include "Utils/CommonTypes.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
+// Receives each finished tile of a tiled run; rcTile is where it belongs in the output frame.
+// Returning false aborts the run (e.g. on a write error).
+typedef std::function<bool(const ImageRect& rcTile, const ConstImageView& tile)> TileSinkFn;
+
+// Where an evicted history frame goes. Disk writes it to a spill file (QOI for 8-bit RGB,
+// .vraw otherwise) and reads it back on demand. Regenerate drops it and re-runs the steps
+// from the nearest earlier frame still available; frames whose steps changed since the run
+// (their fingerprint no longer matches) cannot be rebuilt and are spilled instead.
+enum class HistorySpillMode { Disk, Regenerate };
+
+struct HistoryStats
+{
+    unsigned long long nBudgetBytes;        // 0 = unlimited
+    unsigned long long nResidentBytes;      // pixels of history frames held in memory
+    unsigned long long nPeakResidentBytes;  // high-water mark of nResidentBytes
+    unsigned long long nSpillFileBytes;     // size of the current spill files on disk
+    int nFrames;                            // frames in the history (resident or not)
+    int nResidentFrames;
+    int nSpilledFrames;                     // evicted, on disk
+    int nDroppedFrames;                     // evicted, rebuilt by re-running steps
+    unsigned long long nEvictions;          // frames removed from memory
+    unsigned long long nSpillWrites;        // spill files written
+    unsigned long long nReloads;            // frames read back from spill files
+    unsigned long long nRegenerations;      // frames rebuilt by re-running steps
+    unsigned long long nOverBudget;         // budget passes that ran out of evictable frames
+};
+
 // Pre-allocated buffer set for one pipeline step.
 // Buffers are kept alive between runs so OS pages stay warm (eliminates page faults).
+// In the sequence, stepOutput (or interleaved, for the last step of a planar run) is also the
+// step's history slot: the history frame shares it, and the next run writes it in place.
 struct PipelineBuffers
 {
-    CImageBuffer              stepInput;   // copy of previous step's output
+    CImageBuffer              stepInput;   // shares previous step's output (read-only)
     CImageBuffer              stepOutput;  // this step's result
-    std::vector<CImageBuffer> roiIn;       // per-ROI extracted inputs
-    std::vector<CImageBuffer> roiOut;      // per-ROI algorithm outputs
+    CImageBuffer              converted;   // stepInput in the depth/layout the algorithm runs in
+    CImageBuffer              interleaved; // planar output of the chain's last step, re-interleaved
+    std::vector<CImageBuffer> roiIn;       // per-ROI extracted inputs (non-view algorithms)
+    std::vector<CImageBuffer> roiOut;      // per-ROI algorithm outputs (non-view algorithms)
+    std::vector<ImageRect>    roiClipped;  // ProcessStep's per-call ROI bookkeeping, kept so a
+    std::vector<char>         roiFlags;    // rerun does not allocate it again
 
-    // Ensure all buffers are at least the right size; reallocates only on dimension change.
-    void Prepare(int w, int h, int ch, const std::vector<CRect>& rois)
+    // Ensure the output buffer is the right size; reallocates only on dimension change.
+    // A buffer of the right size is left to the algorithm's own Create(), which keeps a
+    // different channel count or depth (e.g. sized by PrepareBuffers) instead of flipping it.
+    // stepInput is not touched: it shares a history frame and Create() would discard it.
+    // ROI buffers are sized lazily by ExtractRegionInto/Process, and only when needed.
+    void Prepare(int w, int h, int ch, PixelDepth depth, PixelLayout layout, const std::vector<ImageRect>& rois)
     {
-        stepInput.Create(w, h, ch);
-        stepOutput.Create(w, h, ch);
+        if (!stepOutput.IsValid() || stepOutput.GetWidth() != w || stepOutput.GetHeight() != h)
+            stepOutput.Create(w, h, ch, depth, layout);
         if (roiIn.size()  != rois.size()) roiIn.resize(rois.size());
         if (roiOut.size() != rois.size()) roiOut.resize(rois.size());
-        for (int j = 0; j < (int)rois.size(); j++)
-        {
-            roiIn[j].Create(rois[j].Width(), rois[j].Height(), ch);
-            roiOut[j].Create(rois[j].Width(), rois[j].Height(), ch);
-        }
     }
 };
 
@@ -34,7 +74,9 @@ public:
     CSequenceManager();
     ~CSequenceManager();
 
-    void SetNotifyWnd(HWND hWnd) { m_hNotifyWnd = hWnd; }
+    // Receives the run's events (see SequenceEvent) on the thread that executes it; not owned,
+    // nullptr for none. Set while no run is active.
+    void SetObserver(ISequenceObserver* pObserver) { m_pObserver = pObserver; }
 
     // Step management
     void AddStep(CAlgorithmBase* pAlg);  // takes ownership
@@ -45,41 +87,200 @@ public:
     int GetStepCount() const;
     CAlgorithmBase* GetStep(int index) const;
 
-    // Execution
-    bool StartExecution(const CImageBuffer& input);
+    // Execution. Every history frame carries a fingerprint of everything that produced it:
+    // the input block and geometry, the ROI set, and the type and parameter values of each step
+    // up to it. A run resumes after the longest prefix of steps whose fingerprints match the
+    // current history, reusing those outputs (StepReused events) instead of recomputing them.
+    bool StartExecution(const CImageBuffer& input);    // asynchronous (worker thread)
+    bool Execute(const CImageBuffer& input);           // synchronous, on the calling thread
     void StopExecution();
     bool IsRunning() const { return m_bRunning; }
 
-    // Results
-    const std::vector<CImageBuffer>& GetHistory() const { return m_history; }
+    // Sizes the step buffers for frames of this format ahead of the first run, so that run
+    // allocates no step output, conversion or ROI buffer (scratch memory the algorithms take
+    // inside Process still comes from the pool). Each step's output format is learnt by
+    // running the steps once over a small blank frame; fusion is mirrored, stripe chains are
+    // not. Call again after changing the steps, ROIs or frame format; false if not possible.
+    bool PrepareBuffers(int width, int height, int channels, PixelDepth depth = PixelDepth::U8);
+
+    // Pointwise fusion (on by default): a run of two or more consecutive pointwise steps on an
+    // 8-bit frame executes as one CPointwiseChain pass, in full-frame and tiled runs alike.
+    // Only the run's last frame is computed; the frames of the steps before it enter the
+    // history as dropped and GetHistoryFrame() regenerates them from their steps on request.
+    // Frames whose steps changed since cannot be rebuilt, so a UI that shows every
+    // intermediate frame anyway gains nothing from fusion and should turn it off.
+    void SetPointwiseFusion(bool bEnabled) { m_bFusePointwise = bEnabled; }
+    bool GetPointwiseFusion() const { return m_bFusePointwise; }
+
+    // Stripe execution (off by default, full-frame runs without ROIs): a run of two or more
+    // steps with bounded neighbourhoods executes as one CStripeChain, whose L2-sized bands
+    // flow through every step of the run before the next band is read. History works as with
+    // fusion: only the run's last frame is computed, the others are regenerated on request.
+    // Each band recomputes its steps' halo rows, so it pays off where the steps are limited by
+    // memory bandwidth (large frames, many threads) rather than by arithmetic; measure first.
+    // nCacheBytes sizes the bands; 0 uses the L2 size the OS reports.
+    void SetStripeExecution(bool bEnabled, size_t nCacheBytes = 0) { m_bStripes = bEnabled; m_nStripeCacheBytes = nCacheBytes; }
+    bool GetStripeExecution() const { return m_bStripes; }
+
+    // Tiled execution (synchronous): the chain runs over overlapping tiles, each extended by the
+    // sum of the steps' neighbourhood radii, so the stitched result equals a full-frame run while
+    // peak memory follows the tile size. The input may be a mapped raw frame up to
+    // MAX_TILED_IMAGE_WIDTH x MAX_TILED_IMAGE_HEIGHT. ROIs and history are not used.
+    // Fails up front if any step needs the whole frame (GetNeighbourhoodRadius() < 0).
+    void SetTileSize(int nTileSize) { m_nTileSize = nTileSize; }
+    int  GetTileSize() const { return m_nTileSize; }
+    bool CanExecuteTiled(int* pHalo = nullptr) const;
+    bool ExecuteTiled(const CImageBuffer& input, const TileSinkFn& sink);
+    bool ExecuteTiled(const CImageBuffer& input, CImageBuffer& output);   // stitched in memory
+
+    // Processing history: frame 0 is the run's input, frame k the output of step k - 1.
+    // Frames are not copies: frame 0 shares the caller's input and frame k the output slot of
+    // step k - 1, which the step wrote in place. A rerun truncates the frames it recomputes and
+    // writes the same slots again, so at an unchanged frame size it allocates no frame memory
+    // (unless a frame is still held elsewhere, e.g. by a viewer; the slot then moves to a new
+    // block and the holder keeps the old one). Without a budget (the default) every frame
+    // stays in memory. With one, frames are evicted least-recently-used first whenever the
+    // resident total exceeds it. The input, the newest frame and frames still referenced
+    // elsewhere (a viewer, the preview) are never evicted; the mini viewers keep only
+    // thumbnails, so they do not hold frames in memory.
+    // GetHistoryFrame() reloads or regenerates an evicted frame; invalid if that fails.
+    int GetHistoryCount() const;
+    CImageBuffer GetHistoryFrame(int index);
+    void SetHistoryBudget(size_t nBytes);
+    size_t GetHistoryBudget() const;
+    void SetHistorySpillMode(HistorySpillMode mode);
+    void SetHistorySpillDirectory(const std::wstring& dir);   // empty = system temp directory
+    HistoryStats GetHistoryStats() const;
+
+    // Run one step over 'input' into 'output'. With ROIs, output is a copy of input with each
+    // ROI replaced by the processed region: view-capable algorithms write the ROI in place
+    // (reading real neighbours across its edges), others go through bufs.roiIn/roiOut.
+    // Small ROIs are processed concurrently, one per OpenMP thread (extra threads use clones
+    // of pStep); large ones run in turn with the algorithm's own parallelism. Where ROIs
+    // overlap, the later one wins, as in a serial pass.
+    // An input depth the step does not support is converted to U8 first, and the input is
+    // brought into the layout the step runs in (see GetStepInputFormat); both go through
+    // bufs.converted. Shared by the sequence thread and the dialog's preview thread.
+    static bool ProcessStep(CAlgorithmBase* pStep, const CImageBuffer& input, CImageBuffer& output,
+                            const std::vector<ImageRect>& rois, PipelineBuffers& bufs,
+                            const std::atomic<bool>* pCancel = nullptr, IProgressSink* pProgress = nullptr);
+
+    // Depth and layout 'pStep' receives for 'input': unsupported depths become U8, and
+    // multi-channel frames are planar exactly when the step prefers planar. A frame already in
+    // that format is passed through, so a run of planar steps converts only at its two ends.
+    static void GetStepInputFormat(const CAlgorithmBase* pStep, const CImageBuffer& input,
+                                   PixelDepth& depth, PixelLayout& layout);
 
     // Multi-ROI support
-    void SetROIs(const std::vector<CRect>& rois) { m_rcROIs = rois; }
-    void AddROI(const CRect& rc) { m_rcROIs.push_back(rc); }
+    void SetROIs(const std::vector<ImageRect>& rois) { m_rcROIs = rois; }
+    void AddROI(const ImageRect& rc) { m_rcROIs.push_back(rc); }
     void RemoveROI(int index);
     void ClearROIs() { m_rcROIs.clear(); }
     bool HasROIs() const { return !m_rcROIs.empty(); }
-    const std::vector<CRect>& GetROIs() const { return m_rcROIs; }
+    const std::vector<ImageRect>& GetROIs() const { return m_rcROIs; }
     int GetROICount() const { return (int)m_rcROIs.size(); }
 
     // Legacy single-ROI compatibility
-    void SetROI(const CRect& rc) { m_rcROIs.clear(); if (!rc.IsRectEmpty()) m_rcROIs.push_back(rc); }
+    void SetROI(const ImageRect& rc) { m_rcROIs.clear(); if (!rc.IsRectEmpty()) m_rcROIs.push_back(rc); }
     bool HasROI() const { return !m_rcROIs.empty(); }
-    CRect GetROI() const { return m_rcROIs.empty() ? CRect(0,0,0,0) : m_rcROIs[0]; }
+    ImageRect GetROI() const { return m_rcROIs.empty() ? ImageRect(0,0,0,0) : m_rcROIs[0]; }
     void ClearROI() { m_rcROIs.clear(); }
 
 private:
-    static UINT ExecuteThread(LPVOID pParam);
-    void DoExecute();
+    void BeginRun(const CImageBuffer& input);
+    bool DoExecute();
+    void Notify(SequenceEvent evt, int index, int count, long long elapsedUs = 0, int permille = 0);
+
+    // ProcessStep with pStep's control already set
+    static bool RunStep(CAlgorithmBase* pStep, const CImageBuffer& input, CImageBuffer& output,
+                        const std::vector<ImageRect>& rois, PipelineBuffers& bufs,
+                        const std::atomic<bool>* pCancel);
+
+    // Passes the running step's progress on as StepProgress events, at most one per
+    // PROGRESS_INTERVAL_MS, so a long step reports without crowding the observer
+    class CStepProgress : public IProgressSink {
+    public:
+        explicit CStepProgress(CSequenceManager& owner) : m_owner(owner), m_nStep(0), m_nCount(0) {}
+        void Begin(int nStep, int nCount);   // before the step runs, on the run's thread
+        void OnProgress(int nPermille) override;
+
+    private:
+        CSequenceManager&                     m_owner;
+        int                                   m_nStep;
+        int                                   m_nCount;
+        std::chrono::steady_clock::time_point m_tLast;
+    };
+
+    // History frame bookkeeping; geometry is kept so an evicted frame can be checked on reload
+    struct HistoryFrame
+    {
+        CImageBuffer       image;          // invalid while evicted
+        int                nWidth, nHeight, nChannels;
+        PixelDepth         eDepth;
+        PixelLayout        eLayout;
+        size_t             nBytes;
+        std::wstring       strSpillPath;   // written on first spill, kept until the frame is dropped
+        unsigned long long nSpillBytes;
+        unsigned long long nFingerprint;   // see StepFingerprint()
+        unsigned long long nLastUse;
+    };
+
+    // Fingerprint of frame 0 (input block, geometry, ROIs) and of a step's output given its
+    // input's fingerprint (algorithm type, parameter values)
+    static unsigned long long InputFingerprint(const CImageBuffer& input, const std::vector<ImageRect>& rois);
+    static unsigned long long StepFingerprint(unsigned long long upstream, CAlgorithmBase* pStep);
+    // Everything a chain built for steps ppSteps[0..count) on frames like 'input' depends on
+    unsigned long long ChainFingerprint(CAlgorithmBase* const* ppSteps, int count, const CImageBuffer& input,
+                                        bool bROIs) const;
+
+    // Chain decision for a run that starts at a given step (nullptr = the step runs alone), kept
+    // from one run to the next and rebuilt when its fingerprint changes
+    struct PlannedChain
+    {
+        unsigned long long          nFingerprint = 0;
+        bool                        bValid = false;
+        std::unique_ptr<CStepChain> pChain;
+    };
+
+    // SequenceHistory.cpp; all called with m_cs held
+    void ClearHistory() { TruncateHistory(0); }
+    void TruncateHistory(int count);   // drops frames from 'count' on, with their spill files
+    void PushHistory(const CImageBuffer& frame, unsigned long long nFingerprint);
+    void PushDroppedHistory(int width, int height, int channels, PixelDepth depth, PixelLayout layout,
+                            unsigned long long nFingerprint);
+    int  FindResumeStep(const CImageBuffer& input);
+    void EnforceHistoryBudget(int keep);
+    bool EvictFrame(int index);
+    bool RestoreFrame(int index);
+    bool CanRegenerate(int index) const;
+    bool RegenerateFrame(int index);
+    bool SpillFrame(int index);
+    bool LoadSpilledFrame(int index);
 
     std::vector<CAlgorithmBase*> m_steps;
-    std::vector<CImageBuffer>    m_history;
-    std::vector<CRect>           m_rcROIs;
+    std::vector<HistoryFrame>    m_history;
+    std::vector<ImageRect>       m_historyROIs;      // ROIs of the run that produced the history
+    int                          m_nResumeStep;      // first step the current run computes
+    size_t                       m_nHistoryBudget;
+    HistorySpillMode             m_eSpillMode;
+    std::wstring                 m_strSpillDir;
+    unsigned                     m_nSpillToken;      // keeps spill file names unique per manager
+    unsigned long long           m_nHistoryClock;    // LRU tick
+    HistoryStats                 m_historyStats;     // counters; frame totals filled on request
+    std::vector<ImageRect>       m_rcROIs;
     CImageBuffer                 m_inputImage;
-    std::vector<PipelineBuffers> m_stepBufs;   // persistent per-step buffer sets
-    CWinThread*                  m_pThread;
-    volatile bool                m_bRunning;
-    volatile bool                m_bStopRequested;
-    HWND                         m_hNotifyWnd;
-    mutable CCriticalSection     m_cs;
+    std::vector<PipelineBuffers> m_stepBufs;   // persistent per-step buffer sets (history slots)
+    std::vector<PlannedChain>    m_chains;     // per start step, worker thread only
+    std::vector<unsigned long long> m_runFingerprints;   // scratch of DoExecute()
+    std::thread                  m_thread;
+    std::atomic<bool>            m_bRunning;
+    std::atomic<bool>            m_bStopRequested;
+    ISequenceObserver*           m_pObserver;
+    std::chrono::steady_clock::time_point m_tRunStart;   // event timestamps count from here
+    CStepProgress                m_stepProgress;
+    int                          m_nTileSize;   // core tile edge in pixels (before halo)
+    std::atomic<bool>            m_bFusePointwise;
+    std::atomic<bool>            m_bStripes;
+    std::atomic<size_t>          m_nStripeCacheBytes;   // 0 = detected L2 size
+    mutable std::mutex           m_cs;
 };
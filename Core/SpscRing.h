@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Fixed-capacity FIFO between exactly one producer thread and one consumer thread, without
+// locks: each side owns one index and publishes it with a release store, so TryPush and TryPop
+// are a few loads and stores and never wait. The slots are allocated once, up front; T should
+// be cheap to copy (it is copied in and out). A full ring rejects the item instead of waiting,
+// so a consumer that stalls cannot hold the producer back.
+template <typename T>
+class CSpscRing {
+public:
+    // The capacity is rounded up to a power of two
+    explicit CSpscRing(size_t nCapacity)
+        : m_nHead(0)
+        , m_nTail(0)
+    {
+        size_t n = 2;
+        while (n < nCapacity) n <<= 1;
+        m_slots.resize(n);
+        m_nMask = n - 1;
+    }
+
+    size_t GetCapacity() const { return m_slots.size(); }
+
+    // Producer thread only; false when the ring is full
+    bool TryPush(const T& item)
+    {
+        const size_t tail = m_nTail.load(std::memory_order_relaxed);
+        if (tail - m_nHead.load(std::memory_order_acquire) == m_slots.size())
+            return false;
+        m_slots[tail & m_nMask] = item;
+        m_nTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only; false when the ring is empty
+    bool TryPop(T& item)
+    {
+        const size_t head = m_nHead.load(std::memory_order_relaxed);
+        if (head == m_nTail.load(std::memory_order_acquire))
+            return false;
+        item = m_slots[head & m_nMask];
+        m_nHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool IsEmpty() const
+    {
+        return m_nHead.load(std::memory_order_acquire) == m_nTail.load(std::memory_order_acquire);
+    }
+
+private:
+    CSpscRing(const CSpscRing&) = delete;
+    CSpscRing& operator=(const CSpscRing&) = delete;
+
+    // The indices count up without wrapping at the capacity; each sits on its own cache line so
+    // the two threads do not invalidate each other's line on every item
+    alignas(64) std::atomic<size_t> m_nHead;   // next slot to read, written by the consumer
+    alignas(64) std::atomic<size_t> m_nTail;   // next slot to write, written by the producer
+    alignas(64) std::vector<T>      m_slots;
+    size_t                          m_nMask;
+};
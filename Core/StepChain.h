@@ -0,0 +1,36 @@
+#pragma once
+#include "Algorithm/AlgorithmBase.h"
+#include <string>
+#include <vector>
+
+// A run of consecutive sequence steps executed as one algorithm (CPointwiseChain,
+// CStripeChain). Its output is the frame of the run's last step. For the steps before it the
+// chain reports the format each would have produced on its own, so the sequence can record
+// those frames in the history and regenerate them from the steps on request.
+class CStepChain : public CAlgorithmBase {
+public:
+    // Steps the chain replaces, and the format of the frame step k of the run (0-based)
+    // produces; CStripeChain knows the formats once Process() has succeeded
+    int GetStepCount() const { return (int)m_frames.size(); }
+    void GetFrameFormat(int k, int& channels, PixelDepth& depth, PixelLayout& layout) const
+    {
+        channels = m_frames[k].nChannels;
+        depth    = m_frames[k].eDepth;
+        layout   = m_frames[k].eLayout;
+    }
+
+    virtual std::wstring GetName() const override { return m_strName; }
+    virtual std::vector<AlgorithmParam>& GetParams() override { return m_params; }
+
+protected:
+    struct FrameFormat
+    {
+        int         nChannels;
+        PixelDepth  eDepth;
+        PixelLayout eLayout;
+    };
+
+    std::wstring                m_strName;   // "Invert + Binarize", for the log
+    std::vector<AlgorithmParam> m_params;    // none
+    std::vector<FrameFormat>    m_frames;    // per replaced step
+};
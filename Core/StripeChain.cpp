@@ -0,0 +1,341 @@
+#include "Core/StripeChain.h"
+#include "Core/PointwiseChain.h"
+#include "Core/Profiler.h"
+#include "Core/SequenceManager.h"
+#include "Utils/Logger.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// Core rows [srcY, srcY + rows) of a band into the same rows of the output frame, plane by plane
+void CopyRows(const CImageBuffer& band, int srcY, CImageBuffer& output, int dstY, int rows)
+{
+    const ConstImageView src = band.GetConstView(ImageRect(0, srcY, band.GetWidth(), srcY + rows));
+    const ImageView      dst = output.GetView(ImageRect(0, dstY, output.GetWidth(), dstY + rows));
+    const int nPlanes = src.IsPlanar() ? src.nChannels : 1;
+    const size_t rowBytes = (size_t)src.nWidth * (src.IsPlanar() ? 1 : src.nChannels) * PixelDepthBytes(src.eDepth);
+    for (int p = 0; p < nPlanes; p++)
+    {
+        const ConstImageView srcPlane = src.IsPlanar() ? src.Plane(p) : src;
+        const ImageView      dstPlane = dst.IsPlanar() ? dst.Plane(p) : dst;
+        for (int y = 0; y < rows; y++)
+            memcpy(dstPlane.Row(y), srcPlane.Row(y), rowBytes);
+    }
+}
+
+} // namespace
+
+CStripeChain::CStripeChain()
+    : m_bFusePointwise(false)
+    , m_bPlanar(false)
+    , m_nHalo(0)
+    , m_nBandHeight(0)
+{
+}
+
+size_t CStripeChain::DetectCacheBytes()
+{
+    static const size_t nBytes = []() -> size_t
+    {
+#ifdef _WIN32
+        DWORD len = 0;
+        GetLogicalProcessorInformation(nullptr, &len);
+        std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(len / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+        if (!info.empty() && GetLogicalProcessorInformation(info.data(), &len))
+        {
+            for (const auto& entry : info)
+                if (entry.Relationship == RelationCache && entry.Cache.Level == 2 && entry.Cache.Size > 0)
+                    return entry.Cache.Size;
+        }
+#elif defined(_SC_LEVEL2_CACHE_SIZE)
+        long n = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (n > 0)
+            return (size_t)n;
+#endif
+        return (size_t)1 << 20;
+    }();
+    return nBytes;
+}
+
+CStripeChain* CStripeChain::Build(CAlgorithmBase* const* ppSteps, int count, const CImageBuffer& input,
+                                  bool bFusePointwise, size_t nCacheBytes)
+{
+    if (count < 2 || !input.IsValid())
+        return nullptr;
+
+    CStripeChain chain;
+    int nMaxRadius = 0;
+    for (int k = 0; k < count && ppSteps[k]; k++)
+    {
+        int nRadius = ppSteps[k]->GetNeighbourhoodRadius();
+        if (nRadius < 0)
+            break;
+        chain.m_steps.push_back(ppSteps[k]);
+        chain.m_nHalo += nRadius;
+        nMaxRadius = std::max(nMaxRadius, nRadius);
+        chain.m_strName += (k > 0 ? L" + " : L"") + ppSteps[k]->GetName();
+    }
+    if (chain.m_steps.size() < 2)
+        return nullptr;
+
+    // One step works on its input rows, its output and the window it keeps, so a band is a
+    // third of the cache; at least four radii high so the halo stays a small share of the work
+    const size_t rowBytes = (size_t)input.GetWidth() * input.GetChannels() * PixelDepthBytes(input.GetDepth());
+    const size_t cacheRows = (nCacheBytes ? nCacheBytes : DetectCacheBytes()) / (3 * rowBytes);
+    const int nBand = (int)std::max<size_t>(cacheRows, (size_t)std::max(16, 4 * nMaxRadius));
+    if (input.GetHeight() < 2 * nBand)
+        return nullptr;
+
+    chain.m_bFusePointwise = bFusePointwise;
+    chain.m_bPlanar = input.IsPlanar();
+    chain.m_nBandHeight = nBand;
+    chain.m_frames.resize(chain.m_steps.size());
+    return new CStripeChain(chain);
+}
+
+std::wstring CStripeChain::GetDescription() const
+{
+    return L"Consecutive bounded-neighbourhood steps, band by band";
+}
+
+bool CStripeChain::Process(const CImageBuffer& input, CImageBuffer& output)
+{
+    if (!input.IsValid() || m_nBandHeight <= 0) return false;
+
+    // The steps poll the chain's cancel flag inside a band; progress is counted by the chain
+    std::vector<ProcessControl> prevControls;
+    for (CAlgorithmBase* pStep : m_steps)
+    {
+        prevControls.push_back(pStep->GetProcessControl());
+        pStep->SetProcessControl(GetStepControl());
+    }
+    const bool bOk = RunBands(input, output);
+    for (size_t i = 0; i < m_steps.size(); i++)
+        m_steps[i]->SetProcessControl(prevControls[i]);
+    return bOk;
+}
+
+ProcessControl CStripeChain::GetStepControl() const
+{
+    ProcessControl control;
+    control.pCancel = m_control.pCancel;
+    return control;
+}
+
+bool CStripeChain::RunBands(const CImageBuffer& input, CImageBuffer& output)
+{
+    CProfileScope phase("phase", "Stripe chain: plan");
+    BandPlan plan;
+    if (!PlanSteps(input, plan))
+        return false;
+    phase.End();
+    const FrameFormat& last = plan.formats.back();
+    if (!output.Create(input.GetWidth(), input.GetHeight(), last.nChannels, last.eDepth, last.eLayout))
+        return false;
+
+    // One section of rows per thread; only the rows each step needs above its section are
+    // computed twice. The steps inside see only a band at a time, so the chain itself polls
+    // the cancel flag and counts progress, per band.
+    CRowProgress progress(*this, input.GetHeight());
+    std::atomic<bool> bFailed(false);
+    #pragma omp parallel
+    {
+        int nThread = 0, nThreads = 1;
+        // Algorithms may keep scratch buffers in members, so every extra thread runs clones
+        BandPlan clones;
+        const BandPlan* pPlan = &plan;
+#ifdef _OPENMP
+        nThread  = omp_get_thread_num();
+        nThreads = omp_get_num_threads();
+        if (nThread > 0)
+        {
+            for (CAlgorithmBase* pStep : plan.steps)
+            {
+                clones.owned.emplace_back(pStep->Clone());
+                clones.steps.push_back(clones.owned.back().get());
+            }
+            clones.radii   = plan.radii;
+            clones.formats = plan.formats;
+            pPlan = &clones;
+        }
+        omp_set_num_threads(1);   // regions opened by the algorithms stay on this thread
+#endif
+        CProfileScope section("phase", "Stripe chain: section");
+        const int y0 = (int)((long long)input.GetHeight() * nThread / nThreads);
+        const int y1 = (int)((long long)input.GetHeight() * (nThread + 1) / nThreads);
+        if (y1 > y0 && !RunSection(*pPlan, input, output, y0, y1, progress))
+            bFailed = true;
+    }
+    return !bFailed && !progress.IsCancelled();
+}
+
+bool CStripeChain::PlanSteps(const CImageBuffer& input, BandPlan& plan)
+{
+    CImageBuffer bufs[2], converted;
+    if (!input.ExtractRegionInto(ImageRect(0, 0, input.GetWidth(), m_nBandHeight), bufs[0]))
+        return false;
+
+    int nCur = 0;
+    for (int i = 0; i < (int)m_steps.size(); i++)
+    {
+        CPointwiseChain* pFused = m_bFusePointwise ?
+            CPointwiseChain::Fuse(&m_steps[i], (int)m_steps.size() - i, bufs[nCur], false) : nullptr;
+        if (pFused)
+        {
+            pFused->SetProcessControl(GetStepControl());
+            plan.owned.emplace_back(pFused);
+        }
+        CAlgorithmBase* pStep = pFused ? pFused : m_steps[i];
+
+        if (!RunBandStep(pStep, bufs[nCur], bufs[nCur ^ 1], converted))
+            return false;
+        nCur ^= 1;
+
+        const CImageBuffer& out = bufs[nCur];
+        plan.steps.push_back(pStep);
+        plan.radii.push_back(pStep->GetNeighbourhoodRadius());
+        plan.formats.push_back({ out.GetChannels(), out.GetDepth(), out.GetLayout() });
+        if (pFused)
+        {
+            for (int k = 0; k < pFused->GetStepCount(); k++)
+                pFused->GetFrameFormat(k, m_frames[i + k].nChannels, m_frames[i + k].eDepth, m_frames[i + k].eLayout);
+            i += pFused->GetStepCount() - 1;
+        }
+        else
+        {
+            m_frames[i] = plan.formats.back();
+        }
+    }
+    return true;
+}
+
+bool CStripeChain::RunSection(const BandPlan& plan, const CImageBuffer& input, CImageBuffer& output, int y0, int y1,
+                              CRowProgress& progress) const
+{
+    const int nSteps  = (int)plan.steps.size();
+    const int nWidth  = input.GetWidth();
+    const int nHeight = input.GetHeight();
+
+    // need[k]: rows below an output row that step k must have produced before the last step
+    // can produce it. done[k]: step k's output is complete above this row.
+    std::vector<int> need(nSteps, 0), done(nSteps);
+    for (int k = nSteps - 2; k >= 0; k--)
+        need[k] = need[k + 1] + plan.radii[k + 1];
+    for (int k = 0; k < nSteps; k++)
+        done[k] = std::max(0, y0 - need[k]);
+
+    std::vector<StepWindow>   windows(nSteps - 1);
+    std::vector<CImageBuffer> outs(nSteps);
+    CImageBuffer slice, converted;
+    for (int k = 0; k < nSteps - 1; k++)
+        windows[k].nTop = done[k];
+
+    for (int target = y0; done[nSteps - 1] < y1; )
+    {
+        if (progress.IsCancelled())
+            return false;
+        const int nPrev = target;
+        target = std::min(y1, target + m_nBandHeight);
+
+        for (int k = 0; k < nSteps; k++)
+        {
+            // Step k's new rows [done, to) read its input rows [a, b)
+            const int r  = plan.radii[k];
+            const int to = std::min(nHeight, target + need[k]);
+            const int a  = std::max(0, done[k] - r);
+            if (to > done[k])
+            {
+                const int b = std::min(nHeight, to + r);
+                const CImageBuffer* pIn = &slice;
+                if (k == 0)
+                {
+                    if (!input.ExtractRegionInto(ImageRect(0, a, nWidth, b), slice))
+                        return false;
+                }
+                else
+                {
+                    const StepWindow& prev = windows[k - 1];
+                    if (prev.nTop != a || prev.nRows != b - a)
+                    {
+                        CLogger::Error(L"CStripeChain - Rows %d-%d of %ls are not in the band", a, b,
+                            plan.steps[k - 1]->GetName().c_str());
+                        return false;
+                    }
+                    pIn = &prev.rows[prev.nCur];
+                }
+                if (!RunBandStep(plan.steps[k], *pIn, outs[k], converted))
+                    return false;
+            }
+            const int nNew = std::max(0, to - done[k]);
+
+            if (k == nSteps - 1)
+            {
+                if (nNew > 0)
+                    CopyRows(outs[k], done[k] - a, output, done[k], nNew);
+            }
+            else
+            {
+                // Keep what the next step reads: its radius above the rows it has yet to produce
+                StepWindow& win = windows[k];
+                const int nTop  = std::max(0, done[k + 1] - plan.radii[k + 1]);
+                const int nKeep = win.nTop + win.nRows - nTop;
+                if (nTop != win.nTop || nNew > 0)
+                {
+                    const FrameFormat& fmt = plan.formats[k];
+                    CImageBuffer& next = win.rows[win.nCur ^ 1];
+                    if (nKeep + nNew > 0 &&
+                        !next.Create(nWidth, nKeep + nNew, fmt.nChannels, fmt.eDepth, fmt.eLayout))
+                        return false;
+                    if (nKeep > 0)
+                        CopyRows(win.rows[win.nCur], nTop - win.nTop, next, 0, nKeep);
+                    if (nNew > 0)
+                        CopyRows(outs[k], done[k] - a, next, nKeep, nNew);
+                    win.nCur ^= 1;
+                    win.nTop  = nTop;
+                    win.nRows = nKeep + nNew;
+                }
+            }
+            done[k] += nNew;
+        }
+        progress.Add(target - nPrev);
+    }
+    return true;
+}
+
+bool CStripeChain::RunBandStep(CAlgorithmBase* pStep, const CImageBuffer& in, CImageBuffer& out, CImageBuffer& converted)
+{
+    const CImageBuffer* pIn = &in;
+    PixelDepth  depth;
+    PixelLayout layout;
+    CSequenceManager::GetStepInputFormat(pStep, *pIn, depth, layout);
+    if (depth != pIn->GetDepth() || layout != pIn->GetLayout())
+    {
+        if (!pIn->ConvertTo(depth, layout, converted))
+            return false;
+        pIn = &converted;
+    }
+    if (!pStep->Process(*pIn, out) || !out.IsValid() ||
+        out.GetWidth() != pIn->GetWidth() || out.GetHeight() != pIn->GetHeight())
+    {
+        if (!pStep->IsCancelled())
+            CLogger::Error(L"CStripeChain - Step %ls failed on a %d x %d band", pStep->GetName().c_str(),
+                pIn->GetWidth(), pIn->GetHeight());
+        return false;
+    }
+    return true;
+}
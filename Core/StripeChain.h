@@ -0,0 +1,79 @@
+#pragma once
+#include "Core/StepChain.h"
+#include <atomic>
+#include <memory>
+
+// A run of steps with bounded neighbourhoods (GetNeighbourhoodRadius() >= 0) executed band by
+// band instead of frame by frame.
+//
+// The frame is split into one section of rows per OpenMP thread, and each section is walked
+// top to bottom in full-width bands sized so that a band and the step results derived from it
+// fit one core's L2 cache. A band flows through every step before the next one is read: step
+// k runs on the rows of step k-1's output it needs, the band plus its own radius above and
+// below, so a chain touches main memory about once instead of once per step. Each step keeps
+// the last rows of its output that the next step will read again as context, so halo rows are
+// recomputed only where sections meet. Rows a kernel reads outside the frame are clamped
+// exactly as in a full-frame run, and results equal running the steps one by one.
+//
+// Threads other than the first run clones of the steps, with the steps' own parallel regions
+// serialised. Pointwise runs inside the chain are fused (CPointwiseChain) when the sequence
+// fuses them.
+class CStripeChain : public CStepChain {
+public:
+    // Chain for the longest run of bounded steps at the start of ppSteps[0..count), for frames
+    // like 'input'; the steps are not owned and must outlive it. Returns nullptr for fewer than
+    // two steps, or for frames less than two bands high (the steps then run frame by frame).
+    // nCacheBytes is the cache a band's working set should fit; 0 uses DetectCacheBytes().
+    static CStripeChain* Build(CAlgorithmBase* const* ppSteps, int count, const CImageBuffer& input,
+                               bool bFusePointwise, size_t nCacheBytes = 0);
+
+    // L2 cache size of one core as the OS reports it, 1 MB when it does not
+    static size_t DetectCacheBytes();
+
+    int GetBandHeight() const { return m_nBandHeight; }
+
+    virtual std::wstring GetDescription() const override;
+    virtual bool Process(const CImageBuffer& input, CImageBuffer& output) override;
+    virtual bool SupportsDepth(PixelDepth) const override { return true; }
+    virtual bool PrefersPlanar() const override { return m_bPlanar; }
+    virtual int GetNeighbourhoodRadius() const override { return m_nHalo; }
+    virtual CAlgorithmBase* Clone() const override { return new CStripeChain(*this); }
+
+private:
+    CStripeChain();
+
+    // What the bands run: the steps, with fused pointwise runs in place of their steps
+    struct BandPlan
+    {
+        std::vector<CAlgorithmBase*>                 steps;
+        std::vector<int>                             radii;
+        std::vector<FrameFormat>                     formats;   // of each step's output
+        std::vector<std::unique_ptr<CAlgorithmBase>> owned;     // fused runs, or per-thread clones
+    };
+
+    // Rows [nTop, nTop + nRows) of one step's output, kept for the next step
+    struct StepWindow
+    {
+        CImageBuffer rows[2];   // current and the one being assembled
+        int          nCur  = 0;
+        int          nTop  = 0;
+        int          nRows = 0;
+    };
+
+    bool RunBands(const CImageBuffer& input, CImageBuffer& output);
+    // Control the steps run with: the chain's cancel flag, no progress sink
+    ProcessControl GetStepControl() const;
+    // Runs the first band on its own to fuse the steps and learn their output formats
+    bool PlanSteps(const CImageBuffer& input, BandPlan& plan);
+    // Output rows [y0, y1), band by band; the cancel flag is checked and progress counted per band
+    bool RunSection(const BandPlan& plan, const CImageBuffer& input, CImageBuffer& output, int y0, int y1,
+                    CRowProgress& progress) const;
+    // 'in' -> 'out' through one step, converting its input where it needs
+    static bool RunBandStep(CAlgorithmBase* pStep, const CImageBuffer& in, CImageBuffer& out, CImageBuffer& converted);
+
+    std::vector<CAlgorithmBase*> m_steps;
+    bool                         m_bFusePointwise;
+    bool                         m_bPlanar;       // layout of the input, which is passed through as it is
+    int                          m_nHalo;         // sum of the steps' radii
+    int                          m_nBandHeight;   // output rows per band
+};
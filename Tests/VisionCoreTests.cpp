@@ -0,0 +1,266 @@
+// Equivalence checks for the sequence engines whose output must not depend on how a chain is
+// executed. Each mode runs a few fixed chains and is compared byte for byte against a plain
+// Execute() with pointwise fusion and stripe execution off.
+//
+//   VisionCoreTests          (exit code 0 when every check passes; registered with ctest)
+
+#include "Core/SequenceManager.h"
+#include "Algorithm/Binarize.h"
+#include "Algorithm/BrightnessContrast.h"
+#include "Algorithm/EdgeDetect.h"
+#include "Algorithm/GaussianBlur.h"
+#include "Algorithm/Grayscale.h"
+#include "Algorithm/Invert.h"
+#include "Algorithm/Morphology.h"
+#include "Algorithm/Sharpening.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+int g_nChecks = 0;
+int g_nFailures = 0;
+
+void Check(bool bOk, const char* pszWhat, const char* pszChain)
+{
+    g_nChecks++;
+    if (!bOk)
+    {
+        g_nFailures++;
+        printf("FAILED: %s (%s)\n", pszWhat, pszChain);
+    }
+}
+
+bool SameFrame(const CImageBuffer& a, const CImageBuffer& b)
+{
+    if (!a.IsValid() || !b.IsValid())
+        return false;
+    if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight() || a.GetChannels() != b.GetChannels() ||
+        a.GetDepth() != b.GetDepth() || a.GetLayout() != b.GetLayout())
+        return false;
+    const size_t rowBytes = (size_t)a.GetWidth() * (a.IsPlanar() ? 1 : a.GetChannels()) * PixelDepthBytes(a.GetDepth());
+    for (int p = 0; p < a.GetPlaneCount(); p++)
+        for (int y = 0; y < a.GetHeight(); y++)
+            if (memcmp(a.GetPlane(p) + (size_t)y * a.GetStride(), b.GetPlane(p) + (size_t)y * b.GetStride(), rowBytes) != 0)
+                return false;
+    return true;
+}
+
+// Shapes on a noisy background; the size is no multiple of any tile size or band height
+CImageBuffer MakeFrame()
+{
+    const int width = 331, height = 257;
+    CImageBuffer frame;
+    frame.Create(width, height, 3);
+    BYTE* pData = frame.GetData();
+    unsigned seed = 12345;
+    for (int y = 0; y < height; y++)
+    {
+        BYTE* pRow = pData + (size_t)y * frame.GetStride();
+        for (int x = 0; x < width * 3; x++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            pRow[x] = (BYTE)((((x / 3 / 23) + (y / 17)) % 2 ? 170 : 70) + (x % 3) * 10 + ((seed >> 16) & 31));
+        }
+    }
+    return frame;
+}
+
+// Fixed chains: pointwise only, mixed, and bounded-radius only
+const char* const kChainNames[] = { "pointwise", "mixed", "neighbourhood" };
+const int CHAIN_COUNT = 3;
+
+void AddChain(CSequenceManager& seq, int chain)
+{
+    switch (chain)
+    {
+    case 0:
+        seq.AddStep(new CGrayscale());
+        seq.AddStep(new CBrightnessContrast());
+        seq.AddStep(new CInvert());
+        seq.AddStep(new CBinarize());
+        break;
+    case 1:
+        seq.AddStep(new CGaussianBlur());
+        seq.AddStep(new CBrightnessContrast());
+        seq.AddStep(new CInvert());
+        seq.AddStep(new CSharpening());
+        seq.AddStep(new CEdgeDetect());
+        seq.AddStep(new CMorphology());
+        break;
+    default:
+        seq.AddStep(new CGaussianBlur());
+        seq.AddStep(new CEdgeDetect());
+        seq.AddStep(new CBinarize());
+        seq.AddStep(new CMorphology());
+        break;
+    }
+}
+
+// Last frame of a plain full-frame run of 'chain', the result every mode must reproduce
+CImageBuffer ReferenceOutput(const CImageBuffer& frame, int chain)
+{
+    CSequenceManager seq;
+    AddChain(seq, chain);
+    seq.SetPointwiseFusion(false);
+    seq.SetStripeExecution(false);
+    if (!seq.Execute(frame))
+        return CImageBuffer();
+    return seq.GetHistoryFrame(seq.GetHistoryCount() - 1);
+}
+
+// Tiled runs stitch overlapping tiles; every tile size must give the full-frame result
+void TestTiled(const CImageBuffer& frame, const CImageBuffer* pReference)
+{
+    const int kTileSizes[] = { 64, 100, 256 };
+    for (int chain = 0; chain < CHAIN_COUNT; chain++)
+    {
+        for (int tileSize : kTileSizes)
+        {
+            for (int fuse = 0; fuse < 2; fuse++)
+            {
+                CSequenceManager seq;
+                AddChain(seq, chain);
+                seq.SetPointwiseFusion(fuse != 0);
+                seq.SetTileSize(tileSize);
+                CImageBuffer output;
+                Check(seq.ExecuteTiled(frame, output) && SameFrame(output, pReference[chain]),
+                      fuse ? "tiled, fused, equals full frame" : "tiled equals full frame", kChainNames[chain]);
+            }
+        }
+    }
+}
+
+// Fused runs compute only a pointwise run's last frame; it and the frames regenerated for the
+// steps before it must match the unfused run's history
+void TestFused(const CImageBuffer& frame)
+{
+    for (int chain = 0; chain < CHAIN_COUNT; chain++)
+    {
+        CSequenceManager plain, fused;
+        AddChain(plain, chain);
+        AddChain(fused, chain);
+        plain.SetPointwiseFusion(false);
+        fused.SetPointwiseFusion(true);
+        if (!plain.Execute(frame) || !fused.Execute(frame))
+        {
+            Check(false, "fused run", kChainNames[chain]);
+            continue;
+        }
+        bool bSame = plain.GetHistoryCount() == fused.GetHistoryCount();
+        for (int i = 0; bSame && i < plain.GetHistoryCount(); i++)
+            bSame = SameFrame(plain.GetHistoryFrame(i), fused.GetHistoryFrame(i));
+        Check(bSame, "fused history equals unfused", kChainNames[chain]);
+    }
+}
+
+// Striped runs push small bands through every step of a chain; the band height (set through
+// the cache size) must not show in the result, with or without fusion
+void TestStriped(const CImageBuffer& frame, const CImageBuffer* pReference)
+{
+    const size_t kCacheBytes[] = { 16 << 10, 256 << 10, 0 };
+    for (int chain = 0; chain < CHAIN_COUNT; chain++)
+    {
+        for (size_t cacheBytes : kCacheBytes)
+        {
+            for (int fuse = 0; fuse < 2; fuse++)
+            {
+                CSequenceManager seq;
+                AddChain(seq, chain);
+                seq.SetPointwiseFusion(fuse != 0);
+                seq.SetStripeExecution(true, cacheBytes);
+                Check(seq.Execute(frame) && SameFrame(seq.GetHistoryFrame(seq.GetHistoryCount() - 1), pReference[chain]),
+                      fuse ? "striped, fused, equals whole frame" : "striped equals whole frame", kChainNames[chain]);
+            }
+        }
+    }
+}
+
+// Counts the steps a run reused from the previous one
+class CReuseCounter : public ISequenceObserver {
+public:
+    int nReused = 0;
+    void OnSequenceEvent(const SequenceEventRecord& evt) override
+    {
+        if (evt.eType == SequenceEvent::StepReused)
+            nReused++;
+    }
+};
+
+// Last frame of a fresh manager running the mixed chain with its brightness step set
+CImageBuffer MixedChainOutput(const CImageBuffer& frame, double brightness)
+{
+    CSequenceManager seq;
+    AddChain(seq, 1);
+    seq.SetPointwiseFusion(false);
+    seq.GetStep(1)->GetParams()[1].dCurrentVal = brightness;
+    if (!seq.Execute(frame))
+        return CImageBuffer();
+    return seq.GetHistoryFrame(seq.GetHistoryCount() - 1);
+}
+
+// A rerun resumes after the steps whose inputs and parameters are unchanged, and its result
+// equals a fresh run of the same steps
+void TestResume(const CImageBuffer& frame)
+{
+    for (int fuse = 0; fuse < 2; fuse++)
+    {
+        const char* pszMode = fuse ? "mixed, fused" : "mixed";
+        CImageBuffer input;
+        input.CopyDataFrom(frame);
+
+        CSequenceManager seq;
+        CReuseCounter counter;
+        AddChain(seq, 1);
+        seq.SetPointwiseFusion(fuse != 0);
+        seq.SetObserver(&counter);
+        const int nSteps = seq.GetStepCount();
+        Check(seq.Execute(input) && counter.nReused == 0, "first run reuses nothing", pszMode);
+
+        // Nothing changed: every step is reused
+        counter.nReused = 0;
+        Check(seq.Execute(input) && counter.nReused == nSteps, "unchanged rerun reuses every step", pszMode);
+        Check(SameFrame(seq.GetHistoryFrame(nSteps), MixedChainOutput(frame, 0.0)), "unchanged rerun output", pszMode);
+
+        // Brightness of step 2 changed: only step 1 is reused
+        seq.GetStep(1)->GetParams()[1].dCurrentVal = 40.0;
+        counter.nReused = 0;
+        Check(seq.Execute(input) && counter.nReused == 1, "parameter change resumes at its step", pszMode);
+        bool bFrames = true;   // the reused frame and the recomputed ones alike
+        for (int i = 0; i <= nSteps; i++)
+            bFrames = bFrames && seq.GetHistoryFrame(i).IsValid();
+        Check(bFrames && SameFrame(seq.GetHistoryFrame(nSteps), MixedChainOutput(frame, 40.0)),
+              "parameter change output", pszMode);
+
+        // The input edited in place: nothing is reused
+        BYTE* pData = input.GetData();
+        for (int x = 0; x < input.GetWidth() * 3; x++)
+            pData[(size_t)(input.GetHeight() / 2) * input.GetStride() + x] ^= 0x55;
+        counter.nReused = 0;
+        Check(seq.Execute(input) && counter.nReused == 0, "edited input reuses nothing", pszMode);
+        Check(SameFrame(seq.GetHistoryFrame(nSteps), MixedChainOutput(input, 40.0)), "edited input output", pszMode);
+        seq.SetObserver(nullptr);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    const CImageBuffer frame = MakeFrame();
+    CImageBuffer reference[CHAIN_COUNT];
+    for (int chain = 0; chain < CHAIN_COUNT; chain++)
+    {
+        reference[chain] = ReferenceOutput(frame, chain);
+        Check(reference[chain].IsValid(), "reference run", kChainNames[chain]);
+    }
+
+    TestTiled(frame, reference);
+    TestFused(frame);
+    TestStriped(frame, reference);
+    TestResume(frame);
+
+    printf("%d check(s), %d failure(s)\n", g_nChecks, g_nFailures);
+    return g_nFailures == 0 ? 0 : 1;
+}
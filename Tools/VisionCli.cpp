@@ -0,0 +1,450 @@
+// Headless recipe runner: the step chain operators build in the GUI, on a console.
+//
+//   VisionCli --recipe FILE --input PATH [options]
+//
+//   --recipe FILE     recipe to run (CRecipe binary .vrcp or text form)
+//   --input PATH      an image file, or a folder whose images run as a batch
+//   --output DIR      where results are written (same file names); nothing is written without it
+//   --format EXT      format of the written files (bmp, ppm, qoi, ...); default = the input's
+//   --threads N       OpenMP threads per image (default: all for one image, 1 per batch worker)
+//   --workers N       batch workers (default: one per hardware thread)
+//   --warmup N        untimed runs before the measured ones (default 0)
+//   --repeat N        measured runs (default 1)
+//   --no-fusion       run pointwise steps one by one instead of fused
+//   --stripes         stripe execution for runs of bounded-neighbourhood steps
+//   --tiled           tiled execution; implied for frames over MAX_IMAGE_WIDTH x MAX_IMAGE_HEIGHT
+//                     (mapped .vraw line-scan frames), whose results are written as .vraw
+//   --report FILE     also write the timing table as CSV
+//   --trace FILE      profile the measured runs: print step / ROI / phase spans (min, mean,
+//                     p99) and write them as Chrome trace JSON (chrome://tracing, Perfetto)
+//
+// One image runs through CSequenceManager::Execute; the table lists each step's time
+// (min / mean / max over the measured runs; a chained run of steps reports its whole time on
+// its last step). A tiled image runs through ExecuteTiled and reports the whole run only; its
+// recipe must not have ROIs or steps that need the whole frame. A folder runs through
+// CBatchProcessor and reports throughput, stage utilisation and latency per run. Exit code 0 on
+// success, 1 on a failed run, 2 on bad usage.
+
+#include "Core/BatchProcessor.h"
+#include "Core/ImageCodec.h"
+#include "Core/Profiler.h"
+#include "Core/RawFrame.h"
+#include "Core/Recipe.h"
+#include "Core/SequenceManager.h"
+#include "Algorithm/AlgorithmManager.h"
+#include "Utils/StringUtil.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+// Collects each step's time of a run (0 for the earlier steps of a chained run)
+class CStepTimes : public ISequenceObserver {
+public:
+    explicit CStepTimes(std::vector<double>& stepUs) : m_stepUs(stepUs) {}
+
+    void OnSequenceEvent(const SequenceEventRecord& evt) override
+    {
+        if (evt.eType == SequenceEvent::StepDone && evt.nIndex >= 0 && evt.nIndex < (int)m_stepUs.size())
+            m_stepUs[evt.nIndex] = (double)evt.nElapsedUs;
+    }
+
+private:
+    std::vector<double>& m_stepUs;
+};
+
+struct CliOptions
+{
+    std::wstring strRecipe;
+    std::wstring strInput;
+    std::wstring strOutputDir;
+    std::wstring strFormat;
+    std::wstring strReport;
+    std::wstring strTrace;
+    int  nThreads  = 0;   // 0 = default
+    int  nWorkers  = 0;
+    int  nWarmup   = 0;
+    int  nRepeat   = 1;
+    bool bFusion   = true;
+    bool bStripes  = false;
+    bool bTiled    = false;
+};
+
+void PrintUsage()
+{
+    fprintf(stderr,
+        "usage: VisionCli --recipe FILE --input PATH [--output DIR] [--format EXT]\n"
+        "                 [--threads N] [--workers N] [--warmup N] [--repeat N]\n"
+        "                 [--no-fusion] [--stripes] [--tiled] [--report FILE] [--trace FILE]\n");
+}
+
+bool ParseArgs(const std::vector<std::wstring>& args, CliOptions& opt)
+{
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        const std::wstring& a = args[i];
+        const bool bHasValue = (i + 1 < args.size());
+        auto Count = [&](int& n, int nMin) -> bool
+        {
+            if (!bHasValue) return false;
+            n = (int)wcstol(args[++i].c_str(), nullptr, 10);
+            return n >= nMin;
+        };
+
+        bool bOk = true;
+        if      (a == L"--recipe"  && bHasValue) opt.strRecipe    = args[++i];
+        else if (a == L"--input"   && bHasValue) opt.strInput     = args[++i];
+        else if (a == L"--output"  && bHasValue) opt.strOutputDir = args[++i];
+        else if (a == L"--format"  && bHasValue) opt.strFormat    = args[++i];
+        else if (a == L"--report"  && bHasValue) opt.strReport    = args[++i];
+        else if (a == L"--trace"   && bHasValue) opt.strTrace     = args[++i];
+        else if (a == L"--threads") bOk = Count(opt.nThreads, 1);
+        else if (a == L"--workers") bOk = Count(opt.nWorkers, 1);
+        else if (a == L"--warmup")  bOk = Count(opt.nWarmup, 0);
+        else if (a == L"--repeat")  bOk = Count(opt.nRepeat, 1);
+        else if (a == L"--no-fusion") opt.bFusion = false;
+        else if (a == L"--stripes")   opt.bStripes = true;
+        else if (a == L"--tiled")     opt.bTiled = true;
+        else bOk = false;
+
+        if (!bOk)
+        {
+            fprintf(stderr, "VisionCli: bad option %s\n", WideToUtf8(a).c_str());
+            return false;
+        }
+    }
+    return !opt.strRecipe.empty() && !opt.strInput.empty();
+}
+
+bool WriteReport(const std::wstring& path, const std::string& csv)
+{
+    FILE* fp = CImageCodec::OpenFile(path, L"wb");
+    if (!fp)
+    {
+        fprintf(stderr, "VisionCli: cannot write %s\n", WideToUtf8(path).c_str());
+        return false;
+    }
+    const bool bOk = fwrite(csv.data(), 1, csv.size(), fp) == csv.size();
+    if (fclose(fp) != 0 || !bOk)
+    {
+        fprintf(stderr, "VisionCli: cannot write %s\n", WideToUtf8(path).c_str());
+        return false;
+    }
+    return true;
+}
+
+// Min / mean / max of microsecond samples, in ms
+void MinMeanMax(const std::vector<double>& us, double& dMin, double& dMean, double& dMax)
+{
+    dMin = *std::min_element(us.begin(), us.end()) / 1000.0;
+    dMax = *std::max_element(us.begin(), us.end()) / 1000.0;
+    dMean = 0.0;
+    for (double v : us) dMean += v;
+    dMean /= us.size() * 1000.0;
+}
+
+// Spans are recorded from the first measured run on
+void BeginTrace(const CliOptions& opt, int nRun)
+{
+    if (!opt.strTrace.empty() && nRun == opt.nWarmup)
+    {
+        CProfiler::GetInstance().Reset();
+        CProfiler::GetInstance().SetEnabled(true);
+    }
+}
+
+bool EndTrace(const CliOptions& opt)
+{
+    if (opt.strTrace.empty())
+        return true;
+    CProfiler& profiler = CProfiler::GetInstance();
+    profiler.SetEnabled(false);
+    printf("profile (%llu span(s) dropped):\n%s", profiler.GetDroppedCount(), profiler.FormatStats().c_str());
+    return profiler.ExportChromeTrace(opt.strTrace);
+}
+
+// One image through the tiled engine; the last measured run streams its result to a .vraw
+int RunTiled(const CliOptions& opt, const CRecipe& recipe, const CImageBuffer& input)
+{
+    if (!recipe.GetROIs().empty())
+    {
+        fprintf(stderr, "VisionCli: tiled runs do not support ROIs; remove them from the recipe\n");
+        return 1;
+    }
+    if (!opt.strFormat.empty() && opt.strFormat != L"vraw")
+    {
+        fprintf(stderr, "VisionCli: tiled results are written as .vraw only\n");
+        return 1;
+    }
+
+    // Steps are added directly: Apply() would size full-frame step buffers, which a frame this
+    // large cannot have
+    std::vector<CAlgorithmBase*> steps = recipe.CreateSteps();
+    if (steps.empty() && !recipe.GetSteps().empty())
+        return 1;
+    CSequenceManager sequence;
+    sequence.SetPointwiseFusion(opt.bFusion);
+    for (CAlgorithmBase* pStep : steps)
+        sequence.AddStep(pStep);
+
+    int nHalo = 0;
+    if (!sequence.CanExecuteTiled(&nHalo))
+    {
+        fprintf(stderr, "VisionCli: the recipe cannot run tiled: a step needs the whole frame\n");
+        return 1;
+    }
+#ifdef _OPENMP
+    if (opt.nThreads > 0)
+        omp_set_num_threads(opt.nThreads);
+#endif
+
+    std::wstring strOutput;
+    if (!opt.strOutputDir.empty())
+    {
+        BatchOptions paths;
+        paths.strOutputDir = opt.strOutputDir;
+        paths.strOutputExtension = L"vraw";
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(opt.strOutputDir), ec);
+        strOutput = CBatchProcessor::GetOutputPath(opt.strInput, paths);
+    }
+
+    std::vector<double> totals;
+    const int nRuns = opt.nWarmup + opt.nRepeat;
+    for (int r = 0; r < nRuns; r++)
+    {
+        // The chain decides the output channels, so the file is opened at the first tile
+        CRawFrameWriter writer;
+        const bool bWrite = !strOutput.empty() && r == nRuns - 1;
+        BeginTrace(opt, r);
+
+        const Clock::time_point t0 = Clock::now();
+        const bool bOk = sequence.ExecuteTiled(input, [&](const ImageRect& rcTile, const ConstImageView& tile) -> bool
+        {
+            if (!bWrite)
+                return true;
+            if (!writer.IsOpen() &&
+                !writer.Open(strOutput, input.GetWidth(), input.GetHeight(), tile.nChannels, tile.eDepth))
+                return false;
+            return writer.WriteRegion(rcTile.left, rcTile.top, tile);
+        });
+        if (!bOk || (writer.IsOpen() && !writer.Close()))
+        {
+            fprintf(stderr, "VisionCli: run %d failed\n", r + 1);
+            return 1;
+        }
+        const double totalUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+        if (r >= opt.nWarmup)
+            totals.push_back(totalUs);
+    }
+
+    printf("%s: %d x %d, %d ch, %d step(s) tiled (%d px tiles, halo %d), %d run(s) after %d warm-up\n",
+        WideToUtf8(opt.strInput).c_str(), input.GetWidth(), input.GetHeight(), input.GetChannels(),
+        sequence.GetStepCount(), sequence.GetTileSize(), nHalo, opt.nRepeat, opt.nWarmup);
+    printf("  %-4s %-24s %10s %10s %10s\n", "", "", "min ms", "mean ms", "max ms");
+    double dMin, dMean, dMax;
+    MinMeanMax(totals, dMin, dMean, dMax);
+    printf("  %-4s %-24s %10.3f %10.3f %10.3f\n", "", "total", dMin, dMean, dMax);
+    char line[256];
+    snprintf(line, sizeof(line), "total,,%.3f,%.3f,%.3f\n", dMin, dMean, dMax);
+    const std::string csv = std::string("step,algorithm,min_ms,mean_ms,max_ms\n") + line;
+    if (!EndTrace(opt))
+        return 1;
+    if (!opt.strReport.empty() && !WriteReport(opt.strReport, csv))
+        return 1;
+    return 0;
+}
+
+// One image through the sequence engine, warm-up and measured runs
+int RunImage(const CliOptions& opt, const CRecipe& recipe)
+{
+    CImageBuffer input;
+    if (!input.LoadFromFile(opt.strInput))
+        return 1;
+
+    // Frames beyond the in-memory limit (mapped .vraw) only fit the tiled engine
+    if (opt.bTiled || input.GetWidth() > MAX_IMAGE_WIDTH || input.GetHeight() > MAX_IMAGE_HEIGHT)
+        return RunTiled(opt, recipe, input);
+
+    // Buffers are sized for the input, so the first run (warm-up or not) allocates no step buffers
+    CSequenceManager sequence;
+    sequence.SetPointwiseFusion(opt.bFusion);
+    sequence.SetStripeExecution(opt.bStripes);
+    if (!recipe.Apply(sequence, &input))
+        return 1;
+#ifdef _OPENMP
+    if (opt.nThreads > 0)
+        omp_set_num_threads(opt.nThreads);
+#endif
+
+    // Step times from the run's StepDone events, which Execute delivers on this thread
+    const int nSteps = sequence.GetStepCount();
+    std::vector<double> stepUs(nSteps, 0.0);
+    CStepTimes stepTimes(stepUs);
+    sequence.SetObserver(&stepTimes);
+
+    std::vector<std::vector<double>> samples(nSteps);
+    std::vector<double> totals;
+    for (int r = 0; r < opt.nWarmup + opt.nRepeat; r++)
+    {
+        // A fresh copy of the pixels each time, or the run would resume from the history
+        CImageBuffer frame;
+        frame.CopyDataFrom(input);
+        std::fill(stepUs.begin(), stepUs.end(), 0.0);
+        BeginTrace(opt, r);
+
+        const Clock::time_point t0 = Clock::now();
+        if (!sequence.Execute(frame))
+        {
+            fprintf(stderr, "VisionCli: run %d failed\n", r + 1);
+            return 1;
+        }
+        const double totalUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+        if (r < opt.nWarmup)
+            continue;
+        for (int k = 0; k < nSteps; k++)
+            samples[k].push_back(stepUs[k]);
+        totals.push_back(totalUs);
+    }
+
+    printf("%s: %d x %d, %d ch, %d step(s), %d run(s) after %d warm-up\n", WideToUtf8(opt.strInput).c_str(),
+        input.GetWidth(), input.GetHeight(), input.GetChannels(), nSteps, opt.nRepeat, opt.nWarmup);
+    printf("  %-4s %-24s %10s %10s %10s\n", "step", "algorithm", "min ms", "mean ms", "max ms");
+    std::string csv = "step,algorithm,min_ms,mean_ms,max_ms\n";
+    char line[256];
+    double dMin, dMean, dMax;
+    for (int k = 0; k < nSteps; k++)
+    {
+        const std::string name = WideToUtf8(sequence.GetStep(k)->GetName());
+        MinMeanMax(samples[k], dMin, dMean, dMax);
+        printf("  %-4d %-24s %10.3f %10.3f %10.3f\n", k + 1, name.c_str(), dMin, dMean, dMax);
+        snprintf(line, sizeof(line), "%d,%s,%.3f,%.3f,%.3f\n", k + 1, name.c_str(), dMin, dMean, dMax);
+        csv += line;
+    }
+    MinMeanMax(totals, dMin, dMean, dMax);
+    printf("  %-4s %-24s %10.3f %10.3f %10.3f\n", "", "total", dMin, dMean, dMax);
+    snprintf(line, sizeof(line), "total,,%.3f,%.3f,%.3f\n", dMin, dMean, dMax);
+    csv += line;
+    if (!EndTrace(opt))
+        return 1;
+
+    if (!opt.strOutputDir.empty())
+    {
+        BatchOptions paths;
+        paths.strOutputDir = opt.strOutputDir;
+        paths.strOutputExtension = opt.strFormat;
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(opt.strOutputDir), ec);
+        CImageBuffer result = sequence.GetHistoryFrame(sequence.GetHistoryCount() - 1);
+        if (!result.SaveToFile(CBatchProcessor::GetOutputPath(opt.strInput, paths)))
+            return 1;
+    }
+    if (!opt.strReport.empty() && !WriteReport(opt.strReport, csv))
+        return 1;
+    return 0;
+}
+
+// A folder through the batch engine; every run processes (and writes) the whole folder
+int RunFolder(const CliOptions& opt, const CRecipe& recipe)
+{
+    const std::vector<std::wstring> files = CBatchProcessor::ListImageFiles(opt.strInput);
+    std::vector<CAlgorithmBase*> steps = recipe.CreateSteps();
+    if (files.empty() || (steps.empty() && !recipe.GetSteps().empty()))
+    {
+        fprintf(stderr, "VisionCli: %s\n", files.empty() ? "no images in the input folder" : "cannot create the steps");
+        for (CAlgorithmBase* p : steps) delete p;
+        return 1;
+    }
+
+    CBatchProcessor batch;
+    for (CAlgorithmBase* p : steps)
+        batch.AddStep(p);
+    batch.SetROIs(recipe.GetROIs());
+
+    BatchOptions options;
+    options.nWorkers           = opt.nWorkers;
+    options.nThreadsPerWorker  = opt.nThreads > 0 ? opt.nThreads : 1;
+    options.strOutputDir       = opt.strOutputDir;
+    options.strOutputExtension = opt.strFormat;
+
+    printf("%s: %d image(s), %d step(s), %d run(s) after %d warm-up\n", WideToUtf8(opt.strInput).c_str(),
+        (int)files.size(), batch.GetStepCount(), opt.nRepeat, opt.nWarmup);
+    printf("  %-4s %10s %10s %8s %8s %8s %10s %10s %7s\n", "run", "images/s", "seconds",
+        "decode", "process", "encode", "p50 ms", "p99 ms", "failed");
+    std::string csv = "run,images_per_sec,seconds,decode_util,process_util,encode_util,p50_ms,p99_ms,failed\n";
+    int nFailed = 0;
+    for (int r = 0; r < opt.nWarmup + opt.nRepeat; r++)
+    {
+        BatchStats stats;
+        BeginTrace(opt, r);
+        if (!batch.Run(files, options, stats))
+            return 1;
+        nFailed += stats.nFailed;
+        if (r < opt.nWarmup)
+            continue;
+
+        char line[256];
+        printf("  %-4d %10.2f %10.3f %7.0f%% %7.0f%% %7.0f%% %10.2f %10.2f %7d\n", r - opt.nWarmup + 1,
+            stats.dImagesPerSec, stats.dElapsedSec, stats.dDecodeUtilisation * 100.0,
+            stats.dProcessUtilisation * 100.0, stats.dEncodeUtilisation * 100.0,
+            stats.dLatencyP50Ms, stats.dLatencyP99Ms, stats.nFailed);
+        snprintf(line, sizeof(line), "%d,%.3f,%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%d\n", r - opt.nWarmup + 1,
+            stats.dImagesPerSec, stats.dElapsedSec, stats.dDecodeUtilisation, stats.dProcessUtilisation,
+            stats.dEncodeUtilisation, stats.dLatencyP50Ms, stats.dLatencyP99Ms, stats.nFailed);
+        csv += line;
+    }
+
+    if (!EndTrace(opt))
+        return 1;
+    if (!opt.strReport.empty() && !WriteReport(opt.strReport, csv))
+        return 1;
+    return nFailed > 0 ? 1 : 0;
+}
+
+int RunCli(const std::vector<std::wstring>& args)
+{
+    CliOptions opt;
+    if (!ParseArgs(args, opt))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    CAlgorithmManager::GetInstance().RegisterAlgorithms();
+    CRecipe recipe;
+    if (!recipe.Load(opt.strRecipe))
+        return 1;
+
+    std::error_code ec;
+    return std::filesystem::is_directory(std::filesystem::path(opt.strInput), ec)
+        ? RunFolder(opt, recipe) : RunImage(opt, recipe);
+}
+
+} // namespace
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t** argv)
+{
+    return RunCli(std::vector<std::wstring>(argv + 1, argv + argc));
+}
+#else
+int main(int argc, char** argv)
+{
+    std::vector<std::wstring> args;
+    for (int i = 1; i < argc; i++)
+        args.push_back(Utf8ToWide(argv[i]));
+    return RunCli(args);
+}
+#endif
@@ -0,0 +1,67 @@
+#include "stdafx.h"
+#include "UI/ImageBitmap.h"
+#include "Core/PixelConvert.h"
+
+// ============================================================================
+// Bitmap Conversion (CImageBuffer RGB rows -> top-down DIB section)
+// ============================================================================
+
+HBITMAP CreateImageHBitmap(const CImageBuffer& image)
+{
+    if (!image.IsValid())
+        return nullptr;
+
+    // DIB sections are 8 bits per sample, interleaved
+    if (image.GetDepth() != PixelDepth::U8 || image.IsPlanar())
+    {
+        CImageBuffer display;
+        return image.ConvertTo(PixelDepth::U8, PixelLayout::Interleaved, display) ? CreateImageHBitmap(display) : nullptr;
+    }
+
+    int         nWidth    = image.GetWidth();
+    int         nHeight   = image.GetHeight();
+    int         nChannels = image.GetChannels();
+    int         nStride   = image.GetStride();
+    const BYTE* pData     = image.GetData();
+
+    HDC hDC = ::GetDC(nullptr);
+    if (hDC == nullptr)
+        return nullptr;
+
+    if (nChannels != 1 && nChannels != 3)
+    {
+        ::ReleaseDC(nullptr, hDC);
+        return nullptr;
+    }
+
+    // Gray and RGB both go to a 32bpp BGRX section: rows need no padding and the
+    // conversion is one SIMD pass per row (no palette, no 24bpp byte swizzle)
+    BITMAPINFO bmi;
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = nWidth;
+    bmi.bmiHeader.biHeight = -nHeight; // Top-down
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    BYTE* pBits = nullptr;
+    HBITMAP hBitmap = ::CreateDIBSection(hDC, &bmi, DIB_RGB_COLORS, reinterpret_cast<void**>(&pBits), nullptr, 0);
+
+    if (hBitmap != nullptr && pBits != nullptr)
+    {
+        const size_t dibStride = (size_t)nWidth * 4;
+        for (int y = 0; y < nHeight; y++)
+        {
+            const BYTE* pSrcRow = pData + (size_t)y * nStride;
+            BYTE* pDstRow = pBits + y * dibStride;
+            if (nChannels == 1)
+                PixelConvert::GrayToBgra(pSrcRow, pDstRow, nWidth);
+            else
+                PixelConvert::RgbToBgra(pSrcRow, pDstRow, nWidth);
+        }
+    }
+
+    ::ReleaseDC(nullptr, hDC);
+    return hBitmap;
+}
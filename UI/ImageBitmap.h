@@ -0,0 +1,5 @@
+#pragma once
+#include "Core/ImageBuffer.h"
+
+// Create a 32bpp BGRX GDI DIB section from a 1- or 3-channel image. Caller owns the HBITMAP.
+HBITMAP CreateImageHBitmap(const CImageBuffer& image);
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "UI/ImageViewer.h"
+#include "UI/ImageBitmap.h"
 #include "Utils/CommonTypes.h"
 
 IMPLEMENT_DYNAMIC(CImageViewer, CStatic)
@@ -20,6 +21,8 @@ END_MESSAGE_MAP()
 
 CImageViewer::CImageViewer()
     : m_hBitmap(NULL)
+    , m_hLevelBitmap(NULL)
+    , m_nBitmapLevel(0)
     , m_hOffscreen(NULL)
     , m_szOffscreen(0, 0)
     , m_bViewDirty(true)
@@ -47,6 +50,7 @@ CImageViewer::CImageViewer()
 CImageViewer::~CImageViewer()
 {
     if (m_hBitmap != NULL)   { ::DeleteObject(m_hBitmap);   m_hBitmap   = NULL; }
+    if (m_hLevelBitmap != NULL) { ::DeleteObject(m_hLevelBitmap); m_hLevelBitmap = NULL; }
     if (m_hOffscreen != NULL) { ::DeleteObject(m_hOffscreen); m_hOffscreen = NULL; }
 }
 
@@ -56,7 +60,12 @@ CImageViewer::~CImageViewer()
 
 void CImageViewer::SetImage(const CImageBuffer& image)
 {
-    m_image = image.Clone();
+    // Display and the pixel readout are 8-bit interleaved; U16/F32 or planar frames are shown
+    // through a converted copy
+    if (image.GetDepth() != PixelDepth::U8 || image.IsPlanar())
+        image.ConvertTo(PixelDepth::U8, PixelLayout::Interleaved, m_image);
+    else
+        m_image = image;   // shares storage (copy-on-write)
     UpdateBitmap();
     m_bViewDirty = true;
     FitToWindow();       // FitToWindow calls Invalidate internally
@@ -66,6 +75,8 @@ void CImageViewer::ClearImage()
 {
     m_image.Release();
     if (m_hBitmap != NULL)   { ::DeleteObject(m_hBitmap);   m_hBitmap   = NULL; }
+    if (m_hLevelBitmap != NULL) { ::DeleteObject(m_hLevelBitmap); m_hLevelBitmap = NULL; }
+    m_nBitmapLevel = 0;
     if (m_hOffscreen != NULL) { ::DeleteObject(m_hOffscreen); m_hOffscreen = NULL; }
     m_dZoom = 1.0;
     m_ptPan = CPoint(0, 0);
@@ -85,8 +96,30 @@ void CImageViewer::UpdateBitmap()
         ::DeleteObject(m_hBitmap);
         m_hBitmap = NULL;
     }
+    if (m_hLevelBitmap != NULL)
+    {
+        ::DeleteObject(m_hLevelBitmap);
+        m_hLevelBitmap = NULL;
+    }
+    m_nBitmapLevel = 0;
     if (m_image.IsValid())
-        m_hBitmap = m_image.CreateHBitmap();
+        m_hBitmap = CreateImageHBitmap(m_image);
+}
+
+// Bitmap of pyramid level 'level' (0 = full resolution). Zoomed-out views stretch from the
+// nearest level, so HALFTONE never has to reduce the full frame; one level is kept at a time.
+HBITMAP CImageViewer::GetLevelBitmap(int level)
+{
+    if (level <= 0)
+        return m_hBitmap;
+    if (m_hLevelBitmap == NULL || m_nBitmapLevel != level)
+    {
+        if (m_hLevelBitmap != NULL)
+            ::DeleteObject(m_hLevelBitmap);
+        m_hLevelBitmap = CreateImageHBitmap(m_image.GetPyramidLevel(level));
+        m_nBitmapLevel = level;
+    }
+    return m_hLevelBitmap != NULL ? m_hLevelBitmap : m_hBitmap;
 }
 
 // ============================================================================
@@ -545,16 +578,20 @@ void CImageViewer::OnPaint()
 
         if (m_image.IsValid() && m_hBitmap)
         {
+            // Zoomed out: stretch from the smallest pyramid level still >= the on-screen size
+            CRect rcImage = GetImageRect();
+            HBITMAP hSource = GetLevelBitmap(m_image.SelectPyramidLevel(rcImage.Width(), rcImage.Height()));
+            int nSourceLevel = (hSource == m_hBitmap) ? 0 : m_nBitmapLevel;
+
             CDC imgDC;
             imgDC.CreateCompatibleDC(&dc);
-            HBITMAP hOldImg = (HBITMAP)imgDC.SelectObject(m_hBitmap);
+            HBITMAP hOldImg = (HBITMAP)imgDC.SelectObject(hSource);
 
-            CRect rcImage = GetImageRect();
             int prevMode = offDC.SetStretchBltMode(HALFTONE);
             ::SetBrushOrgEx(offDC.GetSafeHdc(), 0, 0, NULL);
             offDC.StretchBlt(
                 rcImage.left, rcImage.top, rcImage.Width(), rcImage.Height(),
-                &imgDC, 0, 0, m_image.GetWidth(), m_image.GetHeight(), SRCCOPY);
+                &imgDC, 0, 0, m_image.GetWidth() >> nSourceLevel, m_image.GetHeight() >> nSourceLevel, SRCCOPY);
             offDC.SetStretchBltMode(prevMode);
             imgDC.SelectObject(hOldImg);
         }
@@ -724,7 +761,7 @@ void CImageViewer::OnMouseMove(UINT nFlags, CPoint point)
             m_ptMouseImg    = imgPt;
             m_bHasPixelInfo = true;
 
-            const BYTE* pSrc   = m_image.GetData();
+            const BYTE* pSrc   = m_image.GetConstData();
             int nChannels       = m_image.GetChannels();
             int nStride         = m_image.GetStride();
             const BYTE* pPixel  = pSrc + imgPt.y * nStride + imgPt.x * nChannels;
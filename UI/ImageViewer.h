@@ -58,6 +58,8 @@ protected:
 private:
     CImageBuffer m_image;
     HBITMAP      m_hBitmap;       // source image bitmap (image-space)
+    HBITMAP      m_hLevelBitmap;  // pyramid level bitmap used when zoomed out (see m_nBitmapLevel)
+    int          m_nBitmapLevel;  // pyramid level held in m_hLevelBitmap (0 = none)
     HBITMAP      m_hOffscreen;    // cached rendered view (screen-space, no overlays)
     CSize        m_szOffscreen;   // size of cached bitmap
     bool         m_bViewDirty;    // true when image/zoom/pan changed → re-render cache
@@ -91,6 +93,7 @@ private:
     CString      m_strOverlayInfo;     // multi-line text (lines separated by '\n'), shown top-right in green
 
     void UpdateBitmap();
+    HBITMAP GetLevelBitmap(int level);
     void ClampPan();
     CRect GetImageRect();
 
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "UI/MiniViewer.h"
+#include "UI/ImageBitmap.h"
 #include "Utils/CommonTypes.h"
 
 IMPLEMENT_DYNAMIC(CMiniViewer, CStatic)
@@ -11,7 +12,9 @@ BEGIN_MESSAGE_MAP(CMiniViewer, CStatic)
 END_MESSAGE_MAP()
 
 CMiniViewer::CMiniViewer()
-    : m_hBitmap(NULL)
+    : m_nImageWidth(0)
+    , m_nImageHeight(0)
+    , m_hBitmap(NULL)
     , m_bSelected(false)
     , m_nIndex(-1)
 {
@@ -28,8 +31,7 @@ CMiniViewer::~CMiniViewer()
 
 void CMiniViewer::SetImage(const CImageBuffer& image)
 {
-    m_image = image.Clone();
-    UpdateBitmap();
+    UpdateBitmap(image);
     Invalidate(FALSE);
 }
 
@@ -41,7 +43,7 @@ void CMiniViewer::SetLabel(const CString& label)
 
 void CMiniViewer::Clear()
 {
-    m_image.Release();
+    m_nImageWidth = m_nImageHeight = 0;
     if (m_hBitmap != NULL)
     {
         ::DeleteObject(m_hBitmap);
@@ -63,7 +65,7 @@ void CMiniViewer::SetSelected(bool bSelected)
 
 void CMiniViewer::OnLButtonDown(UINT nFlags, CPoint point)
 {
-    if (m_image.IsValid())
+    if (HasImage())
     {
         CWnd* pParent = GetParent();
         if (pParent != nullptr && ::IsWindow(pParent->GetSafeHwnd()))
@@ -74,7 +76,7 @@ void CMiniViewer::OnLButtonDown(UINT nFlags, CPoint point)
     CStatic::OnLButtonDown(nFlags, point);
 }
 
-void CMiniViewer::UpdateBitmap()
+void CMiniViewer::UpdateBitmap(const CImageBuffer& image)
 {
     if (m_hBitmap != NULL)
     {
@@ -82,7 +84,8 @@ void CMiniViewer::UpdateBitmap()
         m_hBitmap = NULL;
     }
 
-    if (!m_image.IsValid())
+    m_nImageWidth = m_nImageHeight = 0;
+    if (!image.IsValid())
         return;
 
     CRect rcClient;
@@ -97,10 +100,13 @@ void CMiniViewer::UpdateBitmap()
         maxH = 120;
     }
 
-    CImageBuffer thumbnail = m_image.CreateThumbnail(maxW, maxH);
+    // Resampled from the frame's cached pyramid, shared with the main view and the history
+    CImageBuffer thumbnail = image.CreateThumbnail(maxW, maxH);
     if (thumbnail.IsValid())
     {
-        m_hBitmap = thumbnail.CreateHBitmap();
+        m_hBitmap = CreateImageHBitmap(thumbnail);
+        m_nImageWidth = image.GetWidth();
+        m_nImageHeight = image.GetHeight();
     }
 }
 
@@ -119,7 +125,7 @@ void CMiniViewer::OnPaint()
 
     memDC.FillSolidRect(&rcClient, RGB(50, 50, 50));
 
-    if (m_image.IsValid() && m_hBitmap != NULL)
+    if (HasImage())
     {
         BITMAP bm;
         ::GetObject(m_hBitmap, sizeof(BITMAP), &bm);
@@ -130,12 +136,12 @@ void CMiniViewer::OnPaint()
         int labelBarHeight = 18;
         int availH = rcClient.Height() - labelBarHeight;
 
-        double scaleX = (double)rcClient.Width() / (double)m_image.GetWidth();
-        double scaleY = (double)availH / (double)m_image.GetHeight();
+        double scaleX = (double)rcClient.Width() / (double)m_nImageWidth;
+        double scaleY = (double)availH / (double)m_nImageHeight;
         double scale = min(scaleX, scaleY);
 
-        int scaledW = (int)(m_image.GetWidth() * scale);
-        int scaledH = (int)(m_image.GetHeight() * scale);
+        int scaledW = (int)(m_nImageWidth * scale);
+        int scaledH = (int)(m_nImageHeight * scale);
         int drawX = (rcClient.Width() - scaledW) / 2;
         int drawY = (availH - scaledH) / 2;
 
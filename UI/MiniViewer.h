@@ -7,11 +7,11 @@ public:
     CMiniViewer();
     virtual ~CMiniViewer();
 
+    // Keeps only the thumbnail; the frame itself stays with its owner (e.g. the history)
     void SetImage(const CImageBuffer& image);
     void SetLabel(const CString& label);
     void Clear();
-    bool HasImage() const { return m_image.IsValid(); }
-    const CImageBuffer& GetImage() const { return m_image; }
+    bool HasImage() const { return m_hBitmap != NULL; }
     const CString& GetLabel() const { return m_strLabel; }
 
     void SetSelected(bool bSelected);
@@ -26,10 +26,11 @@ protected:
     DECLARE_MESSAGE_MAP()
 
 private:
-    CImageBuffer m_image;
+    int m_nImageWidth;    // size of the frame the thumbnail shows
+    int m_nImageHeight;
     CString m_strLabel;
     HBITMAP m_hBitmap;
     bool m_bSelected;
     int m_nIndex;
-    void UpdateBitmap();
+    void UpdateBitmap(const CImageBuffer& image);
 };
@@ -131,14 +131,14 @@ void CParameterPanel::CreateParamControls()
 
         // Label
         ctrl.pLabel = new CStatic();
-        ctrl.pLabel->Create(param.strName,
+        ctrl.pLabel->Create(param.strName.c_str(),
             WS_CHILD | WS_VISIBLE | SS_LEFT | SS_CENTERIMAGE,
             CRect(0,0,10,10), this, LABEL_ID_BASE + i);
         ctrl.pLabel->SetFont(GetFont());
 
         // Description text (small, gray)
         ctrl.pDesc = new CStatic();
-        ctrl.pDesc->Create(param.strDescription,
+        ctrl.pDesc->Create(param.strDescription.c_str(),
             WS_CHILD | WS_VISIBLE | SS_LEFT,
             CRect(0,0,10,10), this, DESC_ID_BASE + i);
         ctrl.pDesc->SetFont(GetFont());
@@ -152,8 +152,8 @@ void CParameterPanel::CreateParamControls()
                 CRect(0,0,10,10), this, COMBO_ID_BASE + i);
             ctrl.pCombo->SetFont(GetFont());
 
-            for (const CString& opt : param.vecOptions)
-                ctrl.pCombo->AddString(opt);
+            for (const std::wstring& opt : param.vecOptions)
+                ctrl.pCombo->AddString(opt.c_str());
             ctrl.pCombo->SetCurSel((int)param.dCurrentVal);
 
             ctrl.pSlider = nullptr;
@@ -329,7 +329,7 @@ void CParameterPanel::UpdateParamVisibility()
         }
     }
 
-    CString algName = m_pAlgorithm->GetName();
+    CString algName = m_pAlgorithm->GetName().c_str();
 
     if (algName == _T("Binarize") && method >= 0 && n >= 4)
     {
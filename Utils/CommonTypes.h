@@ -1,14 +1,8 @@
 #pragma once
+#include "Core/CoreTypes.h"   // MAX_IMAGE_WIDTH / MAX_IMAGE_HEIGHT, ImageRect
 
-// Maximum supported image dimensions
-#define MAX_IMAGE_WIDTH     5120
-#define MAX_IMAGE_HEIGHT    5120
-
-// Custom Windows messages for sequence processing
-#define WM_SEQUENCE_PROGRESS    (WM_USER + 100)
-#define WM_SEQUENCE_COMPLETE    (WM_USER + 101)
-#define WM_SEQUENCE_ERROR       (WM_USER + 102)
-#define WM_SEQUENCE_STEP_DONE   (WM_USER + 103)
+// Sequence events are waiting in the dialog's event queue (posted once per batch)
+#define WM_SEQUENCE_EVENTS      (WM_USER + 100)
 
 // MiniViewer click notification (WPARAM = viewer index 0-7)
 #define WM_MINIVIEWER_CLICKED   (WM_USER + 200)
@@ -19,6 +13,9 @@
 // Parameter changed notification (triggers real-time preview)
 #define WM_PARAM_CHANGED        (WM_USER + 202)
 
+// Memory the processing history may keep resident; older frames beyond it are spilled to disk
+#define HISTORY_MEMORY_BUDGET_MB    512
+
 // Supported image file formats
 enum class ImageFormat {
     BMP,
@@ -0,0 +1,70 @@
+#include "Utils/Logger.h"
+#include "Utils/StringUtil.h"
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <cwchar>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+void CLogger::Log(const wchar_t* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    Write(L"", format, args);
+    va_end(args);
+}
+
+void CLogger::Error(const wchar_t* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    Write(L"[ERROR]", format, args);
+    va_end(args);
+}
+
+void CLogger::Info(const wchar_t* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    Write(L"[INFO]", format, args);
+    va_end(args);
+}
+
+void CLogger::Write(const wchar_t* level, const wchar_t* format, va_list args)
+{
+    wchar_t message[1024];
+    if (vswprintf(message, sizeof(message) / sizeof(message[0]), format, args) < 0)
+        message[sizeof(message) / sizeof(message[0]) - 1] = L'\0';   // truncated
+
+    // Local timestamp with milliseconds
+    auto now = std::chrono::system_clock::now();
+    std::time_t t = std::chrono::system_clock::to_time_t(now);
+    int ms = (int)(std::chrono::duration_cast<std::chrono::milliseconds>(
+        now.time_since_epoch()).count() % 1000);
+    std::tm tmLocal;
+#ifdef _WIN32
+    localtime_s(&tmLocal, &t);
+#else
+    localtime_r(&t, &tmLocal);
+#endif
+
+    wchar_t line[1200];
+    swprintf(line, sizeof(line) / sizeof(line[0]), L"[%04d-%02d-%02d %02d:%02d:%02d.%03d]%ls %ls\n",
+        tmLocal.tm_year + 1900, tmLocal.tm_mon + 1, tmLocal.tm_mday,
+        tmLocal.tm_hour, tmLocal.tm_min, tmLocal.tm_sec, ms, level, message);
+
+#ifdef _WIN32
+    OutputDebugStringW(line);
+#else
+    // stderr is byte-oriented; encode as UTF-8 so Korean text survives
+    std::string utf8 = WideToUtf8(line);
+    fputs(utf8.c_str(), stderr);
+#endif
+}
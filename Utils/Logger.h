@@ -1,68 +1,19 @@
 #pragma once
 
-#include <afxwin.h>
 #include <cstdarg>
 
+// printf-style wide-string logger. Use %ls for wide string arguments (portable between the
+// MSVC and glibc wide printf families). Output goes to OutputDebugString on Windows and to
+// stderr elsewhere.
 class CLogger
 {
 public:
-    static void Log(LPCTSTR format, ...)
-    {
-        CString strTimestamp = GetTimestamp();
-        CString strMessage;
-
-        va_list args;
-        va_start(args, format);
-        strMessage.FormatV(format, args);
-        va_end(args);
-
-        CString strOutput;
-        strOutput.Format(_T("[%s] %s\n"), (LPCTSTR)strTimestamp, (LPCTSTR)strMessage);
-        OutputDebugString(strOutput);
-    }
-
-    static void Error(LPCTSTR format, ...)
-    {
-        CString strTimestamp = GetTimestamp();
-        CString strMessage;
-
-        va_list args;
-        va_start(args, format);
-        strMessage.FormatV(format, args);
-        va_end(args);
-
-        CString strOutput;
-        strOutput.Format(_T("[%s][ERROR] %s\n"), (LPCTSTR)strTimestamp, (LPCTSTR)strMessage);
-        OutputDebugString(strOutput);
-    }
-
-    static void Info(LPCTSTR format, ...)
-    {
-        CString strTimestamp = GetTimestamp();
-        CString strMessage;
-
-        va_list args;
-        va_start(args, format);
-        strMessage.FormatV(format, args);
-        va_end(args);
-
-        CString strOutput;
-        strOutput.Format(_T("[%s][INFO] %s\n"), (LPCTSTR)strTimestamp, (LPCTSTR)strMessage);
-        OutputDebugString(strOutput);
-    }
+    static void Log(const wchar_t* format, ...);
+    static void Error(const wchar_t* format, ...);
+    static void Info(const wchar_t* format, ...);
 
 private:
-    static CString GetTimestamp()
-    {
-        SYSTEMTIME st;
-        GetLocalTime(&st);
-
-        CString strTime;
-        strTime.Format(_T("%04d-%02d-%02d %02d:%02d:%02d.%03d"),
-            st.wYear, st.wMonth, st.wDay,
-            st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
-        return strTime;
-    }
+    static void Write(const wchar_t* level, const wchar_t* format, va_list args);
 
     // Prevent instantiation
     CLogger() = delete;
@@ -0,0 +1,87 @@
+#include "Utils/StringUtil.h"
+#include <cwctype>
+
+std::string WideToUtf8(const std::wstring& text)
+{
+    std::string utf8;
+    utf8.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        unsigned long c = (unsigned long)text[i];
+
+        // UTF-16 surrogate pair (wchar_t is 16-bit on Windows)
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < text.size())
+        {
+            unsigned long lo = (unsigned long)text[i + 1];
+            if (lo >= 0xDC00 && lo <= 0xDFFF)
+            {
+                c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+                i++;
+            }
+        }
+
+        if (c < 0x80)       utf8 += (char)c;
+        else if (c < 0x800) { utf8 += (char)(0xC0 | (c >> 6)); utf8 += (char)(0x80 | (c & 0x3F)); }
+        else if (c < 0x10000)
+        {
+            utf8 += (char)(0xE0 | (c >> 12));
+            utf8 += (char)(0x80 | ((c >> 6) & 0x3F));
+            utf8 += (char)(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            utf8 += (char)(0xF0 | (c >> 18));
+            utf8 += (char)(0x80 | ((c >> 12) & 0x3F));
+            utf8 += (char)(0x80 | ((c >> 6) & 0x3F));
+            utf8 += (char)(0x80 | (c & 0x3F));
+        }
+    }
+    return utf8;
+}
+
+std::wstring Utf8ToWide(const std::string& text)
+{
+    std::wstring wide;
+    wide.reserve(text.size());
+    size_t i = 0;
+    while (i < text.size())
+    {
+        unsigned char b = (unsigned char)text[i];
+        unsigned long c;
+        int extra;
+        if (b < 0x80)              { c = b;        extra = 0; }
+        else if ((b >> 5) == 0x6)  { c = b & 0x1F; extra = 1; }
+        else if ((b >> 4) == 0xE)  { c = b & 0x0F; extra = 2; }
+        else if ((b >> 3) == 0x1E) { c = b & 0x07; extra = 3; }
+        else                       { c = 0xFFFD;   extra = 0; }   // invalid lead byte
+        i++;
+
+        for (int k = 0; k < extra; k++, i++)
+        {
+            if (i >= text.size() || ((unsigned char)text[i] >> 6) != 0x2) { c = 0xFFFD; break; }
+            c = (c << 6) | ((unsigned char)text[i] & 0x3F);
+        }
+
+        if (sizeof(wchar_t) == 2 && c >= 0x10000)
+        {
+            c -= 0x10000;
+            wide += (wchar_t)(0xD800 + (c >> 10));
+            wide += (wchar_t)(0xDC00 + (c & 0x3FF));
+        }
+        else
+            wide += (wchar_t)c;
+    }
+    return wide;
+}
+
+std::wstring GetFileExtension(const std::wstring& path)
+{
+    size_t dot = path.rfind(L'.');
+    size_t sep = path.find_last_of(L"\\/");
+    if (dot == std::wstring::npos || (sep != std::wstring::npos && dot < sep))
+        return std::wstring();
+
+    std::wstring ext = path.substr(dot + 1);
+    for (auto& ch : ext) ch = (wchar_t)towlower(ch);
+    return ext;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+// Wide/UTF-8 conversion and path helpers shared by the portable core.
+// Paths are std::wstring everywhere; POSIX file APIs receive them as UTF-8.
+
+std::string  WideToUtf8(const std::wstring& text);
+std::wstring Utf8ToWide(const std::string& text);
+
+// Lower-case extension without the dot ("C:\\a\\b.PNG" -> "png"); empty if none
+std::wstring GetFileExtension(const std::wstring& path);
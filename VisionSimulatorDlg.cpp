@@ -1,11 +1,24 @@
 #include "stdafx.h"
 #include "VisionSimulatorApp.h"
 #include "VisionSimulatorDlg.h"
+#include "Core/Profiler.h"
+#include "Core/Recipe.h"
+#include "Utils/StringUtil.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
 #endif
 
+// Viewer ROIs are CRects; the core library takes ImageRect (same layout and semantics)
+static std::vector<ImageRect> ToImageRects(const std::vector<CRect>& rcs)
+{
+    std::vector<ImageRect> out;
+    out.reserve(rcs.size());
+    for (const CRect& rc : rcs)
+        out.push_back(ImageRect(rc.left, rc.top, rc.right, rc.bottom));
+    return out;
+}
+
 IMPLEMENT_DYNAMIC(CVisionSimulatorDlg, CDialogEx)
 
 BEGIN_MESSAGE_MAP(CVisionSimulatorDlg, CDialogEx)
@@ -31,13 +44,14 @@ BEGIN_MESSAGE_MAP(CVisionSimulatorDlg, CDialogEx)
     ON_BN_CLICKED(IDC_BTN_CLEAR_ROI,  &CVisionSimulatorDlg::OnBnClickedClearROI)
     ON_BN_CLICKED(IDC_BTN_REMOVE_ROI, &CVisionSimulatorDlg::OnBnClickedRemoveROI)
     ON_BN_CLICKED(IDC_BTN_CLEAR_ROIS, &CVisionSimulatorDlg::OnBnClickedClearROIs)
+    ON_BN_CLICKED(IDC_BTN_LOAD_RECIPE, &CVisionSimulatorDlg::OnBnClickedLoadRecipe)
+    ON_BN_CLICKED(IDC_BTN_SAVE_RECIPE, &CVisionSimulatorDlg::OnBnClickedSaveRecipe)
+    ON_BN_CLICKED(IDC_BTN_PROFILE,     &CVisionSimulatorDlg::OnBnClickedProfile)
+    ON_BN_CLICKED(IDC_BTN_SAVE_TRACE,  &CVisionSimulatorDlg::OnBnClickedSaveTrace)
     ON_CBN_SELCHANGE(IDC_COMBO_ALGORITHM, &CVisionSimulatorDlg::OnCbnSelchangeAlgorithm)
     ON_LBN_SELCHANGE(IDC_LIST_SEQUENCE,   &CVisionSimulatorDlg::OnLbnSelchangeSequence)
     ON_LBN_SELCHANGE(IDC_LIST_ROI,        &CVisionSimulatorDlg::OnLbnSelchangeROI)
-    ON_MESSAGE(WM_SEQUENCE_PROGRESS,  &CVisionSimulatorDlg::OnSequenceProgress)
-    ON_MESSAGE(WM_SEQUENCE_COMPLETE,  &CVisionSimulatorDlg::OnSequenceComplete)
-    ON_MESSAGE(WM_SEQUENCE_ERROR,     &CVisionSimulatorDlg::OnSequenceError)
-    ON_MESSAGE(WM_SEQUENCE_STEP_DONE, &CVisionSimulatorDlg::OnSequenceStepDone)
+    ON_MESSAGE(WM_SEQUENCE_EVENTS,    &CVisionSimulatorDlg::OnSequenceEvents)
     ON_MESSAGE(WM_MINIVIEWER_CLICKED, &CVisionSimulatorDlg::OnMiniViewerClicked)
     ON_MESSAGE(WM_ROI_UPDATED,        &CVisionSimulatorDlg::OnROIUpdated)
     ON_MESSAGE(WM_PARAM_CHANGED,      &CVisionSimulatorDlg::OnParamChanged)
@@ -45,11 +59,13 @@ END_MESSAGE_MAP()
 
 CVisionSimulatorDlg::CVisionSimulatorDlg(CWnd* pParent)
     : CDialogEx(IDD_VISIONSIMULATOR_DIALOG, pParent)
+    , m_nEventDropsLogged(0)
     , m_pCurrentAlgorithm(nullptr)
     , m_bInitialized(false)
-    , m_nMinWidth(1100)
+    , m_nMinWidth(1200)   // the toolbar ends just left of the Fit/zoom block at this width
     , m_nMinHeight(768)
     , m_nSelectedMiniViewer(-1)
+    , m_nMiniViewerFrames(0)
     , m_nEditingSequenceStep(-1)
     , m_bPreviewPending(false)
     , m_pPreviewThread(nullptr)
@@ -95,7 +111,20 @@ BOOL CVisionSimulatorDlg::OnInitDialog()
 
     CreateControls();
     InitAlgorithmCombo();
-    m_sequenceManager.SetNotifyWnd(GetSafeHwnd());
+    // Core events arrive on the worker thread and queue up in m_sequenceEvents; the first one
+    // after a drain wakes the UI thread, which handles the whole batch in OnSequenceEvents
+    HWND hNotify = GetSafeHwnd();
+    m_sequenceEvents.SetWakeFn([hNotify]()
+    {
+        if (::IsWindow(hNotify))
+            ::PostMessage(hNotify, WM_SEQUENCE_EVENTS, 0, 0);
+    });
+    m_sequenceManager.SetObserver(&m_sequenceEvents);
+    m_sequenceManager.SetHistoryBudget((size_t)HISTORY_MEMORY_BUDGET_MB << 20);
+    // The history panel thumbnails every step, which would regenerate each fused frame at once
+    m_sequenceManager.SetPointwiseFusion(false);
+    // Profiling stays off until [Profile] turns it on: every span costs a string and log space
+    CProfiler::GetInstance().SetEnabled(false);
 
     SetWindowPos(NULL, 0, 0, 1280, 960, SWP_NOMOVE | SWP_NOZORDER);
     CenterWindow();
@@ -119,6 +148,10 @@ void CVisionSimulatorDlg::CreateControls()
     m_btnSave.Create(_T("Save"),       btnStyle, CRect(0,0,10,10), this, IDC_BTN_SAVE);
     m_btnROI.Create(_T("ROI Mode"),    btnStyle, CRect(0,0,10,10), this, IDC_BTN_ROI);
     m_btnClearROI.Create(_T("Clr ROI"),btnStyle, CRect(0,0,10,10), this, IDC_BTN_CLEAR_ROI);
+    m_btnLoadRecipe.Create(_T("Load Recipe"), btnStyle, CRect(0,0,10,10), this, IDC_BTN_LOAD_RECIPE);
+    m_btnSaveRecipe.Create(_T("Save Recipe"), btnStyle, CRect(0,0,10,10), this, IDC_BTN_SAVE_RECIPE);
+    m_btnProfile.Create(_T("Profile"),        btnStyle, CRect(0,0,10,10), this, IDC_BTN_PROFILE);
+    m_btnSaveTrace.Create(_T("Save Trace"),   btnStyle, CRect(0,0,10,10), this, IDC_BTN_SAVE_TRACE);
     m_btnFit.Create(_T("Fit"),         btnStyle, CRect(0,0,10,10), this, IDC_BTN_FIT);
 
     // Main viewer
@@ -200,6 +233,10 @@ void CVisionSimulatorDlg::LayoutControls()
     m_btnSave.MoveWindow(tx, ty, 80, bH);     tx += 84;
     m_btnROI.MoveWindow(tx, ty, 75, bH);      tx += 79;
     m_btnClearROI.MoveWindow(tx, ty, 70, bH); tx += 74;
+    m_btnLoadRecipe.MoveWindow(tx, ty, 90, bH); tx += 94;
+    m_btnSaveRecipe.MoveWindow(tx, ty, 90, bH); tx += 94;
+    m_btnProfile.MoveWindow(tx, ty, 70, bH);    tx += 74;
+    m_btnSaveTrace.MoveWindow(tx, ty, 85, bH);  tx += 89;
     m_btnFit.MoveWindow(W - rightW - margin, ty, 45, bH);
     m_staticZoom.MoveWindow(W - rightW - margin + 50, ty + 4, 65, bH - 4);
 
@@ -329,7 +366,7 @@ void CVisionSimulatorDlg::InitAlgorithmCombo()
 {
     CAlgorithmManager& mgr = CAlgorithmManager::GetInstance();
     for (int i = 0; i < mgr.GetAlgorithmCount(); i++)
-        m_comboAlgorithm.AddString(mgr.GetAlgorithmName(i));
+        m_comboAlgorithm.AddString(mgr.GetAlgorithmName(i).c_str());
     if (m_comboAlgorithm.GetCount() > 0)
     {
         m_comboAlgorithm.SetCurSel(0);
@@ -370,13 +407,13 @@ void CVisionSimulatorDlg::OnLbnSelchangeSequence()
         // Point panel directly to the sequence step (live editing)
         m_paramPanel.SetAlgorithm(pStep);
         // Update combo to reflect algorithm type
-        CString name = pStep->GetName();
+        CString name = pStep->GetName().c_str();
         for (int i = 0; i < m_comboAlgorithm.GetCount(); i++)
         {
             CString s; m_comboAlgorithm.GetLBText(i, s);
             if (s == name) { m_comboAlgorithm.SetCurSel(i); break; }
         }
-        SetStatus(_T("Editing sequence step ") + pStep->GetName() + _T(" - adjust sliders for live preview"));
+        SetStatus(_T("Editing sequence step ") + CString(pStep->GetName().c_str()) + _T(" - adjust sliders for live preview"));
     }
 }
 
@@ -391,7 +428,7 @@ LRESULT CVisionSimulatorDlg::OnROIUpdated(WPARAM wParam, LPARAM lParam)
 {
     UpdateROIList();
     // Sync sequence manager ROIs
-    m_sequenceManager.SetROIs(m_mainViewer.GetROIs());
+    m_sequenceManager.SetROIs(ToImageRects(m_mainViewer.GetROIs()));
     return 0;
 }
 
@@ -454,19 +491,23 @@ void CVisionSimulatorDlg::QueuePreview()
     CAlgorithmBase* pAlg = m_paramPanel.GetAlgorithm();
     if (!pAlg) return;
 
-    // Determine source image (no Clone — CopyDataFrom reuses m_previewInputBuf allocation)
-    const CImageBuffer* pSrc = &m_originalImage;
-    const auto& history = m_sequenceManager.GetHistory();
-    if (m_nEditingSequenceStep > 0 && (int)history.size() > m_nEditingSequenceStep)
-        pSrc = &history[m_nEditingSequenceStep];
+    // Determine source image (shared, copy-on-write — no pixel copy); an evicted history
+    // frame is reloaded here, and the preview's reference keeps it resident while editing
+    CImageBuffer src = m_originalImage;
+    if (m_nEditingSequenceStep > 0 && m_sequenceManager.GetHistoryCount() > m_nEditingSequenceStep)
+    {
+        CImageBuffer frame = m_sequenceManager.GetHistoryFrame(m_nEditingSequenceStep);
+        if (frame.IsValid())
+            src = frame;
+    }
 
-    // Pack data for thread — CopyDataFrom avoids malloc after first call
+    // Pack data for thread
     {
         CSingleLock lock(&m_csPreview, TRUE);
-        m_previewInputBuf.CopyDataFrom(*pSrc);   // 0 malloc after 1st call (same size)
+        m_previewInputBuf = src;
         if (m_pPreviewAlgCopy) { delete m_pPreviewAlgCopy; m_pPreviewAlgCopy = nullptr; }
         m_pPreviewAlgCopy = pAlg->Clone();
-        m_previewROIs     = m_mainViewer.GetROIs();
+        m_previewROIs     = ToImageRects(m_mainViewer.GetROIs());
         m_bNewPreviewPending = true;
     }
 
@@ -482,9 +523,8 @@ UINT CVisionSimulatorDlg::PreviewThreadProc(LPVOID pParam)
     // Thread-local persistent buffers — survive between previews so OS pages stay warm.
     // After the first preview these are reused without any malloc or page fault.
     CImageBuffer              threadInput;
-    CImageBuffer              threadOutput;
-    std::vector<CImageBuffer> threadROIIn;
-    std::vector<CImageBuffer> threadROIOut;
+    PipelineBuffers           threadBufs;
+    CImageBuffer&             threadOutput = threadBufs.stepOutput;
 
     while (true)
     {
@@ -493,13 +533,13 @@ UINT CVisionSimulatorDlg::PreviewThreadProc(LPVOID pParam)
         if (dw != WAIT_OBJECT_0) continue;
 
 restart:
-        // Grab data — CopyDataFrom under lock (brief ~0.5ms hold for 6MB copy)
+        // Grab data under lock (shares m_previewInputBuf's storage, no copy)
         CAlgorithmBase* pAlg = nullptr;
-        std::vector<CRect> rois;
+        std::vector<ImageRect> rois;
         {
             CSingleLock lock(&pDlg->m_csPreview, TRUE);
             if (!pDlg->m_bNewPreviewPending) continue;
-            threadInput.CopyDataFrom(pDlg->m_previewInputBuf);  // 0 malloc after 1st call
+            threadInput = pDlg->m_previewInputBuf;
             pAlg = pDlg->m_pPreviewAlgCopy;
             pDlg->m_pPreviewAlgCopy = nullptr;
             rois = pDlg->m_previewROIs;
@@ -509,37 +549,15 @@ restart:
 
         pDlg->m_bPreviewCancel = false;
 
-        // Prepare ROI buffers (smart Create = 0 malloc if size unchanged)
-        threadROIIn.resize(rois.size());
-        threadROIOut.resize(rois.size());
-        for (int j = 0; j < (int)rois.size(); j++)
-        {
-            threadROIIn[j].Create(rois[j].Width(), rois[j].Height(), threadInput.GetChannels());
-            threadROIOut[j].Create(rois[j].Width(), rois[j].Height(), threadInput.GetChannels());
-        }
-
         auto t0 = std::chrono::high_resolution_clock::now();
-        bool success = false;
 
-        if (rois.empty())
-        {
-            // Smart Create inside Process reuses threadOutput allocation
-            success = pAlg->Process(threadInput, threadOutput);
-        }
-        else
-        {
-            success = threadOutput.CopyDataFrom(threadInput);  // composite base
-            if (success)
-            {
-                for (int j = 0; j < (int)rois.size(); j++)
-                {
-                    if (pDlg->m_bPreviewCancel) { success = false; break; }
-                    if (!threadInput.ExtractRegionInto(rois[j], threadROIIn[j])) continue;
-                    if (pAlg->Process(threadROIIn[j], threadROIOut[j]) && threadROIOut[j].IsValid())
-                        threadOutput.PasteRegion(threadROIOut[j], rois[j].left, rois[j].top);
-                }
-            }
-        }
+        // Same step executor as the sequence thread (zero-copy ROIs for view algorithms)
+        CProfileScope span("preview");
+        if (span.IsActive())
+            span.SetName(pAlg->GetName());
+        bool success = CSequenceManager::ProcessStep(pAlg, threadInput, threadOutput, rois,
+                                                     threadBufs, &pDlg->m_bPreviewCancel);
+        span.End();
 
         delete pAlg;
 
@@ -548,9 +566,9 @@ restart:
 
         if (success && !pDlg->m_bPreviewCancel && ::IsWindow(pDlg->GetSafeHwnd()))
         {
-            // One malloc per result to hand off to UI thread (unavoidable — thread reuses threadOutput)
-            CImageBuffer* pResult = new CImageBuffer();
-            pResult->CopyDataFrom(threadOutput);
+            // Hand off a shared reference; the next preview's write into threadOutput
+            // detaches into a fresh pooled block instead of copying here
+            CImageBuffer* pResult = new CImageBuffer(threadOutput);
             ::PostMessage(pDlg->GetSafeHwnd(), WM_PREVIEW_RESULT,
                 reinterpret_cast<WPARAM>(pResult), static_cast<LPARAM>(ms));
         }
@@ -572,7 +590,7 @@ LRESULT CVisionSimulatorDlg::OnPreviewResult(WPARAM wParam, LPARAM lParam)
     if (pOutput && pOutput->IsValid())
     {
         CAlgorithmBase* pAlg = m_paramPanel.GetAlgorithm();
-        CString algName = pAlg ? pAlg->GetName() : _T("?");
+        CString algName = pAlg ? pAlg->GetName().c_str() : _T("?");
 
         m_mainViewer.ClearOverlayInfo();
         m_mainViewer.SetImage(*pOutput);
@@ -614,12 +632,15 @@ void CVisionSimulatorDlg::AddLog(const CString& text)
 
 void CVisionSimulatorDlg::OnBnClickedLoad()
 {
-    CString filter = _T("Image Files (*.bmp;*.jpg;*.jpeg;*.png;*.tif;*.tiff)|*.bmp;*.jpg;*.jpeg;*.png;*.tif;*.tiff|All Files (*.*)|*.*||");
+    CString filter = _T("Image Files (*.bmp;*.jpg;*.jpeg;*.png;*.tif;*.tiff;*.qoi;*.pgm;*.ppm;*.vraw)|*.bmp;*.jpg;*.jpeg;*.png;*.tif;*.tiff;*.qoi;*.pgm;*.ppm;*.pnm;*.vraw|All Files (*.*)|*.*||");
     CFileDialog dlg(TRUE, NULL, NULL, OFN_HIDEREADONLY, filter, this);
     if (dlg.DoModal() == IDOK)
     {
-        if (m_originalImage.LoadFromFile(dlg.GetPathName()))
+        // Decode aside: a failed load releases its destination, and the old frame stays shown
+        CImageBuffer loaded;
+        if (loaded.LoadFromFile((LPCTSTR)dlg.GetPathName()))
         {
+            m_originalImage = std::move(loaded);
             m_mainViewer.ClearOverlayInfo();
             m_mainViewer.SetImage(m_originalImage);
             m_mainViewer.ClearROIs();
@@ -656,9 +677,10 @@ void CVisionSimulatorDlg::OnBnClickedRun()
     }
 
     // Sync ROIs to sequence manager
-    m_sequenceManager.SetROIs(m_mainViewer.GetROIs());
+    m_sequenceManager.SetROIs(ToImageRects(m_mainViewer.GetROIs()));
 
     m_nSelectedMiniViewer = -1;
+    m_nMiniViewerFrames = 0;
     for (int i = 0; i < 8; i++) m_miniViewers[i].SetSelected(false);
 
     m_mainViewer.ClearOverlayInfo();
@@ -673,6 +695,10 @@ void CVisionSimulatorDlg::OnBnClickedRun()
     logStart.Format(_T("=== 처리 시작 (총 %d 스텝) ==="), m_sequenceManager.GetStepCount());
     AddLog(logStart);
 
+    // The trace covers this run and the previews after it
+    if (CProfiler::GetInstance().IsEnabled())
+        CProfiler::GetInstance().Reset();
+
     m_sequenceManager.StartExecution(m_originalImage);
 }
 
@@ -701,16 +727,15 @@ void CVisionSimulatorDlg::OnBnClickedClear()
 
 void CVisionSimulatorDlg::OnBnClickedSave()
 {
-    CString filter = _T("PNG Files (*.png)|*.png|BMP Files (*.bmp)|*.bmp|JPEG Files (*.jpg)|*.jpg||");
+    CString filter = _T("PNG Files (*.png)|*.png|BMP Files (*.bmp)|*.bmp|JPEG Files (*.jpg)|*.jpg|QOI Files (*.qoi)|*.qoi|PGM/PPM Files (*.pnm)|*.pnm|Raw Frame (*.vraw)|*.vraw||");
     CFileDialog dlg(FALSE, _T("png"), _T("result"), OFN_OVERWRITEPROMPT, filter, this);
     if (dlg.DoModal() == IDOK)
     {
-        const auto& history = m_sequenceManager.GetHistory();
-        if (!history.empty())
+        const int histSize = m_sequenceManager.GetHistoryCount();
+        if (histSize > 0)
         {
             // History already contains composited image
-            CImageBuffer saveImage = history.back().Clone();
-            if (saveImage.SaveToFile(dlg.GetPathName()))
+            if (m_sequenceManager.GetHistoryFrame(histSize - 1).SaveToFile((LPCTSTR)dlg.GetPathName()))
                 SetStatus(_T("Saved: ") + dlg.GetFileName());
             else
                 MessageBox(_T("Failed to save image."), _T("Error"), MB_OK|MB_ICONERROR);
@@ -741,7 +766,7 @@ void CVisionSimulatorDlg::OnBnClickedRemoveROI()
     int sel = m_listROI.GetCurSel();
     if (sel == LB_ERR) return;
     m_mainViewer.RemoveROI(sel);
-    m_sequenceManager.SetROIs(m_mainViewer.GetROIs());
+    m_sequenceManager.SetROIs(ToImageRects(m_mainViewer.GetROIs()));
     UpdateROIList();
 }
 
@@ -752,6 +777,98 @@ void CVisionSimulatorDlg::OnBnClickedClearROIs()
     UpdateROIList();
 }
 
+void CVisionSimulatorDlg::OnBnClickedLoadRecipe()
+{
+    if (m_sequenceManager.IsRunning()) return;
+
+    CString filter = _T("Recipe Files (*.vrcp)|*.vrcp|Recipe Text (*.txt)|*.txt|All Files (*.*)|*.*||");
+    CFileDialog dlg(TRUE, NULL, NULL, OFN_HIDEREADONLY, filter, this);
+    if (dlg.DoModal() != IDOK) return;
+
+    CRecipe recipe;
+    // Buffers are sized for the loaded image, which may differ from the recipe's frame
+    if (!recipe.Load((LPCTSTR)dlg.GetPathName()) ||
+        !recipe.Apply(m_sequenceManager, m_originalImage.IsValid() ? &m_originalImage : nullptr))
+    {
+        MessageBox(_T("Failed to load recipe."), _T("Error"), MB_OK|MB_ICONERROR);
+        return;
+    }
+
+    m_mainViewer.ClearROIs();
+    for (const ImageRect& rc : recipe.GetROIs())
+        m_mainViewer.AddROI(CRect(rc.left, rc.top, rc.right, rc.bottom));
+    m_nEditingSequenceStep = -1;
+    m_paramPanel.SetAlgorithm(m_pCurrentAlgorithm);
+    UpdateSequenceList();
+    UpdateROIList();
+    m_btnRun.EnableWindow(m_originalImage.IsValid() && m_sequenceManager.GetStepCount() > 0);
+
+    AddLog(_T("레시피 로드: ") + dlg.GetFileName());
+    SetStatus(_T("Recipe loaded: ") + dlg.GetFileName());
+}
+
+void CVisionSimulatorDlg::OnBnClickedSaveRecipe()
+{
+    CString filter = _T("Recipe Files (*.vrcp)|*.vrcp|Recipe Text (*.txt)|*.txt||");
+    CFileDialog dlg(FALSE, _T("vrcp"), _T("recipe"), OFN_OVERWRITEPROMPT, filter, this);
+    if (dlg.DoModal() != IDOK) return;
+
+    m_sequenceManager.SetROIs(ToImageRects(m_mainViewer.GetROIs()));
+    CRecipe recipe;
+    recipe.Capture(m_sequenceManager);
+    recipe.SetFrame(m_originalImage);
+    if (recipe.Save((LPCTSTR)dlg.GetPathName()))
+        SetStatus(_T("Recipe saved: ") + dlg.GetFileName());
+    else
+        MessageBox(_T("Failed to save recipe."), _T("Error"), MB_OK|MB_ICONERROR);
+}
+
+void CVisionSimulatorDlg::OnBnClickedProfile()
+{
+    CProfiler& profiler = CProfiler::GetInstance();
+    const bool bEnable = !profiler.IsEnabled();
+    if (bEnable)
+        profiler.Reset();
+    profiler.SetEnabled(bEnable);
+    m_btnProfile.SetWindowText(bEnable ? _T("Profiling") : _T("Profile"));
+    SetStatus(bEnable ? _T("Profiling on | Each run restarts the trace; [Save Trace] exports it")
+                      : _T("Profiling off | [Save Trace] still exports the spans recorded so far"));
+}
+
+void CVisionSimulatorDlg::OnBnClickedSaveTrace()
+{
+    CString filter = _T("Chrome Trace (*.json)|*.json||");
+    CFileDialog dlg(FALSE, _T("json"), _T("trace"), OFN_OVERWRITEPROMPT, filter, this);
+    if (dlg.DoModal() != IDOK) return;
+
+    CProfiler& profiler = CProfiler::GetInstance();
+    if (!profiler.ExportChromeTrace((LPCTSTR)dlg.GetPathName()))
+    {
+        MessageBox(_T("Failed to save trace."), _T("Error"), MB_OK|MB_ICONERROR);
+        return;
+    }
+
+    // The same spans, aggregated, one log line per row
+    AddLog(_T("=== 프로파일 (chrome://tracing 에서 ") + dlg.GetFileName() + _T(" 열기) ==="));
+    const unsigned long long nDropped = profiler.GetDroppedCount();
+    if (nDropped > 0)
+    {
+        CString s;
+        s.Format(_T("스레드별 로그가 가득 차 구간 %llu개가 빠졌습니다"), nDropped);
+        AddLog(s);
+    }
+    const std::wstring table = Utf8ToWide(profiler.FormatStats());
+    size_t nStart = 0;
+    while (nStart < table.size())
+    {
+        size_t nEnd = table.find(L'\n', nStart);
+        if (nEnd == std::wstring::npos) nEnd = table.size();
+        AddLog(CString(table.substr(nStart, nEnd - nStart).c_str()));
+        nStart = nEnd + 1;
+    }
+    SetStatus(_T("Trace saved: ") + dlg.GetFileName());
+}
+
 void CVisionSimulatorDlg::OnBnClickedAddSeq()
 {
     // Always add a new clone of m_pCurrentAlgorithm
@@ -835,7 +952,7 @@ void CVisionSimulatorDlg::UpdateSequenceList()
     {
         CAlgorithmBase* pStep = m_sequenceManager.GetStep(i);
         CString text;
-        text.Format(_T("%d. %s"), i+1, (LPCTSTR)pStep->GetName());
+        text.Format(_T("%d. %s"), i+1, pStep->GetName().c_str());
 
         auto& params = pStep->GetParams();
         if (!params.empty())
@@ -852,7 +969,7 @@ void CVisionSimulatorDlg::UpdateSequenceList()
                     vs.Format(fmt, params[p].dCurrentVal);
                 }
                 if (p > 0) ps += _T(", ");
-                ps += params[p].strName + _T("=") + vs;
+                ps += CString(params[p].strName.c_str()) + _T("=") + vs;
             }
             text += _T(" (") + ps + _T(")");
         }
@@ -923,7 +1040,14 @@ LRESULT CVisionSimulatorDlg::OnMiniViewerClicked(WPARAM wParam, LPARAM lParam)
 
     if (m_miniViewers[nIndex].HasImage())
     {
-        m_mainViewer.SetImage(m_miniViewers[nIndex].GetImage());
+        // Mini viewers hold thumbnails only; the frame comes from the history (reloaded if evicted)
+        CImageBuffer frame = m_sequenceManager.GetHistoryFrame(nIndex);
+        if (!frame.IsValid())
+        {
+            SetStatus(_T("이 단계의 이미지를 다시 불러올 수 없습니다. 시퀀스를 다시 실행하세요."));
+            return 0;
+        }
+        m_mainViewer.SetImage(frame);
 
         // Build green overlay with applied algorithm + params
         CString overlayInfo;
@@ -937,7 +1061,7 @@ LRESULT CVisionSimulatorDlg::OnMiniViewerClicked(WPARAM wParam, LPARAM lParam)
             CAlgorithmBase* pStep = m_sequenceManager.GetStep(stepIdx);
             if (pStep)
             {
-                overlayInfo = pStep->GetName();
+                overlayInfo = pStep->GetName().c_str();
                 auto& params = pStep->GetParams();
                 for (int p = 0; p < (int)params.size(); p++)
                 {
@@ -946,7 +1070,7 @@ LRESULT CVisionSimulatorDlg::OnMiniViewerClicked(WPARAM wParam, LPARAM lParam)
                     {
                         int iVal = (int)params[p].dCurrentVal;
                         if (iVal >= 0 && iVal < (int)params[p].vecOptions.size())
-                            pval = params[p].vecOptions[iVal];
+                            pval = params[p].vecOptions[iVal].c_str();
                         else
                             pval.Format(_T("%d"), iVal);
                     }
@@ -958,7 +1082,7 @@ LRESULT CVisionSimulatorDlg::OnMiniViewerClicked(WPARAM wParam, LPARAM lParam)
                         fmt.Format(_T("%%.%df"), params[p].nPrecision);
                         pval.Format(fmt, params[p].dCurrentVal);
                     }
-                    overlayInfo += _T("\n") + params[p].strName + _T(": ") + pval;
+                    overlayInfo += _T("\n") + CString(params[p].strName.c_str()) + _T(": ") + pval;
                 }
             }
         }
@@ -973,79 +1097,125 @@ LRESULT CVisionSimulatorDlg::OnMiniViewerClicked(WPARAM wParam, LPARAM lParam)
 // Sequence execution message handlers
 // ---------------------------------------------------------------------------
 
-LRESULT CVisionSimulatorDlg::OnSequenceStepDone(WPARAM wParam, LPARAM lParam)
+LRESULT CVisionSimulatorDlg::OnSequenceEvents(WPARAM wParam, LPARAM lParam)
 {
-    int stepIdx   = (int)wParam;
-    long long elapsedMs = (long long)lParam;
+    m_sequenceEvents.Drain(*this);
+
+    // Progress lost while the UI thread was not draining; the run's end is never among it
+    const unsigned long long nDropped = m_sequenceEvents.GetDroppedCount();
+    if (nDropped > m_nEventDropsLogged)
+    {
+        CString s;
+        s.Format(_T("이벤트 큐가 가득 차 진행 이벤트 %llu개가 빠졌습니다"), nDropped - m_nEventDropsLogged);
+        AddLog(s);
+        m_nEventDropsLogged = nDropped;
+    }
+    return 0;
+}
+
+void CVisionSimulatorDlg::OnSequenceEvent(const SequenceEventRecord& evt)
+{
+    switch (evt.eType)
+    {
+    case SequenceEvent::Progress:   OnSequenceProgress(evt); break;
+    case SequenceEvent::StepProgress: OnSequenceStepProgress(evt); break;
+    case SequenceEvent::StepDone:
+    case SequenceEvent::StepReused: OnSequenceStepDone(evt); break;
+    case SequenceEvent::Complete:   OnSequenceComplete(evt); break;
+    case SequenceEvent::Error:      OnSequenceError(evt);    break;
+    case SequenceEvent::Stopped:    OnSequenceStopped(evt);  break;
+    case SequenceEvent::TileDone:   break;   // the dialog runs full frames only
+    }
+}
+
+void CVisionSimulatorDlg::OnSequenceStepDone(const SequenceEventRecord& evt)
+{
+    const int stepIdx = evt.nIndex;
 
     UpdateMiniViewers();
-    const auto& history = m_sequenceManager.GetHistory();
-    if (!history.empty())
+    const int histSize = m_sequenceManager.GetHistoryCount();
+    if (histSize > 0)
     {
         m_mainViewer.ClearOverlayInfo();
-        m_mainViewer.SetImage(history.back());
+        m_mainViewer.SetImage(m_sequenceManager.GetHistoryFrame(histSize - 1));
     }
 
     // Log step completion with timing
     CAlgorithmBase* pStep = m_sequenceManager.GetStep(stepIdx);
-    CString algName = pStep ? pStep->GetName() : _T("Unknown");
+    CString algName = pStep ? pStep->GetName().c_str() : _T("Unknown");
     CString s;
-    s.Format(_T("[완료] 스텝 %d - %s (%lldms)"), stepIdx + 1, (LPCTSTR)algName, elapsedMs);
+    if (evt.eType == SequenceEvent::StepReused)   // output unchanged since the previous run
+        s.Format(_T("[재사용] 스텝 %d - %s"), stepIdx + 1, (LPCTSTR)algName);
+    else
+        s.Format(_T("[완료] 스텝 %d - %s (%.1fms)"), stepIdx + 1, (LPCTSTR)algName, evt.nElapsedUs / 1000.0);
     AddLog(s);
-
-    return 0;
 }
 
-LRESULT CVisionSimulatorDlg::OnSequenceProgress(WPARAM wParam, LPARAM lParam)
+void CVisionSimulatorDlg::OnSequenceProgress(const SequenceEventRecord& evt)
 {
-    int stepNum   = (int)wParam;
-    int stepTotal = (int)lParam;
+    int stepNum   = evt.nIndex + 1;
+    int stepTotal = evt.nCount;
 
     CString s;
     s.Format(_T("[스텝 %d/%d] 처리 중..."), stepNum, stepTotal);
     SetStatus(s);
 
     // Log step start with algorithm name
-    CAlgorithmBase* pStep = m_sequenceManager.GetStep(stepNum - 1);
-    CString algName = pStep ? pStep->GetName() : _T("Unknown");
+    CAlgorithmBase* pStep = m_sequenceManager.GetStep(evt.nIndex);
+    CString algName = pStep ? pStep->GetName().c_str() : _T("Unknown");
     CString logMsg;
     logMsg.Format(_T("[시작] 스텝 %d/%d - %s"), stepNum, stepTotal, (LPCTSTR)algName);
     AddLog(logMsg);
+}
 
-    return 0;
+void CVisionSimulatorDlg::OnSequenceStepProgress(const SequenceEventRecord& evt)
+{
+    // Status bar only; the log keeps one line per step
+    CString s;
+    s.Format(_T("[스텝 %d/%d] 처리 중... %d%%"), evt.nIndex + 1, evt.nCount, evt.nPermille / 10);
+    SetStatus(s);
 }
 
-LRESULT CVisionSimulatorDlg::OnSequenceComplete(WPARAM wParam, LPARAM lParam)
+void CVisionSimulatorDlg::OnSequenceComplete(const SequenceEventRecord& evt)
 {
     m_btnRun.EnableWindow(TRUE);
     m_btnStop.EnableWindow(FALSE);
     m_btnSave.EnableWindow(TRUE);
 
-    const auto& history = m_sequenceManager.GetHistory();
-    if (!history.empty())
+    const int histSize = m_sequenceManager.GetHistoryCount();
+    if (histSize > 0)
     {
         m_mainViewer.ClearOverlayInfo();
-        m_mainViewer.SetImage(history.back());
+        m_mainViewer.SetImage(m_sequenceManager.GetHistoryFrame(histSize - 1));
     }
 
     UpdateMiniViewers();
     SetStatus(_T("처리 완료!"));
-    AddLog(_T("=== 모든 처리 완료 ==="));
-    return 0;
+    CString s;
+    s.Format(_T("=== 모든 처리 완료 (%.1fms) ==="), evt.nTimeUs / 1000.0);
+    AddLog(s);
 }
 
-LRESULT CVisionSimulatorDlg::OnSequenceError(WPARAM wParam, LPARAM lParam)
+void CVisionSimulatorDlg::OnSequenceError(const SequenceEventRecord& evt)
 {
-    CString* pMsg = reinterpret_cast<CString*>(lParam);
-    CString errText = pMsg ? *pMsg : _T("Unknown error");
+    // The event names the failed step; the reason is in the core log
+    CAlgorithmBase* pStep = m_sequenceManager.GetStep(evt.nIndex);
+    CString algName = pStep ? pStep->GetName().c_str() : _T("Unknown");
+    CString errText;
+    errText.Format(_T("스텝 %d (%s) 처리 실패"), evt.nIndex + 1, (LPCTSTR)algName);
     SetStatus(_T("오류: ") + errText);
     m_btnRun.EnableWindow(TRUE);
     m_btnStop.EnableWindow(FALSE);
-    CString logErr;
-    logErr.Format(_T("[오류] 스텝 %d 처리 실패"), (int)wParam + 1);
-    AddLog(logErr);
+    AddLog(_T("[오류] ") + errText);
     MessageBox(errText, _T("Processing Error"), MB_OK|MB_ICONERROR);
-    return 0;
+}
+
+void CVisionSimulatorDlg::OnSequenceStopped(const SequenceEventRecord& evt)
+{
+    // OnBnClickedStop has already reset the buttons
+    CString s;
+    s.Format(_T("[중지] %.1fms 후 중지됨"), evt.nTimeUs / 1000.0);
+    AddLog(s);
 }
 
 // ---------------------------------------------------------------------------
@@ -1054,20 +1224,22 @@ LRESULT CVisionSimulatorDlg::OnSequenceError(WPARAM wParam, LPARAM lParam)
 
 void CVisionSimulatorDlg::UpdateMiniViewers()
 {
-    const auto& history = m_sequenceManager.GetHistory();
-    int histSize = (int)history.size();
+    int histSize = m_sequenceManager.GetHistoryCount();
 
     for (int i = 0; i < 8; i++)
     {
         if (i < histSize)
         {
-            m_miniViewers[i].SetImage(history[i]);
+            // Each frame is thumbnailed once per run, while it is still the newest and resident;
+            // touching older frames here would reload frames the budget has evicted
+            if (i >= m_nMiniViewerFrames)
+                m_miniViewers[i].SetImage(m_sequenceManager.GetHistoryFrame(i));
 
             CString label;
             if (i == 0)
                 label = _T("Original");
             else if (i - 1 < m_sequenceManager.GetStepCount())
-                label = m_sequenceManager.GetStep(i - 1)->GetName();
+                label = m_sequenceManager.GetStep(i - 1)->GetName().c_str();
             else
                 label.Format(_T("Step %d"), i);
 
@@ -1080,11 +1252,13 @@ void CVisionSimulatorDlg::UpdateMiniViewers()
             m_miniLabels[i].SetWindowText(_T(""));
         }
     }
+    m_nMiniViewerFrames = min(histSize, 8);
 }
 
 void CVisionSimulatorDlg::ClearMiniViewers()
 {
     m_nSelectedMiniViewer = -1;
+    m_nMiniViewerFrames = 0;
     for (int i = 0; i < 8; i++)
     {
         m_miniViewers[i].Clear();
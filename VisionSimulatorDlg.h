@@ -7,9 +7,10 @@
 #include "Core/SequenceManager.h"
 #include "Algorithm/AlgorithmManager.h"
 #include "Utils/CommonTypes.h"
+#include <atomic>
 #include <chrono>
 
-class CVisionSimulatorDlg : public CDialogEx {
+class CVisionSimulatorDlg : public CDialogEx, private ISequenceObserver {
     DECLARE_DYNAMIC(CVisionSimulatorDlg)
 public:
     CVisionSimulatorDlg(CWnd* pParent = nullptr);
@@ -43,6 +44,10 @@ protected:
     afx_msg void OnBnClickedClearROI();
     afx_msg void OnBnClickedRemoveROI();
     afx_msg void OnBnClickedClearROIs();
+    afx_msg void OnBnClickedLoadRecipe();
+    afx_msg void OnBnClickedSaveRecipe();
+    afx_msg void OnBnClickedProfile();
+    afx_msg void OnBnClickedSaveTrace();
 
     // Combo/List handlers
     afx_msg void OnCbnSelchangeAlgorithm();
@@ -50,10 +55,7 @@ protected:
     afx_msg void OnLbnSelchangeROI();
 
     // Custom messages
-    afx_msg LRESULT OnSequenceProgress(WPARAM wParam, LPARAM lParam);
-    afx_msg LRESULT OnSequenceComplete(WPARAM wParam, LPARAM lParam);
-    afx_msg LRESULT OnSequenceError(WPARAM wParam, LPARAM lParam);
-    afx_msg LRESULT OnSequenceStepDone(WPARAM wParam, LPARAM lParam);
+    afx_msg LRESULT OnSequenceEvents(WPARAM wParam, LPARAM lParam);
     afx_msg LRESULT OnMiniViewerClicked(WPARAM wParam, LPARAM lParam);
     afx_msg LRESULT OnROIUpdated(WPARAM wParam, LPARAM lParam);
     afx_msg LRESULT OnParamChanged(WPARAM wParam, LPARAM lParam);
@@ -84,6 +86,8 @@ private:
     // Toolbar buttons
     CButton m_btnLoad, m_btnRun, m_btnStop, m_btnClear, m_btnSave, m_btnFit;
     CButton m_btnROI, m_btnClearROI;
+    CButton m_btnLoadRecipe, m_btnSaveRecipe;
+    CButton m_btnProfile, m_btnSaveTrace;
 
     // Status / zoom
     CStatic m_staticStatus;
@@ -96,9 +100,21 @@ private:
     // Group boxes
     CStatic m_grpAlgorithm, m_grpSequence, m_grpROI, m_grpHistory;
 
-    // Core
-    CImageBuffer    m_originalImage;
-    CSequenceManager m_sequenceManager;
+    // Core. Run events reach the UI thread through m_sequenceEvents, which must outlive the
+    // manager's worker thread.
+    CImageBuffer        m_originalImage;
+    CSequenceEventQueue m_sequenceEvents;
+    CSequenceManager    m_sequenceManager;
+    unsigned long long  m_nEventDropsLogged;   // m_sequenceEvents drops already in the log
+
+    // Sequence events, drained from m_sequenceEvents on the UI thread
+    void OnSequenceEvent(const SequenceEventRecord& evt) override;
+    void OnSequenceProgress(const SequenceEventRecord& evt);
+    void OnSequenceStepProgress(const SequenceEventRecord& evt);
+    void OnSequenceStepDone(const SequenceEventRecord& evt);
+    void OnSequenceComplete(const SequenceEventRecord& evt);
+    void OnSequenceError(const SequenceEventRecord& evt);
+    void OnSequenceStopped(const SequenceEventRecord& evt);
 
     // Current algorithm for editing (new, from combo)
     CAlgorithmBase* m_pCurrentAlgorithm;
@@ -108,6 +124,7 @@ private:
 
     // Mini viewer state
     int m_nSelectedMiniViewer;
+    int m_nMiniViewerFrames;     // history frames of the current run already thumbnailed
 
     // Layout helpers
     void LayoutControls();
@@ -134,12 +151,12 @@ private:
     CWinThread*      m_pPreviewThread;
     HANDLE           m_hPreviewReady;    // auto-reset: signals thread to wake
     HANDLE           m_hPreviewStop;     // manual-reset: signals thread to exit
-    volatile bool    m_bPreviewCancel;   // cancel current in-progress preview
+    std::atomic<bool> m_bPreviewCancel;   // cancel current in-progress preview
     volatile bool    m_bNewPreviewPending; // another preview queued while thread runs
     CCriticalSection m_csPreview;
     CImageBuffer     m_previewInputBuf;
     CAlgorithmBase*  m_pPreviewAlgCopy;  // cloned algo for thread (thread owns it)
-    std::vector<CRect> m_previewROIs;
+    std::vector<ImageRect> m_previewROIs;
 
     static UINT PreviewThreadProc(LPVOID pParam);
     void  StartPreviewThread();
@@ -85,6 +85,14 @@
 #define IDC_GRP_LOG                 1096
 #define IDC_EDIT_LOG                1097
 
+// Recipe buttons
+#define IDC_BTN_LOAD_RECIPE         1098
+#define IDC_BTN_SAVE_RECIPE         1099
+
+// Profiler toggle and trace export
+#define IDC_BTN_SAVE_TRACE          1100
+#define IDC_BTN_PROFILE             1101
+
 // Preview timer
 #define TIMER_PREVIEW               1
 